@@ -71,6 +71,72 @@ struct PosNormalTexCoordVertex {
 	}
 };
 
+// the layouts of Engine::Ressources::Mesh::VertexFormat::Quantized (see VertexQuantization), for the Quantized vertex shaders
+struct QuantizedPosNormalVertex {
+	uint16_t pos[4]; // unorm in the bounds of the mesh, the 4th is padding
+	int16_t normal[2]; // octahedral
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = sizeof(QuantizedPosNormalVertex);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributeDescriptions[0].offset = offsetof(QuantizedPosNormalVertex, pos);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset = offsetof(QuantizedPosNormalVertex, normal);
+
+		return attributeDescriptions;
+	}
+};
+
+struct QuantizedPosNormalTexCoordVertex {
+	uint16_t pos[4];
+	int16_t normal[2];
+	uint16_t texCoord[2]; // half floats
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = sizeof(QuantizedPosNormalTexCoordVertex);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributeDescriptions[0].offset = offsetof(QuantizedPosNormalTexCoordVertex, pos);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset = offsetof(QuantizedPosNormalTexCoordVertex, normal);
+
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[2].offset = offsetof(QuantizedPosNormalTexCoordVertex, texCoord);
+
+		return attributeDescriptions;
+	}
+};
+
 struct blinnPhongColor {
 	//alignas(16) glm::vec3 diffuse;
 	glm::vec3 diffuse;
@@ -2,7 +2,10 @@
 #include "../Components/CameraMovement.h"
 #include "../Components/BoxMovement.h"
 #include "../Materials/defaultMaterial.h"
+#include <glm/gtc/constants.hpp>
+#include <cmath>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Game {
@@ -127,16 +130,26 @@ const std::vector<uint32_t> indices = {
 
 
 void MainScene::initObject(){
-    auto blinnPhongColorPipelineConfig = Engine::Ressources::PipelineConfigInfo::defaultPipelineConfigInfo("shaders/GameEngineCore/blinnPhongVertColor.glsl.spv", "shaders/GameEngineCore/blinnPhongFragColor.glsl.spv", Material::PosNormalVertex::getBindingDescription(), Material::PosNormalVertex::getAttributeDescriptions());
-    auto blinnPhongTexPipelineConfig = Engine::Ressources::PipelineConfigInfo::defaultPipelineConfigInfo("shaders/GameEngineCore/blinnPhongVertText.glsl.spv", "shaders/GameEngineCore/blinnPhongFragText.glsl.spv", Material::PosNormalTexCoordVertex::getBindingDescription(), Material::PosNormalTexCoordVertex::getAttributeDescriptions());
-    auto blinnPhongColorPipeline = std::make_unique<Engine::Ressources::Pipeline>(blinnPhongColorPipelineConfig);
-    auto blinnPhongTexPipeline = std::make_unique<Engine::Ressources::Pipeline>(blinnPhongTexPipelineConfig);
+    // with descriptor indexing all the materials are in the MaterialTable, they don't break the batches
+    bool bindless = Engine::Ressources::MaterialTable::IsEnabled();
+    std::string colorFragShader = bindless ? "shaders/GameEngineCore/blinnPhongFragColorBindless.glsl.spv" : "shaders/GameEngineCore/blinnPhongFragColor.glsl.spv";
+    std::string texFragShader = bindless ? "shaders/GameEngineCore/blinnPhongFragTextBindless.glsl.spv" : "shaders/GameEngineCore/blinnPhongFragText.glsl.spv";
+
+    // the meshes are uploaded with Mesh::VertexFormat::Quantized, half the size of the float vertices
+    auto blinnPhongColorPipelineConfig = Engine::Ressources::PipelineConfigInfo::defaultPipelineConfigInfo("shaders/GameEngineCore/blinnPhongVertColorQuantized.glsl.spv", colorFragShader, Material::QuantizedPosNormalVertex::getBindingDescription(), Material::QuantizedPosNormalVertex::getAttributeDescriptions());
+    auto blinnPhongTexPipelineConfig = Engine::Ressources::PipelineConfigInfo::defaultPipelineConfigInfo("shaders/GameEngineCore/blinnPhongVertTextQuantized.glsl.spv", texFragShader, Material::QuantizedPosNormalTexCoordVertex::getBindingDescription(), Material::QuantizedPosNormalTexCoordVertex::getAttributeDescriptions());
+    blinnPhongColorPipelineConfig.bindless = bindless;
+    blinnPhongTexPipelineConfig.bindless = bindless;
+    // built on the worker threads while the rest of the scene loads
+    auto& pipelineBuilder = Engine::Ressources::PipelineBuilder::Instance();
+    auto blinnPhongColorPipeline = pipelineBuilder.build(blinnPhongColorPipelineConfig);
+    auto blinnPhongTexPipeline = pipelineBuilder.build(blinnPhongTexPipelineConfig);
 
     auto& ressourceManager = Engine::Ressources::RessourceManager::getInstance();
 
 
-    auto blinnPhongColorTemplate = std::make_shared<Engine::Ressources::MaterialTemplate>(std::move(blinnPhongColorPipeline));
-    auto blinnPhongTexTemplate = std::make_shared<Engine::Ressources::MaterialTemplate>(std::move(blinnPhongTexPipeline));
+    auto blinnPhongColorTemplate = std::make_shared<Engine::Ressources::MaterialTemplate>(blinnPhongColorPipeline);
+    auto blinnPhongTexTemplate = std::make_shared<Engine::Ressources::MaterialTemplate>(blinnPhongTexPipeline);
     ressourceManager.loadMaterialTemplate("blinnPhongColor", blinnPhongColorTemplate);
     ressourceManager.loadMaterialTemplate("blinnPhongTexture", blinnPhongTexTemplate);
 
@@ -156,11 +169,10 @@ void MainScene::initObject(){
     mat2->updateData(&defaultMat2);
 
 
-    auto woodTextureInfo = Engine::Ressources::Texture::TextureCreateInfo::getDefault("Assets/Game/wood.jpg");
-    auto woodTexture = std::make_shared<Engine::Ressources::Texture>(woodTextureInfo);
+    // decoded on the workers, drawn with a placeholder then its small mips until it's streamed in
+    auto woodTexture = Engine::Ressources::TextureStreamer::Instance().load("Assets/Game/wood.jpg");
     ressourceManager.loadTexture("wood", woodTexture);
-    std::vector<VkDescriptorImageInfo> imageInfo = {woodTexture->createDescriptorImageInfo()};
-    auto mat3 = std::make_shared<Engine::Ressources::Material>(blinnPhongTexTemplate, sizeof(Material::blinnPhongText), &imageInfo);
+    auto mat3 = std::make_shared<Engine::Ressources::Material>(blinnPhongTexTemplate, sizeof(Material::blinnPhongText), std::vector<std::shared_ptr<Engine::Ressources::Texture>>{woodTexture});
     ressourceManager.loadMaterial("mat 3", mat3);
     auto matStruct3 = Material::blinnPhongText();
     matStruct3.shininess = 1.0;
@@ -173,6 +185,7 @@ void MainScene::initObject(){
     cubeTexMesh->setOrCreateChannelAndCopyData("normals", (void*)normals.data(), sizeof(normals[0]), normals.size());
     cubeTexMesh->setOrCreateChannelAndCopyData("texture coord", (void*)texCoords.data(), sizeof(texCoords[0]), texCoords.size());
     cubeTexMesh->setIndices(std::vector(indices));
+    cubeTexMesh->setVertexFormat(Engine::Ressources::Mesh::VertexFormat::Quantized);
     cubeTexMesh->uploadDataToGpu();
     cubeTexMesh->removeDataFromCpu();
 
@@ -181,6 +194,7 @@ void MainScene::initObject(){
     cubeMesh->setOrCreateChannelAndCopyData("positions", (void*)positions.data(), sizeof(positions[0]), positions.size());
     cubeMesh->setOrCreateChannelAndCopyData("normals", (void*)normals.data(), sizeof(normals[0]), normals.size());
     cubeMesh->setIndices(indices);
+    cubeMesh->setVertexFormat(Engine::Ressources::Mesh::VertexFormat::Quantized);
     cubeMesh->uploadDataToGpu();
     cubeMesh->removeDataFromCpu();
     ressourceManager.loadMesh("cubeTexMesh", cubeTexMesh);
@@ -190,16 +204,15 @@ void MainScene::initObject(){
     {
         model->loadObj("Assets/Game/model.obj");
         LogDebug("finish loading model");
+        model->setVertexFormat(Engine::Ressources::Mesh::VertexFormat::Quantized);
         model->uploadDataToGpu();
         model->removeDataFromCpu();
         ressourceManager.loadMesh("model", model);
     }
 
-    auto modelTextureInfo = Engine::Ressources::Texture::TextureCreateInfo::getDefault("Assets/Game/modelTexture.png");
-    auto modelTexture = std::make_shared<Engine::Ressources::Texture>(modelTextureInfo);
+    auto modelTexture = Engine::Ressources::TextureStreamer::Instance().load("Assets/Game/modelTexture.png");
     ressourceManager.loadTexture("model Texture", modelTexture);
-    std::vector<VkDescriptorImageInfo> modelImageiNfo = {modelTexture->createDescriptorImageInfo()};
-    auto modelMat = std::make_shared<Engine::Ressources::Material>(blinnPhongTexTemplate, sizeof(Material::blinnPhongText), &modelImageiNfo);
+    auto modelMat = std::make_shared<Engine::Ressources::Material>(blinnPhongTexTemplate, sizeof(Material::blinnPhongText), std::vector<std::shared_ptr<Engine::Ressources::Texture>>{modelTexture});
     ressourceManager.loadMaterial("model mat", modelMat);
     auto modelMatStruct = Material::blinnPhongText();
     modelMatStruct.shininess = 1.0;
@@ -257,6 +270,16 @@ void MainScene::initObject(){
         entity.addComponent<Engine::Components::CubeCollider>();
     }
 
+    // same mesh and material, one instanced draw (the headless tests check it on both culling paths)
+    const uint32_t crateCount = 16;
+    for (uint32_t i = 0; i < crateCount; i++) {
+        auto& entity = addEntity("crate " + std::to_string(i));
+        auto& transform = entity.addComponent<Engine::Components::Transform>();
+        float angle = glm::two_pi<float>() * i / crateCount;
+        transform.position = {12.0f * std::cos(angle), -2.45f, 12.0f * std::sin(angle)};
+        entity.addComponent<Engine::Components::MeshRenderer>(mat2, cubeMesh);
+    }
+
     //TODO: make prefab work
 
     /*{*/
@@ -0,0 +1,96 @@
+// checks the frames written by Game --headless --capture : something was drawn over the clear color, and when a second
+// capture is given both are the same image but for a few pixels (the cpu and gpu culling paths must draw the same scene)
+//   CaptureCheck frame.png [other.png]
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <cstdlib>
+#include <iostream>
+
+// a pixel differs when one of its channels is further than that
+static constexpr int CHANNEL_TOLERANCE = 16;
+// the pixels that differ from the first one, at least
+static constexpr double MIN_DRAWN_RATIO = 0.01;
+// the pixels that differ between the two captures (the streamed textures can be a level apart), at most
+static constexpr double MAX_DIFFERENT_RATIO = 0.01;
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    stbi_uc* pixels = nullptr;
+
+    ~Image() { stbi_image_free(pixels); };
+    const stbi_uc* at(int i) const { return pixels + i * 4; };
+};
+
+static bool load(const char* path, Image& image) {
+    int channels = 0;
+    image.pixels = stbi_load(path, &image.width, &image.height, &channels, 4);
+    if (!image.pixels) {
+        std::cerr << "failed to read " << path << " : " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool differs(const stbi_uc* a, const stbi_uc* b) {
+    for (int c = 0; c < 3; c++) {
+        if (std::abs(a[c] - b[c]) > CHANNEL_TOLERANCE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// a frame where nothing was drawn is the clear color everywhere
+static bool checkDrawn(const char* path, const Image& image) {
+    int pixelCount = image.width * image.height;
+    int drawn = 0;
+    for (int i = 0; i < pixelCount; i++) {
+        drawn += differs(image.at(i), image.at(0));
+    }
+    double ratio = (double)drawn / pixelCount;
+    std::cout << path << " : " << image.width << "x" << image.height << ", " << ratio * 100.0 << "% drawn" << std::endl;
+    if (ratio < MIN_DRAWN_RATIO) {
+        std::cerr << path << " is empty" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool checkSame(const Image& image, const Image& other) {
+    if (image.width != other.width || image.height != other.height) {
+        std::cerr << "the captures don't have the same size" << std::endl;
+        return false;
+    }
+    int pixelCount = image.width * image.height;
+    int different = 0;
+    for (int i = 0; i < pixelCount; i++) {
+        different += differs(image.at(i), other.at(i));
+    }
+    double ratio = (double)different / pixelCount;
+    std::cout << ratio * 100.0 << "% of the pixels differ" << std::endl;
+    if (ratio > MAX_DIFFERENT_RATIO) {
+        std::cerr << "the captures differ" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage : CaptureCheck frame.png [other.png]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Image image;
+    if (!load(argv[1], image) || !checkDrawn(argv[1], image)) {
+        return EXIT_FAILURE;
+    }
+    if (argc == 3) {
+        Image other;
+        if (!load(argv[2], other) || !checkDrawn(argv[2], other) || !checkSame(image, other)) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
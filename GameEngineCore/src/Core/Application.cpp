@@ -1,54 +1,131 @@
 #include "Application.h"
 #include "Renderer/DefaultRenderer.h"
 #include "Renderer/VulkanApi.h"
+#include "Renderer/PipelineCache.h"
 #include "Ressources/RessourceManager.h"
 #include "Ressources/DescriptorsManager.h"
+#include "Ressources/PipelineBuilder.h"
+#include "Ressources/MaterialTable.h"
+#include "Ressources/GeometryPool.h"
+#include "Ressources/StagingRing.h"
+#include "Ressources/MemoryAllocator.h"
+#include "Ressources/TextureStreamer.h"
+#include "Utils/Profiler.h"
 #include "Scene/Components/Renderer.h"
 #include "Input.h"
+#include <chrono>
 #include <iostream>
 #include "Collisions/Collisions.h"
 #include "Log/Log.h"
 
 namespace Engine {
 
-Application::Application(createInfo& createInfo)
-: Application(createInfo.title, createInfo.width, createInfo.height, createInfo.defaultScene, createInfo.maxDeltaTime)
+Application::Application(const char* title, uint32_t width, uint32_t height, Engine::Scene* defaultScene, float maxDeltaTime, bool headless)
+: Application(createInfo{title, width, height, defaultScene, maxDeltaTime, headless})
 {
 };
 
-Application::Application(const char* title, uint32_t width, uint32_t height, Engine::Scene* defaultScene, float maxDeltaTime)
-: m_window(title, width, height), m_maxDeltaTime(maxDeltaTime)
+Application::Application(const createInfo& createInfo)
+: m_window(createInfo.title, createInfo.width, createInfo.height, createInfo.headless), m_maxDeltaTime(createInfo.maxDeltaTime)
 {
+    m_frameCount = createInfo.frameCount;
+    m_headlessDeltaTime = createInfo.headlessDeltaTime;
+    m_capturePath = createInfo.capturePath;
+    m_tracePath = createInfo.tracePath;
+    m_traceFrames = createInfo.traceFrames;
+
+    auto startupStart = std::chrono::steady_clock::now();
+
+    if (createInfo.clearCaches) {
+        Engine::Renderer::VulkanApi::ClearPipelineCache();
+    }
+
+    // before the renderer, it makes its gpu profiler only when this one is there
+    Engine::Utils::Profiler::Init();
     Engine::Renderer::VulkanApi::Init(m_window);
+    Engine::Ressources::MemoryAllocator::Init();
+    Engine::Ressources::StagingRing::Init();
+    Engine::Ressources::GeometryPool::Init();
     Engine::Ressources::RessourceManager::Init();
+    Engine::Ressources::TextureStreamer::Init();
     Engine::Ressources::DescriptorBuilder::Init();
-    m_renderer = new Engine::Renderer::DefaultRenderer();
-    
-    // Set up the model buffer allocator and deallocator
-    Engine::Components::Renderer::SetModelBufferAllocator([this]() {
-        return static_cast<Engine::Renderer::DefaultRenderer*>(m_renderer)->allocateModelBufferIndex();
-    });
-    
-    Engine::Components::Renderer::SetModelBufferDeallocator([this](uint32_t index) {
-        static_cast<Engine::Renderer::DefaultRenderer*>(m_renderer)->deallocateModelBufferIndex(index);
-    });
-    
-    m_scene = defaultScene;
+    // the materials of the bindless pipelines, before the scene makes them
+    if (Engine::Renderer::VulkanApi::Instance().supportsBindless()) {
+        Engine::Ressources::MaterialTable::Init();
+    }
+    Engine::Ressources::PipelineBuilder::Init();
+    m_renderer = new Engine::Renderer::DefaultRenderer(createInfo.cullingMode);
+
+    m_scene = createInfo.defaultScene;
     m_scene->initialize();
+    if (createInfo.startupReport) {
+        Engine::Ressources::PipelineBuilder::Instance().waitAll();
+    }
+
+    // compare a first launch (cold) with the next ones (warm), the pipelines still building in PipelineBuilder aren't
+    // counted unless startupReport waited for them
+    double startupMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+    Engine::Renderer::PipelineCache::Stats cacheStats = Engine::Renderer::VulkanApi::Instance().getPipelineCache().getStats();
+    LogInfo("startup took ", startupMilliseconds, " ms (", cacheStats.warm ? "warm" : "cold", " pipeline cache), ",
+        cacheStats.pipelines, " pipelines created in ", cacheStats.pipelineMilliseconds, " ms, ",
+        cacheStats.reflectionHits, " shaders reflection cached, ", cacheStats.reflectionMisses, " reflected");
+    if (createInfo.startupReport) {
+        std::cout << "startup " << startupMilliseconds << " ms " << (cacheStats.warm ? "warm" : "cold") << ", "
+                  << cacheStats.pipelines << " pipelines in " << cacheStats.pipelineMilliseconds << " ms, "
+                  << cacheStats.reflectionHits << " reflection hits, " << cacheStats.reflectionMisses << " misses" << std::endl;
+    }
 }
 
 Application::~Application()
 {
+    // the pipelines still building use the descriptor layouts and the device
+    Engine::Ressources::PipelineBuilder::Shutdown();
     delete m_scene;
     Engine::Ressources::DescriptorBuilder::DestroyAll();
     Engine::Ressources::RessourceManager::Shutdown();
+    // after the materials, the files still decoding are waited on
+    Engine::Ressources::TextureStreamer::Shutdown();
+    // after the materials, they give back their slot
+    Engine::Ressources::MaterialTable::Shutdown();
+    Engine::Ressources::GeometryPool::Shutdown();
     delete m_renderer;
+    Engine::Ressources::StagingRing::Shutdown();
+    Engine::Ressources::MemoryAllocator::Shutdown();
     Engine::Renderer::VulkanApi::Shutdown();
+    Engine::Utils::Profiler::Shutdown();
+}
+
+// one frame of the scene, the same windowed and headless
+void Application::runFrame(float dt)
+{
+    Engine::Utils::Profiler::Instance().beginFrame();
+
+    {
+        Engine::Utils::Profiler::Scope profilerScope("update");
+        m_scene->updateComponents(dt);
+    }
+    {
+        Engine::Utils::Profiler::Scope profilerScope("collisions");
+        Engine::Collisions::ManageCollision(*m_scene, dt);
+    }
+    {
+        Engine::Utils::Profiler::Scope profilerScope("render");
+        m_renderer->render(*m_scene);
+    }
 }
 
 
 void Application::Run()
 {
+    if (m_tracePath) {
+        Engine::Utils::Profiler::Instance().captureTrace(m_tracePath, m_traceFrames);
+    }
+
+    if (m_window.isHeadless()) {
+        runHeadless();
+        return;
+    }
+
     float lastTime = 0.0f;
     while (m_running && !m_window.shouldClose())
     {
@@ -60,11 +137,7 @@ void Application::Run()
 
         lastTime = currentTime;
 
-        m_scene->updateComponents(dt);
-
-        Engine::Collisions::ManageCollision(*m_scene, dt);
-
-        m_renderer->render(*m_scene);
+        runFrame(dt);
 
         m_window.pollEvents();
         Engine::Input::Instance().Update();
@@ -73,6 +146,27 @@ void Application::Run()
     Engine::Renderer::VulkanApi::Instance().deviceWaitIdle();
 }
 
+void Application::runHeadless()
+{
+    // fixed delta time so the same frame count gives the same image
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < m_frameCount && m_running; i++) {
+        runFrame(m_headlessDeltaTime);
+    }
+
+    Engine::Renderer::VulkanApi::Instance().deviceWaitIdle();
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LogInfo("rendered ", m_frameCount, " headless frames in ", milliseconds, " ms (",
+        m_frameCount ? milliseconds / m_frameCount : 0.0, " ms per frame)");
+    Engine::Utils::Profiler::Instance().logAverages();
+
+    if (m_capturePath && m_frameCount > 0) {
+        m_renderer->saveFrame(m_capturePath);
+        LogInfo("last frame written to ", m_capturePath);
+    }
+}
+
 
 }
 
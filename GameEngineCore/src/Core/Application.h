@@ -1,6 +1,7 @@
 #pragma once
 #include "Scene/Scene.h"
 #include "Renderer/Renderer.h"
+#include "Renderer/DefaultRenderer.h"
 #include "Window.h"
 #include <GLFW/glfw3.h>
 #include <cstdint>
@@ -16,10 +17,27 @@ public:
         uint32_t height;
         Engine::Scene* defaultScene;
         float maxDeltaTime = 0.04; // negative value for no max. Make freeze (and launch) not blow everything up and don't know if there's a better method
+        // no window nor swap chain, the frames are rendered in offscreen targets (golden images and benchmarks in ci,
+        // works on lavapipe). Runs frameCount frames with a fixed delta time of headlessDeltaTime
+        bool headless = false;
+        uint32_t frameCount = 1;
+        float headlessDeltaTime = 1.0f / 60.0f;
+        // the last frame is written there as a png when set (headless only)
+        const char* capturePath = nullptr;
+        // the cpu and gpu scopes of the first traceFrames frames are written there when set (Utils::Profiler)
+        const char* tracePath = nullptr;
+        uint32_t traceFrames = 120;
+        // the pipeline and reflection caches are deleted before the device is made, a cold start
+        bool clearCaches = false;
+        // the startup time is printed on stdout (even when the logs are compiled out) once the pipelines of the scene
+        // are built, cmake/StartupBenchmark.cmake compares a cold and a warm start with it
+        bool startupReport = false;
+        // the gpu driven path of the DefaultRenderer when the device supports it by default
+        Engine::Renderer::DefaultRenderer::CullingMode cullingMode = Engine::Renderer::DefaultRenderer::CullingMode::Auto;
     };
 public:
-    Application(createInfo& createInfo);
-    Application(const char * title, uint32_t width, uint32_t height, Engine::Scene* defaultScene, float maxDeltaTime);
+    Application(const createInfo& createInfo);
+    Application(const char * title, uint32_t width, uint32_t height, Engine::Scene* defaultScene, float maxDeltaTime, bool headless = false);
 
     /*using RendererFactory = std::function<Engine::Renderer::Renderer*(Window&)>;*/
     /*Application(const char * title, uint32_t width, uint32_t height, Engine::Scene* defaultScene, RendererFactory rendererFactory);*/
@@ -27,8 +45,17 @@ public:
     ~Application();
 
     void Run();
+    Engine::Renderer::Renderer& getRenderer() { return *m_renderer; };
+private:
+    void runFrame(float dt);
+    void runHeadless();
 private:
     float m_maxDeltaTime = 0.0f;
+    uint32_t m_frameCount = 1;
+    float m_headlessDeltaTime = 1.0f / 60.0f;
+    const char* m_capturePath = nullptr;
+    const char* m_tracePath = nullptr;
+    uint32_t m_traceFrames = 120;
      
     bool m_running = true;
     Window m_window;
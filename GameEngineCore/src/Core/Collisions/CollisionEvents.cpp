@@ -0,0 +1,111 @@
+#include "CollisionEvents.h"
+#include "Core/Scene/Entities/Entity.h"
+#include <algorithm>
+
+namespace Engine {
+namespace Collisions {
+
+CollisionEvents& CollisionEvents::Instance() {
+    static CollisionEvents instance;
+    return instance;
+}
+
+CollisionEvents::SubscriptionId CollisionEvents::subscribe(Entity* entity, Callback callback) {
+    SubscriptionId id = m_nextId++;
+    if (m_dispatching) {
+        m_pendingEntitySubscriptions.push_back({entity, id, std::move(callback)});
+    } else {
+        insertEntitySubscription({entity, id, std::move(callback)});
+    }
+    return id;
+}
+
+void CollisionEvents::insertEntitySubscription(EntitySubscription&& subscription) {
+    auto position = std::upper_bound(m_entitySubscriptions.begin(), m_entitySubscriptions.end(), subscription.entity,
+        [](Entity* entity, const EntitySubscription& other) { return entity < other.entity; });
+    m_entitySubscriptions.insert(position, std::move(subscription));
+}
+
+CollisionEvents::SubscriptionId CollisionEvents::subscribeLayers(uint32_t layerMask, Callback callback) {
+    SubscriptionId id = m_nextId++;
+    if (m_dispatching) {
+        m_pendingLayerSubscriptions.push_back({layerMask, id, std::move(callback)});
+    } else {
+        m_layerSubscriptions.push_back({layerMask, id, std::move(callback)});
+    }
+    return id;
+}
+
+void CollisionEvents::unsubscribe(SubscriptionId id) {
+    m_pendingUnsubscribe.push_back(id);
+    if (!m_dispatching) {
+        applyPending();
+    }
+}
+
+bool CollisionEvents::isUnsubscribed(SubscriptionId id) const {
+    return std::find(m_pendingUnsubscribe.begin(), m_pendingUnsubscribe.end(), id) != m_pendingUnsubscribe.end();
+}
+
+void CollisionEvents::applyPending() {
+    for (EntitySubscription& subscription : m_pendingEntitySubscriptions) {
+        insertEntitySubscription(std::move(subscription));
+    }
+    m_pendingEntitySubscriptions.clear();
+    for (LayerSubscription& subscription : m_pendingLayerSubscriptions) {
+        m_layerSubscriptions.push_back(std::move(subscription));
+    }
+    m_pendingLayerSubscriptions.clear();
+
+    if (m_pendingUnsubscribe.empty()) {
+        return;
+    }
+
+    std::erase_if(m_entitySubscriptions, [this](const EntitySubscription& subscription) { return isUnsubscribed(subscription.id); });
+    std::erase_if(m_layerSubscriptions, [this](const LayerSubscription& subscription) { return isUnsubscribed(subscription.id); });
+    m_pendingUnsubscribe.clear();
+}
+
+static bool isInLayers(const Entity* entity, uint32_t layerMask) {
+    return entity && (layerMask & (1u << entity->layer));
+}
+
+void CollisionEvents::dispatch() {
+    if (m_events.empty()) {
+        return;
+    }
+
+    m_dispatching = true;
+
+    // the (un)subscriptions of the callbacks wait for the end, the vectors don't move
+    auto dispatchToEntity = [this](const CollisionEvent& event) {
+        auto byEntity = [](const EntitySubscription& subscription, Entity* entity) { return subscription.entity < entity; };
+        auto it = std::lower_bound(m_entitySubscriptions.begin(), m_entitySubscriptions.end(), event.entityA, byEntity);
+        for (; it != m_entitySubscriptions.end() && it->entity == event.entityA; ++it) {
+            if (isUnsubscribed(it->id)) continue;
+            it->callback(event);
+        }
+    };
+
+    for (const CollisionEvent& event : m_events) {
+        if (event.entityA) {
+            dispatchToEntity(event);
+        }
+        if (event.entityB) {
+            dispatchToEntity(event.flipped());
+        }
+
+        for (const LayerSubscription& subscription : m_layerSubscriptions) {
+            if (isUnsubscribed(subscription.id)) continue;
+            if (isInLayers(event.entityA, subscription.layerMask) || isInLayers(event.entityB, subscription.layerMask)) {
+                subscription.callback(event);
+            }
+        }
+    }
+
+    m_dispatching = false;
+    applyPending();
+}
+
+}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Engine {
+
+class Entity;
+
+namespace Collisions {
+
+enum class CollisionEventType : uint8_t {
+    Begin,   // first step the two entities touch
+    Persist, // they were already touching the step before
+    End      // they stopped touching (or one of them was removed)
+};
+
+struct CollisionEvent {
+    CollisionEventType type;
+    // on End an entity can be nullptr if it was removed (or lost all its colliders) since the last step
+    Entity* entityA;
+    Entity* entityB;
+    glm::vec3 normal = glm::vec3(0.0f); // from B to A
+    glm::vec3 point = glm::vec3(0.0f); // average of the contact points
+    float normalImpulse = 0.0f; // total impulse the solver applied along the normal this step (0 on End)
+
+    // same event seen from B
+    CollisionEvent flipped() const {
+        CollisionEvent event = *this;
+        std::swap(event.entityA, event.entityB);
+        event.normal = -normal;
+        return event;
+    };
+};
+
+// The solver doesn't call anything, the collision step writes every event of the step in one buffer
+// and it's all sent to the subscribers at the end of ManageCollision (so no virtual call in the middle of the solver)
+class CollisionEvents {
+public:
+    using Callback = std::function<void(const CollisionEvent&)>;
+    using SubscriptionId = uint32_t;
+
+    static CollisionEvents& Instance();
+
+    // every event where entity is one of the two, the event is flipped so entityA is always entity
+    // safe to call from a callback, the subscription gets the events from the next dispatch
+    SubscriptionId subscribe(Entity* entity, Callback callback);
+    // every event where one of the two entities has its layer in layerMask (bit 1 << Entity::layer)
+    // safe to call from a callback, like subscribe
+    SubscriptionId subscribeLayers(uint32_t layerMask, Callback callback);
+    // safe to call from a callback
+    void unsubscribe(SubscriptionId id);
+
+    // all the events of the last step (for the ones who prefer to poll)
+    const std::vector<CollisionEvent>& getEvents() const { return m_events; };
+
+    // used by the collision step
+    void clear() { m_events.clear(); };
+    void push(const CollisionEvent& event) { m_events.push_back(event); };
+    void dispatch();
+
+private:
+    CollisionEvents() = default;
+
+    struct EntitySubscription;
+    void insertEntitySubscription(EntitySubscription&& subscription);
+    bool isUnsubscribed(SubscriptionId id) const;
+    // the subscriptions made during the dispatch are added before the unsubscribed ones are removed
+    void applyPending();
+
+private:
+    struct EntitySubscription {
+        Entity* entity;
+        SubscriptionId id;
+        Callback callback;
+    };
+    struct LayerSubscription {
+        uint32_t layerMask;
+        SubscriptionId id;
+        Callback callback;
+    };
+
+    std::vector<CollisionEvent> m_events;
+
+    // sorted by entity so the subscribers of an entity are found with a binary search
+    std::vector<EntitySubscription> m_entitySubscriptions;
+    std::vector<LayerSubscription> m_layerSubscriptions;
+
+    SubscriptionId m_nextId = 1;
+    // the subscription vectors don't change during the dispatch, the callbacks are called in place
+    bool m_dispatching = false;
+    std::vector<EntitySubscription> m_pendingEntitySubscriptions;
+    std::vector<LayerSubscription> m_pendingLayerSubscriptions;
+    std::vector<SubscriptionId> m_pendingUnsubscribe;
+};
+
+}
+}
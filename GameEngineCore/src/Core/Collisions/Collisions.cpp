@@ -1,7 +1,9 @@
 #include "Collisions.h"
+#include "CollisionEvents.h"
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <set>
@@ -11,6 +13,7 @@
 #include "Core/Scene/Entities/Entity.h"
 #include "Core/Scene/Components/Physics/Colliders.h"
 #include "Core/Scene/Components/Physics/RigidBody.h"
+#include "Core/Utils/LinearArena.h"
 #include "glm/fwd.hpp"
 #include "Core/Log/Log.h"
 
@@ -20,21 +23,122 @@ namespace Collisions {
 
 struct Object {
     Entity* entity;
-    std::vector<Components::Collider*> colliders;
+    // range inside of the collider list of the step (colliders of one entity are next to each other)
+    uint32_t firstCollider;
+    uint32_t colliderCount;
     Components::Transform* transform;
     std::optional<Components::RigidBody*> rigidBody;
 
-    
+    glm::vec3 velocity;
+    // aabb of all the colliders grown by where they go this step (+ margin), pairs that don't overlap are skipped
+    Components::AABB fatAABB;
 };
 
+// how much further than the movement of this step we still create speculative contacts
+// (small so resting bodies keep a contact before they actually touch, it reduces the jitter)
+static constexpr float SPECULATIVE_MARGIN = 0.02f;
+
 ContactManifold::ContactManifold()
-: normal(0.0)
+: normal(0.0), penetration(0.0f)
 {
 }
 
-ContactManifold::ContactManifold(std::vector<ContactPoint> contactPoints, glm::vec3 normal, float penetration)
-: normal(normal), points(contactPoints), penetration(penetration)
+ContactManifold::ContactManifold(ContactPoint contactPoint, glm::vec3 normal, float penetration)
+: normal(normal), penetration(penetration)
 {
+    addPoint(contactPoint);
+}
+
+void ContactManifold::addPoint(const ContactPoint& point) {
+    if (pointCount >= MAX_CONTACT_POINTS) {
+        return;
+    }
+    points[pointCount++] = point;
+}
+
+// signed area (x2) of the triangle abc seen from the normal
+static float signedArea(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& normal) {
+    return glm::dot(glm::cross(b - a, c - a), normal);
+}
+
+// Same idea as in the Dirk Gregorius slides :
+// 1. first point : the one furthest along a fixed direction of the contact plane (so it's stable from frame to frame)
+// 2. second point : the furthest from the first one
+// 3. third point : the one that gives the triangle with the biggest area
+// 4. fourth point : the one the most outside of that triangle (the biggest area added)
+void ContactManifold::setPointsReduced(const glm::vec3* candidates, uint32_t count) {
+    pointCount = 0;
+    if (count <= MAX_CONTACT_POINTS) {
+        for (uint32_t i = 0; i < count; i++) {
+            addPoint({candidates[i]});
+        }
+        return;
+    }
+
+    uint32_t a = 0;
+    float best = -std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < count; i++) {
+        float d = glm::dot(candidates[i], tangent.vec1);
+        if (d > best) {
+            best = d;
+            a = i;
+        }
+    }
+
+    uint32_t b = a;
+    best = -1.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 diff = candidates[i] - candidates[a];
+        float d = glm::dot(diff, diff);
+        if (d > best) {
+            best = d;
+            b = i;
+        }
+    }
+
+    uint32_t c = a;
+    float bestArea = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        float area = signedArea(candidates[a], candidates[b], candidates[i], normal);
+        if (std::abs(area) > std::abs(bestArea)) {
+            bestArea = area;
+            c = i;
+        }
+    }
+
+    addPoint({candidates[a]});
+    addPoint({candidates[b]});
+    if (c == a || c == b) {
+        // every point is on the line ab
+        return;
+    }
+    addPoint({candidates[c]});
+
+    // make abc counter clockwise so a point outside of an edge has a negative area
+    if (bestArea < 0.0f) {
+        std::swap(b, c);
+    }
+
+    uint32_t d = a;
+    float mostOutside = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i == a || i == b || i == c) {
+            continue;
+        }
+        float area = std::min({
+            signedArea(candidates[a], candidates[b], candidates[i], normal),
+            signedArea(candidates[b], candidates[c], candidates[i], normal),
+            signedArea(candidates[c], candidates[a], candidates[i], normal)
+        });
+        if (area < mostOutside) {
+            mostOutside = area;
+            d = i;
+        }
+    }
+
+    if (d != a) {
+        addPoint({candidates[d]});
+    }
 }
 
 
@@ -54,14 +158,15 @@ float calculateEffectiveMassTwoRb(float massA, glm::mat3& inertiaTensorA, glm::v
                 glm::dot(crossB, (inertiaTensorB * crossB)));
 };
 
+// everything is inline so a collision is a single trivially copyable block (no allocation per contact)
 struct PreStepInfo{
     bool oneRb = false;
 
-    std::vector<glm::vec3> relativePositionA;
-    std::vector<glm::vec3> relativePositionB;
-    std::vector<float> normalEffectiveMass;
-    std::vector<float> tangent1EffectiveMass;
-    std::vector<float> tangent2EffectiveMass;
+    std::array<glm::vec3, MAX_CONTACT_POINTS> relativePositionA;
+    std::array<glm::vec3, MAX_CONTACT_POINTS> relativePositionB;
+    std::array<float, MAX_CONTACT_POINTS> normalEffectiveMass;
+    std::array<float, MAX_CONTACT_POINTS> tangent1EffectiveMass;
+    std::array<float, MAX_CONTACT_POINTS> tangent2EffectiveMass;
 
 
     void calculatePreStepInfo(Components::RigidBody* rbA, Components::RigidBody* rbB, ContactManifold& manifold){
@@ -70,19 +175,13 @@ struct PreStepInfo{
             assert(rbA);
         }
 
-        relativePositionA.resize(manifold.points.size());
-        relativePositionB.resize(manifold.points.size());
-        normalEffectiveMass.resize(manifold.points.size());
-        tangent1EffectiveMass.resize(manifold.points.size());
-        tangent2EffectiveMass.resize(manifold.points.size());
-
         glm::mat3 inertiaTensorA = rbA->getinvInertiaTensor();
         glm::mat3 inertiaTensorB;
         if (!oneRb){
-            inertiaTensorB = rbA->getinvInertiaTensor();
+            inertiaTensorB = rbB->getinvInertiaTensor();
         }
         //
-        for (int i=0;i<manifold.points.size();i++){
+        for (int i=0;i<manifold.pointCount;i++){
 
             ContactPoint& point = manifold.points[i];
             relativePositionA[i] = point.position - rbA->getWorldCenterOfMass();
@@ -112,74 +211,122 @@ struct PreStepInfo{
     }
 };
 
+// pointers and not references : the solver swaps A and B and swapping references would swap the objects themselves
 struct Collision {
-    Object& objA;
-    Object& objB;
+    Object* objA;
+    Object* objB;
     ContactManifold manifold;
 
     PreStepInfo preStep;
 
-    float normalImpulse; // accumulated impusle (contact constraints)
-    float tangent1Impulse; // accumulated impusle along tangent1 for the friction
-    float tangent2Impulse; // accumulated impusle along tangent2 for the friction
+    float normalImpulse = 0.0f; // accumulated impusle (contact constraints)
+    float tangent1Impulse = 0.0f; // accumulated impusle along tangent1 for the friction
+    float tangent2Impulse = 0.0f; // accumulated impusle along tangent2 for the friction
+
+    Collision(Object* a, Object* b, const ContactManifold& manifold)
+    : objA(a), objB(b), manifold(manifold) {};
 };
 
+// two entities touching during a step, everything between them (all their colliders) summed up
+// entityA < entityB so the lists can be compared with a merge to know what began and what ended
+struct TouchingPair {
+    Entity* entityA;
+    Entity* entityB;
+    glm::vec3 normal; // from B to A
+    glm::vec3 pointSum;
+    uint32_t pointCount;
+    float normalImpulse;
+    bool touching;
+
+    bool operator<(const TouchingPair& other) const {
+        return entityA != other.entityA ? entityA < other.entityA : entityB < other.entityB;
+    };
+};
+
+// Everything the collision step needs between two frames. The vectors are cleared and not freed and
+// the collisions come from the arena so once the scene is "warm" a step doesn't allocate anything
+struct StepStorage {
+    std::vector<Components::Collider*> colliders;
+    std::vector<Object> objects;
+    std::vector<Collision*> collisions;
+    Utils::LinearArena collisionArena{sizeof(Collision) * 256};
+
+    // kept from one step to the other (not cleared by reset) for the begin / end events
+    std::vector<TouchingPair> touchingPairs;
+    std::vector<TouchingPair> previousTouchingPairs;
+
+    void reset() {
+        colliders.clear();
+        objects.clear();
+        collisions.clear();
+        collisionArena.reset();
+    }
+};
+
+static StepStorage s_stepStorage;
+
 using FindContactFunc = ContactManifold(*)(const Components::Collider*,
-                                           const Components::Collider*);
+                                           const Components::Collider*,
+                                           float speculativeDistance);
 
 
-std::vector<Collision> detectCollisions(std::vector<Object>& objects);
-void solveCollision(std::vector<Collision>& collisions, float dt);
+void detectCollisions(StepStorage& storage, float dt);
+void solveCollision(std::vector<Collision*>& collisions, float dt);
+void writeCollisionEvents(StepStorage& storage, CollisionEvents& events);
 
 
 
 // TODO: Implement trigger
 void ManageCollision(Scene &scene, float dt) {
-    /*std::vector<Object> entities; // entity with colliders*/
-    /*for (auto entity : scene.getAllEntities()) {*/
-    /*    auto collidersWeak = entity->getComponents<Components::Collider>();*/
-    /*    if (collidersWeak.size() == 0)*/
-    /*        continue;*/
-    /**/
-    /*    std::vector<std::shared_ptr<Components::Collider>> colliders(collidersWeak.size());*/
-    /*    for (int i = 0; i<collidersWeak.size();i++) {*/
-    /*        colliders[i] = collidersWeak[i].lock();*/
-    /*    }*/
-    
-    /*    entities.push_back(Object(entity, std::move(colliders), entity->getComponent<Components::Transform>().value().lock(), entity->getComponent<Components::RigidBody>()));*/
-    /*}*/
-
-    std::vector<Components::Collider*> colliders = scene.getComponentsRigistry().getAllElementOfType<Engine::Components::Collider>();
-    std::unordered_map<Entity*, Object> entitiesMap;
-    for (Components::Collider* collider : colliders){
-        auto entity = collider->m_entity;
-        if (entitiesMap.contains(entity)){
-            entitiesMap[entity].colliders.push_back(collider);
+    StepStorage& storage = s_stepStorage;
+    storage.reset();
+
+    scene.getComponentsRigistry().getAllElementOfType<Engine::Components::Collider>(storage.colliders);
+
+    // group the colliders by entity, one object per entity
+    std::sort(storage.colliders.begin(), storage.colliders.end(), [](Components::Collider* a, Components::Collider* b) {
+        return a->m_entity < b->m_entity;
+    });
+
+    for (uint32_t i = 0; i < storage.colliders.size(); i++){
+        auto entity = storage.colliders[i]->m_entity;
+        if (!storage.objects.empty() && storage.objects.back().entity == entity){
+            storage.objects.back().colliderCount++;
+            continue;
         }
 
         Object object;
         object.entity = entity;
-        object.colliders = {collider};
+        object.firstCollider = i;
+        object.colliderCount = 1;
         object.transform = entity->getComponent<Components::Transform>().value();
         object.rigidBody = entity->getComponent<Components::RigidBody>();
-        entitiesMap[entity] = std::move(object);
+        object.velocity = object.rigidBody.has_value() ? object.rigidBody.value()->getCurrentVelocity() : glm::vec3(0.0f);
+        storage.objects.push_back(object);
     }
 
-    std::vector<Object> entities;
-    entities.reserve(entitiesMap.size());
-    for (auto object : entitiesMap){
-        entities.push_back(std::move(object.second));
+    for (Object& object : storage.objects){
+        Components::AABB aabb = storage.colliders[object.firstCollider]->getWorldAABB();
+        for (uint32_t i = object.firstCollider + 1; i < object.firstCollider + object.colliderCount; i++){
+            aabb = aabb.merged(storage.colliders[i]->getWorldAABB());
+        }
+        object.fatAABB = aabb.swept(object.velocity * dt, SPECULATIVE_MARGIN);
     }
 
-    auto collisions = detectCollisions(entities);
-    solveCollision(collisions, dt);
+    detectCollisions(storage, dt);
+    solveCollision(storage.collisions, dt);
+
+    // the callbacks are only called once the whole step is done
+    CollisionEvents& events = CollisionEvents::Instance();
+    writeCollisionEvents(storage, events);
+    events.dispatch();
 }
 
-ContactManifold TestSphereSphere(const Components::Collider* colliderA, const Components::Collider* colliderB) {
+ContactManifold TestSphereSphere(const Components::Collider* colliderA, const Components::Collider* colliderB, float speculativeDistance) {
     Components::SphereCollider* sphereA = (Components::SphereCollider*)colliderA;
     Components::SphereCollider* sphereB = (Components::SphereCollider*)colliderB;
     glm::vec3 aCenter = sphereA->getWorldCenter();
-    glm::vec3 bCenter = sphereA->getWorldCenter();
+    glm::vec3 bCenter = sphereB->getWorldCenter();
     float aRadius = sphereA->getRadius(); 
     float bRadius = sphereB->getRadius();
 
@@ -194,10 +341,11 @@ ContactManifold TestSphereSphere(const Components::Collider* colliderA, const Co
         glm::vec3 surfacePointB = bCenter + bRadius * -normal;
         point.position = surfacePointA + (surfacePointB - surfacePointA) / 2.0f;
         auto penetration = aRadius + bRadius;
-        return ContactManifold({point}, normal, penetration);
+        return ContactManifold(point, normal, penetration);
     }
 
-    if (distance > aRadius + bRadius) {
+    // further than that it's not even a speculative contact
+    if (distance > aRadius + bRadius + speculativeDistance) {
         return ContactManifold();
     }
 
@@ -207,8 +355,9 @@ ContactManifold TestSphereSphere(const Components::Collider* colliderA, const Co
     glm::vec3 surfacePointA = aCenter + aRadius * normal;
     glm::vec3 surfacePointB = bCenter + bRadius * -normal;
     point.position = surfacePointA + (surfacePointB - surfacePointA) / 2.0f;
-    auto penetration = distance - (aRadius + bRadius);
-    return ContactManifold({point}, normal, penetration);
+    // negative when they are not touching yet (speculative contact)
+    auto penetration = (aRadius + bRadius) - distance;
+    return ContactManifold(point, normal, penetration);
 
 }
 
@@ -222,7 +371,7 @@ glm::vec3 getOrthogonalVector(glm::vec3 vec) {
 }
 
 
-ContactManifold TestSphereCapsule(const Components::Collider* colliderA, const Components::Collider* colliderB) {
+ContactManifold TestSphereCapsule(const Components::Collider* colliderA, const Components::Collider* colliderB, float speculativeDistance) {
     Components::SphereCollider* sphere = (Components::SphereCollider*)colliderA;
     Components::CapsuleCollider* capsule = (Components::CapsuleCollider*)colliderB;
     glm::vec3 SphereCenter = sphere->getWorldCenter();
@@ -248,10 +397,10 @@ ContactManifold TestSphereCapsule(const Components::Collider* colliderA, const C
         glm::vec3 surfacePointB = SphereCenter + SphereRadius * -normal;
         point.position = surfacePointA + (surfacePointB - surfacePointA) / 2.0f;
         auto penetration = SphereRadius + CapsuleRadius;
-        return ContactManifold({point}, normal, penetration);
+        return ContactManifold(point, normal, penetration);
     }
 
-    if (distance > SphereRadius + CapsuleRadius) {
+    if (distance > SphereRadius + CapsuleRadius + speculativeDistance) {
         return ContactManifold();
     }
 
@@ -261,12 +410,14 @@ ContactManifold TestSphereCapsule(const Components::Collider* colliderA, const C
     glm::vec3 surfacePointA = SphereCenter + SphereRadius * -normal;
     glm::vec3 surfacePointB = capsuleCenterProj + CapsuleRadius * normal;
     point.position = surfacePointA + (surfacePointB - surfacePointA) / 2.0f;
-    auto penetration = distance - (SphereRadius + CapsuleRadius);
-    return ContactManifold({point}, normal, penetration);
+    auto penetration = (SphereRadius + CapsuleRadius) - distance;
+    return ContactManifold(point, normal, penetration);
 }
 
+// speculativeDistance : up to which distance shapes that don't touch still give a contact (with a negative penetration)
 ContactManifold findCollision(const Components::Collider* a,
-                              const Components::Collider* b) {
+                              const Components::Collider* b,
+                              float speculativeDistance) {
     static const FindContactFunc tests[3][3] = 
         {
             // Sphere             Cube              Capsule
@@ -275,60 +426,191 @@ ContactManifold findCollision(const Components::Collider* a,
             { nullptr,          nullptr,            nullptr }  // Capsule 
         };
 
-    bool swap = b->type > a->type;
+    // the table is only filled above the diagonal
+    bool swap = a->type > b->type;
 
     if (swap)
     {
         std::swap(a, b);
     }
 
-    ContactManifold points = tests[a->type][b->type](a, b);
+    ContactManifold points = tests[a->type][b->type](a, b, speculativeDistance);
+
+    // the tests give a normal from their b to their a, put it back in the order of the caller
+    if (swap)
+    {
+        points.normal *= -1.0f;
+    }
 
 
     return points;
 }
 
-std::vector<Collision> detectCollisions(std::vector<Object>& objects) {
-    std::vector<Collision> collisions;
+void detectCollisions(StepStorage& storage, float dt) {
+    std::vector<Object>& objects = storage.objects;
     for (int i = 0 ;i<objects.size();i++) {
         Object& a = objects[i];
         // we start at i+1 like that we only have unique pairs (if i then i==j and entity == entity)
         for (int j=i+1;j<objects.size();j++) {
             Object& b = objects[j];
-            for (Components::Collider* colliderA : a.colliders)
-            for (Components::Collider* colliderB : b.colliders) {
+            if (!a.fatAABB.overlaps(b.fatAABB)) {
+                continue;
+            }
+
+            glm::vec3 relativeVelocity = a.velocity - b.velocity;
+            float speculativeDistance = glm::length(relativeVelocity) * dt + SPECULATIVE_MARGIN;
+
+            for (uint32_t colliderIndexA = a.firstCollider; colliderIndexA < a.firstCollider + a.colliderCount; colliderIndexA++)
+            for (uint32_t colliderIndexB = b.firstCollider; colliderIndexB < b.firstCollider + b.colliderCount; colliderIndexB++) {
+                Components::Collider* colliderA = storage.colliders[colliderIndexA];
+                Components::Collider* colliderB = storage.colliders[colliderIndexB];
 
-                ContactManifold manifold = findCollision(colliderA, colliderB);
+                ContactManifold manifold = findCollision(colliderA, colliderB, speculativeDistance);
+
+                if (!manifold.hasContacts()){
+                    continue;
+                }
 
-                if (manifold.points.size() > 0){
-                    //LogDebug("Collision between : %s and %s and do they both have rb : %i", a.entity->name.c_str(), b.entity->name.c_str(), a.rigidBody.has_value() && b.rigidBody.has_value());
-                    collisions.emplace_back(a, b, manifold);
+                // speculative contact : only keep it if they are actually closing and can cover the gap this step
+                if (manifold.penetration < 0.0f) {
+                    float closingVelocity = -glm::dot(manifold.normal, relativeVelocity);
+                    if (closingVelocity <= 0.0f || closingVelocity * dt + SPECULATIVE_MARGIN < -manifold.penetration) {
+                        continue;
+                    }
                 }
+
+                //LogDebug("Collision between : %s and %s and do they both have rb : %i", a.entity->name.c_str(), b.entity->name.c_str(), a.rigidBody.has_value() && b.rigidBody.has_value());
+                storage.collisions.push_back(storage.collisionArena.create<Collision>(&a, &b, manifold));
             }
         }
     }
+}
+
 
-    return std::move(collisions);
+// the entity can be gone since the last step, objects are sorted by entity so it's a binary search
+static Entity* findAliveEntity(const std::vector<Object>& objects, Entity* entity) {
+    auto it = std::lower_bound(objects.begin(), objects.end(), entity, [](const Object& object, Entity* entity) {
+        return object.entity < entity;
+    });
+    return (it != objects.end() && it->entity == entity) ? entity : nullptr;
 }
 
+// Called after the solver so the impulses are the final ones of the step.
+// Speculative contacts that didn't push anything are not a collision (they are not touching).
+void writeCollisionEvents(StepStorage& storage, CollisionEvents& events) {
+    events.clear();
+
+    std::vector<TouchingPair>& current = storage.touchingPairs;
+    std::vector<TouchingPair>& previous = storage.previousTouchingPairs;
+    current.clear();
+
+    // the collisions of a pair of entities are next to each other (see detectCollisions)
+    for (Collision* collision : storage.collisions) {
+        Entity* entityA = collision->objA->entity;
+        Entity* entityB = collision->objB->entity;
+        // the solver may have swapped A and B (and flipped the normal with it)
+        glm::vec3 normal = collision->manifold.normal;
+        if (entityB < entityA) {
+            std::swap(entityA, entityB);
+            normal *= -1.0f;
+        }
+
+        if (current.empty() || current.back().entityA != entityA || current.back().entityB != entityB) {
+            current.push_back({entityA, entityB, glm::vec3(0.0f), glm::vec3(0.0f), 0, 0.0f, false});
+        }
+        TouchingPair& pair = current.back();
+
+        bool touching = collision->manifold.penetration >= 0.0f || collision->normalImpulse > 0.0f;
+        if (!touching) {
+            continue;
+        }
+        // the normal of the deepest one (the first one is good enough, they mostly agree)
+        if (!pair.touching) {
+            pair.normal = normal;
+        }
+        pair.touching = true;
+        pair.normalImpulse += collision->normalImpulse;
+        for (uint32_t i = 0; i < collision->manifold.pointCount; i++) {
+            pair.pointSum += collision->manifold.points[i].position;
+        }
+        pair.pointCount += collision->manifold.pointCount;
+    }
+
+    std::erase_if(current, [](const TouchingPair& pair) { return !pair.touching; });
+    // already sorted since the objects are, but it's cheap and doesn't rely on the order of detectCollisions
+    std::sort(current.begin(), current.end());
+
+    auto contactEvent = [](CollisionEventType type, const TouchingPair& pair) {
+        CollisionEvent event;
+        event.type = type;
+        event.entityA = pair.entityA;
+        event.entityB = pair.entityB;
+        event.normal = pair.normal;
+        event.point = pair.pointCount > 0 ? pair.pointSum / (float)pair.pointCount : glm::vec3(0.0f);
+        event.normalImpulse = pair.normalImpulse;
+        return event;
+    };
+
+    // merge of the two sorted lists
+    size_t i = 0, j = 0;
+    while (i < previous.size() || j < current.size()) {
+        if (j < current.size() && (i >= previous.size() || current[j] < previous[i])) {
+            events.push(contactEvent(CollisionEventType::Begin, current[j++]));
+        } else if (i < previous.size() && (j >= current.size() || previous[i] < current[j])) {
+            CollisionEvent event;
+            event.type = CollisionEventType::End;
+            event.entityA = findAliveEntity(storage.objects, previous[i].entityA);
+            event.entityB = findAliveEntity(storage.objects, previous[i].entityB);
+            events.push(event);
+            i++;
+        } else {
+            events.push(contactEvent(CollisionEventType::Persist, current[j]));
+            i++;
+            j++;
+        }
+    }
+
+    std::swap(current, previous);
+}
+
+// velocity change the contact constraint asks for, false if the contact shouldn't do anything
+bool contactTargetVelocity(const ContactManifold& manifold, float separatingVelocity, float dt, float& desiredVelocity) {
+    if (manifold.penetration < 0.0f) {
+        // speculative : still a gap, they are allowed to close it this step (-gap/dt) but not more
+        // no bounce and no baumgarte, it only removes the part of the approach that would make them overlap
+        float approachLimit = manifold.penetration / dt;
+        if (separatingVelocity >= approachLimit) return false;
+        desiredVelocity = approachLimit - separatingVelocity;
+        return true;
+    }
+
+    if (separatingVelocity > 0.0f) return false;
+
+    float baumgarteFactor = 0.2f;
+    float baumgarteImpulse = baumgarteFactor * manifold.penetration / dt;
+
+    float bounciness = 0.5f;
+    desiredVelocity = (-(1.0f + bounciness) * separatingVelocity) + baumgarteImpulse;
+    return true;
+}
 
 // TODO: Physics material
 void solveCollisionOneRb(Collision& collision, float dt){
     // Ensure objA has the rigidbody
-    if (collision.objB.rigidBody.has_value()) {
+    if (collision.objB->rigidBody.has_value()) {
         std::swap(collision.objA, collision.objB);
         collision.manifold.normal *= -1.0f;
     }
 
 
-    auto rb = collision.objA.rigidBody.value();
+    auto rb = collision.objA->rigidBody.value();
 
     auto omega = rb->getOmega();
     auto velocity = rb->getCurrentVelocity();
 
     PreStepInfo& preStep = collision.preStep;
 
-    for (int i=0;i<collision.manifold.points.size();i++){
+    for (int i=0;i<collision.manifold.pointCount;i++){
         ContactPoint& point = collision.manifold.points[i];
 
         glm::vec3 relativeVelocity = velocity + glm::cross(omega, preStep.relativePositionA[i]);
@@ -363,13 +645,9 @@ void solveCollisionOneRb(Collision& collision, float dt){
         // contact constraint
         {
             float separatingVelocity = glm::dot(collision.manifold.normal, relativeVelocity);
-            if (separatingVelocity > 0.0f) continue;;
+            float desiredVelocity;
+            if (!contactTargetVelocity(collision.manifold, separatingVelocity, dt, desiredVelocity)) continue;
 
-            float baumgarteFactor = 0.2f;
-            float baumgarteImpulse = baumgarteFactor * collision.manifold.penetration / dt;
-
-            float bounciness = 0.5f;
-            float desiredVelocity = (-(1.0f + bounciness) * separatingVelocity) + baumgarteImpulse;
             float lambda = desiredVelocity * preStep.normalEffectiveMass[i];
 
             float newImpulse = std::max(collision.normalImpulse + lambda, 0.f);;
@@ -384,8 +662,8 @@ void solveCollisionOneRb(Collision& collision, float dt){
 }
 
 void solveCollisionBothRb(Collision& collision, float dt) {
-    auto rbA = collision.objA.rigidBody.value();
-    auto rbB = collision.objB.rigidBody.value();
+    auto rbA = collision.objA->rigidBody.value();
+    auto rbB = collision.objB->rigidBody.value();
 
     auto omegaA = rbA->getOmega();
     auto velocityA = rbA->getCurrentVelocity();
@@ -395,7 +673,7 @@ void solveCollisionBothRb(Collision& collision, float dt) {
     PreStepInfo& preStep = collision.preStep;
 
 
-    for (int i=0;i<collision.manifold.points.size();i++){
+    for (int i=0;i<collision.manifold.pointCount;i++){
         ContactPoint& point = collision.manifold.points[i];
 
         glm::vec3 velocityPointA = velocityA + glm::cross(omegaA, preStep.relativePositionA[i]);
@@ -404,13 +682,9 @@ void solveCollisionBothRb(Collision& collision, float dt) {
         // contact constraint
         {
             float separatingVelocity = glm::dot(collision.manifold.normal, velocityPointA - velocityPointB);
-            if (separatingVelocity > 0.0f) continue;;
-
-            float baumgarteFactor = 0.2f;
-            float baumgarteImpulse = baumgarteFactor * collision.manifold.penetration / dt;
+            float desiredVelocity;
+            if (!contactTargetVelocity(collision.manifold, separatingVelocity, dt, desiredVelocity)) continue;
 
-            float bounciness = 0.5f;
-            float desiredVelocity = (-(1.0f + bounciness) * separatingVelocity) + baumgarteImpulse;
             float lambda = desiredVelocity * preStep.normalEffectiveMass[i];
 
             float newImpulse = std::max(collision.normalImpulse + lambda, 0.f);;
@@ -425,29 +699,30 @@ void solveCollisionBothRb(Collision& collision, float dt) {
 }
 
 // TODO: combine both one rb and both rb function into one (by using default values if not rb)
-void solveCollision(std::vector<Collision>& collisions, float dt) {
+void solveCollision(std::vector<Collision*>& collisions, float dt) {
     const int nbIteration = 15;
     for (int iteration=0;iteration<nbIteration;iteration++){
-        for (Collision& collision : collisions) {
+        for (Collision* collisionPointer : collisions) {
+            Collision& collision = *collisionPointer;
             // xor operation only one of them
-            if (collision.objA.rigidBody.has_value() ^ collision.objB.rigidBody.has_value()) {
-                if (collision.objB.rigidBody.has_value()) {
+            if (collision.objA->rigidBody.has_value() ^ collision.objB->rigidBody.has_value()) {
+                if (collision.objB->rigidBody.has_value()) {
                     std::swap(collision.objA, collision.objB);
                     collision.manifold.normal *= -1.0f;
                 }
 
 
                 if (iteration == 0) {
-                    collision.preStep.calculatePreStepInfo(collision.objA.rigidBody.value(), nullptr, collision.manifold);
+                    collision.preStep.calculatePreStepInfo(collision.objA->rigidBody.value(), nullptr, collision.manifold);
                 }
 
                 solveCollisionOneRb(collision, dt);
             }
 
 
-            if (collision.objA.rigidBody.has_value() && collision.objB.rigidBody.has_value()) {
+            if (collision.objA->rigidBody.has_value() && collision.objB->rigidBody.has_value()) {
                 if (iteration == 0) {
-                    collision.preStep.calculatePreStepInfo(collision.objA.rigidBody.value(), collision.objB.rigidBody.value(), collision.manifold);
+                    collision.preStep.calculatePreStepInfo(collision.objA->rigidBody.value(), collision.objB->rigidBody.value(), collision.manifold);
                 }
 
                 solveCollisionBothRb(collision, dt);
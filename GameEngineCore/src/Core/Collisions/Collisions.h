@@ -9,6 +9,8 @@
 //
 
 #include "Core/Scene/Scene.h"
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "GJKEPA.h"
 
@@ -25,15 +27,25 @@ struct Tangent {
     glm::vec3 vec2;
 };
 
+// a box on a box already gives 4 points, more than that doesn't make the stacking better, it just cost more iterations
+static constexpr uint32_t MAX_CONTACT_POINTS = 4;
+
 struct ContactManifold
 {
-    std::vector<ContactPoint> points;
+    std::array<ContactPoint, MAX_CONTACT_POINTS> points;
+    uint32_t pointCount = 0;
     glm::vec3 normal;
     Tangent tangent;
     float penetration;
 
     ContactManifold();
-    ContactManifold(std::vector<ContactPoint> contactPoints, glm::vec3 normal, float penetration);
+    ContactManifold(ContactPoint contactPoint, glm::vec3 normal, float penetration);
+
+    bool hasContacts() const { return pointCount > 0; };
+    void addPoint(const ContactPoint& point);
+
+    // keep the (at most) 4 candidates that span the biggest area, see reduceContactPoints in the cpp
+    void setPointsReduced(const glm::vec3* candidates, uint32_t count);
 };
 
 void ManageCollision(Scene& scene, float dt);
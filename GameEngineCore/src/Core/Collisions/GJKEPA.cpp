@@ -3,6 +3,7 @@
 #include "glm/geometric.hpp"
 #include <MacTypes.h>
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <limits>
 #include <tuple>
@@ -228,19 +229,36 @@ void AddIfUniqueEdge(std::vector<std::pair<size_t, size_t>> &edges,
 ContactManifold EPA(Simplex &simplex, const Components::Collider &colliderA,
                     const Components::Collider &colliderB);
 
+ContactManifold SpeculativeContact(const Components::Collider &colliderA,
+                                   const Components::Collider &colliderB,
+                                   float speculativeDistance);
+
 ContactManifold EPA(const Components::Collider *colliderA,
-                    const Components::Collider *colliderB) {
+                    const Components::Collider *colliderB,
+                    float speculativeDistance) {
   auto result = GJK(*colliderA, *colliderB);
   if (!result.first) {
+    if (speculativeDistance > 0.0f) {
+      return SpeculativeContact(*colliderA, *colliderB, speculativeDistance);
+    }
     return ContactManifold();
   }
   return EPA(result.second, *colliderA, *colliderB);
 };
 
+// contactTolerance : how far in front of the reference face a point can be and still be kept
+// (a bit more than 0 for real contacts, the gap for speculative ones)
 ContactManifold
 generateContactManifoldAfterEPA(const Components::Collider &colliderA,
                                 const Components::Collider &colliderB,
-                                glm::vec3 normal, float penetration);
+                                glm::vec3 normal, float penetration,
+                                float contactTolerance = 1e-4f);
+
+// same with the polyhedrons of the two cubes already built
+ContactManifold clipContactManifold(Components::Polyhedron &polyhedronA,
+                                    Components::Polyhedron &polyhedronB,
+                                    glm::vec3 normal, float penetration,
+                                    float contactTolerance);
 
 ContactManifold EPA(Simplex &simplex, const Components::Collider &colliderA,
                     const Components::Collider &colliderB) {
@@ -476,22 +494,38 @@ std::optional<glm::vec3> intersectEdgePlane(const glm::vec3 &v_start,
   }
 }
 
+// fixed size polygon for the clipping, a face of a convex collider never has this many vertices
+// and each clip adds at most one vertex so it can't overflow in practice (and if it does we just drop points)
+struct ContactPolygon {
+  static constexpr uint32_t CAPACITY = 32;
+  std::array<glm::vec3, CAPACITY> vertices;
+  uint32_t count = 0;
+
+  void push_back(const glm::vec3 &vertex) {
+    if (count < CAPACITY) {
+      vertices[count++] = vertex;
+    }
+  }
+  bool empty() const { return count == 0; }
+  const glm::vec3 &operator[](uint32_t i) const { return vertices[i]; }
+};
+
 // Clips a polygon (represented by ordered vertices) against a single plane
-std::vector<glm::vec3>
-clipPolygonAgainstPlane(const std::vector<glm::vec3> &polygonVertices,
-                        const Plane &clippingPlane) {
-  std::vector<glm::vec3> outputVertices;
+void clipPolygonAgainstPlane(const ContactPolygon &polygonVertices,
+                             const Plane &clippingPlane,
+                             ContactPolygon &outputVertices) {
+  outputVertices.count = 0;
   if (polygonVertices.empty()) {
-    return outputVertices;
+    return;
   }
 
   constexpr float epsilon =
       1e-6f; // Tolerance for checking if point is on plane
 
-  for (size_t i = 0; i < polygonVertices.size(); ++i) {
+  for (uint32_t i = 0; i < polygonVertices.count; ++i) {
     const glm::vec3 &currentVertex = polygonVertices[i];
     const glm::vec3 &nextVertex =
-        polygonVertices[(i + 1) % polygonVertices.size()]; // Wrap around
+        polygonVertices[(i + 1) % polygonVertices.count]; // Wrap around
 
     float dist_current = clippingPlane.signedDistance(currentVertex);
     float dist_next = clippingPlane.signedDistance(nextVertex);
@@ -531,22 +565,21 @@ clipPolygonAgainstPlane(const std::vector<glm::vec3> &polygonVertices,
   }
 
   // Remove duplicate consecutive vertices (can happen at corners)
-  if (outputVertices.size() > 1) {
-    auto last = std::unique(outputVertices.begin(), outputVertices.end(),
+  if (outputVertices.count > 1) {
+    auto begin = outputVertices.vertices.begin();
+    auto last = std::unique(begin, begin + outputVertices.count,
                             [epsilon](const glm::vec3 &a, const glm::vec3 &b) {
                               return glm::distance(a, b) < epsilon;
                             });
-    outputVertices.erase(last, outputVertices.end());
+    outputVertices.count = (uint32_t)(last - begin);
 
     // Check if first and last points are the same after unique
-    if (outputVertices.size() > 1 &&
-        glm::distance(outputVertices.front(), outputVertices.back()) <
+    if (outputVertices.count > 1 &&
+        glm::distance(outputVertices[0], outputVertices[outputVertices.count - 1]) <
             epsilon) {
-      outputVertices.pop_back(); // Remove redundant last point
+      outputVertices.count--; // Remove redundant last point
     }
   }
-
-  return outputVertices;
 }
 
 Tangent calculateTangent(glm::vec3 contactNormal) {
@@ -575,33 +608,214 @@ Tangent calculateTangent(glm::vec3 contactNormal) {
   return tangent;
 }
 
+// a cube in world space: its center and its three axes (unit) with the half size along each
+struct WorldBox {
+  glm::vec3 center;
+  glm::vec3 axes[3];
+  float halfSizes[3];
+};
+
+static WorldBox getWorldBox(const Components::CubeCollider &cube) {
+  glm::mat4 model =
+      cube.m_entity->getComponent<Components::Transform>().value()->getModelMatrix();
+  glm::mat3 linear(model);
+  WorldBox box;
+  box.center = glm::vec3(model * glm::vec4(cube.center, 1.0f));
+  glm::vec3 halfAxes[3] = {linear * (cube.forward * cube.forwardHalfSize),
+                           linear * (cube.up * cube.upHalfSize),
+                           linear * (cube.right * cube.rightHalfSize)};
+  for (int i = 0; i < 3; i++) {
+    box.halfSizes[i] = glm::length(halfAxes[i]);
+    box.axes[i] = box.halfSizes[i] > 0.0f ? halfAxes[i] / box.halfSizes[i]
+                                          : glm::vec3(0.0f);
+  }
+  return box;
+}
+
+static glm::vec3 closestPointOnBox(const WorldBox &box, glm::vec3 point) {
+  glm::vec3 offset = point - box.center;
+  glm::vec3 result = box.center;
+  for (int i = 0; i < 3; i++) {
+    float distance = glm::clamp(glm::dot(offset, box.axes[i]),
+                                -box.halfSizes[i], box.halfSizes[i]);
+    result += distance * box.axes[i];
+  }
+  return result;
+}
+
+static glm::vec3 closestPointOnSegment(glm::vec3 start, glm::vec3 end,
+                                       glm::vec3 point) {
+  glm::vec3 segment = end - start;
+  float lengthSq = glm::dot(segment, segment);
+  if (lengthSq < 1e-12f) {
+    return start;
+  }
+  float t = glm::clamp(glm::dot(point - start, segment) / lengthSq, 0.0f, 1.0f);
+  return start + t * segment;
+}
+
+// the gap between a cube and a round shape (a sphere is a capsule with a zero
+// length segment): the closest points of the box and of the segment are found by
+// projecting one on the other in turn, it converges to the real closest points
+// from above (the gap is never smaller than the real one). The normal goes from
+// the round shape to the cube, the point is in the middle of the gap
+static ContactManifold speculativeBoxRound(const WorldBox &box,
+                                           glm::vec3 segmentStart,
+                                           glm::vec3 segmentEnd, float radius,
+                                           float speculativeDistance) {
+  static constexpr int ITERATIONS = 8;
+
+  glm::vec3 onSegment = closestPointOnSegment(segmentStart, segmentEnd, box.center);
+  glm::vec3 onBox = closestPointOnBox(box, onSegment);
+  for (int i = 0; i < ITERATIONS; i++) {
+    glm::vec3 nextOnSegment = closestPointOnSegment(segmentStart, segmentEnd, onBox);
+    glm::vec3 nextOnBox = closestPointOnBox(box, nextOnSegment);
+    bool converged = glm::distance(nextOnBox, onBox) < 1e-5f &&
+                     glm::distance(nextOnSegment, onSegment) < 1e-5f;
+    onSegment = nextOnSegment;
+    onBox = nextOnBox;
+    if (converged) {
+      break;
+    }
+  }
+
+  glm::vec3 delta = onBox - onSegment;
+  float distance = glm::length(delta);
+  float gap = distance - radius;
+  // the segment inside the box: they overlap, not for the speculative contact
+  if (distance < 1e-6f || gap <= 0.0f || gap > speculativeDistance) {
+    return ContactManifold();
+  }
+
+  glm::vec3 normal = delta / distance;
+  ContactPoint point;
+  glm::vec3 roundSurface = onSegment + radius * normal;
+  point.position = roundSurface + (onBox - roundSurface) / 2.0f;
+  return ContactManifold(point, normal, -gap);
+}
+
+// Shapes are not touching yet (GJK said no) but they might this step.
+// For two cubes the gap is found with a separating axis test over the face normals of both shapes and the
+// center to center direction. The projected gap on any axis is never bigger than the real distance so
+// the best axis is a safe (a bit conservative) separation. Then the points come from the same clipping as EPA.
+// A sphere or a capsule against a cube (the pairs EPA is used for) takes the closest points of the box and of
+// the sphere center or the capsule segment, one point of contact
+ContactManifold SpeculativeContact(const Components::Collider &colliderA,
+                                   const Components::Collider &colliderB,
+                                   float speculativeDistance) {
+  using Components::ColliderType;
+  if (colliderA.type == ColliderType::Sphere && colliderB.type == ColliderType::Cube) {
+    const auto &sphere = static_cast<const Components::SphereCollider &>(colliderA);
+    glm::vec3 center = sphere.getWorldCenter();
+    // the normal of speculativeBoxRound goes to the cube (B here), the manifold's one goes from B to A
+    ContactManifold manifold = speculativeBoxRound(
+        getWorldBox(static_cast<const Components::CubeCollider &>(colliderB)),
+        center, center, sphere.getRadius(), speculativeDistance);
+    manifold.normal *= -1.0f;
+    return manifold;
+  }
+  if (colliderA.type == ColliderType::Cube && colliderB.type == ColliderType::Capsule) {
+    const auto &capsule = static_cast<const Components::CapsuleCollider &>(colliderB);
+    return speculativeBoxRound(
+        getWorldBox(static_cast<const Components::CubeCollider &>(colliderA)),
+        capsule.getWorldCenter1(), capsule.getWorldCenter2(),
+        capsule.getRadius(), speculativeDistance);
+  }
+  if (colliderA.type != ColliderType::Cube || colliderB.type != ColliderType::Cube) {
+    return ContactManifold();
+  }
+
+  // built once, for the axes, the supports and the clipping
+  Components::Polyhedron polyhedronA = colliderA.getPolyhedron();
+  Components::Polyhedron polyhedronB = colliderB.getPolyhedron();
+
+  glm::vec3 centerA(0.0f);
+  for (const glm::vec3 &vertex : polyhedronA.vertices) {
+    centerA += vertex;
+  }
+  centerA /= (float)polyhedronA.vertices.size();
+  glm::vec3 centerB(0.0f);
+  for (const glm::vec3 &vertex : polyhedronB.vertices) {
+    centerB += vertex;
+  }
+  centerB /= (float)polyhedronB.vertices.size();
+
+  auto support = [](const Components::Polyhedron &polyhedron, glm::vec3 axis) {
+    float best = -std::numeric_limits<float>::max();
+    for (const glm::vec3 &vertex : polyhedron.vertices) {
+      best = std::max(best, glm::dot(vertex, axis));
+    }
+    return best;
+  };
+
+  // the normal goes from B to A (same as the one from EPA)
+  glm::vec3 bestNormal(0.0f);
+  float bestGap = -std::numeric_limits<float>::max();
+  auto testAxis = [&](glm::vec3 axis) {
+    if (glm::dot(axis, axis) < 1e-8f) {
+      return;
+    }
+    axis = glm::normalize(axis);
+    if (glm::dot(axis, centerA - centerB) < 0.0f) {
+      axis = -axis;
+    }
+    float gap = -support(polyhedronA, -axis) - support(polyhedronB, axis);
+    if (gap > bestGap) {
+      bestGap = gap;
+      bestNormal = axis;
+    }
+  };
+
+  testAxis(centerA - centerB);
+  for (const Components::Face &face : polyhedronA.faces) {
+    testAxis(face.normal);
+  }
+  for (const Components::Face &face : polyhedronB.faces) {
+    testAxis(face.normal);
+  }
+
+  if (bestGap <= 0.0f || bestGap > speculativeDistance) {
+    return ContactManifold();
+  }
+
+  // negative penetration = speculative contact, the solver only removes the velocity that would close more than the gap
+  return clipContactManifold(polyhedronA, polyhedronB, bestNormal, -bestGap,
+                             bestGap + 1e-4f);
+}
+
 // based on
 // https://dyn4j.org/2011/11/contact-points-using-clipping/
 ContactManifold
 generateContactManifoldAfterEPA(const Components::Collider &colliderA,
                                 const Components::Collider &colliderB,
-                                glm::vec3 normal, float penetration) {
+                                glm::vec3 normal, float penetration,
+                                float contactTolerance) {
     if ((colliderA.m_entity->name == "second entity" || colliderB.m_entity->name == "second entity") && colliderA.m_entity->name != "plane" && colliderB.m_entity->name != "plane"){
         
     }
-  Components::Polyhedron polyhedronA;
-  Components::Polyhedron polyhedronB;
-  ContactManifold manifold;
-  manifold.normal = normal;
-  manifold.tangent = calculateTangent(normal);
-  manifold.penetration = penetration;
-
   if (colliderA.type == Components::ColliderType::Capsule ||
       colliderB.type == Components::ColliderType::Capsule) {
     return ContactManifold();
   } else if (colliderA.type == Components::ColliderType::Sphere ||
              colliderB.type == Components::ColliderType::Sphere) {
     return ContactManifold();
-  } else {
-    polyhedronA = colliderA.getPolyhedron();
-    polyhedronB = colliderB.getPolyhedron();
   }
 
+  Components::Polyhedron polyhedronA = colliderA.getPolyhedron();
+  Components::Polyhedron polyhedronB = colliderB.getPolyhedron();
+  return clipContactManifold(polyhedronA, polyhedronB, normal, penetration,
+                             contactTolerance);
+}
+
+ContactManifold clipContactManifold(Components::Polyhedron &polyhedronA,
+                                    Components::Polyhedron &polyhedronB,
+                                    glm::vec3 normal, float penetration,
+                                    float contactTolerance) {
+  ContactManifold manifold;
+  manifold.normal = normal;
+  manifold.tangent = calculateTangent(normal);
+  manifold.penetration = penetration;
+
   Components::Face &face1 = findClosestFaceToCollisions(polyhedronA, normal);
   Components::Face &face2 = findClosestFaceToCollisions(polyhedronB, -normal);
 
@@ -610,23 +824,24 @@ generateContactManifoldAfterEPA(const Components::Collider &colliderA,
 
   Components::Face &ref = face1IsMoreAligned ? face1 : face2;
   Components::Face &inc = face1IsMoreAligned ? face2 : face1;
-  Components::Polyhedron refPolyhedron =
-      face1IsMoreAligned ? std::move(polyhedronA) : std::move(polyhedronB);
-  Components::Polyhedron incPolyhedron =
-      face1IsMoreAligned ? std::move(polyhedronB) : std::move(polyhedronA);
-
-  std::vector<glm::vec3> incidentVertices =
-      inc.getVertices(incPolyhedron.vertices);
+  const Components::Polyhedron &refPolyhedron =
+      face1IsMoreAligned ? polyhedronA : polyhedronB;
+  const Components::Polyhedron &incPolyhedron =
+      face1IsMoreAligned ? polyhedronB : polyhedronA;
 
   // Clip the incident face polygon against the side planes of the reference
-  // face
-  std::vector<glm::vec3> clippedVertices = incidentVertices;
-  std::vector<glm::vec3> refVertices = ref.getVertices(refPolyhedron.vertices);
-  int numRefVerts = refVertices.size();
+  // face (ping pong between two fixed buffers, no allocation)
+  ContactPolygon clipBuffers[2];
+  uint32_t current = 0;
+  for (uint32_t index : inc.vertexIndices) {
+    clipBuffers[current].push_back(incPolyhedron.vertices[index]);
+  }
+
+  int numRefVerts = ref.vertexIndices.size();
 
   for (int i = 0; i < numRefVerts; ++i) {
-    const glm::vec3 &v1 = refVertices[i];
-    const glm::vec3 &v2 = refVertices[(i + 1) % numRefVerts]; // Next vertex
+    const glm::vec3 &v1 = refPolyhedron.vertices[ref.vertexIndices[i]];
+    const glm::vec3 &v2 = refPolyhedron.vertices[ref.vertexIndices[(i + 1) % numRefVerts]]; // Next vertex
 
     glm::vec3 edgeDirection = glm::normalize(v2 - v1);
 
@@ -640,10 +855,11 @@ generateContactManifoldAfterEPA(const Components::Collider &colliderA,
     Plane clippingPlane(planeNormal, v1);
 
     // Clip the current polygon against this plane
-    clippedVertices = clipPolygonAgainstPlane(clippedVertices, clippingPlane);
+    clipPolygonAgainstPlane(clipBuffers[current], clippingPlane, clipBuffers[1 - current]);
+    current = 1 - current;
 
     // If clipping resulted in no vertices, there's no contact patch
-    if (clippedVertices.empty()) {
+    if (clipBuffers[current].empty()) {
       return manifold; // Early exit
     }
   }
@@ -651,26 +867,31 @@ generateContactManifoldAfterEPA(const Components::Collider &colliderA,
   Plane referencePlane =
       Plane::calculateFacePlane(ref.vertexIndices, refPolyhedron.vertices);
 
-  constexpr float distanceTolerance = 1e-4f; // Tolerance for penetration check
+  const float distanceTolerance = contactTolerance; // Tolerance for penetration check
 
-  for (const glm::vec3 &point : clippedVertices) {
+  // reuse the other buffer for the points that are really in contact
+  const ContactPolygon &clippedVertices = clipBuffers[current];
+  ContactPolygon &candidates = clipBuffers[1 - current];
+  candidates.count = 0;
+  for (uint32_t i = 0; i < clippedVertices.count; i++) {
+    const glm::vec3 &point = clippedVertices[i];
     float dist = referencePlane.signedDistance(point);
 
     // If the point is behind or very close to the reference face plane
     if (dist <= distanceTolerance) {
       // Optional: Project point onto the reference plane for cleaner contacts
       // glm::vec3 contactPointOnPlane = point - dist * referencePlane.normal;
-      // manifold.points.push_back(contactPointOnPlane);
 
-      ContactPoint contactPoint;
-      contactPoint.position = point;
       // contactPoint.penetration = -dist/;
       // manifold.penetration = std::max(manifold.penetration, -dist); // get
       // positive value
-      manifold.points.push_back(contactPoint);
+      candidates.push_back(point);
     }
   }
 
+  // a face against a face can give a lot of points (cylinder like colliders), keep the 4 that matters
+  manifold.setPointsReduced(candidates.vertices.data(), candidates.count);
+
   return manifold;
 };
 
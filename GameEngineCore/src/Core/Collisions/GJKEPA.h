@@ -30,7 +30,8 @@ struct ContactManifold;
 struct Simplex;
 
 //std::pair<bool, Simplex> GJK(const Components::Collider& colliderA, const Components::Collider& colliderB);
-ContactManifold EPA(const Components::Collider* colliderA, const Components::Collider* colliderB);
+// speculativeDistance > 0 : if the shapes don't overlap but are closer than that, return a contact with a negative penetration (the gap)
+ContactManifold EPA(const Components::Collider* colliderA, const Components::Collider* colliderB, float speculativeDistance);
 //ContactManifold EPA(Simplex& simplex, const Components::Collider& colliderA, const Components::Collider& colliderB);
 
 
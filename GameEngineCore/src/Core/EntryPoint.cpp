@@ -1,6 +1,7 @@
 #include "EntryPoint.h"
 #include "Application.h"
 #include <iostream>
+#include <string>
 #include "Log/Log.h"
 
 extern Engine::Application::createInfo CreateAppInfo();
@@ -10,6 +11,36 @@ int main(int argc, char** argv)
     Engine::Log::Log::init(); 
 
     auto info = CreateAppInfo();
+
+    // --headless [--frames N] [--capture out.png] renders offscreen, for the golden images and benchmarks in ci
+    // --trace out.json [--trace-frames N] writes the cpu and gpu timelines of the first frames
+    // --clear-caches deletes the pipeline and reflection caches first, --startup-report prints the startup time (both
+    // for cmake/StartupBenchmark.cmake, with --headless --frames 0)
+    // --cpu-culling / --gpu-culling force a path of the renderer, --gpu-culling fails when the device can't do it
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            info.headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            info.frameCount = std::stoul(argv[++i]);
+        } else if (arg == "--capture" && i + 1 < argc) {
+            info.capturePath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            info.tracePath = argv[++i];
+        } else if (arg == "--trace-frames" && i + 1 < argc) {
+            info.traceFrames = std::stoul(argv[++i]);
+        } else if (arg == "--clear-caches") {
+            info.clearCaches = true;
+        } else if (arg == "--startup-report") {
+            info.startupReport = true;
+        } else if (arg == "--cpu-culling") {
+            info.cullingMode = Engine::Renderer::DefaultRenderer::CullingMode::Cpu;
+        } else if (arg == "--gpu-culling") {
+            info.cullingMode = Engine::Renderer::DefaultRenderer::CullingMode::Gpu;
+        } else {
+            LogWarning("unknown argument ", arg);
+        }
+    }
     Engine::Application app(info);
     app.Run();
 
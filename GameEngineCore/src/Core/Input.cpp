@@ -14,6 +14,10 @@ Input& Input::Instance() {
 Input::Input(GLFWwindow* window)
 : m_window(window)
 {
+    // headless
+    if (!window) {
+        return;
+    }
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     if (glfwRawMouseMotionSupported())
         glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
@@ -35,11 +39,15 @@ void Input::removeAllCallbacks() {
 }
 
 void Input::setCursorMode(int value) {
-    glfwSetInputMode(m_window, GLFW_CURSOR, value);
+    if (m_window) {
+        glfwSetInputMode(m_window, GLFW_CURSOR, value);
+    }
 }
 
 void Input::setInputMode(int mode, int value) {
-    glfwSetInputMode(m_window, mode, value);
+    if (m_window) {
+        glfwSetInputMode(m_window, mode, value);
+    }
 }
 
 void Input::addOnKeyPressed(std::function<void(int)> callback) {
@@ -51,6 +59,9 @@ void Input::addOnKeyReleased(std::function<void(int)> callback) {
 }
 
 bool Input::isKeyPressed(int key){
+    if (!m_window) {
+        return false;
+    }
     return glfwGetKey(m_window, key);
 }
 
@@ -1,11 +1,18 @@
 #include "DefaultRenderer.h"
 #include "Lights.h"
 #include "VulkanApi.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <cstring>
-#include <map>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include "Core/Ressources/DescriptorsManager.h"
 #include "Core/Ressources/UniformBuffer.h"
+#include "Core/Ressources/MaterialTable.h"
+#include "Core/Ressources/StagingRing.h"
+#include "Core/Ressources/TextureStreamer.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "Core/Scene/Entities/Entity.h"
@@ -13,6 +20,12 @@
 //TODO: remove this
 #include "Core/Scene/Components/MeshRenderer.h"
 #include "Core/Scene/Components/Camera.h"
+#include "Core/Scene/Components/Transform.h"
+#include "Core/Ressources/Mesh.h"
+#include "Core/Log/Log.h"
+#include "Core/Utils/ThreadPool.h"
+#include "Core/Utils/Profiler.h"
+#include "GpuCulling.h"
 #include "Core/Renderer/Lights.h"
 #include "Core/Scene/Components/PointLight.h"
 #include "Core/Scene/Components/DirectionalLight.h"
@@ -21,16 +34,20 @@
 namespace Engine {
 namespace Renderer {
 
-DefaultRenderer::DefaultRenderer()
+DefaultRenderer::DefaultRenderer(CullingMode cullingMode)
     : Renderer()
 {
     auto maxFramesInFlight = VulkanApi::Instance().getMaxFramesInFlight();
     m_globalDescriptorSets.resize(maxFramesInFlight);
-    m_modelDescriptorSets.resize(maxFramesInFlight);
+    m_objectDescriptorSets.resize(maxFramesInFlight);
 
     m_globalUniformBuffer = std::make_unique<Ressources::UniformBuffer>(sizeof(GlobalUniformBufferObject), maxFramesInFlight);
-    m_modelUniformBuffer = std::make_unique<Ressources::UniformBuffer>(sizeof(glm::mat4) * MAX_OBJECTS, maxFramesInFlight);
     m_lightsUniformBuffer = std::make_unique<Ressources::UniformBuffer>(sizeof(LightEnvironment), maxFramesInFlight);
+    m_objectBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(ObjectData) * INITIAL_OBJECT_CAPACITY, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_pointLightBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(PointLight) * MAX_POINT_LIGHTS, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_clusterBuffer = std::make_unique<Ressources::InstanceBuffer>(
+        sizeof(LightClusters::ClusterRange) * LightClusters::CLUSTER_COUNT + sizeof(uint32_t) * INITIAL_LIGHT_INDEX_CAPACITY,
+        maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
     // Set up global descriptor sets
     for (size_t i = 0; i < maxFramesInFlight; i++) {
@@ -44,140 +61,672 @@ DefaultRenderer::DefaultRenderer()
         lightsBufferInfo.offset = 0;
         lightsBufferInfo.range = sizeof(LightEnvironment); // Size of one model matrix
 
+        VkDescriptorBufferInfo pointLightBufferInfo{};
+        pointLightBufferInfo.buffer = m_pointLightBuffer->getBuffer(i);
+        pointLightBufferInfo.offset = 0;
+        pointLightBufferInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo clusterBufferInfo{};
+        clusterBufferInfo.buffer = m_clusterBuffer->getBuffer(i);
+        clusterBufferInfo.offset = 0;
+        clusterBufferInfo.range = VK_WHOLE_SIZE;
+
         auto descriptorBuilder = Engine::Ressources::DescriptorBuilder();
         descriptorBuilder
             .bind_buffer(0, &globalBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-            .bind_buffer(1, &lightsBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
+            .bind_buffer(1, &lightsBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .bind_buffer(2, &pointLightBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .bind_buffer(3, &clusterBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
         /*m_globalDescriptorSets[i] = descriptorBuilder.build(&globalDescriptorLayout);*/
         m_globalDescriptorSets[i] = descriptorBuilder.build();
 
-        // Set up model descriptor sets with dynamic uniform buffer
-        VkDescriptorBufferInfo modelBufferInfo{};
-        modelBufferInfo.buffer = m_modelUniformBuffer->getBuffer(i);
-        modelBufferInfo.offset = 0;
-        modelBufferInfo.range = sizeof(glm::mat4); // Size of one model matrix
+        // Set up the object table descriptor sets (one storage buffer per frame)
+        VkDescriptorBufferInfo objectBufferInfo{};
+        objectBufferInfo.buffer = m_objectBuffer->getBuffer(i);
+        objectBufferInfo.offset = 0;
+        objectBufferInfo.range = VK_WHOLE_SIZE;
 
         descriptorBuilder = Engine::Ressources::DescriptorBuilder();
         descriptorBuilder
-            .bind_buffer(0, &modelBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT);
-        /*m_modelDescriptorSets[i] = descriptorBuilder.build(&modelDescriptorLayout);*/
-        m_modelDescriptorSets[i] = descriptorBuilder.build();
+            .bind_buffer(0, &objectBufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+        m_objectDescriptorSets[i] = descriptorBuilder.build();
+    }
+
+    // lavapipe and desktop drivers, MoltenVK stays on the cpu culling
+    bool gpuDriven = VulkanApi::Instance().supportsGpuDrivenRendering();
+    if (cullingMode == CullingMode::Gpu && !gpuDriven) {
+        throw std::runtime_error("the gpu culling needs drawIndirectCount and multiDrawIndirect!");
+    }
+    if (gpuDriven && cullingMode != CullingMode::Cpu) {
+        m_gpuCulling = std::make_unique<GpuCulling>(sizeof(ObjectData), INITIAL_OBJECT_CAPACITY);
     }
+
+    // one chunk per thread that runs the parallelFor and one for the renderers that draw themselves
+    m_secondaryCommandBuffers = std::make_unique<SecondaryCommandBuffers>(Utils::ThreadPool::Instance().getWorkerCount() + 2);
 }
 
-uint32_t DefaultRenderer::allocateModelBufferIndex() {
-    // If we have free indices available, use one of those
-    if (!m_freeIndices.empty()) {
-        uint32_t index = m_freeIndices.back();
-        m_freeIndices.pop_back();
-        return index;
+// The buffer of this frame was waited on in beginFrame so it can be recreated bigger right away, the other frames
+// keep theirs until it's their turn. The descriptor set of this frame isn't used by the gpu anymore either.
+void DefaultRenderer::reserveObjects(uint32_t objectCount) {
+    if (!m_objectBuffer->reserve(objectCount * sizeof(ObjectData), m_currentFrame)) {
+        return;
+    }
+
+    VkDescriptorBufferInfo objectBufferInfo{};
+    objectBufferInfo.buffer = m_objectBuffer->getBuffer(m_currentFrame);
+    objectBufferInfo.offset = 0;
+    objectBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_objectDescriptorSets[m_currentFrame];
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &objectBufferInfo;
+
+    VulkanApi::Instance().updateDescriptorSets(1, &write, 0, nullptr);
+}
+
+// Point lights over MAX_POINT_LIGHTS are dropped. Like the object table, the cluster buffer of this frame is free and
+// can grow right away
+void DefaultRenderer::updateLights(Engine::Scene& scene, const glm::mat4& view, const glm::mat4& proj, float nearPlane, float farPlane) {
+    LightEnvironment lightEnvironment{};
+    uint32_t directionalLightIndex = 0;
+
+    // gathered on the cpu first, the binning reads them and the mapped memory is slow to read
+    m_pointLights.clear();
+    auto& pointLights = scene.getComponents<Components::PointLight>();
+    for (auto& pointLight : pointLights){
+        if (m_pointLights.size() >= MAX_POINT_LIGHTS) {
+            break;
+        }
+        m_pointLights.push_back(pointLight.lightInfo);
+    }
+    uint32_t pointLightIndex = (uint32_t)m_pointLights.size();
+    memcpy(m_pointLightBuffer->getMappedMemory(m_currentFrame), m_pointLights.data(), pointLightIndex * sizeof(PointLight));
+
+    auto& dirLights = scene.getComponents<Components::DirectionalLight>();
+    for (auto& dirLight : dirLights){
+        if (directionalLightIndex >= MAX_DIRECTIONAL_LIGHTS) {
+            break;
+        }
+        lightEnvironment.directionalLights[directionalLightIndex] = dirLight.lightInfo;
+        directionalLightIndex ++;
     }
 
-    // If no free indices and we haven't reached the limit, create a new one
-    if (m_nextModelBufferIndex >= MAX_OBJECTS) {
-        throw std::runtime_error("Exceeded maximum number of objects");
+    auto swapChainExtent = VulkanApi::Instance().getSwapChainExtent();
+    m_lightClusters.setProjection(proj, nearPlane, farPlane, (float)swapChainExtent.width, (float)swapChainExtent.height);
+    m_lightClusters.build(m_pointLights.data(), pointLightIndex, view);
+
+    const std::vector<LightClusters::ClusterRange>& clusters = m_lightClusters.getClusters();
+    const std::vector<uint32_t>& lightIndices = m_lightClusters.getLightIndices();
+    size_t clustersSize = clusters.size() * sizeof(LightClusters::ClusterRange);
+    size_t indicesSize = std::max<size_t>(lightIndices.size(), 1) * sizeof(uint32_t);
+
+    if (m_clusterBuffer->reserve(clustersSize + indicesSize, m_currentFrame)) {
+        VkDescriptorBufferInfo clusterBufferInfo{};
+        clusterBufferInfo.buffer = m_clusterBuffer->getBuffer(m_currentFrame);
+        clusterBufferInfo.offset = 0;
+        clusterBufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_globalDescriptorSets[m_currentFrame];
+        write.dstBinding = 3;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &clusterBufferInfo;
+
+        VulkanApi::Instance().updateDescriptorSets(1, &write, 0, nullptr);
     }
-    
-    return m_nextModelBufferIndex++;
+
+    char* clusterData = (char*)m_clusterBuffer->getMappedMemory(m_currentFrame);
+    memcpy(clusterData, clusters.data(), clustersSize);
+    memcpy(clusterData + clustersSize, lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+
+    lightEnvironment.nbDirectionalLight = directionalLightIndex;
+    lightEnvironment.nbPointLight = pointLightIndex;
+    lightEnvironment.clusterTileSize = m_lightClusters.getTileSize();
+    lightEnvironment.clusterSliceScale = m_lightClusters.getSliceScale();
+    lightEnvironment.clusterSliceBias = m_lightClusters.getSliceBias();
+
+    m_lightsUniformBuffer->updateData(&lightEnvironment, sizeof(LightEnvironment), m_frameInfo.frameIndex);
 }
 
-void DefaultRenderer::deallocateModelBufferIndex(uint32_t index) {
-    // Validate the index
-    if (index >= m_nextModelBufferIndex) {
-        throw std::runtime_error("Invalid model buffer index deallocation");
+// the spheres of the meshes are moved to world space and tested against the camera, big scenes use the worker threads
+// the renderers that draw themselves (and meshes without bounds) are never culled
+void DefaultRenderer::cullRenderers(const std::vector<Components::Renderer*>& renderers, const glm::mat4& viewProjection) {
+    uint32_t count = (uint32_t)renderers.size();
+    m_cullingModels.resize(count);
+    m_frustumCuller.resize(count);
+
+    Utils::ThreadPool::Instance().parallelFor(count, MIN_RENDERERS_PER_CULLING_THREAD, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            Ressources::Mesh* mesh = renderers[i]->getInstancedMesh();
+            if (mesh) {
+                m_cullingModels[i] = renderers[i]->getTransform()->getModelMatrix();
+            }
+            if (!mesh || !mesh->getBounds().has_value()) {
+                m_frustumCuller.setSphere(i, glm::vec3(0.0f), std::numeric_limits<float>::max());
+                continue;
+            }
+
+            const glm::mat4& model = m_cullingModels[i];
+            const Ressources::MeshBounds& bounds = mesh->getBounds().value();
+
+            glm::vec3 center = model * glm::vec4(bounds.center, 1.0f);
+            float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))});
+            m_frustumCuller.setSphere(i, center, bounds.radius * scale);
+        }
+    });
+
+    m_frustumCuller.cull(Frustum::fromViewProjection(viewProjection));
+}
+
+// Every drawn renderer becomes a (key, index) entry, sorted so the draws with the same pipeline, then material, then
+// mesh are next to each other and the meshes are front to back. The renderers that draw themselves come last
+void DefaultRenderer::buildQueue(const std::vector<Components::Renderer*>& renderers, bool onlyVisible, const glm::mat4& view) {
+    uint32_t count = (uint32_t)renderers.size();
+    m_drawItems.resize(count);
+    m_renderQueue.clear();
+    m_renderQueue.reserve(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (onlyVisible && !m_frustumCuller.isVisible(i)) {
+            continue;
+        }
+
+        DrawItem& item = m_drawItems[i];
+        item.renderer = renderers[i];
+        item.material = item.renderer->getMaterial().lock().get();
+        item.materialTemplate = item.material->getMaterialTemplate();
+        item.mesh = item.renderer->getInstancedMesh();
+
+        // still building on a worker thread (PipelineBuilder), drawn once it's done
+        if (!item.materialTemplate->isReady()) {
+            continue;
+        }
+
+        // bindless materials all share the set of the MaterialTable, they are sorted by mesh only
+        uint32_t materialKey = item.material->isBindless() ? 0 : item.material->getIndex();
+        uint64_t key;
+        item.lod = 0;
+        if (item.mesh) {
+            ProjectedBounds bounds;
+            float pixels = std::numeric_limits<float>::max();
+            if (projectBounds(item.mesh, m_cullingModels[i], view, bounds)) {
+                item.lod = selectLod(item.renderer, item.mesh, bounds);
+                // the texture is taken as covering the whole mesh once
+                if (bounds.distance > 0.0f) {
+                    pixels = 2.0f * bounds.radius * m_lodProjectionScale / bounds.distance;
+                }
+            }
+            if (item.material->hasStreamedTextures()) {
+                requestTextures(item.material, pixels);
+            }
+            // the camera looks down -z in view space
+            float depth = -(view * m_cullingModels[i][3]).z;
+            // the levels of a mesh are different draws, next to each other
+            uint32_t meshKey = (item.mesh->getIndex() << 3) | item.lod;
+            key = RenderQueue::makeKey(RenderQueue::Pass::Opaque, item.materialTemplate->getIndex(), materialKey, meshKey, depth);
+        } else {
+            // no bounds to know its size, the full resolution
+            if (item.material->hasStreamedTextures()) {
+                requestTextures(item.material, std::numeric_limits<float>::max());
+            }
+            key = RenderQueue::makeKey(RenderQueue::Pass::Custom, item.materialTemplate->getIndex(), materialKey, 0, 0.0f);
+        }
+        m_renderQueue.push(key, i);
+    }
+
+    m_renderQueue.sort();
+}
+
+bool DefaultRenderer::projectBounds(const Ressources::Mesh* mesh, const glm::mat4& model, const glm::mat4& view, ProjectedBounds& bounds) const {
+    if (!mesh->getBounds().has_value()) {
+        return false;
     }
+    const Ressources::MeshBounds& meshBounds = mesh->getBounds().value();
+    bounds.scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))});
+    bounds.radius = meshBounds.radius * bounds.scale;
+    glm::vec3 center = view * model * glm::vec4(meshBounds.center, 1.0f);
+    bounds.distance = glm::length(center) - bounds.radius;
+    return true;
+}
 
-    // Check if this index is already in the free list
-    if (std::find(m_freeIndices.begin(), m_freeIndices.end(), index) != m_freeIndices.end()) {
-        throw std::runtime_error("Attempting to deallocate already freed index");
+// The error of a level is a distance in the local space of the mesh, scaled by the biggest axis of the model and
+// projected at the distance of the closest point of the bounds. The renderer keeps its level while it's inside the
+// hysteresis margin
+uint32_t DefaultRenderer::selectLod(Components::Renderer* renderer, const Ressources::Mesh* mesh, const ProjectedBounds& bounds) const {
+    uint32_t lodCount = mesh->getLodCount();
+    if (lodCount <= 1) {
+        return 0;
+    }
+    // the camera is inside the bounds
+    if (bounds.distance <= 0.0f) {
+        renderer->setLod(0);
+        return 0;
     }
 
-    // Add the index to the free list for reuse
-    m_freeIndices.push_back(index);
+    float pixelsPerError = bounds.scale * m_lodProjectionScale * m_lodBias / bounds.distance;
+    auto projectedError = [&](uint32_t lod) { return mesh->getLod(lod).error * pixelsPerError; };
+
+    uint32_t current = std::min(renderer->getLod(), lodCount - 1);
+    uint32_t lod = current;
+    while (lod > 0 && projectedError(lod) > m_lodThreshold * (1.0f + LOD_HYSTERESIS)) {
+        lod--;
+    }
+    if (lod == current) {
+        while (lod + 1 < lodCount && projectedError(lod + 1) <= m_lodThreshold * (1.0f - LOD_HYSTERESIS)) {
+            lod++;
+        }
+    }
+
+    renderer->setLod(lod);
+    return lod;
+}
+
+void DefaultRenderer::requestTextures(Ressources::Material* material, float pixels) {
+    Ressources::TextureStreamer& streamer = Ressources::TextureStreamer::Instance();
+    for (const std::shared_ptr<Ressources::Texture>& texture : material->getTextures()) {
+        if (texture->isStreamed()) {
+            streamer.request(texture.get(), pixels);
+        }
+    }
+}
+
+void DefaultRenderer::buildRuns() {
+    const std::vector<RenderQueue::Entry>& entries = m_renderQueue.getEntries();
+    m_runs.clear();
+
+    // the pointers are compared, two ids truncated in the key to the same bits only split the run
+    uint32_t first = 0;
+    while (first < entries.size() && m_drawItems[entries[first].index].mesh) {
+        const DrawItem& firstItem = m_drawItems[entries[first].index];
+        uint32_t last = first + 1;
+        while (last < entries.size()) {
+            const DrawItem& item = m_drawItems[entries[last].index];
+            if (!item.mesh || item.materialTemplate != firstItem.materialTemplate || item.mesh != firstItem.mesh || item.lod != firstItem.lod) {
+                break;
+            }
+            // a bindless material is read with the materialIndex of each instance
+            if (!item.material->isBindless() && item.material != firstItem.material) {
+                break;
+            }
+            last++;
+        }
+        m_runs.push_back({first, last, 0});
+        first = last;
+
+        // named here on the main thread, the recording threads only read them
+        if (getGpuProfiler()) {
+            uint32_t templateIndex = firstItem.materialTemplate->getIndex();
+            if (templateIndex >= m_templateScopeNames.size()) {
+                m_templateScopeNames.resize(templateIndex + 1, nullptr);
+            }
+            if (!m_templateScopeNames[templateIndex]) {
+                m_templateScopeNames[templateIndex] = Utils::Profiler::Instance().intern("material template " + std::to_string(templateIndex));
+            }
+        }
+    }
+
+    // the custom pass is sorted after the opaque one
+    m_customFirst = first;
+}
+
+void DefaultRenderer::buildDrawRanges() {
+    const std::vector<RenderQueue::Entry>& entries = m_renderQueue.getEntries();
+    m_drawRanges.clear();
+
+    for (uint32_t runIndex = 0; runIndex < m_runs.size(); runIndex++) {
+        const DrawItem& item = m_drawItems[entries[m_runs[runIndex].first].index];
+        if (!m_drawRanges.empty()) {
+            const DrawItem& previous = m_drawItems[entries[m_runs[runIndex - 1].first].index];
+            // the same template has the same pipeline and is bindless or not for all its materials
+            bool sameMaterial = item.material == previous.material || item.material->isBindless();
+            bool sameBuffers = item.mesh == previous.mesh || (item.mesh->isPooled() && previous.mesh->isPooled());
+            if (item.materialTemplate == previous.materialTemplate && sameMaterial && sameBuffers) {
+                m_drawRanges.back().lastRun = runIndex + 1;
+                m_runs[runIndex].drawRange = (uint32_t)m_drawRanges.size() - 1;
+                continue;
+            }
+        }
+        m_drawRanges.push_back({runIndex, runIndex + 1});
+        m_runs[runIndex].drawRange = (uint32_t)m_drawRanges.size() - 1;
+    }
+}
+
+void DefaultRenderer::bindPipeline(RecordState& state, Ressources::MaterialTemplate* materialTemplate) {
+    if (materialTemplate == state.boundPipeline) {
+        return;
+    }
+
+    materialTemplate->bindPipeline(state.frameInfo);
+
+    // every pipeline has the same set 0 and 1 layouts but they are bound again in case the layout isn't compatible
+    VkDescriptorSet frameSets[] = {state.frameInfo.globalSet, state.frameInfo.objectsSet};
+    VulkanApi::Instance().cmdBindDescriptorSets(state.frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, materialTemplate->getPipeline()->getPipelineLayout(), 0, 2, frameSets, 0, nullptr);
+
+    if (materialTemplate->isBindless()) {
+        // every material of the template is in this set, bindMaterial has nothing to do
+        Ressources::MaterialTable::Instance().bind(state.frameInfo.commandBuffer, materialTemplate->getPipeline()->getPipelineLayout());
+    }
+
+    state.boundPipeline = materialTemplate;
+    state.boundMaterial = nullptr; // set 2 is a different layout for every template
+    state.stats.pipelineBinds++;
+}
+
+void DefaultRenderer::bindMaterial(RecordState& state, Ressources::Material* material) {
+    if (material == state.boundMaterial || material->isBindless()) {
+        return;
+    }
+    material->bindDescriptorSet(state.frameInfo);
+    state.boundMaterial = material;
+    state.stats.materialBinds++;
+}
+
+void DefaultRenderer::bindMesh(RecordState& state, Ressources::Mesh* mesh) {
+    if (mesh == state.boundMesh) {
+        return;
+    }
+    // the meshes of the GeometryPool share their buffers, only the draw parameters change
+    if (!mesh->isPooled() || !state.boundMesh || !state.boundMesh->isPooled()) {
+        mesh->bind(state.frameInfo);
+        state.stats.meshBinds++;
+    }
+    state.boundMesh = mesh;
+}
+
+// they bind their own material and buffers, nothing can be skipped after them
+void DefaultRenderer::renderCustom(RecordState& state, const DrawItem& item) {
+    bindPipeline(state, item.materialTemplate);
+    item.renderer->render(state.frameInfo);
+
+    state.boundMaterial = nullptr;
+    state.boundMesh = nullptr;
+    state.stats.drawCalls++;
+}
+
+void DefaultRenderer::recordRuns(RecordState& state, uint32_t firstRun, uint32_t lastRun, bool gpuCulled) {
+    const std::vector<RenderQueue::Entry>& entries = m_renderQueue.getEntries();
+    ObjectData* objects = (ObjectData*)m_objectBuffer->getMappedMemory(m_currentFrame);
+    GpuProfiler* profiler = getGpuProfiler();
+
+    for (uint32_t runIndex = firstRun; runIndex < lastRun; runIndex++) {
+        const DrawRun& run = m_runs[runIndex];
+        const DrawItem& item = m_drawItems[entries[run.first].index];
+        uint32_t instanceCount = run.last - run.first;
+
+        // the gpu path wrote them before the culling
+        if (!gpuCulled) {
+            for (uint32_t i = run.first; i < run.last; i++) {
+                ObjectData& object = objects[i];
+                const glm::mat4& model = m_cullingModels[entries[i].index];
+                // quantized positions are scaled back by the model matrix, the normals don't see it
+                object.model = model * item.mesh->getDequantization();
+                object.normalMatrix = glm::transpose(glm::inverse(model));
+                // per instance, a run of bindless materials has several
+                object.materialIndex = m_drawItems[entries[i].index].material->getIndex();
+            }
+        }
+
+        // the queue is sorted by template first, a chunk of the parallel recording can split a group in two scopes
+        if (profiler && item.materialTemplate != state.profiledTemplate) {
+            profiler->endScope(state.frameInfo.commandBuffer, state.groupScope);
+            state.groupScope = profiler->beginScope(state.frameInfo.commandBuffer, m_templateScopeNames[item.materialTemplate->getIndex()]);
+            state.profiledTemplate = item.materialTemplate;
+        }
+
+        bindPipeline(state, item.materialTemplate);
+        bindMaterial(state, item.material);
+        bindMesh(state, item.mesh);
+        if (!gpuCulled) {
+            item.mesh->draw(state.frameInfo, instanceCount, run.first, item.lod);
+            state.stats.drawCalls++;
+        } else if (m_drawRanges[run.drawRange].firstRun == runIndex) {
+            // the binds of the other runs of the range do nothing, one indirect draw for all their batches
+            const DrawRange& range = m_drawRanges[run.drawRange];
+            m_gpuCulling->drawRange(state.frameInfo, run.drawRange, range.firstRun, range.lastRun - range.firstRun);
+            state.stats.drawCalls++;
+        }
+        state.stats.instances += instanceCount;
+        state.stats.triangles += instanceCount * (item.mesh->getIndexCount(item.lod) / 3);
+    }
+
+    if (profiler) {
+        profiler->endScope(state.frameInfo.commandBuffer, state.groupScope);
+        state.groupScope = GpuProfiler::NO_SCOPE;
+        state.profiledTemplate = nullptr;
+    }
+}
+
+void DefaultRenderer::recordCustoms(RecordState& state) {
+    const std::vector<RenderQueue::Entry>& entries = m_renderQueue.getEntries();
+    if (m_customFirst == entries.size()) {
+        return;
+    }
+    GpuProfiler::Scope scope(getGpuProfiler(), state.frameInfo.commandBuffer, "custom renderers");
+    for (size_t i = m_customFirst; i < entries.size(); i++) {
+        renderCustom(state, m_drawItems[entries[i].index]);
+    }
+}
+
+// The runs are split in contiguous chunks, each recorded by one thread in its own secondary command buffer with its
+// own bound state. The primary executes them in order so the draws keep the order of the queue. The renderers that
+// draw themselves go in one more secondary recorded here, after the others
+void DefaultRenderer::recordDraws(bool gpuCulled) {
+    Utils::Profiler::Scope profilerScope("record draws");
+    uint32_t runCount = (uint32_t)m_runs.size();
+    // on the gpu path the chunks are split between draw ranges, the indirect draw of a range is recorded with its first run
+    uint32_t splitCount = gpuCulled ? (uint32_t)m_drawRanges.size() : runCount;
+    uint32_t chunkCount = std::min(splitCount / MIN_RUNS_PER_RECORDING_CHUNK, m_secondaryCommandBuffers->getMaxChunkCount() - 1);
+    auto chunkFirstRun = [&](uint32_t chunk) {
+        uint32_t split = (uint32_t)((uint64_t)chunk * splitCount / chunkCount);
+        if (!gpuCulled) {
+            return split;
+        }
+        return split < splitCount ? m_drawRanges[split].firstRun : runCount;
+    };
+
+    if (m_recordingMode == RecordingMode::Inline || chunkCount < 2) {
+        beginRenderPass();
+
+        RecordState state{};
+        state.frameInfo = m_frameInfo;
+        recordRuns(state, 0, runCount, gpuCulled);
+        recordCustoms(state);
+        m_renderStats = state.stats;
+        return;
+    }
+
+    beginRenderPass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    VkFramebuffer framebuffer = VulkanApi::Instance().getSwapChainFrameBuffer(m_currentImageIndex);
+    m_recordStates.assign(chunkCount + 1, RecordState{});
+    for (RecordState& state : m_recordStates) {
+        state.frameInfo = m_frameInfo;
+    }
+
+    auto recordChunk = [&](uint32_t chunk) {
+        RecordState& state = m_recordStates[chunk];
+        state.frameInfo.commandBuffer = m_secondaryCommandBuffers->begin(m_currentFrame, chunk, framebuffer);
+        setViewportAndScissor(state.frameInfo.commandBuffer);
+        if (chunk < chunkCount) {
+            recordRuns(state, chunkFirstRun(chunk), chunkFirstRun(chunk + 1), gpuCulled);
+        } else {
+            recordCustoms(state);
+        }
+        m_secondaryCommandBuffers->end(state.frameInfo.commandBuffer);
+    };
+
+    Utils::ThreadPool::Instance().parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t chunk = begin; chunk < end; chunk++) {
+            recordChunk(chunk);
+        }
+    });
+    recordChunk(chunkCount);
+
+    m_secondaryCommandBuffers->execute(m_frameInfo.commandBuffer, m_currentFrame, chunkCount + 1);
+
+    m_renderStats = RenderStats{};
+    for (const RecordState& state : m_recordStates) {
+        m_renderStats.pipelineBinds += state.stats.pipelineBinds;
+        m_renderStats.materialBinds += state.stats.materialBinds;
+        m_renderStats.meshBinds += state.stats.meshBinds;
+        m_renderStats.drawCalls += state.stats.drawCalls;
+        m_renderStats.instances += state.stats.instances;
+        m_renderStats.triangles += state.stats.triangles;
+    }
+}
+
+void DefaultRenderer::renderCpuCulled(const std::vector<Components::Renderer*>& renderers, const glm::mat4& view, const glm::mat4& viewProjection) {
+    {
+        Utils::Profiler::Scope profilerScope("culling");
+        cullRenderers(renderers, viewProjection);
+    }
+    {
+        Utils::Profiler::Scope profilerScope("build queue");
+        buildQueue(renderers, true, view);
+        buildRuns();
+    }
+
+    // one cmdDrawIndexed for each run of renderers with the same material and mesh
+    recordDraws(false);
+}
+
+// Every renderer with a mesh goes in the object table with its bounds, gpuCull.comp decides what is drawn.
+// The renderers that draw themselves are never culled, like on the cpu path
+void DefaultRenderer::renderGpuCulled(const std::vector<Components::Renderer*>& renderers, const glm::mat4& view, const glm::mat4& viewProjection) {
+    uint32_t count = (uint32_t)renderers.size();
+    m_cullingModels.resize(count);
+    Utils::ThreadPool::Instance().parallelFor(count, MIN_RENDERERS_PER_CULLING_THREAD, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            if (renderers[i]->getInstancedMesh()) {
+                m_cullingModels[i] = renderers[i]->getTransform()->getModelMatrix();
+            }
+        }
+    });
+
+    {
+        Utils::Profiler::Scope profilerScope("build queue");
+        buildQueue(renderers, false, view);
+        buildRuns();
+        buildDrawRanges();
+    }
+    const std::vector<RenderQueue::Entry>& entries = m_renderQueue.getEntries();
+
+    // the runs start at entry 0 so the objects are the entries before m_customFirst
+    uint32_t objectCount = m_customFirst;
+    uint32_t batchCount = (uint32_t)m_runs.size();
+    uint32_t drawRangeCount = (uint32_t)m_drawRanges.size();
+
+    // one batch per run, the visible batches of a draw range are packed from the command of its first run
+    m_gpuCulling->reserve(m_currentFrame, m_objectBuffer->getBuffer(m_currentFrame), objectCount, batchCount, drawRangeCount);
+    ObjectData* objects = (ObjectData*)m_objectBuffer->getMappedMemory(m_currentFrame);
+    GpuCulling::ObjectBounds* bounds = m_gpuCulling->getObjectBounds(m_currentFrame);
+    GpuCulling::Batch* batches = m_gpuCulling->getBatches(m_currentFrame);
+
+    for (uint32_t batchIndex = 0; batchIndex < batchCount; batchIndex++) {
+        const DrawRun& run = m_runs[batchIndex];
+        const DrawItem& item = m_drawItems[entries[run.first].index];
+
+        GpuCulling::Batch& batch = batches[batchIndex];
+        batch.indexCount = item.mesh->getIndexCount(item.lod);
+        batch.firstIndex = item.mesh->getFirstIndex(item.lod);
+        batch.vertexOffset = item.mesh->getVertexOffset();
+        batch.firstInstance = run.first;
+        batch.drawRangeFirst = m_drawRanges[run.drawRange].firstRun;
+        batch.drawRange = run.drawRange;
+
+        glm::vec4 sphere(0.0f, 0.0f, 0.0f, -1.0f);
+        if (item.mesh->getBounds().has_value()) {
+            sphere = glm::vec4(item.mesh->getBounds()->center, item.mesh->getBounds()->radius);
+            // the culling uses object.model which has the dequantization, the sphere goes in the quantized space.
+            // The radius is divided by the smallest scale so it stays around the mesh after the non uniform scale
+            if (item.mesh->getVertexFormat() == Ressources::Mesh::VertexFormat::Quantized) {
+                const glm::mat4& dequantization = item.mesh->getDequantization();
+                glm::vec3 extent(dequantization[0][0], dequantization[1][1], dequantization[2][2]);
+                glm::vec3 center = (glm::vec3(sphere) - glm::vec3(dequantization[3])) / extent;
+                sphere = glm::vec4(center, sphere.w / std::min(extent.x, std::min(extent.y, extent.z)));
+            }
+        }
+
+        for (uint32_t i = run.first; i < run.last; i++) {
+            ObjectData& object = objects[i];
+            const glm::mat4& model = m_cullingModels[entries[i].index];
+            object.model = model * item.mesh->getDequantization();
+            object.normalMatrix = glm::transpose(glm::inverse(model));
+            object.materialIndex = m_drawItems[entries[i].index].material->getIndex();
+
+            bounds[i].sphere = sphere;
+            bounds[i].batch = batchIndex;
+        }
+    }
+
+    {
+        GpuProfiler::Scope scope(getGpuProfiler(), m_frameInfo.commandBuffer, "gpu culling");
+        m_gpuCulling->cull(m_frameInfo, viewProjection, objectCount, batchCount, drawRangeCount);
+    }
+
+    // the vertex shaders read the visible objects, packed by the culling
+    m_frameInfo.objectsSet = m_gpuCulling->getVisibleObjectsSet(m_currentFrame);
+
+    recordDraws(true);
 }
 
 void DefaultRenderer::render(Engine::Scene& scene) {
     beginFrame();
-    beginRenderPass();
 
-    GlobalUniformBufferObject ubo{};
-    {
-        Engine::Components::Camera* camera = scene.getEntityByTag("Main Camera").value()->getComponent<Engine::Components::Camera>().value();
-        ubo.view = camera->getViewMatrix();
-        auto swapChainExtent = VulkanApi::Instance().getSwapChainExtent();
-        ubo.proj = camera->getProjectionMatrix(swapChainExtent.width / (float)swapChainExtent.height);
+    m_renderStats = RenderStats{};
+    // this frame's fence was waited on, its secondary command buffers can be recorded again
+    m_secondaryCommandBuffers->reset(m_currentFrame);
+
+    if (Ressources::MaterialTable::IsEnabled()) {
+        Ressources::MaterialTable::Instance().beginFrame();
     }
+    // before the render pass, the materials whose textures change get their new descriptors before they are drawn
+    if (Ressources::TextureStreamer::IsEnabled()) {
+        Utils::Profiler::Scope profilerScope("texture streaming");
+        GpuProfiler::Scope scope(getGpuProfiler(), m_frameInfo.commandBuffer, "texture streaming");
+        Ressources::TextureStreamer::Instance().update(m_frameInfo.commandBuffer, m_currentFrame);
+    }
+
+    GlobalUniformBufferObject ubo{};
+    Engine::Components::Camera* camera = scene.getEntityByTag("Main Camera").value()->getComponent<Engine::Components::Camera>().value();
+    ubo.view = camera->getViewMatrix();
+    auto swapChainExtent = VulkanApi::Instance().getSwapChainExtent();
+    ubo.proj = camera->getProjectionMatrix(swapChainExtent.width / (float)swapChainExtent.height);
+    // proj[1][1] is 1 / tan(fov / 2), half the height of the frame is that many units at a distance of 1
+    m_lodProjectionScale = std::abs(ubo.proj[1][1]) * swapChainExtent.height * 0.5f;
 
     m_globalUniformBuffer->updateData(&ubo, sizeof(GlobalUniformBufferObject), m_currentFrame);
     m_frameInfo.globalSet = m_globalDescriptorSets[m_currentFrame];
 
-    // Get the pipeline layout from the first renderer component we find
-    // since all pipelines should share the same global descriptor set layout
-    VkPipelineLayout* pipelineLayout = nullptr;
+    // the buffer uploads queued since the last frame and by the updates above are copied before the culling and the
+    // render pass read them, what is written after this (host visible only) needs no copy
+    Ressources::StagingRing::Instance().flush(m_frameInfo.commandBuffer);
+
     auto rendererComponents = scene.getComponentsRigistry().getAllElementOfType<Components::Renderer>();
     if (rendererComponents.size() <= 0){
+        beginRenderPass();
         endRenderPass();
         endFrame();
         return;
     }
-    pipelineLayout = &rendererComponents[0]->getMaterial().lock()->getMaterialTemplate()->getPipeline()->getPipelineLayout();
-
-
-    // get all the lights
-    LightEnvironment lightEnvironment;
-    int pointLightIndex = 0;
-    int directionalLightIndex = 0;
-
-    auto& pointLights = scene.getComponents<Components::PointLight>();
-    for (auto& pointLight : pointLights){
-        lightEnvironment.pointLights[pointLightIndex] = pointLight.lightInfo;
-        pointLightIndex ++;
-    }
-    
-    auto& dirLights = scene.getComponents<Components::DirectionalLight>();
-    for (auto& dirLight : dirLights){
-        lightEnvironment.directionalLights[directionalLightIndex] = dirLight.lightInfo;
-        directionalLightIndex ++;
-    }
 
-    lightEnvironment.nbDirectionalLight = directionalLightIndex;
-    lightEnvironment.nbPointLight = pointLightIndex;
+    updateLights(scene, ubo.view, ubo.proj, camera->nearPlane, camera->farPlane);
 
-    m_lightsUniformBuffer->updateData(&lightEnvironment, sizeof(LightEnvironment), m_frameInfo.frameIndex);
+    // at most one object per renderer
+    reserveObjects((uint32_t)rendererComponents.size());
+    m_frameInfo.objectsSet = m_objectDescriptorSets[m_currentFrame];
 
-    VulkanApi& api = VulkanApi::Instance();
-    if (pipelineLayout != VK_NULL_HANDLE) {
-        api.cmdBindDescriptorSets(
-            m_frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            *pipelineLayout,
-            0,
-            1,
-            &m_frameInfo.globalSet,
-            0,
-            nullptr
-        );
-    }
-
-    // Store model descriptor set in frameInfo for use by renderers
-    m_frameInfo.modelsSet = m_modelDescriptorSets[m_currentFrame];
-    m_frameInfo.modelsBuffer = m_modelUniformBuffer.get();
-
-    // Group renderers by material template
-    std::map<Engine::Ressources::MaterialTemplate*, std::vector<Engine::Components::Renderer*>> renderGroups;
-    
-    for (Components::Renderer* component : rendererComponents) {
-        auto material = component->getMaterial().lock();
-        auto materialTemplate = material->getMaterialTemplate();
-        renderGroups[materialTemplate].push_back(component);
-    }
-    
-    // Render each group
-    for (const auto& group : renderGroups) {
-        group.first->bindPipeline(m_frameInfo);
-        for (const auto& component : group.second) {
-            component->render(m_frameInfo);
-        }
+    // the culling is recorded before the render pass on the gpu path
+    if (m_gpuCulling) {
+        renderGpuCulled(rendererComponents, ubo.view, ubo.proj * ubo.view);
+    } else {
+        renderCpuCulled(rendererComponents, ubo.view, ubo.proj * ubo.view);
     }
 
     endRenderPass();
@@ -3,10 +3,25 @@
 #include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
+#include <memory>
 #include "Core/Ressources/UniformBuffer.h"
+#include "Core/Ressources/InstanceBuffer.h"
+#include "FrustumCulling.h"
+#include "GpuCulling.h"
+#include "RenderQueue.h"
+#include "SecondaryCommandBuffers.h"
+#include "LightClusters.h"
 
 
 namespace Engine {
+namespace Ressources {
+class Material;
+class MaterialTemplate;
+class Mesh;
+}
+namespace Components {
+class Renderer;
+}
 namespace Renderer {
 
 
@@ -17,24 +32,185 @@ public:
         glm::mat4 proj;
     };
 
-    static constexpr uint32_t MAX_OBJECTS = 1000;
+    // one per drawn object in the object table (set 1 binding 0), same layout as ObjectData in the shaders (std430)
+    struct ObjectData {
+        glm::mat4 model;
+        glm::mat4 normalMatrix;
+        uint32_t materialIndex;
+        uint32_t padding[3];
+    };
 
-    DefaultRenderer();
+    // per frame, the table grows when there are more objects
+    static constexpr uint32_t INITIAL_OBJECT_CAPACITY = 1024;
+    // light indices of all the clusters, grows like the object table
+    static constexpr uint32_t INITIAL_LIGHT_INDEX_CAPACITY = 16 * 1024;
+
+    // Auto takes the gpu driven path when the device supports it, Gpu throws when it doesn't (the headless tests
+    // force each path)
+    enum class CullingMode {
+        Auto,
+        Cpu,
+        Gpu,
+    };
+
+    DefaultRenderer(CullingMode cullingMode = CullingMode::Auto);
 
     void render(Engine::Scene& scene) override;
-    uint32_t allocateModelBufferIndex(); // Returns next available index
-    void deallocateModelBufferIndex(uint32_t index); // Deallocates the given index
+
+    // what the last frame recorded, a bind is only counted when the state really changed
+    struct RenderStats {
+        uint32_t pipelineBinds = 0;
+        uint32_t materialBinds = 0;
+        uint32_t meshBinds = 0;
+        uint32_t drawCalls = 0;
+        uint32_t instances = 0; // on the gpu path it's before the culling
+        uint32_t triangles = 0; // same
+    };
+
+    // Parallel records the draws of the render pass on the worker threads in secondary command buffers when there
+    // are enough of them, Inline always records in the frame's command buffer
+    enum class RecordingMode {
+        Inline,
+        Parallel,
+    };
+
+    void setRecordingMode(RecordingMode mode) { m_recordingMode = mode; };
+    RecordingMode getRecordingMode() const { return m_recordingMode; };
+
+    // visible and culled renderers of the last frame (cpu culling only, the gpu culling isn't read back)
+    const FrustumCuller::Stats& getCullingStats() const { return m_frustumCuller.getStats(); };
+    const RenderStats& getRenderStats() const { return m_renderStats; };
+
+    // a mesh is drawn with its coarsest level of detail whose error is below threshold pixels on screen, lodBias
+    // scales the errors (2 makes the levels change twice closer)
+    void setLodThreshold(float pixels) { m_lodThreshold = pixels; };
+    float getLodThreshold() const { return m_lodThreshold; };
+    void setLodBias(float bias) { m_lodBias = bias; };
+    float getLodBias() const { return m_lodBias; };
 
     /*VkDescriptorSetLayout globalDescriptorLayout;*/
     /*VkDescriptorSetLayout modelDescriptorLayout;*/
+private:
+    // what the queue entries point to, indexed like the renderers
+    struct DrawItem {
+        Components::Renderer* renderer;
+        Ressources::MaterialTemplate* materialTemplate;
+        Ressources::Material* material;
+        Ressources::Mesh* mesh; // nullptr when the renderer draws itself
+        uint32_t lod;
+    };
+
+    // queue entries [first, last) with the same material and mesh, drawn with one command
+    struct DrawRun {
+        uint32_t first;
+        uint32_t last;
+        uint32_t drawRange; // on the gpu path, the index of its range in m_drawRanges
+    };
+
+    // runs [firstRun, lastRun) drawn with one indirect draw on the gpu path, consecutive runs of the same pipeline
+    // whose material and mesh binds do nothing between them (bindless materials, pooled meshes)
+    struct DrawRange {
+        uint32_t firstRun;
+        uint32_t lastRun;
+    };
+
+    // what one command buffer has bound, each recording thread has its own
+    struct RecordState {
+        FrameInfo frameInfo;
+        Ressources::MaterialTemplate* boundPipeline = nullptr;
+        Ressources::Material* boundMaterial = nullptr;
+        Ressources::Mesh* boundMesh = nullptr;
+        RenderStats stats;
+        // the gpu profiler scope of the runs of the same material template
+        Ressources::MaterialTemplate* profiledTemplate = nullptr;
+        uint32_t groupScope = GpuProfiler::NO_SCOPE;
+    };
+
+    // below that the transforms are read on one thread
+    static constexpr uint32_t MIN_RENDERERS_PER_CULLING_THREAD = 2048;
+    // below that a secondary command buffer costs more than it saves
+    static constexpr uint32_t MIN_RUNS_PER_RECORDING_CHUNK = 256;
+    // where the bounds of an instanced mesh are this frame, for its level of detail and its streamed textures
+    struct ProjectedBounds {
+        float distance; // from the camera to the closest point, 0 or less when the camera is inside
+        float scale; // biggest axis of the model
+        float radius; // in world space
+    };
+
+    // a renderer goes to a finer level when its error is above threshold * (1 + LOD_HYSTERESIS), to a coarser one
+    // when the error of that one is below threshold * (1 - LOD_HYSTERESIS)
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+
+    void reserveObjects(uint32_t objectCount);
+    // fills the lights uniform buffer, the point lights and their clusters for this frame
+    void updateLights(Engine::Scene& scene, const glm::mat4& view, const glm::mat4& proj, float nearPlane, float farPlane);
+    void cullRenderers(const std::vector<Components::Renderer*>& renderers, const glm::mat4& viewProjection);
+    // fills and sorts the render queue, onlyVisible uses the result of cullRenderers
+    void buildQueue(const std::vector<Components::Renderer*>& renderers, bool onlyVisible, const glm::mat4& view);
+    // false when the mesh has no bounds
+    bool projectBounds(const Ressources::Mesh* mesh, const glm::mat4& model, const glm::mat4& view, ProjectedBounds& bounds) const;
+    // from the screen space error of the levels and the one drawn last frame
+    uint32_t selectLod(Components::Renderer* renderer, const Ressources::Mesh* mesh, const ProjectedBounds& bounds) const;
+    // the size on screen of what the material is drawn on, for the TextureStreamer
+    void requestTextures(Ressources::Material* material, float pixels);
+    // splits the sorted queue in m_runs, the renderers that draw themselves are after the runs
+    void buildRuns();
+    // groups the runs in m_drawRanges and sets their drawRange
+    void buildDrawRanges();
+
+    void renderCpuCulled(const std::vector<Components::Renderer*>& renderers, const glm::mat4& view, const glm::mat4& viewProjection);
+    void renderGpuCulled(const std::vector<Components::Renderer*>& renderers, const glm::mat4& view, const glm::mat4& viewProjection);
+
+    // records the render pass, inline or split in chunks of runs recorded in parallel (never splitting a draw range)
+    void recordDraws(bool gpuCulled);
+    // runs [firstRun, lastRun), on the cpu path it writes their objects too (run.first is the first instance)
+    void recordRuns(RecordState& state, uint32_t firstRun, uint32_t lastRun, bool gpuCulled);
+    // the renderers that draw themselves, always on the calling thread (they may update buffers)
+    void recordCustoms(RecordState& state);
+
+    // only record the bind when it's not the bound one already
+    void bindPipeline(RecordState& state, Ressources::MaterialTemplate* materialTemplate);
+    void bindMaterial(RecordState& state, Ressources::Material* material);
+    void bindMesh(RecordState& state, Ressources::Mesh* mesh);
+    void renderCustom(RecordState& state, const DrawItem& item);
+
 private:
     std::vector<VkDescriptorSet> m_globalDescriptorSets;
     std::unique_ptr<Engine::Ressources::UniformBuffer> m_globalUniformBuffer;
     std::unique_ptr<Engine::Ressources::UniformBuffer> m_lightsUniformBuffer;
-    std::vector<VkDescriptorSet> m_modelDescriptorSets;
-    std::unique_ptr<Engine::Ressources::UniformBuffer> m_modelUniformBuffer;
-    uint32_t m_nextModelBufferIndex = 0;
-    std::vector<uint32_t> m_freeIndices; // Store available indices for reuse
+    // PointLight[MAX_POINT_LIGHTS] (set 0 binding 2) and the clusters followed by their light indices (binding 3),
+    // written again every frame (persistently mapped)
+    std::unique_ptr<Engine::Ressources::InstanceBuffer> m_pointLightBuffer;
+    std::unique_ptr<Engine::Ressources::InstanceBuffer> m_clusterBuffer;
+    LightClusters m_lightClusters;
+    std::vector<PointLight> m_pointLights;
+    std::vector<VkDescriptorSet> m_objectDescriptorSets;
+    // ObjectData of every drawn object, written again every frame (persistently mapped)
+    std::unique_ptr<Engine::Ressources::InstanceBuffer> m_objectBuffer;
+
+    FrustumCuller m_frustumCuller;
+    std::vector<glm::mat4> m_cullingModels; // model matrix of each renderer, computed once for the culling and the object table
+
+    // nullptr when the device can't do it, the cpu culling is used instead
+    std::unique_ptr<GpuCulling> m_gpuCulling;
+
+    std::vector<DrawItem> m_drawItems;
+    RenderQueue m_renderQueue;
+    std::vector<DrawRun> m_runs;
+    std::vector<DrawRange> m_drawRanges;
+    uint32_t m_customFirst = 0; // first queue entry of the renderers that draw themselves
+    // gpu profiler scope of each material template by index, interned once
+    std::vector<const char*> m_templateScopeNames;
+
+    RecordingMode m_recordingMode = RecordingMode::Parallel;
+    std::unique_ptr<SecondaryCommandBuffers> m_secondaryCommandBuffers;
+    std::vector<RecordState> m_recordStates; // one per chunk, kept to not allocate every frame
+    RenderStats m_renderStats;
+
+    float m_lodThreshold = 1.0f;
+    float m_lodBias = 1.0f;
+    // pixels per unit of local error at a distance of 1, from the projection and the height of the frame
+    float m_lodProjectionScale = 0.0f;
 };
 
 }
@@ -0,0 +1,89 @@
+#include "FrustumCulling.h"
+#include "Core/Utils/ThreadPool.h"
+#include <algorithm>
+
+namespace Engine {
+namespace Renderer {
+
+using namespace Utils::Simd;
+
+// below that one thread is faster than waking the others up
+static constexpr uint32_t MIN_SPHERES_PER_THREAD = 4096;
+
+Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection) {
+    // glm is column major : viewProjection[column][row]
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2; // depth is -1 to 1 (no GLM_FORCE_DEPTH_ZERO_TO_ONE)
+    frustum.planes[5] = row3 - row2;
+
+    // normalized so the distance can be compared to the radius
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+void FrustumCuller::resize(uint32_t count) {
+    m_count = count;
+    uint32_t paddedCount = (count + 3) & ~3u;
+    m_storage.resize(paddedCount); // 4 streams of paddedCount floats = paddedCount Float4
+    float* data = (float*)m_storage.data();
+    m_x = data;
+    m_y = data + paddedCount;
+    m_z = data + paddedCount * 2;
+    m_radius = data + paddedCount * 3;
+    m_visible.resize(paddedCount);
+
+    // the padding is never visible
+    for (uint32_t i = count; i < paddedCount; i++) {
+        setSphere(i, glm::vec3(0.0f), -1.0f);
+    }
+}
+
+// begin is a multiple of 4
+void FrustumCuller::cullRange(const Frustum& frustum, uint32_t begin, uint32_t end) {
+    const Float4 zero = set1(0.0f);
+    for (uint32_t i = begin; i < end; i += 4) {
+        Float4 x = load(m_x + i);
+        Float4 y = load(m_y + i);
+        Float4 z = load(m_z + i);
+        Float4 negativeRadius = zero - load(m_radius + i);
+
+        int visible = 0xF;
+        for (const glm::vec4& plane : frustum.planes) {
+            Float4 distance = x * set1(plane.x) + y * set1(plane.y) + z * set1(plane.z) + set1(plane.w);
+            visible &= moveMask(lessThan(negativeRadius, distance));
+            if (!visible) {
+                break;
+            }
+        }
+
+        m_visible[i + 0] = (visible >> 0) & 1;
+        m_visible[i + 1] = (visible >> 1) & 1;
+        m_visible[i + 2] = (visible >> 2) & 1;
+        m_visible[i + 3] = (visible >> 3) & 1;
+    }
+}
+
+void FrustumCuller::cull(const Frustum& frustum) {
+    uint32_t groupCount = (m_count + 3) / 4;
+
+    Utils::ThreadPool::Instance().parallelFor(groupCount, MIN_SPHERES_PER_THREAD / 4, [&](uint32_t begin, uint32_t end) {
+        cullRange(frustum, begin * 4, end * 4);
+    });
+
+    m_stats.visible = (uint32_t)std::count(m_visible.begin(), m_visible.begin() + m_count, 1);
+    m_stats.culled = m_count - m_stats.visible;
+}
+
+}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Core/Utils/Simd.h"
+
+namespace Engine {
+namespace Renderer {
+
+struct Frustum {
+    // xyz : normal pointing inside, w : distance, a point is inside a plane if dot(normal, point) + w >= 0
+    // left, right, bottom, top, near, far
+    glm::vec4 planes[6];
+
+    // Gribb & Hartmann, the planes are read from the rows of proj * view
+    static Frustum fromViewProjection(const glm::mat4& viewProjection);
+};
+
+// World space bounding spheres stored as structure of arrays (x, y, z, radius) so they are tested 4 at a time.
+// Big scenes are split between the threads of Utils::ThreadPool.
+class FrustumCuller {
+public:
+    struct Stats {
+        uint32_t visible = 0;
+        uint32_t culled = 0;
+    };
+
+    // count spheres, their content is undefined until setSphere
+    void resize(uint32_t count);
+    // can be called from several threads as long as it's not the same index
+    void setSphere(uint32_t index, glm::vec3 center, float radius) {
+        m_x[index] = center.x;
+        m_y[index] = center.y;
+        m_z[index] = center.z;
+        m_radius[index] = radius;
+    };
+
+    void cull(const Frustum& frustum);
+
+    bool isVisible(uint32_t index) const { return m_visible[index]; };
+    const Stats& getStats() const { return m_stats; };
+
+private:
+    void cullRange(const Frustum& frustum, uint32_t begin, uint32_t end);
+
+private:
+    uint32_t m_count = 0;
+    // Float4 so the storage is 16 bytes aligned, used as float arrays
+    std::vector<Utils::Simd::Float4> m_storage;
+    float* m_x = nullptr;
+    float* m_y = nullptr;
+    float* m_z = nullptr;
+    float* m_radius = nullptr;
+    std::vector<uint8_t> m_visible;
+
+    Stats m_stats;
+};
+
+}
+}
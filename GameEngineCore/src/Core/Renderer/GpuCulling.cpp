@@ -0,0 +1,451 @@
+#include "GpuCulling.h"
+#include "FrustumCulling.h"
+#include "VulkanApi.h"
+#include "Core/Ressources/Buffer.h"
+#include "Core/Ressources/DescriptorsManager.h"
+#include "Core/Ressources/Texture.h"
+#include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Engine {
+namespace Renderer {
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64; // local_size_x of gpuCull.comp
+static constexpr uint32_t PYRAMID_GROUP_SIZE = 8; // local_size_x/y of depthPyramid.comp
+
+static uint32_t previousPowerOfTwo(uint32_t value) {
+    uint32_t result = 1;
+    while (result * 2 <= value) {
+        result *= 2;
+    }
+    return result;
+}
+
+static bool hasStencil(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+GpuCulling::GpuCulling(size_t objectDataSize, uint32_t initialObjectCapacity)
+    : m_objectDataSize(objectDataSize)
+{
+    VulkanApi& api = VulkanApi::Instance();
+    uint32_t maxFramesInFlight = api.getMaxFramesInFlight();
+
+    m_cullPipeline = std::make_unique<Ressources::ComputePipeline>("shaders/GameEngineCore/gpuCull.comp.spv", sizeof(uint32_t));
+    m_pyramidPipeline = std::make_unique<Ressources::ComputePipeline>("shaders/GameEngineCore/depthPyramid.comp.spv", sizeof(PyramidLevelSizes));
+
+    m_paramsBuffer = std::make_unique<Ressources::UniformBuffer>(sizeof(CullParams), maxFramesInFlight);
+    m_boundsBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(ObjectBounds) * initialObjectCapacity, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_batchBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(Batch) * initialObjectCapacity, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_instanceCountBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(uint32_t) * initialObjectCapacity, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    m_visibleObjectBuffer = std::make_unique<Ressources::InstanceBuffer>(objectDataSize * initialObjectCapacity, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_drawCommandBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(VkDrawIndexedIndirectCommand) * initialObjectCapacity, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    m_drawCountBuffer = std::make_unique<Ressources::InstanceBuffer>(sizeof(uint32_t) * initialObjectCapacity, maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (api.createSampler(&samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid sampler!");
+    }
+
+    createDepthPyramid();
+
+    // the object table isn't known yet, the sets are written for real in the first reserve
+    m_objectBuffers.resize(maxFramesInFlight, VK_NULL_HANDLE);
+    m_cullSets.resize(maxFramesInFlight, VK_NULL_HANDLE);
+    m_visibleObjectSets.resize(maxFramesInFlight, VK_NULL_HANDLE);
+    for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+        writeVisibleObjectSet(i);
+    }
+
+    api.addRecreationCallback([this](VkRenderPass&, VkExtent2D&) {
+        // the device is idle and the depth buffer was recreated (empty)
+        destroyDepthPyramid();
+        createDepthPyramid();
+        for (uint32_t i = 0; i < m_cullSets.size(); i++) {
+            if (m_cullSets[i] != VK_NULL_HANDLE) {
+                writeCullSet(i);
+            }
+        }
+    });
+}
+
+GpuCulling::~GpuCulling() {
+    VulkanApi& api = VulkanApi::Instance();
+    destroyDepthPyramid();
+    api.destroySampler(m_sampler, nullptr);
+}
+
+void GpuCulling::createDepthPyramid() {
+    VulkanApi& api = VulkanApi::Instance();
+    VkExtent2D extent = api.getSwapChainExtent();
+
+    // power of 2 so every level is exactly half of the one above
+    m_pyramidWidth = previousPowerOfTwo(extent.width);
+    m_pyramidHeight = previousPowerOfTwo(extent.height);
+    uint32_t levelCount = 1;
+    while ((std::max(m_pyramidWidth, m_pyramidHeight) >> levelCount) > 0) {
+        levelCount++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = m_pyramidWidth;
+    imageInfo.extent.height = m_pyramidHeight;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (api.createImage(&imageInfo, nullptr, &m_pyramidImage) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid image!");
+    }
+
+    m_pyramidAllocation = Ressources::MemoryAllocator::Instance().allocateForImage(m_pyramidImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_pyramidImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (api.createImageView(&viewInfo, nullptr, &m_pyramidView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid image view!");
+    }
+
+    m_pyramidLevelViews.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        if (api.createImageView(&viewInfo, nullptr, &m_pyramidLevelViews[level]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid image view!");
+        }
+    }
+
+    // level 0 reads the depth buffer, the others the level above. the sets are kept between resizes
+    m_pyramidLevelSets.resize(std::max((size_t)levelCount, m_pyramidLevelSets.size()), VK_NULL_HANDLE);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        VkDescriptorImageInfo sourceInfo{};
+        sourceInfo.sampler = m_sampler;
+        if (level == 0) {
+            sourceInfo.imageView = api.getDepthBuffer()->getImageView();
+            sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        } else {
+            sourceInfo.imageView = m_pyramidLevelViews[level - 1];
+            sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorImageInfo destinationInfo{};
+        destinationInfo.imageView = m_pyramidLevelViews[level];
+        destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        if (m_pyramidLevelSets[level] == VK_NULL_HANDLE) {
+            m_pyramidLevelSets[level] = Ressources::DescriptorBuilder()
+                .bind_image(0, &sourceInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .bind_image(1, &destinationInfo, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                .build();
+            continue;
+        }
+
+        VkWriteDescriptorSet writes[2]{};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = m_pyramidLevelSets[level];
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo = &sourceInfo;
+        writes[1] = writes[0];
+        writes[1].dstBinding = 1;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = &destinationInfo;
+        api.updateDescriptorSets(2, writes, 0, nullptr);
+    }
+
+    // always in general, the culling can bind it before it was ever built
+    VkCommandBuffer commandBuffer = api.beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_pyramidImage;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    api.endSingleTimeCommands(commandBuffer);
+
+    m_hasDepth = false;
+}
+
+void GpuCulling::destroyDepthPyramid() {
+    VulkanApi& api = VulkanApi::Instance();
+    for (VkImageView view : m_pyramidLevelViews) {
+        api.destroyImageView(view, nullptr);
+    }
+    m_pyramidLevelViews.clear();
+    api.destroyImageView(m_pyramidView, nullptr);
+    api.destroyImage(m_pyramidImage, nullptr);
+    Ressources::MemoryAllocator::Instance().free(m_pyramidAllocation);
+    m_pyramidView = VK_NULL_HANDLE;
+    m_pyramidImage = VK_NULL_HANDLE;
+}
+
+void GpuCulling::writeVisibleObjectSet(uint32_t frameIndex) {
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_visibleObjectBuffer->getBuffer(frameIndex);
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    if (m_visibleObjectSets[frameIndex] == VK_NULL_HANDLE) {
+        // same layout as the object table set of DefaultRenderer
+        m_visibleObjectSets[frameIndex] = Ressources::DescriptorBuilder()
+            .bind_buffer(0, &bufferInfo, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+        return;
+    }
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_visibleObjectSets[frameIndex];
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    VulkanApi::Instance().updateDescriptorSets(1, &write, 0, nullptr);
+}
+
+void GpuCulling::writeCullSet(uint32_t frameIndex) {
+    VkDescriptorBufferInfo paramsInfo{m_paramsBuffer->getBuffer(frameIndex), 0, sizeof(CullParams)};
+    VkDescriptorBufferInfo storageInfos[] = {
+        {m_objectBuffers[frameIndex], 0, VK_WHOLE_SIZE},
+        {m_boundsBuffer->getBuffer(frameIndex), 0, VK_WHOLE_SIZE},
+        {m_batchBuffer->getBuffer(frameIndex), 0, VK_WHOLE_SIZE},
+        {m_instanceCountBuffer->getBuffer(frameIndex), 0, VK_WHOLE_SIZE},
+        {m_visibleObjectBuffer->getBuffer(frameIndex), 0, VK_WHOLE_SIZE},
+        {m_drawCommandBuffer->getBuffer(frameIndex), 0, VK_WHOLE_SIZE},
+        {m_drawCountBuffer->getBuffer(frameIndex), 0, VK_WHOLE_SIZE},
+    };
+    VkDescriptorImageInfo pyramidInfo{m_sampler, m_pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+
+    if (m_cullSets[frameIndex] == VK_NULL_HANDLE) {
+        Ressources::DescriptorBuilder builder;
+        builder.bind_buffer(0, &paramsInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        for (uint32_t i = 0; i < 7; i++) {
+            builder.bind_buffer(i + 1, &storageInfos[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        }
+        builder.bind_image(8, &pyramidInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+        m_cullSets[frameIndex] = builder.build();
+        return;
+    }
+
+    VkWriteDescriptorSet writes[9]{};
+    for (uint32_t i = 0; i < 9; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_cullSets[frameIndex];
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[0].pBufferInfo = &paramsInfo;
+    for (uint32_t i = 0; i < 7; i++) {
+        writes[i + 1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i + 1].pBufferInfo = &storageInfos[i];
+    }
+    writes[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[8].pImageInfo = &pyramidInfo;
+
+    VulkanApi::Instance().updateDescriptorSets(9, writes, 0, nullptr);
+}
+
+// Like the object table, only the buffers of this frame grow (its fence was waited in beginFrame)
+void GpuCulling::reserve(uint32_t frameIndex, VkBuffer objectBuffer, uint32_t objectCount, uint32_t batchCount, uint32_t drawRangeCount) {
+    // never empty, a descriptor can't point to a buffer of size 0
+    objectCount = std::max(objectCount, 1u);
+    batchCount = std::max(batchCount, 1u);
+    drawRangeCount = std::max(drawRangeCount, 1u);
+
+    bool changed = objectBuffer != m_objectBuffers[frameIndex];
+    m_objectBuffers[frameIndex] = objectBuffer;
+
+    // | so every buffer is reserved
+    changed |= m_boundsBuffer->reserve(objectCount * sizeof(ObjectBounds), frameIndex);
+    changed |= m_batchBuffer->reserve(batchCount * sizeof(Batch), frameIndex);
+    changed |= m_instanceCountBuffer->reserve(batchCount * sizeof(uint32_t), frameIndex);
+    changed |= m_drawCommandBuffer->reserve(batchCount * sizeof(VkDrawIndexedIndirectCommand), frameIndex);
+    changed |= m_drawCountBuffer->reserve(drawRangeCount * sizeof(uint32_t), frameIndex);
+    if (m_visibleObjectBuffer->reserve(objectCount * m_objectDataSize, frameIndex)) {
+        writeVisibleObjectSet(frameIndex);
+        changed = true;
+    }
+
+    if (changed) {
+        writeCullSet(frameIndex);
+    }
+}
+
+void GpuCulling::buildDepthPyramid(VkCommandBuffer commandBuffer) {
+    VulkanApi& api = VulkanApi::Instance();
+    Ressources::Texture* depthBuffer = api.getDepthBuffer();
+
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (hasStencil(depthBuffer->getFormat())) {
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    // depth written by the last frame -> read here, the pyramid read by the last culling -> written here
+    VkImageMemoryBarrier barriers[2]{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = depthBuffer->getImage();
+    barriers[0].subresourceRange = {depthAspect, 0, 1, 0, 1};
+    barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = m_pyramidImage;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, (uint32_t)m_pyramidLevelViews.size(), 0, 1};
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+    api.cmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    m_pyramidPipeline->bind(commandBuffer);
+
+    VkExtent2D extent = api.getSwapChainExtent();
+    int32_t sourceWidth = (int32_t)extent.width;
+    int32_t sourceHeight = (int32_t)extent.height;
+    int32_t width = (int32_t)m_pyramidWidth;
+    int32_t height = (int32_t)m_pyramidHeight;
+
+    for (uint32_t level = 0; level < m_pyramidLevelViews.size(); level++) {
+        api.cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pyramidPipeline->getPipelineLayout(), 0, 1, &m_pyramidLevelSets[level], 0, nullptr);
+
+        PyramidLevelSizes sizes{sourceWidth, sourceHeight, width, height};
+        api.cmdPushConstants(commandBuffer, m_pyramidPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidLevelSizes), &sizes);
+        api.cmdDispatch(commandBuffer, (width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+
+        // the next level (and the culling) reads this one
+        VkImageMemoryBarrier levelBarrier = barriers[1];
+        levelBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+        sourceWidth = width;
+        sourceHeight = height;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+
+    // back to a depth attachment for the render pass of this frame
+    VkImageMemoryBarrier depthBarrier = barriers[0];
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+}
+
+void GpuCulling::cull(Renderer::FrameInfo& frameInfo, const glm::mat4& viewProjection, uint32_t objectCount, uint32_t batchCount, uint32_t drawRangeCount) {
+    VulkanApi& api = VulkanApi::Instance();
+    VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+    uint32_t frameIndex = frameInfo.frameIndex;
+
+    // the pyramid and the matrices are from the last frame, something that just appeared from behind an occluder
+    // is drawn one frame late
+    if (m_hasDepth) {
+        buildDepthPyramid(commandBuffer);
+    }
+
+    CullParams params{};
+    Frustum frustum = Frustum::fromViewProjection(viewProjection);
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), params.frustumPlanes);
+    params.previousViewProjection = m_previousViewProjection;
+    params.pyramidSize = glm::vec2((float)m_pyramidWidth, (float)m_pyramidHeight);
+    params.objectCount = objectCount;
+    params.batchCount = batchCount;
+    params.occlusionEnabled = m_hasDepth ? 1 : 0;
+    m_paramsBuffer->updateData(&params, sizeof(CullParams), frameIndex);
+
+    if (objectCount > 0) {
+        api.cmdFillBuffer(commandBuffer, m_instanceCountBuffer->getBuffer(frameIndex), 0, batchCount * sizeof(uint32_t), 0);
+        api.cmdFillBuffer(commandBuffer, m_drawCountBuffer->getBuffer(frameIndex), 0, drawRangeCount * sizeof(uint32_t), 0);
+
+        VkMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        m_cullPipeline->bind(commandBuffer);
+        api.cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline->getPipelineLayout(), 0, 1, &m_cullSets[frameIndex], 0, nullptr);
+
+        uint32_t pass = 0;
+        api.cmdPushConstants(commandBuffer, m_cullPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &pass);
+        api.cmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        // the instance counts are final
+        VkMemoryBarrier cullBarrier{};
+        cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+        pass = 1;
+        api.cmdPushConstants(commandBuffer, m_cullPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &pass);
+        api.cmdDispatch(commandBuffer, (batchCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        // commands and counts read by the indirect draws, visible objects by the vertex shaders
+        VkMemoryBarrier drawBarrier{};
+        drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    // the render pass of this frame writes the depth the next pyramid is built from
+    m_previousViewProjection = viewProjection;
+    m_hasDepth = true;
+}
+
+void GpuCulling::drawRange(Renderer::FrameInfo& frameInfo, uint32_t drawRange, uint32_t firstCommand, uint32_t maxDrawCount) {
+    VulkanApi::Instance().cmdDrawIndexedIndirectCount(
+        frameInfo.commandBuffer,
+        m_drawCommandBuffer->getBuffer(frameInfo.frameIndex), firstCommand * sizeof(VkDrawIndexedIndirectCommand),
+        m_drawCountBuffer->getBuffer(frameInfo.frameIndex), drawRange * sizeof(uint32_t),
+        maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+}
+}
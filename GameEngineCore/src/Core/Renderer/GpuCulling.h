@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Renderer.h"
+#include "Core/Ressources/InstanceBuffer.h"
+#include "Core/Ressources/UniformBuffer.h"
+#include "Core/Ressources/Pipeline.h"
+
+namespace Engine {
+namespace Renderer {
+
+// Culling of the renderers with a mesh done on the gpu. Every frame (before the render pass):
+// - the depth of the last frame is reduced in a depth pyramid (Hi-Z, each level keeps the farthest depth)
+// - gpuCull.comp tests every object of the object table against the frustum and the pyramid, copies the visible ones
+//   in the visible object table and writes the draw commands with their count
+// the draws are then vkCmdDrawIndexedIndirectCount, the cpu never knows what is visible.
+// Only created when VulkanApi::supportsGpuDrivenRendering() (lavapipe has it, MoltenVK doesn't)
+class GpuCulling {
+public:
+    // layouts of gpuCull.comp (std430)
+    struct ObjectBounds {
+        glm::vec4 sphere; // local space, a negative radius is never culled
+        uint32_t batch;
+        uint32_t padding[3];
+    };
+
+    // objects with the same mesh and material, they are next to each other in the object table
+    struct Batch {
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance; // first object of the batch, in the object table and in the visible one
+        uint32_t drawRangeFirst; // first command of its draw range
+        uint32_t drawRange; // commands drawn with one indirect draw (same pipeline, descriptor sets and buffers)
+    };
+
+    GpuCulling(size_t objectDataSize, uint32_t initialObjectCapacity);
+    ~GpuCulling();
+
+    // after beginFrame, objectBuffer is the object table of the frame (it's read by the culling)
+    void reserve(uint32_t frameIndex, VkBuffer objectBuffer, uint32_t objectCount, uint32_t batchCount, uint32_t drawRangeCount);
+    ObjectBounds* getObjectBounds(uint32_t frameIndex) { return (ObjectBounds*)m_boundsBuffer->getMappedMemory(frameIndex); };
+    Batch* getBatches(uint32_t frameIndex) { return (Batch*)m_batchBuffer->getMappedMemory(frameIndex); };
+
+    // records the depth pyramid and the culling, outside of the render pass
+    void cull(Renderer::FrameInfo& frameInfo, const glm::mat4& viewProjection, uint32_t objectCount, uint32_t batchCount, uint32_t drawRangeCount);
+
+    // the visible objects, bound as set 1 instead of the object table
+    VkDescriptorSet getVisibleObjectsSet(uint32_t frameIndex) { return m_visibleObjectSets[frameIndex]; };
+
+    // in the render pass, with the pipeline, material and mesh of the range bound
+    void drawRange(Renderer::FrameInfo& frameInfo, uint32_t drawRange, uint32_t firstCommand, uint32_t maxDrawCount);
+
+private:
+    struct CullParams {
+        glm::vec4 frustumPlanes[6];
+        glm::mat4 previousViewProjection;
+        glm::vec2 pyramidSize;
+        uint32_t objectCount;
+        uint32_t batchCount;
+        uint32_t occlusionEnabled;
+    };
+
+    struct PyramidLevelSizes {
+        int32_t sourceWidth;
+        int32_t sourceHeight;
+        int32_t destinationWidth;
+        int32_t destinationHeight;
+    };
+
+    void createDepthPyramid();
+    void destroyDepthPyramid();
+    void buildDepthPyramid(VkCommandBuffer commandBuffer);
+
+    void writeCullSet(uint32_t frameIndex);
+    void writeVisibleObjectSet(uint32_t frameIndex);
+
+private:
+    size_t m_objectDataSize;
+
+    std::unique_ptr<Ressources::ComputePipeline> m_cullPipeline;
+    std::unique_ptr<Ressources::ComputePipeline> m_pyramidPipeline;
+
+    // per frame in flight
+    std::unique_ptr<Ressources::UniformBuffer> m_paramsBuffer;
+    std::unique_ptr<Ressources::InstanceBuffer> m_boundsBuffer;
+    std::unique_ptr<Ressources::InstanceBuffer> m_batchBuffer;
+    std::unique_ptr<Ressources::InstanceBuffer> m_instanceCountBuffer;
+    std::unique_ptr<Ressources::InstanceBuffer> m_visibleObjectBuffer;
+    std::unique_ptr<Ressources::InstanceBuffer> m_drawCommandBuffer;
+    std::unique_ptr<Ressources::InstanceBuffer> m_drawCountBuffer;
+    std::vector<VkBuffer> m_objectBuffers; // the object table the cull set points to
+    std::vector<VkDescriptorSet> m_cullSets;
+    std::vector<VkDescriptorSet> m_visibleObjectSets;
+
+    // one pyramid for every frame, the frames are recorded one after the other on the same queue
+    VkImage m_pyramidImage = VK_NULL_HANDLE;
+    Ressources::Allocation m_pyramidAllocation;
+    VkImageView m_pyramidView = VK_NULL_HANDLE; // every level, read by the culling
+    std::vector<VkImageView> m_pyramidLevelViews; // one level each, written by depthPyramid.comp
+    std::vector<VkDescriptorSet> m_pyramidLevelSets;
+    uint32_t m_pyramidWidth = 0;
+    uint32_t m_pyramidHeight = 0;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+
+    // false until a frame was rendered in the current depth buffer (start, resize)
+    bool m_hasDepth = false;
+    glm::mat4 m_previousViewProjection = glm::mat4(1.0f);
+};
+
+}
+}
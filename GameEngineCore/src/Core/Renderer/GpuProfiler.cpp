@@ -0,0 +1,149 @@
+#include "GpuProfiler.h"
+#include "VulkanApi.h"
+#include "Core/Utils/Profiler.h"
+#include <cmath>
+#include <stdexcept>
+#include "Core/Log/Log.h"
+
+namespace Engine {
+namespace Renderer {
+
+static uint32_t getTimestampValidBits() {
+    VulkanApi& api = VulkanApi::Instance();
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(api.getPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(api.getPhysicalDevice(), &familyCount, families.data());
+    return families[api.getGraphicsQueueFamily()].timestampValidBits;
+}
+
+bool GpuProfiler::IsSupported() {
+    return getTimestampValidBits() > 0;
+}
+
+GpuProfiler::GpuProfiler()
+    : m_frames(VulkanApi::Instance().getMaxFramesInFlight())
+{
+    VulkanApi& api = VulkanApi::Instance();
+
+    VkPhysicalDeviceProperties properties;
+    api.getPhysicalDeviceProperties(&properties);
+    m_timestampPeriod = properties.limits.timestampPeriod;
+    uint32_t validBits = getTimestampValidBits();
+    m_timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = (uint32_t)m_frames.size() * MAX_SCOPES_PER_FRAME * 2;
+    if (api.createQueryPool(&poolInfo, nullptr, &m_queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    for (Frame& frame : m_frames) {
+        frame.names.resize(MAX_SCOPES_PER_FRAME);
+    }
+    m_results.resize(MAX_SCOPES_PER_FRAME * 2 * 2);
+
+    calibrate();
+}
+
+GpuProfiler::~GpuProfiler() {
+    VulkanApi::Instance().destroyQueryPool(m_queryPool, nullptr);
+}
+
+// query 0 is reset again by the first frame
+void GpuProfiler::calibrate() {
+    VulkanApi& api = VulkanApi::Instance();
+    VkCommandBuffer commandBuffer = api.beginSingleTimeCommands();
+    api.cmdResetQueryPool(commandBuffer, m_queryPool, 0, 1);
+    api.cmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 0);
+    int64_t submitTime = Utils::Profiler::Now();
+    api.endSingleTimeCommands(commandBuffer);
+    int64_t doneTime = Utils::Profiler::Now();
+
+    uint64_t ticks = 0;
+    api.getQueryPoolResults(m_queryPool, 0, 1, sizeof(uint64_t), &ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    m_cpuOffset = submitTime + (doneTime - submitTime) / 2 - toCpuTime(ticks);
+}
+
+int64_t GpuProfiler::toCpuTime(uint64_t ticks) const {
+    return m_cpuOffset + (int64_t)std::llround((double)(ticks & m_timestampMask) * m_timestampPeriod);
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    resolve(frameIndex);
+
+    m_currentFrame = frameIndex;
+    Frame& frame = m_frames[frameIndex];
+    frame.scopeCount = 0;
+    frame.profilerFrame = Utils::Profiler::IsEnabled() ? Utils::Profiler::Instance().getFrame() : 0;
+    VulkanApi::Instance().cmdResetQueryPool(commandBuffer, m_queryPool, getQuery(0), MAX_SCOPES_PER_FRAME * 2);
+}
+
+// the fence of the frame was waited on, every query it wrote is available. The availability is still checked, a
+// scope that was begun and never ended has no result
+void GpuProfiler::resolve(uint32_t frameIndex) {
+    Frame& frame = m_frames[frameIndex];
+    uint32_t scopeCount = frame.scopeCount;
+    if (scopeCount == 0 || !Utils::Profiler::IsEnabled()) {
+        return;
+    }
+
+    uint32_t firstQuery = frameIndex * MAX_SCOPES_PER_FRAME * 2;
+    VkResult result = VulkanApi::Instance().getQueryPoolResults(m_queryPool, firstQuery, scopeCount * 2, scopeCount * 2 * 2 * sizeof(uint64_t),
+        m_results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+
+    Utils::Profiler& profiler = Utils::Profiler::Instance();
+    for (uint32_t scope = 0; scope < scopeCount; scope++) {
+        const uint64_t* begin = &m_results[scope * 4];
+        const uint64_t* end = &m_results[scope * 4 + 2];
+        if (!begin[1] || !end[1]) {
+            continue;
+        }
+        profiler.addScope(Utils::Profiler::Track::Gpu, frame.names[scope], toCpuTime(begin[0]), toCpuTime(end[0]), frame.profilerFrame);
+    }
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+    Frame& frame = m_frames[m_currentFrame];
+    uint32_t scope = frame.scopeCount.fetch_add(1);
+    if (scope >= MAX_SCOPES_PER_FRAME) {
+        frame.scopeCount = MAX_SCOPES_PER_FRAME;
+        if (!m_fullWarned.exchange(true)) {
+            LogWarning("more than ", MAX_SCOPES_PER_FRAME, " gpu profiler scopes in a frame, the next ones are not measured");
+        }
+        return NO_SCOPE;
+    }
+
+    frame.names[scope] = name;
+    VulkanApi::Instance().cmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, getQuery(scope));
+    return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (scope == NO_SCOPE) {
+        return;
+    }
+    VulkanApi::Instance().cmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, getQuery(scope) + 1);
+}
+
+GpuProfiler::Scope::Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name)
+: m_profiler(profiler), m_commandBuffer(commandBuffer)
+{
+    if (m_profiler) {
+        m_scope = m_profiler->beginScope(commandBuffer, name);
+    }
+}
+
+GpuProfiler::Scope::~Scope() {
+    if (m_profiler) {
+        m_profiler->endScope(m_commandBuffer, m_scope);
+    }
+}
+
+}
+}
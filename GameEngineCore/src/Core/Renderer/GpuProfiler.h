@@ -0,0 +1,76 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+namespace Renderer {
+
+// Gpu time of the named scopes of the frame with timestamp queries, a begin and an end query per scope. Each frame in
+// flight has its own range of the pool: it's read when the frame comes back to beginFrame (its fence was waited, so
+// the results are there and nothing stalls), getMaxFramesInFlight frames after being recorded. The times go to
+// Utils::Profiler on the cpu clock, with the cpu scopes of the frame they were recorded in.
+// The gpu clock is matched to the cpu one once at the start (the middle of a submit that writes a timestamp and its
+// wait), the gpu scopes can be off by about the time of a submit in the trace, not in their durations
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 512;
+    static constexpr uint32_t NO_SCOPE = UINT32_MAX;
+
+    // the graphics queue can write timestamps
+    static bool IsSupported();
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    // first thing in the command buffer of frameIndex, after its fence: gives the scopes that frame had to the
+    // Utils::Profiler then resets its queries
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // can be called from any thread, in secondary command buffers too. NO_SCOPE when the frame has no queries left.
+    // name is a literal or comes from Utils::Profiler::intern, it's read when the frame is resolved
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    // from the constructor to the destructor, nothing when profiler is nullptr
+    class Scope {
+    public:
+        Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        GpuProfiler* m_profiler;
+        VkCommandBuffer m_commandBuffer;
+        uint32_t m_scope = NO_SCOPE;
+    };
+
+private:
+    struct Frame {
+        std::vector<const char*> names; // of the scopes, MAX_SCOPES_PER_FRAME
+        std::atomic<uint32_t> scopeCount{0};
+        uint64_t profilerFrame = 0; // Utils::Profiler frame it was recorded in
+    };
+
+    // the first query of the scope, the end is the next one
+    uint32_t getQuery(uint32_t scope) const { return (m_currentFrame * MAX_SCOPES_PER_FRAME + scope) * 2; };
+    void resolve(uint32_t frameIndex);
+    void calibrate();
+    int64_t toCpuTime(uint64_t ticks) const;
+
+private:
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    std::vector<Frame> m_frames;
+    uint32_t m_currentFrame = 0;
+    std::atomic<bool> m_fullWarned{false};
+
+    double m_timestampPeriod = 1.0; // nanoseconds per tick
+    uint64_t m_timestampMask = UINT64_MAX; // the valid bits
+    int64_t m_cpuOffset = 0; // cpu time of the gpu time 0, in nanoseconds
+    std::vector<uint64_t> m_results; // value and availability of each query
+};
+
+}
+}
@@ -0,0 +1,198 @@
+#include "LightClusters.h"
+#include "Core/Utils/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Engine {
+namespace Renderer {
+
+// below that the slices are built on one thread
+static constexpr uint32_t MIN_LIGHTS_FOR_THREADS = 64;
+// what's left of the light color at its range
+static constexpr float LIGHT_CUTOFF = 1.0f / 256.0f;
+// lights that never fade are in every cluster, the radius is capped so the maths stay finite
+static constexpr float MAX_LIGHT_RANGE = 1e30f;
+
+LightClusters::LightClusters()
+    : m_clusterBounds(CLUSTER_COUNT), m_clusterLights(CLUSTER_COUNT), m_clusters(CLUSTER_COUNT)
+{
+}
+
+float LightClusters::getLightRange(const PointLight& light) {
+    float maxColor = std::max({light.color.r, light.color.g, light.color.b});
+    // 1 / (c + l * d + q * d^2) * maxColor = cutoff
+    float c = light.constantAttenuation - maxColor / LIGHT_CUTOFF;
+    float l = light.linearAttenuation;
+    float q = light.quadraticAttenuation;
+
+    if (c >= 0.0f) {
+        return 0.0f; // already under the cutoff at the light position
+    }
+    if (q > 0.0f) {
+        return (-l + std::sqrt(l * l - 4.0f * q * c)) / (2.0f * q);
+    }
+    if (l > 0.0f) {
+        return -c / l;
+    }
+    return std::numeric_limits<float>::max();
+}
+
+void LightClusters::setProjection(const glm::mat4& proj, float nearPlane, float farPlane, float width, float height) {
+    if (proj == m_proj && nearPlane == m_near && farPlane == m_far && width == m_width && height == m_height) {
+        return;
+    }
+    m_proj = proj;
+    m_near = nearPlane;
+    m_far = farPlane;
+    m_width = width;
+    m_height = height;
+
+    float logRatio = std::log(farPlane / nearPlane);
+    m_sliceScale = CLUSTER_COUNT_Z / logRatio;
+    m_sliceBias = -(float)CLUSTER_COUNT_Z * std::log(nearPlane) / logRatio;
+    m_tileSize = glm::vec2(width / CLUSTER_COUNT_X, height / CLUSTER_COUNT_Y);
+
+    // ndc = proj[0][0] * x / depth (proj[1][1] for y, negative because of the vulkan flip)
+    for (uint32_t z = 0; z < CLUSTER_COUNT_Z; z++) {
+        float nearDepth = nearPlane * std::pow(farPlane / nearPlane, (float)z / CLUSTER_COUNT_Z);
+        float farDepth = nearPlane * std::pow(farPlane / nearPlane, (float)(z + 1) / CLUSTER_COUNT_Z);
+
+        for (uint32_t y = 0; y < CLUSTER_COUNT_Y; y++) {
+            for (uint32_t x = 0; x < CLUSTER_COUNT_X; x++) {
+                glm::vec2 ndcMin(x * 2.0f / CLUSTER_COUNT_X - 1.0f, y * 2.0f / CLUSTER_COUNT_Y - 1.0f);
+                glm::vec2 ndcMax((x + 1) * 2.0f / CLUSTER_COUNT_X - 1.0f, (y + 1) * 2.0f / CLUSTER_COUNT_Y - 1.0f);
+                glm::vec2 scale(1.0f / proj[0][0], 1.0f / proj[1][1]);
+
+                glm::vec2 corners[4] = {
+                    ndcMin * scale * nearDepth, ndcMax * scale * nearDepth,
+                    ndcMin * scale * farDepth, ndcMax * scale * farDepth,
+                };
+
+                Aabb& bounds = m_clusterBounds[x + CLUSTER_COUNT_X * (y + CLUSTER_COUNT_Y * z)];
+                bounds.min = glm::vec3(corners[0], -farDepth);
+                bounds.max = glm::vec3(corners[0], -nearDepth);
+                for (const glm::vec2& corner : corners) {
+                    bounds.min = glm::vec3(glm::min(glm::vec2(bounds.min), corner), bounds.min.z);
+                    bounds.max = glm::vec3(glm::max(glm::vec2(bounds.max), corner), bounds.max.z);
+                }
+            }
+        }
+    }
+}
+
+uint32_t LightClusters::sliceOf(float depth) const {
+    if (depth <= m_near) {
+        return 0;
+    }
+    float slice = std::floor(std::log(depth) * m_sliceScale + m_sliceBias);
+    return (uint32_t)std::clamp(slice, 0.0f, (float)(CLUSTER_COUNT_Z - 1));
+}
+
+uint32_t LightClusters::tileOf(float ndc, uint32_t count) const {
+    float tile = std::floor((ndc * 0.5f + 0.5f) * count);
+    return (uint32_t)std::clamp(tile, 0.0f, (float)(count - 1));
+}
+
+// The tiles are found from the box around the sphere, x / depth is the biggest and smallest at its corners
+bool LightClusters::binLight(const PointLight& light, const glm::mat4& view, LightBin& bin) const {
+    float radius = std::min(getLightRange(light), MAX_LIGHT_RANGE);
+    if (radius <= 0.0f) {
+        return false;
+    }
+
+    glm::vec3 center = view * glm::vec4(glm::vec3(light.pos), 1.0f);
+    // the camera looks down -z in view space
+    float depth = -center.z;
+    float minDepth = depth - radius;
+    float maxDepth = depth + radius;
+    if (maxDepth < m_near || minDepth > m_far) {
+        return false;
+    }
+    minDepth = std::max(minDepth, m_near);
+    maxDepth = std::min(maxDepth, m_far);
+
+    glm::vec2 ndcMin(std::numeric_limits<float>::max());
+    glm::vec2 ndcMax(-std::numeric_limits<float>::max());
+    glm::vec2 scale(m_proj[0][0], m_proj[1][1]);
+    for (float side : {-radius, radius}) {
+        for (float sideDepth : {minDepth, maxDepth}) {
+            glm::vec2 ndc = (glm::vec2(center) + side) / sideDepth * scale;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+    }
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) {
+        return false;
+    }
+
+    bin.center = center;
+    bin.radius = radius;
+    bin.minX = tileOf(ndcMin.x, CLUSTER_COUNT_X);
+    bin.maxX = tileOf(ndcMax.x, CLUSTER_COUNT_X);
+    bin.minY = tileOf(ndcMin.y, CLUSTER_COUNT_Y);
+    bin.maxY = tileOf(ndcMax.y, CLUSTER_COUNT_Y);
+    bin.minZ = sliceOf(minDepth);
+    bin.maxZ = sliceOf(maxDepth);
+    return true;
+}
+
+void LightClusters::buildSlice(uint32_t slice) {
+    uint32_t sliceFirst = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * slice;
+    for (uint32_t i = sliceFirst; i < sliceFirst + CLUSTER_COUNT_X * CLUSTER_COUNT_Y; i++) {
+        m_clusterLights[i].clear();
+    }
+
+    for (const LightBin& bin : m_bins) {
+        if (slice < bin.minZ || slice > bin.maxZ) {
+            continue;
+        }
+
+        for (uint32_t y = bin.minY; y <= bin.maxY; y++) {
+            for (uint32_t x = bin.minX; x <= bin.maxX; x++) {
+                uint32_t cluster = sliceFirst + x + CLUSTER_COUNT_X * y;
+
+                // the closest point of the box to the sphere
+                const Aabb& bounds = m_clusterBounds[cluster];
+                glm::vec3 offset = glm::clamp(bin.center, bounds.min, bounds.max) - bin.center;
+                if (glm::dot(offset, offset) <= bin.radius * bin.radius) {
+                    m_clusterLights[cluster].push_back(bin.light);
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::build(const PointLight* lights, uint32_t lightCount, const glm::mat4& view) {
+    m_bins.clear();
+    for (uint32_t i = 0; i < lightCount; i++) {
+        LightBin bin;
+        if (binLight(lights[i], view, bin)) {
+            bin.light = i;
+            m_bins.push_back(bin);
+        }
+    }
+
+    uint32_t minSlicesPerThread = m_bins.size() < MIN_LIGHTS_FOR_THREADS ? CLUSTER_COUNT_Z : 1;
+    Utils::ThreadPool::Instance().parallelFor(CLUSTER_COUNT_Z, minSlicesPerThread, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t slice = begin; slice < end; slice++) {
+            buildSlice(slice);
+        }
+    });
+
+    // packed one cluster after the other
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < CLUSTER_COUNT; i++) {
+        m_clusters[i].offset = offset;
+        m_clusters[i].count = (uint32_t)m_clusterLights[i].size();
+        offset += m_clusters[i].count;
+    }
+
+    m_lightIndices.resize(offset);
+    for (uint32_t i = 0; i < CLUSTER_COUNT; i++) {
+        std::copy(m_clusterLights[i].begin(), m_clusterLights[i].end(), m_lightIndices.begin() + m_clusters[i].offset);
+    }
+}
+
+}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Lights.h"
+
+namespace Engine {
+namespace Renderer {
+
+// The view frustum cut in clusters (screen tiles x depth slices that get thicker with the distance). Every point light
+// is put in the clusters its sphere of influence touches, the fragment shaders find their cluster from gl_FragCoord
+// and the view depth and only shade its lights. Built on the cpu every frame, the slices are split between the threads
+class LightClusters {
+public:
+    static constexpr uint32_t CLUSTER_COUNT_X = 16; // make numbers the same as in shader
+    static constexpr uint32_t CLUSTER_COUNT_Y = 9;
+    static constexpr uint32_t CLUSTER_COUNT_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+    // lights of cluster i are lightIndices[offset, offset + count), same layout as in the shaders (uvec2)
+    struct ClusterRange {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    LightClusters();
+
+    // the bounds of the clusters are only computed again when one of them changed
+    void setProjection(const glm::mat4& proj, float nearPlane, float farPlane, float width, float height);
+    void build(const PointLight* lights, uint32_t lightCount, const glm::mat4& view);
+
+    const std::vector<ClusterRange>& getClusters() const { return m_clusters; };
+    const std::vector<uint32_t>& getLightIndices() const { return m_lightIndices; };
+
+    // slice = log(depth) * sliceScale + sliceBias, tile = gl_FragCoord.xy / tileSize
+    float getSliceScale() const { return m_sliceScale; };
+    float getSliceBias() const { return m_sliceBias; };
+    glm::vec2 getTileSize() const { return m_tileSize; };
+
+    // distance at which the light is under 1/256 of its color, the attenuation never reaches 0
+    static float getLightRange(const PointLight& light);
+
+private:
+    // view space sphere and the clusters it can touch
+    struct LightBin {
+        uint32_t light; // index in the lights given to build
+        glm::vec3 center;
+        float radius;
+        uint32_t minX, maxX, minY, maxY, minZ, maxZ;
+    };
+
+    struct Aabb {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    uint32_t sliceOf(float depth) const;
+    uint32_t tileOf(float ndc, uint32_t count) const;
+    bool binLight(const PointLight& light, const glm::mat4& view, LightBin& bin) const;
+    void buildSlice(uint32_t slice);
+
+private:
+    glm::mat4 m_proj{0.0f};
+    float m_near = 0.0f;
+    float m_far = 0.0f;
+    float m_width = 0.0f;
+    float m_height = 0.0f;
+
+    float m_sliceScale = 0.0f;
+    float m_sliceBias = 0.0f;
+    glm::vec2 m_tileSize{0.0f};
+    std::vector<Aabb> m_clusterBounds; // view space
+
+    std::vector<LightBin> m_bins;
+    // lights of each cluster before they are packed, a slice is only written by one thread
+    std::vector<std::vector<uint32_t>> m_clusterLights;
+
+    std::vector<ClusterRange> m_clusters;
+    std::vector<uint32_t> m_lightIndices;
+};
+
+}
+}
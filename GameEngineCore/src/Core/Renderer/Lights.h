@@ -5,7 +5,8 @@
 namespace Engine {
 namespace Renderer {
 
-static constexpr uint32_t MAX_POINT_LIGHTS = 100; // make numbers the same as in shader
+// the point lights are in a storage buffer (set 0 binding 2), the uniform buffer only has the directional ones
+static constexpr uint32_t MAX_POINT_LIGHTS = 4096;
 static constexpr uint32_t MAX_DIRECTIONAL_LIGHTS = 10;
 
 
@@ -28,10 +29,13 @@ struct DirectionalLight {
 };
 
 
+// set 0 binding 1 (std140), the cluster values are the ones of LightClusters
 struct LightEnvironment {
     uint32_t nbPointLight;
     uint32_t nbDirectionalLight;
-    PointLight pointLights[MAX_POINT_LIGHTS];
+    glm::vec2 clusterTileSize;
+    float clusterSliceScale;
+    float clusterSliceBias;
     DirectionalLight directionalLights[MAX_DIRECTIONAL_LIGHTS];
 };
 
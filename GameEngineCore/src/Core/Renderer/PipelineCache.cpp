@@ -0,0 +1,198 @@
+#include "PipelineCache.h"
+#include "Core/Log/Log.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace Engine {
+namespace Renderer {
+
+static constexpr uint32_t CACHE_MAGIC = 0x43504547; // "GEPC"
+// bump when the layout of the file changes
+static constexpr uint32_t CACHE_VERSION = 1;
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path)
+    : m_device(device), m_physicalDevice(physicalDevice), m_path(path)
+{
+    std::vector<char> data = load();
+    m_stats.warm = !data.empty();
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    // the driver checks the data again and ignores it if it doesn't like it
+    if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+PipelineCache::~PipelineCache() {
+    save();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+}
+
+PipelineCache::Header PipelineCache::makeHeader() {
+    Header header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    // vulkan 1.1, left at 0 on older devices (the pipeline cache UUID still changes with the driver)
+    if (properties.apiVersion >= VK_API_VERSION_1_1) {
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+        memcpy(header.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+    }
+    return header;
+}
+
+std::vector<char> PipelineCache::load() {
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file.is_open()) {
+        LogInfo("no pipeline cache at ", m_path, ", cold start");
+        return {};
+    }
+
+    Header header{};
+    Header expected = makeHeader();
+    file.read((char*)&header, sizeof(Header));
+    if (!file || memcmp(&header, &expected, sizeof(Header)) != 0) {
+        LogInfo("pipeline cache ", m_path, " is from another device, driver or version, cold start");
+        return {};
+    }
+
+    // reflections : count, then hash, binding count, bindings
+    uint32_t reflectionCount = 0;
+    file.read((char*)&reflectionCount, sizeof(uint32_t));
+    for (uint32_t i = 0; i < reflectionCount && file; i++) {
+        uint64_t hash = 0;
+        uint32_t bindingCount = 0;
+        file.read((char*)&hash, sizeof(uint64_t));
+        file.read((char*)&bindingCount, sizeof(uint32_t));
+
+        std::vector<ReflectedBinding> bindings(bindingCount);
+        file.read((char*)bindings.data(), bindingCount * sizeof(ReflectedBinding));
+        m_reflections[hash] = std::move(bindings);
+    }
+
+    uint64_t dataSize = 0;
+    file.read((char*)&dataSize, sizeof(uint64_t));
+    std::vector<char> data(dataSize);
+    file.read(data.data(), dataSize);
+
+    if (!file) {
+        LogWarning("pipeline cache ", m_path, " is truncated, cold start");
+        m_reflections.clear();
+        return {};
+    }
+    return data;
+}
+
+void PipelineCache::save() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr) != VK_SUCCESS) {
+        return;
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    std::string tempPath = m_path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LogWarning("failed to write the pipeline cache to ", tempPath);
+            return;
+        }
+
+        Header header = makeHeader();
+        file.write((const char*)&header, sizeof(Header));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t reflectionCount = (uint32_t)m_reflections.size();
+        file.write((const char*)&reflectionCount, sizeof(uint32_t));
+        for (const auto& [hash, bindings] : m_reflections) {
+            uint32_t bindingCount = (uint32_t)bindings.size();
+            file.write((const char*)&hash, sizeof(uint64_t));
+            file.write((const char*)&bindingCount, sizeof(uint32_t));
+            file.write((const char*)bindings.data(), bindingCount * sizeof(ReflectedBinding));
+        }
+
+        uint64_t size = dataSize;
+        file.write((const char*)&size, sizeof(uint64_t));
+        file.write(data.data(), dataSize);
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_path, error);
+    if (error) {
+        LogWarning("failed to write the pipeline cache to ", m_path, " : ", error.message());
+    }
+}
+
+void PipelineCache::Clear(const std::string& path) {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    if (error) {
+        LogWarning("failed to delete the pipeline cache ", path, " : ", error.message());
+    }
+    std::filesystem::remove(path + ".tmp", error);
+}
+
+bool PipelineCache::findReflection(uint64_t hash, std::vector<ReflectedBinding>& bindings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_reflections.find(hash);
+    if (it == m_reflections.end()) {
+        m_stats.reflectionMisses++;
+        return false;
+    }
+    bindings = it->second;
+    m_stats.reflectionHits++;
+    return true;
+}
+
+void PipelineCache::addReflection(uint64_t hash, const std::vector<ReflectedBinding>& bindings) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reflections[hash] = bindings;
+}
+
+void PipelineCache::addPipelineTime(double milliseconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.pipelines++;
+    m_stats.pipelineMilliseconds += milliseconds;
+}
+
+PipelineCache::Stats PipelineCache::getStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+// FNV-1a, the size is hashed too so two shaders only differing by trailing zeros don't collide
+uint64_t PipelineCache::hashCode(const std::vector<char>& code) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : code) {
+        hash ^= (uint8_t)c;
+        hash *= 1099511628211ull;
+    }
+    hash ^= code.size();
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+}
+}
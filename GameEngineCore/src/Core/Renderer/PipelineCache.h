@@ -0,0 +1,81 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine {
+namespace Renderer {
+
+// What makes the second launch fast: the VkPipelineCache the driver fills when it compiles the pipelines and the
+// descriptor bindings reflected from each SPIR-V (keyed by its hash) so SPIRV-Reflect only runs on new shaders.
+// Both are in one file loaded when the device is created and saved when it's destroyed. The file is only used when
+// it comes from the same device and driver (vendor, device id, driver and pipeline cache UUIDs), otherwise it starts
+// empty (cold). Can be used from several threads.
+class PipelineCache {
+public:
+    struct ReflectedBinding {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+    };
+
+    // what the pipelines of this launch cost, logged at the end of the startup
+    struct Stats {
+        bool warm = false; // a valid file was loaded
+        uint32_t pipelines = 0;
+        double pipelineMilliseconds = 0.0; // in vkCreate*Pipelines only
+        uint32_t reflectionHits = 0;
+        uint32_t reflectionMisses = 0;
+    };
+
+    PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+    ~PipelineCache();
+
+    VkPipelineCache getCache() { return m_cache; };
+
+    // false when the shader was never reflected
+    bool findReflection(uint64_t hash, std::vector<ReflectedBinding>& bindings);
+    void addReflection(uint64_t hash, const std::vector<ReflectedBinding>& bindings);
+
+    void addPipelineTime(double milliseconds);
+    Stats getStats();
+
+    // written to a temporary file first, a crash while saving doesn't leave a broken cache
+    void save();
+
+    static uint64_t hashCode(const std::vector<char>& code);
+    // deletes the file, the next launch is cold (the startup benchmark)
+    static void Clear(const std::string& path);
+
+private:
+    // identifies the device and driver the cache was made with
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint8_t driverUUID[VK_UUID_SIZE];
+    };
+
+    Header makeHeader();
+    // returns the VkPipelineCache data, empty when there is no valid file
+    std::vector<char> load();
+
+private:
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    std::string m_path;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+
+    std::mutex m_mutex;
+    std::unordered_map<uint64_t, std::vector<ReflectedBinding>> m_reflections;
+    Stats m_stats;
+};
+
+}
+}
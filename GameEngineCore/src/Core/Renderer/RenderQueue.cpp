@@ -0,0 +1,54 @@
+#include "RenderQueue.h"
+#include <cstring>
+
+namespace Engine {
+namespace Renderer {
+
+uint64_t RenderQueue::makeKey(Pass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+    // the bits of a positive float are in the same order as the float, the top 16 keep the exponent and 7 bits of mantissa
+    uint32_t depthBits = 0;
+    if (depth > 0.0f) {
+        std::memcpy(&depthBits, &depth, sizeof(float));
+    }
+
+    return ((uint64_t)((uint32_t)pass & 0xF) << 60) |
+           ((uint64_t)(pipeline & 0xFFF) << 48) |
+           ((uint64_t)(material & 0xFFFF) << 32) |
+           ((uint64_t)(mesh & 0xFFFF) << 16) |
+           (uint64_t)(depthBits >> 16);
+}
+
+// LSD radix sort, 8 bits per pass. A byte that is the same for every key (unused pass bits, a single pipeline, ...)
+// is skipped, most frames only sort a few of the 8 bytes
+void RenderQueue::sort() {
+    size_t count = m_entries.size();
+    if (count < 2) {
+        return;
+    }
+    m_sortBuffer.resize(count);
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t histogram[256] = {};
+        for (const Entry& entry : m_entries) {
+            histogram[(entry.key >> shift) & 0xFF]++;
+        }
+        if (histogram[(m_entries[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+
+        for (const Entry& entry : m_entries) {
+            m_sortBuffer[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        m_entries.swap(m_sortBuffer);
+    }
+}
+
+}
+}
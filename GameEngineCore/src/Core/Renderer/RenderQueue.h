@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+namespace Renderer {
+
+// Everything drawn in a frame as a flat array of (64 bit key, index) sorted with a radix sort, the state that changes
+// the least often is in the high bits so the draws that share it end up next to each other:
+//   pass (4 bits) | pipeline (12) | material (16) | mesh (16) | depth (16)
+// the ids are truncated to their bits, two things can share an id and be interleaved, the recording compares
+// the real state so it only costs a bind
+class RenderQueue {
+public:
+    enum class Pass : uint32_t {
+        Opaque = 0, // meshes, front to back
+        Custom = 1  // renderers that draw themselves (particles, ...), after the opaque ones
+    };
+
+    struct Entry {
+        uint64_t key;
+        uint32_t index; // whatever the caller pushed, the renderer uses its renderer index
+    };
+
+    // depth is the view space distance, only its order matters (negative is 0)
+    static uint64_t makeKey(Pass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+    void clear() { m_entries.clear(); };
+    void reserve(size_t count) { m_entries.reserve(count); };
+    void push(uint64_t key, uint32_t index) { m_entries.push_back({key, index}); };
+
+    // stable, equal keys keep the order they were pushed in
+    void sort();
+
+    const std::vector<Entry>& getEntries() const { return m_entries; };
+
+private:
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_sortBuffer;
+};
+
+}
+}
@@ -1,8 +1,12 @@
 #include "Renderer.h"
 #include "Core/Ressources/DescriptorsManager.h"
+#include "Core/Ressources/Buffer.h"
+#include "Core/Utils/Profiler.h"
 #include "VulkanApi.h"
 #include "vulkan/vulkan_core.h"
+#include <stb_image_write.h>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 
 
@@ -12,6 +16,9 @@ namespace Renderer {
 Renderer::Renderer() {
     createCommandBuffers();
     createSyncObjects();
+    if (Utils::Profiler::IsEnabled() && GpuProfiler::IsSupported()) {
+        m_gpuProfiler = std::make_unique<GpuProfiler>();
+    }
 }
 
 Renderer::~Renderer() {
@@ -28,13 +35,27 @@ void Renderer::beginFrame() {
     VulkanApi& api = VulkanApi::Instance();
     api.waitForFences(1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
 
+    // one offscreen target per frame in flight, the fence says it's free
+    if (api.isHeadless()) {
+        m_currentImageIndex = m_currentFrame;
+        api.resetFences(1, &m_inFlightFences[m_currentFrame]);
+        vkResetCommandBuffer(m_commandBuffers[m_currentFrame], 0);
+        m_frameInfo.commandBuffer = m_commandBuffers[m_currentFrame];
+        m_frameInfo.frameIndex = m_currentFrame;
+        beginCommandBuffer();
+        return;
+    }
 
     VkResult result = api.acquireNextImageKHR(api.getSwapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_currentImageIndex);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+    // a failed acquire doesn't signal the semaphore, the frame gets an image of the new swap chain before anything
+    // is recorded (the submit waits on that semaphore and the fence is only reset once there is an image)
+    while (result == VK_ERROR_OUT_OF_DATE_KHR) {
         api.recreateSwapChain();
-        return;
-    } else if (result != VK_SUCCESS &&
+        result = api.acquireNextImageKHR(api.getSwapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_currentImageIndex);
+    }
+
+    if (result != VK_SUCCESS &&
         result != VK_SUBOPTIMAL_KHR) { // VK suboptimal consider as success
         // but can be consider as failure
         throw std::runtime_error("failed to acquire swap chain image!");
@@ -46,20 +67,33 @@ void Renderer::beginFrame() {
 
     m_frameInfo.commandBuffer = m_commandBuffers[m_currentFrame];
     m_frameInfo.frameIndex = m_currentFrame;
+
+    // recording starts here so compute work can be recorded before the render pass
+    beginCommandBuffer();
 }
 
-void Renderer::beginRenderPass() {
+void Renderer::beginCommandBuffer() {
+    VulkanApi& api = VulkanApi::Instance();
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0; // Optional
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
-    VulkanApi& api = VulkanApi::Instance();
-    
     if (api.beginCommandBuffer(m_commandBuffers[m_currentFrame], &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    // the results of this frame's last use are read, its fence was waited on
+    if (m_gpuProfiler) {
+        m_gpuProfiler->beginFrame(m_commandBuffers[m_currentFrame], m_currentFrame);
+        m_frameScope = m_gpuProfiler->beginScope(m_commandBuffers[m_currentFrame], "frame");
+    }
+}
+
+void Renderer::beginRenderPass(VkSubpassContents contents) {
+    VulkanApi& api = VulkanApi::Instance();
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = api.getRenderPass();
@@ -76,7 +110,19 @@ void Renderer::beginRenderPass() {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    api.cmdBeginRenderPass(m_commandBuffers[m_currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (m_gpuProfiler) {
+        m_renderPassScope = m_gpuProfiler->beginScope(m_commandBuffers[m_currentFrame], "render pass");
+    }
+    api.cmdBeginRenderPass(m_commandBuffers[m_currentFrame], &renderPassInfo, contents);
+
+    if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+        setViewportAndScissor(m_commandBuffers[m_currentFrame]);
+    }
+}
+
+void Renderer::setViewportAndScissor(VkCommandBuffer commandBuffer) {
+    VulkanApi& api = VulkanApi::Instance();
+    auto swapChainExtent = api.getSwapChainExtent();
 
     // we set them as dynamic so we have to set them
     VkViewport viewport{};
@@ -86,30 +132,51 @@ void Renderer::beginRenderPass() {
     viewport.height = static_cast<float>(swapChainExtent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    api.cmdSetViewport(m_commandBuffers[m_currentFrame], 0, 1, &viewport);
+    api.cmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
     scissor.extent = swapChainExtent;
-    api.cmdSetScissor(m_commandBuffers[m_currentFrame], 0, 1, &scissor);
-
+    api.cmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
 void Renderer::endRenderPass() {
     VulkanApi& api = VulkanApi::Instance();
     api.cmdEndRenderPass(m_commandBuffers[m_currentFrame]);
-
-    if (api.endCommandBuffer(m_commandBuffers[m_currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to record command buffer!");
+    if (m_gpuProfiler) {
+        m_gpuProfiler->endScope(m_commandBuffers[m_currentFrame], m_renderPassScope);
     }
 }
 
 void Renderer::endFrame() {
     VulkanApi& api = VulkanApi::Instance();
 
+    if (m_gpuProfiler) {
+        m_gpuProfiler->endScope(m_commandBuffers[m_currentFrame], m_frameScope);
+    }
+
+    if (api.endCommandBuffer(m_commandBuffers[m_currentFrame]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+    m_lastFrame = m_currentFrame;
+    m_lastImageIndex = m_currentImageIndex;
+    m_frameSubmitted = true;
+
+    // nothing to wait on or to present
+    if (api.isHeadless()) {
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
+        if (api.queueSubmit(1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+        m_currentFrame = (m_currentFrame + 1) % api.getMaxFramesInFlight();
+        return;
+    }
+
     VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[m_currentFrame]};
     VkPipelineStageFlags waitStages[] = {
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -152,6 +219,65 @@ void Renderer::endFrame() {
     m_currentFrame = (m_currentFrame + 1) % api.getMaxFramesInFlight();
 }
 
+Renderer::FrameCapture Renderer::readbackFrame() {
+    VulkanApi& api = VulkanApi::Instance();
+    if (!api.isHeadless()) {
+        throw std::runtime_error("frames can only be read back in headless mode!");
+    }
+    if (!m_frameSubmitted) {
+        throw std::runtime_error("no frame was rendered yet!");
+    }
+    api.waitForFences(1, &m_inFlightFences[m_lastFrame], VK_TRUE, UINT64_MAX);
+
+    FrameCapture capture;
+    VkExtent2D extent = api.getSwapChainExtent();
+    capture.width = extent.width;
+    capture.height = extent.height;
+    VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * 4;
+
+    Ressources::Buffer readbackBuffer;
+    readbackBuffer.createBaseBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, Ressources::MemoryAllocator::Usage::Transient);
+
+    VkCommandBuffer commandBuffer = api.beginSingleTimeCommands();
+    VkImage image = api.getSwapChainImage(m_lastImageIndex);
+
+    // the render pass left it in TRANSFER_SRC_OPTIMAL, its writes still have to be made visible to the copy
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0; // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    api.cmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.getBuffer(), 1, &region);
+
+    // waits for the copy
+    api.endSingleTimeCommands(commandBuffer);
+
+    capture.pixels.resize(size);
+    memcpy(capture.pixels.data(), readbackBuffer.getMappedMemory(), size);
+    return capture;
+}
+
+void Renderer::saveFrame(const std::string& path) {
+    FrameCapture capture = readbackFrame();
+    if (!stbi_write_png(path.c_str(), capture.width, capture.height, 4, capture.pixels.data(), capture.width * 4)) {
+        throw std::runtime_error("failed to write the frame to " + path);
+    }
+}
+
 void Renderer::createCommandBuffers() {
     VulkanApi& api = VulkanApi::Instance();
     auto maxFrameInFlight = api.getMaxFramesInFlight();
@@ -1,10 +1,13 @@
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 #include "Core/Scene/Scene.h"
 #include "vulkan/vulkan_core.h"
 #include <GLFW/glfw3.h>
 #include "Core/Ressources/UniformBuffer.h"
+#include "GpuProfiler.h"
 
 namespace Engine {
 namespace Renderer {
@@ -15,23 +18,42 @@ public:
         int frameIndex = 0;
         VkCommandBuffer commandBuffer;
         VkDescriptorSet globalSet;
-        VkDescriptorSet modelsSet;
-        Ressources::UniformBuffer* modelsBuffer = nullptr;
+        VkDescriptorSet objectsSet;
     };
 
     Renderer();
     virtual ~Renderer();
 
+    // beginFrame starts recording the command buffer and endFrame submits it, the render pass is in between
     void beginFrame();
     void endFrame();
 
     virtual void render(Engine::Scene& scene) = 0;
+
+    // the last submitted frame in rgba8 (srgb), rows from the top. Waits for it, headless only (the swap chain images
+    // are given back to the presentation engine)
+    struct FrameCapture {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;
+    };
+    FrameCapture readbackFrame();
+    // readbackFrame written as a png
+    void saveFrame(const std::string& path);
     
-    void beginRenderPass();
+    // with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass is only filled with cmdExecuteCommands,
+    // the secondary command buffers set their own viewport and scissor
+    void beginRenderPass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void endRenderPass();
 
+    // nullptr when the Utils::Profiler isn't enabled or the queue has no timestamps. The frame and the render pass
+    // are measured here, the renderers add their own scopes
+    GpuProfiler* getGpuProfiler() { return m_gpuProfiler.get(); };
+
 protected:
+    void setViewportAndScissor(VkCommandBuffer commandBuffer);
 
+    void beginCommandBuffer();
     void createSyncObjects();
     void createCommandBuffers();
 protected:
@@ -46,6 +68,14 @@ protected:
     uint32_t m_currentFrame = 0;
 
     uint32_t m_currentImageIndex = 0;
+    // of the last endFrame, for the readback
+    uint32_t m_lastFrame = 0;
+    uint32_t m_lastImageIndex = 0;
+    bool m_frameSubmitted = false;
+
+    std::unique_ptr<GpuProfiler> m_gpuProfiler;
+    uint32_t m_frameScope = GpuProfiler::NO_SCOPE;
+    uint32_t m_renderPassScope = GpuProfiler::NO_SCOPE;
 
 };
 
@@ -0,0 +1,89 @@
+#include "SecondaryCommandBuffers.h"
+#include "VulkanApi.h"
+#include <stdexcept>
+
+namespace Engine {
+namespace Renderer {
+
+SecondaryCommandBuffers::SecondaryCommandBuffers(uint32_t maxChunkCount)
+    : m_maxChunkCount(maxChunkCount)
+{
+    VulkanApi& api = VulkanApi::Instance();
+    uint32_t maxFramesInFlight = api.getMaxFramesInFlight();
+    m_pools.resize(maxFramesInFlight, std::vector<VkCommandPool>(maxChunkCount, VK_NULL_HANDLE));
+    m_commandBuffers.resize(maxFramesInFlight, std::vector<VkCommandBuffer>(maxChunkCount, VK_NULL_HANDLE));
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // the whole pool is reset every frame
+    poolInfo.queueFamilyIndex = api.getGraphicsQueueFamily();
+
+    for (uint32_t frame = 0; frame < maxFramesInFlight; frame++) {
+        for (uint32_t chunk = 0; chunk < maxChunkCount; chunk++) {
+            if (api.createCommandPool(&poolInfo, nullptr, &m_pools[frame][chunk]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create secondary command pool!");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = m_pools[frame][chunk];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (api.allocateCommandBuffers(&allocInfo, &m_commandBuffers[frame][chunk]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+        }
+    }
+}
+
+SecondaryCommandBuffers::~SecondaryCommandBuffers() {
+    VulkanApi& api = VulkanApi::Instance();
+    // the command buffers are freed with their pool
+    for (std::vector<VkCommandPool>& framePools : m_pools) {
+        for (VkCommandPool pool : framePools) {
+            api.destroyCommandPool(pool, nullptr);
+        }
+    }
+}
+
+void SecondaryCommandBuffers::reset(uint32_t frameIndex) {
+    VulkanApi& api = VulkanApi::Instance();
+    for (VkCommandPool pool : m_pools[frameIndex]) {
+        api.resetCommandPool(pool, 0);
+    }
+}
+
+VkCommandBuffer SecondaryCommandBuffers::begin(uint32_t frameIndex, uint32_t chunk, VkFramebuffer framebuffer) {
+    VulkanApi& api = VulkanApi::Instance();
+    VkCommandBuffer commandBuffer = m_commandBuffers[frameIndex][chunk];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = api.getRenderPass();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (api.beginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+    return commandBuffer;
+}
+
+void SecondaryCommandBuffers::end(VkCommandBuffer commandBuffer) {
+    if (VulkanApi::Instance().endCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+}
+
+void SecondaryCommandBuffers::execute(VkCommandBuffer primaryCommandBuffer, uint32_t frameIndex, uint32_t chunkCount) {
+    VulkanApi::Instance().cmdExecuteCommands(primaryCommandBuffer, chunkCount, m_commandBuffers[frameIndex].data());
+}
+
+}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+namespace Renderer {
+
+// Secondary command buffers to record the render pass on several threads. A command pool can only be used by one
+// thread at a time so there is one per chunk of draws (as many chunks as threads) and per frame in flight, the pools
+// of a frame are reset when it starts again (its fence was waited in beginFrame).
+class SecondaryCommandBuffers {
+public:
+    SecondaryCommandBuffers(uint32_t maxChunkCount);
+    ~SecondaryCommandBuffers();
+
+    uint32_t getMaxChunkCount() const { return m_maxChunkCount; };
+
+    // after beginFrame, before any begin of this frame
+    void reset(uint32_t frameIndex);
+
+    // can be called from any thread, one thread per chunk. Continues the render pass in framebuffer
+    VkCommandBuffer begin(uint32_t frameIndex, uint32_t chunk, VkFramebuffer framebuffer);
+    void end(VkCommandBuffer commandBuffer);
+
+    // the chunks [0, chunkCount) in order, in a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    void execute(VkCommandBuffer primaryCommandBuffer, uint32_t frameIndex, uint32_t chunkCount);
+
+private:
+    uint32_t m_maxChunkCount;
+
+    // [frame][chunk]
+    std::vector<std::vector<VkCommandPool>> m_pools;
+    std::vector<std::vector<VkCommandBuffer>> m_commandBuffers;
+};
+
+}
+}
@@ -2,6 +2,7 @@
 #include "Core/VulkanConfig.h"
 #include "vulkan/vulkan_core.h"
 #include "Core/Ressources/Texture.h"
+#include "PipelineCache.h"
 #include <algorithm>
 #include <map>
 #include <set>
@@ -25,9 +26,12 @@ void VulkanApi::Shutdown(){
     delete vulkanInstance;
     vulkanInstance = nullptr;
 }
+void VulkanApi::ClearPipelineCache() {
+    PipelineCache::Clear(PIPELINE_CACHE_PATH);
+}
 
 VulkanApi::VulkanApi(Window& window)
-: m_window(window)
+: m_window(window), m_headless(window.isHeadless())
 {
     window.setResizeCallback([this](int width, int height) {
         m_framebufferResized = true;
@@ -43,8 +47,13 @@ VulkanApi::~VulkanApi() {
 void VulkanApi::initVulkan() {
     pickPhysicalDevice();
     createLogicalDevice();
-    createSwapChain();
-    createImageViews();
+    m_pipelineCache = new PipelineCache(m_device, m_physicalDevice, PIPELINE_CACHE_PATH);
+    if (m_headless) {
+        createOffscreenTargets();
+    } else {
+        createSwapChain();
+        createImageViews();
+    }
     createDepthBuffer();
     createRenderPass();
     createFrameBuffers();
@@ -61,6 +70,9 @@ void VulkanApi::shutDownVulkan() {
     
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 
+    // saves it
+    delete m_pipelineCache;
+
     vkDestroyDevice(m_device, nullptr);
 }
 
@@ -107,11 +119,13 @@ int VulkanApi::rateDeviceSuitability(VkPhysicalDevice device) {
 
     if (! deviceFeatures.samplerAnisotropy) return 0;
 
-    bool swapChainAdequate = false;
-    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-    swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+    if (!m_headless) {
+        bool swapChainAdequate = false;
+        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 
-    if (! swapChainAdequate) return 0; 
+        if (! swapChainAdequate) return 0; 
+    }
 
     // if the device has met the previous condition it is suitable
     int score = 1;
@@ -135,7 +149,11 @@ bool VulkanApi::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(VulkanConfig::DeviceExtensions.begin(), VulkanConfig::DeviceExtensions.end());
+    // headless needs no swap chain
+    std::set<std::string> requiredExtensions;
+    if (!m_headless) {
+        requiredExtensions.insert(VulkanConfig::DeviceExtensions.begin(), VulkanConfig::DeviceExtensions.end());
+    }
 
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -160,15 +178,66 @@ void VulkanApi::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // the gpu driven path needs vulkan 1.2 drawIndirectCount, MoltenVK doesn't have it so it's optional
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+
+    VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+    supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    bool hasVulkan12 = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+    if (hasVulkan12) {
+        supportedFeatures.pNext = &supportedFeatures12;
+    }
+    vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedFeatures);
+    m_gpuDrivenRendering = hasVulkan12 && supportedFeatures12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect;
+    // descriptor indexing for the bindless material table, the textures are written while the set is bound
+    m_bindless = hasVulkan12
+        && supportedFeatures12.runtimeDescriptorArray
+        && supportedFeatures12.shaderSampledImageArrayNonUniformIndexing
+        && supportedFeatures12.descriptorBindingPartiallyBound
+        && supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind
+        && supportedFeatures12.descriptorBindingUpdateUnusedWhilePending;
+    // desktop gpus all have it, the mobile ones usually have ASTC/ETC2 instead
+    m_textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+    if (m_bindless) {
+        VkPhysicalDeviceVulkan12Properties properties12{};
+        properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &properties12;
+        vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+        m_maxBindlessTextures = std::min(
+            properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+            properties12.maxPerStageDescriptorUpdateAfterBindSampledImages
+        );
+    }
+
+    VkPhysicalDeviceVulkan12Features deviceFeatures12{};
+    deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    deviceFeatures12.drawIndirectCount = m_gpuDrivenRendering ? VK_TRUE : VK_FALSE;
+    deviceFeatures12.runtimeDescriptorArray = m_bindless ? VK_TRUE : VK_FALSE;
+    deviceFeatures12.shaderSampledImageArrayNonUniformIndexing = m_bindless ? VK_TRUE : VK_FALSE;
+    deviceFeatures12.descriptorBindingPartiallyBound = m_bindless ? VK_TRUE : VK_FALSE;
+    deviceFeatures12.descriptorBindingSampledImageUpdateAfterBind = m_bindless ? VK_TRUE : VK_FALSE;
+    deviceFeatures12.descriptorBindingUpdateUnusedWhilePending = m_bindless ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = hasVulkan12 ? &deviceFeatures12 : nullptr;
+    deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.features.multiDrawIndirect = m_gpuDrivenRendering ? VK_TRUE : VK_FALSE;
+    deviceFeatures.features.textureCompressionBC = m_textureCompressionBC ? VK_TRUE : VK_FALSE;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-    createInfo.pEnabledFeatures = &deviceFeatures;
+    // features go through pNext so the 1.2 ones can be chained
+    createInfo.pNext = &deviceFeatures;
+    createInfo.pEnabledFeatures = nullptr;
 
     // this is now optional with newer version of vulkan
     createInfo.enabledExtensionCount = 0;
@@ -179,7 +248,7 @@ void VulkanApi::createLogicalDevice() {
         createInfo.enabledLayerCount = 0;
     }
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(VulkanConfig::DeviceExtensions.size());
+    createInfo.enabledExtensionCount = m_headless ? 0 : static_cast<uint32_t>(VulkanConfig::DeviceExtensions.size());
     createInfo.ppEnabledExtensionNames = VulkanConfig::DeviceExtensions.data();
 
 
@@ -204,8 +273,11 @@ QueueFamilyIndices VulkanApi::findQueueFamilies(VkPhysicalDevice device) {
 
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_window.getSurface(), &presentSupport);
+        // headless, nothing is presented
+        VkBool32 presentSupport = m_headless;
+        if (!m_headless) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_window.getSurface(), &presentSupport);
+        }
 
         if (presentSupport) {
             indices.presentFamily = i;
@@ -283,6 +355,22 @@ void VulkanApi::createSwapChain() {
 }
 
 
+void VulkanApi::createOffscreenTargets() {
+    m_swapChainExtent = m_window.getExtent();
+    // rgba so the read back pixels go to a png as they are
+    m_swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        auto info = Ressources::Texture::TextureCreateInfo::getDefaultWihtoutPath(m_swapChainExtent.width, m_swapChainExtent.height);
+        info.possibleFormats = {m_swapChainImageFormat};
+        info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        Ressources::Texture* target = new Ressources::Texture(info, this);
+        m_offscreenTargets.push_back(target);
+        m_swapChainImages.push_back(target->getImage());
+        m_swapChainImageViews.push_back(target->getImageView());
+    }
+}
+
 VkSurfaceFormatKHR VulkanApi::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
     for (const auto& availableFormat : availableFormats) {
         if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
@@ -354,17 +442,31 @@ void VulkanApi::cleanupSwapChain(){
         vkDestroyFramebuffer(m_device, m_swapChainFramebuffers[i], nullptr);
     }
 
+    delete m_depthBuffer;
+    m_depthBuffer = nullptr;
+
+    if (m_headless) {
+        for (Ressources::Texture* target : m_offscreenTargets) {
+            delete target;
+        }
+        m_offscreenTargets.clear();
+        m_swapChainImages.clear();
+        m_swapChainImageViews.clear();
+        return;
+    }
+
     for (size_t i = 0; i < m_swapChainImageViews.size(); i++) {
         vkDestroyImageView(m_device, m_swapChainImageViews[i], nullptr);
     }
 
-    delete m_depthBuffer;
-    m_depthBuffer = nullptr;
-
     vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
 };
 
 void VulkanApi::recreateSwapChain() {
+    // the offscreen targets keep their size
+    if (m_headless) {
+        return;
+    }
     int width = 0, height = 0;
     glfwGetFramebufferSize(m_window.getGLFWWindow(), &width, &height);
     // if window minimized (== 0) then wait until reopened
@@ -425,13 +527,13 @@ void VulkanApi::createRenderPass() {
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = m_depthBuffer->getFormat();
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // read back next frame to build the depth pyramid of the gpu culling
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -597,6 +699,28 @@ void VulkanApi::freeCommandBuffers(
     vkFreeCommandBuffers(m_device, m_commandPool, commandBufferCount, pCommandBuffers);
 }
 
+VkResult VulkanApi::createCommandPool(
+    const VkCommandPoolCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkCommandPool* pCommandPool)
+{
+    return vkCreateCommandPool(m_device, pCreateInfo, pAllocator, pCommandPool);
+}
+
+void VulkanApi::destroyCommandPool(
+    VkCommandPool commandPool,
+    const VkAllocationCallbacks* pAllocator)
+{
+    vkDestroyCommandPool(m_device, commandPool, pAllocator);
+}
+
+VkResult VulkanApi::resetCommandPool(
+    VkCommandPool commandPool,
+    VkCommandPoolResetFlags flags)
+{
+    return vkResetCommandPool(m_device, commandPool, flags);
+}
+
 VkResult VulkanApi::createImage(
     const VkImageCreateInfo* pCreateInfo,
     const VkAllocationCallbacks* pAllocator,
@@ -715,6 +839,57 @@ void VulkanApi::cmdDrawIndexed(
         vertexOffset, firstInstance);
 }
 
+void VulkanApi::cmdDrawIndexedIndirectCount(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize offset,
+    VkBuffer countBuffer,
+    VkDeviceSize countBufferOffset,
+    uint32_t maxDrawCount,
+    uint32_t stride)
+{
+    vkCmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer,
+        countBufferOffset, maxDrawCount, stride);
+}
+
+void VulkanApi::cmdDispatch(
+    VkCommandBuffer commandBuffer,
+    uint32_t groupCountX,
+    uint32_t groupCountY,
+    uint32_t groupCountZ)
+{
+    vkCmdDispatch(commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+void VulkanApi::cmdPushConstants(
+    VkCommandBuffer commandBuffer,
+    VkPipelineLayout layout,
+    VkShaderStageFlags stageFlags,
+    uint32_t offset,
+    uint32_t size,
+    const void* pValues)
+{
+    vkCmdPushConstants(commandBuffer, layout, stageFlags, offset, size, pValues);
+}
+
+void VulkanApi::cmdFillBuffer(
+    VkCommandBuffer commandBuffer,
+    VkBuffer dstBuffer,
+    VkDeviceSize dstOffset,
+    VkDeviceSize size,
+    uint32_t data)
+{
+    vkCmdFillBuffer(commandBuffer, dstBuffer, dstOffset, size, data);
+}
+
+void VulkanApi::cmdExecuteCommands(
+    VkCommandBuffer commandBuffer,
+    uint32_t commandBufferCount,
+    const VkCommandBuffer* pCommandBuffers)
+{
+    vkCmdExecuteCommands(commandBuffer, commandBufferCount, pCommandBuffers);
+}
+
 VkResult VulkanApi::createGraphicsPipelines(
     VkPipelineCache pipelineCache,
     uint32_t createInfoCount,
@@ -726,6 +901,17 @@ VkResult VulkanApi::createGraphicsPipelines(
         pCreateInfos, pAllocator, pPipelines);
 }
 
+VkResult VulkanApi::createComputePipelines(
+    VkPipelineCache pipelineCache,
+    uint32_t createInfoCount,
+    const VkComputePipelineCreateInfo* pCreateInfos,
+    const VkAllocationCallbacks* pAllocator,
+    VkPipeline* pPipelines)
+{
+    return vkCreateComputePipelines(m_device, pipelineCache, createInfoCount,
+        pCreateInfos, pAllocator, pPipelines);
+}
+
 void VulkanApi::destroyPipeline(
     VkPipeline pipeline,
     const VkAllocationCallbacks* pAllocator)
@@ -1027,6 +1213,59 @@ void VulkanApi::cmdCopyBufferToImage(
         pRegions);
 }
 
+void VulkanApi::cmdCopyImageToBuffer(
+    VkCommandBuffer commandBuffer,
+    VkImage srcImage,
+    VkImageLayout srcImageLayout,
+    VkBuffer dstBuffer,
+    uint32_t regionCount,
+    const VkBufferImageCopy* pRegions)
+{
+    vkCmdCopyImageToBuffer(
+        commandBuffer,
+        srcImage,
+        srcImageLayout,
+        dstBuffer,
+        regionCount,
+        pRegions);
+}
+
+void VulkanApi::cmdCopyImage(
+    VkCommandBuffer commandBuffer,
+    VkImage srcImage,
+    VkImageLayout srcImageLayout,
+    VkImage dstImage,
+    VkImageLayout dstImageLayout,
+    uint32_t regionCount,
+    const VkImageCopy* pRegions)
+{
+    vkCmdCopyImage(
+        commandBuffer,
+        srcImage,
+        srcImageLayout,
+        dstImage,
+        dstImageLayout,
+        regionCount,
+        pRegions);
+}
+
+void VulkanApi::cmdClearColorImage(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    VkImageLayout imageLayout,
+    const VkClearColorValue* pColor,
+    uint32_t rangeCount,
+    const VkImageSubresourceRange* pRanges)
+{
+    vkCmdClearColorImage(
+        commandBuffer,
+        image,
+        imageLayout,
+        pColor,
+        rangeCount,
+        pRanges);
+}
+
 void VulkanApi::getPhysicalDeviceProperties(
     VkPhysicalDeviceProperties* pProperties) 
 {
@@ -1048,5 +1287,50 @@ void VulkanApi::destroySampler(
     vkDestroySampler(m_device, sampler, pAllocator);
 }
 
+VkResult VulkanApi::createQueryPool(
+    const VkQueryPoolCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkQueryPool* pQueryPool)
+{
+    return vkCreateQueryPool(m_device, pCreateInfo, pAllocator, pQueryPool);
+}
+
+void VulkanApi::destroyQueryPool(
+    VkQueryPool queryPool,
+    const VkAllocationCallbacks* pAllocator)
+{
+    vkDestroyQueryPool(m_device, queryPool, pAllocator);
+}
+
+VkResult VulkanApi::getQueryPoolResults(
+    VkQueryPool queryPool,
+    uint32_t firstQuery,
+    uint32_t queryCount,
+    size_t dataSize,
+    void* pData,
+    VkDeviceSize stride,
+    VkQueryResultFlags flags)
+{
+    return vkGetQueryPoolResults(m_device, queryPool, firstQuery, queryCount, dataSize, pData, stride, flags);
+}
+
+void VulkanApi::cmdResetQueryPool(
+    VkCommandBuffer commandBuffer,
+    VkQueryPool queryPool,
+    uint32_t firstQuery,
+    uint32_t queryCount)
+{
+    vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery, queryCount);
+}
+
+void VulkanApi::cmdWriteTimestamp(
+    VkCommandBuffer commandBuffer,
+    VkPipelineStageFlagBits pipelineStage,
+    VkQueryPool queryPool,
+    uint32_t query)
+{
+    vkCmdWriteTimestamp(commandBuffer, pipelineStage, queryPool, query);
+}
+
 }
 }
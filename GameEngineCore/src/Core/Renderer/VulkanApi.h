@@ -11,6 +11,8 @@ class Texture;
 
 namespace Renderer {
 
+class PipelineCache;
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
@@ -34,15 +36,26 @@ public:
     static VulkanApi& Instance();
     static void Init(Window& window);
     static void Shutdown();
+    // the pipeline and reflection caches start empty at the next Init
+    static void ClearPipelineCache();
 
     VkDevice& getDevice() { return m_device; };
     VkPhysicalDevice& getPhysicalDevice() { return m_physicalDevice; };
     VkRenderPass& getRenderPass() { return m_renderPass; };
     VkExtent2D& getSwapChainExtent() { return m_swapChainExtent; };
     VkCommandPool& getCommandPool(){ return m_commandPool; };
+    uint32_t getGraphicsQueueFamily() { return findQueueFamilies(m_physicalDevice).graphicsFamily.value(); };
     VkQueue& getGraphicsQueue() {return m_graphicsQueue; };
     VkSwapchainKHR& getSwapChain() {return m_swapChain; };
     VkFramebuffer& getSwapChainFrameBuffer(int index) { return m_swapChainFramebuffers[index]; };
+    VkImage getSwapChainImage(int index) { return m_swapChainImages[index]; };
+    VkFormat getSwapChainImageFormat() { return m_swapChainImageFormat; };
+    // no surface and no swap chain, the frames go to offscreen images (one per frame in flight) left in
+    // TRANSFER_SRC_OPTIMAL so they can be read back
+    bool isHeadless() { return m_headless; };
+    ::Engine::Ressources::Texture* getDepthBuffer() { return m_depthBuffer; };
+    // loaded from PIPELINE_CACHE_PATH with the device, saved when it's destroyed
+    PipelineCache& getPipelineCache() { return *m_pipelineCache; };
     bool frameBufferResized() { return m_framebufferResized; };
     void setFrameBufferResized(bool value) {m_framebufferResized = value; };
 
@@ -55,6 +68,14 @@ public:
 
     int getMaxFramesInFlight() {return MAX_FRAMES_IN_FLIGHT; };
 
+    // drawIndirectCount (vulkan 1.2) and multiDrawIndirect are enabled, the culling and the draw counts can be done on the gpu
+    bool supportsGpuDrivenRendering() { return m_gpuDrivenRendering; };
+    // descriptor indexing (vulkan 1.2) is enabled, the materials can go in Ressources::MaterialTable
+    bool supportsBindless() { return m_bindless; };
+    uint32_t getMaxBindlessTextures() { return m_maxBindlessTextures; };
+    // the BC1 to BC7 formats can be sampled, without it Ressources::Texture decodes them on the cpu
+    bool supportsTextureCompressionBC() { return m_textureCompressionBC; };
+
     // Buffer operations
     VkResult createBuffer(
         const VkBufferCreateInfo* pCreateInfo,
@@ -108,6 +129,20 @@ public:
         uint32_t commandBufferCount,
         const VkCommandBuffer* pCommandBuffers);
 
+    // pools owned by the caller (recording on other threads)
+    VkResult createCommandPool(
+        const VkCommandPoolCreateInfo* pCreateInfo,
+        const VkAllocationCallbacks* pAllocator,
+        VkCommandPool* pCommandPool);
+
+    void destroyCommandPool(
+        VkCommandPool commandPool,
+        const VkAllocationCallbacks* pAllocator);
+
+    VkResult resetCommandPool(
+        VkCommandPool commandPool,
+        VkCommandPoolResetFlags flags);
+
     // Image operations
     VkResult createImage(
         const VkImageCreateInfo* pCreateInfo,
@@ -193,6 +228,41 @@ public:
         int32_t vertexOffset,
         uint32_t firstInstance);
         
+    void cmdDrawIndexedIndirectCount(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer,
+        VkDeviceSize offset,
+        VkBuffer countBuffer,
+        VkDeviceSize countBufferOffset,
+        uint32_t maxDrawCount,
+        uint32_t stride);
+
+    void cmdDispatch(
+        VkCommandBuffer commandBuffer,
+        uint32_t groupCountX,
+        uint32_t groupCountY,
+        uint32_t groupCountZ);
+
+    void cmdPushConstants(
+        VkCommandBuffer commandBuffer,
+        VkPipelineLayout layout,
+        VkShaderStageFlags stageFlags,
+        uint32_t offset,
+        uint32_t size,
+        const void* pValues);
+
+    void cmdFillBuffer(
+        VkCommandBuffer commandBuffer,
+        VkBuffer dstBuffer,
+        VkDeviceSize dstOffset,
+        VkDeviceSize size,
+        uint32_t data);
+
+    void cmdExecuteCommands(
+        VkCommandBuffer commandBuffer,
+        uint32_t commandBufferCount,
+        const VkCommandBuffer* pCommandBuffers);
+
     // Pipeline
     VkResult createGraphicsPipelines(
         VkPipelineCache pipelineCache,
@@ -200,6 +270,13 @@ public:
         const VkGraphicsPipelineCreateInfo* pCreateInfos,
         const VkAllocationCallbacks* pAllocator,
         VkPipeline* pPipelines);
+
+    VkResult createComputePipelines(
+        VkPipelineCache pipelineCache,
+        uint32_t createInfoCount,
+        const VkComputePipelineCreateInfo* pCreateInfos,
+        const VkAllocationCallbacks* pAllocator,
+        VkPipeline* pPipelines);
         
     void destroyPipeline(
         VkPipeline pipeline,
@@ -362,6 +439,31 @@ public:
         uint32_t regionCount,
         const VkBufferImageCopy* pRegions);
 
+    void cmdCopyImageToBuffer(
+        VkCommandBuffer commandBuffer,
+        VkImage srcImage,
+        VkImageLayout srcImageLayout,
+        VkBuffer dstBuffer,
+        uint32_t regionCount,
+        const VkBufferImageCopy* pRegions);
+
+    void cmdCopyImage(
+        VkCommandBuffer commandBuffer,
+        VkImage srcImage,
+        VkImageLayout srcImageLayout,
+        VkImage dstImage,
+        VkImageLayout dstImageLayout,
+        uint32_t regionCount,
+        const VkImageCopy* pRegions);
+
+    void cmdClearColorImage(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkImageLayout imageLayout,
+        const VkClearColorValue* pColor,
+        uint32_t rangeCount,
+        const VkImageSubresourceRange* pRanges);
+
     void getPhysicalDeviceProperties(
         VkPhysicalDeviceProperties* pProperties);
 
@@ -374,6 +476,36 @@ public:
         VkSampler sampler,
         const VkAllocationCallbacks* pAllocator);
 
+    VkResult createQueryPool(
+        const VkQueryPoolCreateInfo* pCreateInfo,
+        const VkAllocationCallbacks* pAllocator,
+        VkQueryPool* pQueryPool);
+
+    void destroyQueryPool(
+        VkQueryPool queryPool,
+        const VkAllocationCallbacks* pAllocator);
+
+    VkResult getQueryPoolResults(
+        VkQueryPool queryPool,
+        uint32_t firstQuery,
+        uint32_t queryCount,
+        size_t dataSize,
+        void* pData,
+        VkDeviceSize stride,
+        VkQueryResultFlags flags);
+
+    void cmdResetQueryPool(
+        VkCommandBuffer commandBuffer,
+        VkQueryPool queryPool,
+        uint32_t firstQuery,
+        uint32_t queryCount);
+
+    void cmdWriteTimestamp(
+        VkCommandBuffer commandBuffer,
+        VkPipelineStageFlagBits pipelineStage,
+        VkQueryPool queryPool,
+        uint32_t query);
+
 private:
 
     void initVulkan();
@@ -388,6 +520,8 @@ private:
 
 
     void createSwapChain();
+    // the headless swap chain
+    void createOffscreenTargets();
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
@@ -406,6 +540,7 @@ private:
     void createCommandPool();
 private:
     const int MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
 
     Window& m_window;
 
@@ -424,10 +559,18 @@ private:
     VkRenderPass m_renderPass;
 
     std::vector<VkFramebuffer> m_swapChainFramebuffers;
+    // headless, m_swapChainImages and m_swapChainImageViews are theirs
+    std::vector<::Engine::Ressources::Texture*> m_offscreenTargets;
+    bool m_headless = false;
 
     ::Engine::Ressources::Texture* m_depthBuffer;
+    PipelineCache* m_pipelineCache = nullptr;
 
     bool m_framebufferResized = false;
+    bool m_gpuDrivenRendering = false;
+    bool m_bindless = false;
+    uint32_t m_maxBindlessTextures = 0;
+    bool m_textureCompressionBC = false;
 
     VkCommandPool m_commandPool;
 
@@ -2,6 +2,8 @@
 #include "Core/Renderer/VulkanApi.h"
 #include "vulkan/vulkan_core.h"
 #include "Core/Log/Log.h"
+#include "StagingRing.h"
+#include <cstring>
 #include <cstdint>
 #include <stdexcept>
 
@@ -10,14 +12,14 @@ namespace Ressources {
 
 Buffer::Buffer(uint32_t bufferCount)
 : m_buffers(bufferCount, VK_NULL_HANDLE)  // Initialize with null handles
-    , m_buffersMemory(bufferCount, VK_NULL_HANDLE)  // Initialize with null handles
+    , m_allocations(bufferCount)
     , m_mappedMemory(bufferCount, nullptr) 
 {
 }
 
 Buffer::Buffer(uint32_t size, uint32_t bufferCount)
 : m_buffers(bufferCount, VK_NULL_HANDLE)  // Initialize with null handles
-    , m_buffersMemory(bufferCount, VK_NULL_HANDLE)  // Initialize with null handles
+    , m_allocations(bufferCount)
     , m_mappedMemory(bufferCount, nullptr) 
     , m_size(size)
 {
@@ -25,14 +27,9 @@ Buffer::Buffer(uint32_t size, uint32_t bufferCount)
 }
 
 Buffer::~Buffer() {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
     for (size_t i = 0; i < m_buffers.size(); i++) {
-        if (m_mappedMemory[i]) {
-            api.unmapMemory(m_buffersMemory[i]);
-        }
         LogDebug("destorying buffer and buffer memoery");
-        api.destroyBuffer(m_buffers[i], nullptr);
-        api.freeMemory(m_buffersMemory[i], nullptr);
+        destroyBaseBuffer(i);
     }
 }
 
@@ -40,7 +37,29 @@ void Buffer::createBaseBuffer(
     size_t size,
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
-    uint32_t bufferIndex
+    uint32_t bufferIndex,
+    MemoryAllocator::Usage memoryUsage
+) {
+    createRawBuffer(size, usage, properties, m_buffers[bufferIndex], m_allocations[bufferIndex], memoryUsage);
+    m_mappedMemory[bufferIndex] = m_allocations[bufferIndex].mappedMemory;
+}
+
+void Buffer::destroyBaseBuffer(uint32_t bufferIndex) {
+    // a queued copy would write to the destroyed buffer (or to a new one given the same handle)
+    if (m_buffers[bufferIndex] != VK_NULL_HANDLE && StagingRing::IsEnabled()) {
+        StagingRing::Instance().cancel(m_buffers[bufferIndex]);
+    }
+    destroyRawBuffer(m_buffers[bufferIndex], m_allocations[bufferIndex]);
+    m_mappedMemory[bufferIndex] = nullptr;
+}
+
+void Buffer::createRawBuffer(
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    VkBuffer& buffer,
+    Allocation& allocation,
+    MemoryAllocator::Usage memoryUsage
 ) {
     Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
     VkBufferCreateInfo bufferInfo{};
@@ -49,23 +68,20 @@ void Buffer::createBaseBuffer(
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (api.createBuffer(&bufferInfo, nullptr, &m_buffers[bufferIndex]) != VK_SUCCESS) {
+    if (api.createBuffer(&bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer!");
     }; 
 
-    VkMemoryRequirements memRequirements;
-    api.getBufferMemoryRequirements(m_buffers[bufferIndex], &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (api.allocateMemory(&allocInfo, nullptr, &m_buffersMemory[bufferIndex]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    };
+    allocation = MemoryAllocator::Instance().allocateForBuffer(buffer, properties, memoryUsage);
+}
 
-    api.bindBufferMemory(m_buffers[bufferIndex], m_buffersMemory[bufferIndex], 0);
+void Buffer::destroyRawBuffer(VkBuffer& buffer, Allocation& allocation) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    if (buffer != VK_NULL_HANDLE) {
+        api.destroyBuffer(buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+    }
+    MemoryAllocator::Instance().free(allocation);
 }
 
 void Buffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
@@ -101,43 +117,33 @@ uint32_t Buffer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags prope
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void Buffer::mapMemory(VkDeviceSize size, VkMemoryMapFlags flags, void** ppData, uint32_t index) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-    api.mapMemory(m_buffersMemory[index], 0, size, flags, ppData);
-}
-void Buffer::unmapMemory(uint32_t index) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-    api.unmapMemory(m_buffersMemory[index]);
+void Buffer::updateData(void* data, size_t size, uint32_t bufferIndex, uint32_t offset) {
+    if (!StagingRing::Instance().upload(data, size, m_buffers[bufferIndex], offset)) {
+        uploadImmediate(data, size, m_buffers[bufferIndex], offset);
+    }
 }
 
-void Buffer::updateData(void* data, size_t size, uint32_t bufferIndex, uint32_t offset) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+void Buffer::uploadImmediate(const void* data, size_t size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    Allocation stagingAllocation;
 
     // Create staging buffer
-    createBaseBuffer(
+    createRawBuffer(
         size,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        0  // Use temporary index
+        stagingBuffer,
+        stagingAllocation,
+        MemoryAllocator::Usage::Transient
     );
 
-    stagingBuffer = m_buffers[0];
-    stagingBufferMemory = m_buffersMemory[0];
-
-    // Map memory and copy data
-    void* mappedMemory;
-    api.mapMemory(stagingBufferMemory, 0, size, 0, &mappedMemory);
-    memcpy(mappedMemory, data, size);
-    api.unmapMemory(stagingBufferMemory);
+    memcpy(stagingAllocation.mappedMemory, data, size);
 
     // Copy from staging buffer to device local buffer
-    copyBuffer(stagingBuffer, m_buffers[bufferIndex], size, 0, offset);
+    copyBuffer(stagingBuffer, dstBuffer, size, 0, dstOffset);
 
     // Cleanup staging buffer
-    api.destroyBuffer(stagingBuffer, nullptr);
-    api.freeMemory(stagingBufferMemory, nullptr);
+    destroyRawBuffer(stagingBuffer, stagingAllocation);
 }
 
 }
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <vector>
 #include "Core/Renderer/VulkanApi.h"
+#include "MemoryAllocator.h"
 
 namespace Engine {
 namespace Ressources {
@@ -15,29 +16,45 @@ public:
     
     ~Buffer();
 
+    // device local buffers: the copy goes through the staging ring and is done before the render pass of the frame
+    // being recorded (or of the next one when the frame's copies were already flushed)
     virtual void updateData(void* data, size_t size, uint32_t bufferIndex = 0, uint32_t offset = 0);
     VkBuffer getBuffer(uint32_t index = 0) const { return m_buffers[index]; }
+    // nullptr when the memory isn't host visible
+    void* getMappedMemory(uint32_t index = 0) const { return m_mappedMemory[index]; }
 
+    // host visible memory is mapped for the whole life of the buffer (getMappedMemory). The buffers are never moved
+    // by MemoryAllocator::defragment, their handles are in descriptor sets written once
     void createBaseBuffer(
         size_t size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
-        uint32_t index
+        uint32_t index,
+        MemoryAllocator::Usage memoryUsage = MemoryAllocator::Usage::Persistent
     );
+    void destroyBaseBuffer(uint32_t index);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
-
-    void mapMemory(VkDeviceSize size, VkMemoryMapFlags flags, void** ppData, uint32_t index = 0);
-    void unmapMemory(uint32_t index = 0);
+    // temporary staging buffer and a copy waited on right away, for what doesn't fit in the staging ring
+    void uploadImmediate(const void* data, size_t size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
 public:
     uint32_t m_size;
 
 protected:
     std::vector<VkBuffer> m_buffers;
-    std::vector<VkDeviceMemory> m_buffersMemory;
+    std::vector<Allocation> m_allocations;
     std::vector<void*> m_mappedMemory;  // For persistent mapping if needed
 
 
 public:
+    static void createRawBuffer(
+        VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        VkMemoryPropertyFlags properties,
+        VkBuffer& buffer,
+        Allocation& allocation,
+        MemoryAllocator::Usage memoryUsage = MemoryAllocator::Usage::Persistent
+    );
+    static void destroyRawBuffer(VkBuffer& buffer, Allocation& allocation);
     static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     static uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, Renderer::VulkanApi& api);
 };
@@ -210,6 +210,7 @@ VkDescriptorSetLayout DescriptorLayoutCache::create_descriptor_layout(VkDescript
     }
 
     //try to grab from cache
+    std::lock_guard<std::mutex> lock(m_mutex);
     auto it = m_layoutCache.find(layoutinfo);
     if (it != m_layoutCache.end()){
         return (*it).second;
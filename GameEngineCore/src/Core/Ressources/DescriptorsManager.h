@@ -9,6 +9,7 @@
 #include "vulkan/vulkan_core.h"
 #include <GLFW/glfw3.h>
 #include <deque>
+#include <mutex>
 #include <span>
 #include <unordered_map>
 #include <vector>
@@ -46,6 +47,8 @@ private:
     };
 
     std::unordered_map<DescriptorLayoutInfo, VkDescriptorSetLayout, DescriptorLayoutHash> m_layoutCache;
+    // the pipelines are reflected on worker threads (PipelineBuilder)
+    std::mutex m_mutex;
 };
 
 
@@ -0,0 +1,182 @@
+#include "GeometryPool.h"
+#include "Core/Renderer/VulkanApi.h"
+#include "Core/Log/Log.h"
+
+namespace Engine {
+namespace Ressources {
+
+RangeAllocator::RangeAllocator(VkDeviceSize size)
+    : m_size(size)
+{
+    insertFree(0, size);
+}
+
+void RangeAllocator::insertFree(VkDeviceSize offset, VkDeviceSize size) {
+    m_freeByOffset[offset] = size;
+    m_freeBySize.insert({size, offset});
+}
+
+void RangeAllocator::removeFree(std::map<VkDeviceSize, VkDeviceSize>::iterator it) {
+    auto [first, last] = m_freeBySize.equal_range(it->second);
+    for (auto sizeIt = first; sizeIt != last; sizeIt++) {
+        if (sizeIt->second == it->first) {
+            m_freeBySize.erase(sizeIt);
+            break;
+        }
+    }
+    m_freeByOffset.erase(it);
+}
+
+bool RangeAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    if (size == 0) {
+        return false;
+    }
+
+    // the smallest free range it fits in, a bigger one only when the alignment padding doesn't fit
+    for (auto it = m_freeBySize.lower_bound(size); it != m_freeBySize.end(); it++) {
+        VkDeviceSize rangeOffset = it->second;
+        VkDeviceSize rangeSize = it->first;
+        VkDeviceSize alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+        VkDeviceSize padding = alignedOffset - rangeOffset;
+        if (padding + size > rangeSize) {
+            continue;
+        }
+
+        removeFree(m_freeByOffset.find(rangeOffset));
+        if (padding > 0) {
+            insertFree(rangeOffset, padding);
+        }
+        if (padding + size < rangeSize) {
+            insertFree(alignedOffset + size, rangeSize - padding - size);
+        }
+
+        m_usedSize += size;
+        offset = alignedOffset;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::free(VkDeviceSize offset, VkDeviceSize size) {
+    m_usedSize -= size;
+
+    auto next = m_freeByOffset.lower_bound(offset);
+    if (next != m_freeByOffset.end() && next->first == offset + size) {
+        size += next->second;
+        removeFree(next);
+    }
+
+    auto previous = m_freeByOffset.lower_bound(offset);
+    if (previous != m_freeByOffset.begin()) {
+        previous--;
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            removeFree(previous);
+        }
+    }
+
+    insertFree(offset, size);
+}
+
+static GeometryPool* instance;
+
+void GeometryPool::Init() {
+    instance = new GeometryPool();
+}
+
+GeometryPool& GeometryPool::Instance() {
+    return *instance;
+}
+
+void GeometryPool::Shutdown() {
+    delete instance;
+    instance = nullptr;
+}
+
+bool GeometryPool::IsEnabled() {
+    return instance != nullptr;
+}
+
+GeometryPool::GeometryPool()
+    : m_vertexRanges(VERTEX_POOL_SIZE), m_indexRanges(INDEX_POOL_SIZE)
+{
+    m_vertexBuffer = std::make_unique<Buffer>(VERTEX_POOL_SIZE, 1);
+    m_vertexBuffer->createBaseBuffer(
+        VERTEX_POOL_SIZE,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0
+    );
+
+    m_indexBuffer = std::make_unique<Buffer>(INDEX_POOL_SIZE, 1);
+    m_indexBuffer->createBaseBuffer(
+        INDEX_POOL_SIZE,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0
+    );
+}
+
+bool GeometryPool::allocateVertices(VkDeviceSize size, VkDeviceSize stride, Range& range) {
+    if (!m_vertexRanges.allocate(size, stride, range.offset)) {
+        LogWarning("geometry pool : no room for ", size, " bytes of vertices");
+        return false;
+    }
+    range.size = size;
+    return true;
+}
+
+bool GeometryPool::allocateIndices(VkDeviceSize size, Range& range) {
+    if (!m_indexRanges.allocate(size, sizeof(uint32_t), range.offset)) {
+        LogWarning("geometry pool : no room for ", size, " bytes of indices");
+        return false;
+    }
+    range.size = size;
+    return true;
+}
+
+void GeometryPool::freeVertices(Range& range) {
+    if (range.size == 0) {
+        return;
+    }
+    m_vertexRanges.free(range.offset, range.size);
+    range = Range{};
+}
+
+void GeometryPool::freeIndices(Range& range) {
+    if (range.size == 0) {
+        return;
+    }
+    m_indexRanges.free(range.offset, range.size);
+    range = Range{};
+}
+
+void GeometryPool::uploadVertices(const Range& range, const void* data, size_t size) {
+    m_vertexBuffer->updateData(const_cast<void*>(data), size, 0, (uint32_t)range.offset);
+}
+
+void GeometryPool::uploadIndices(const Range& range, const void* data, size_t size) {
+    m_indexBuffer->updateData(const_cast<void*>(data), size, 0, (uint32_t)range.offset);
+}
+
+void GeometryPool::bind(VkCommandBuffer commandBuffer) {
+    auto& api = Renderer::VulkanApi::Instance();
+    VkBuffer vertexBuffers[] = {m_vertexBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    api.cmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    api.cmdBindIndexBuffer(commandBuffer, m_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+GeometryPool::Stats GeometryPool::getStats() const {
+    Stats stats;
+    stats.vertexUsed = m_vertexRanges.getUsedSize();
+    stats.indexUsed = m_indexRanges.getUsedSize();
+    stats.freeRangeCount = m_vertexRanges.getFreeRangeCount() + m_indexRanges.getFreeRangeCount();
+    stats.largestVertexRange = m_vertexRanges.getLargestFreeRange();
+    stats.largestIndexRange = m_indexRanges.getLargestFreeRange();
+    return stats;
+}
+
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include "Buffer.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+
+namespace Engine {
+namespace Ressources {
+
+// Best fit free list over [0, size). The free neighbours are merged back when a range is freed so meshes streamed
+// in and out don't leave small holes behind. The alignment doesn't have to be a power of 2 (vertex strides).
+class RangeAllocator {
+public:
+    RangeAllocator(VkDeviceSize size);
+
+    // false when there is no free range big enough
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    void free(VkDeviceSize offset, VkDeviceSize size);
+
+    VkDeviceSize getSize() const { return m_size; };
+    VkDeviceSize getUsedSize() const { return m_usedSize; };
+    uint32_t getFreeRangeCount() const { return (uint32_t)m_freeByOffset.size(); };
+    VkDeviceSize getLargestFreeRange() const { return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first; };
+
+private:
+    void insertFree(VkDeviceSize offset, VkDeviceSize size);
+    void removeFree(std::map<VkDeviceSize, VkDeviceSize>::iterator it);
+
+private:
+    VkDeviceSize m_size;
+    VkDeviceSize m_usedSize = 0;
+    std::map<VkDeviceSize, VkDeviceSize> m_freeByOffset; // offset -> size
+    std::multimap<VkDeviceSize, VkDeviceSize> m_freeBySize; // size -> offset
+};
+
+// One device local vertex buffer and one index buffer shared by the meshes, each mesh is a range in both
+// (Mesh::getVertexOffset and getFirstIndex). They are bound once and switching mesh only changes the draw parameters,
+// which is what the indirect draws need. When it's full the meshes get their own buffers like before.
+class GeometryPool {
+public:
+    static constexpr VkDeviceSize VERTEX_POOL_SIZE = 128 * 1024 * 1024;
+    static constexpr VkDeviceSize INDEX_POOL_SIZE = 64 * 1024 * 1024;
+
+    // in bytes
+    struct Range {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+    };
+
+    struct Stats {
+        VkDeviceSize vertexUsed = 0;
+        VkDeviceSize indexUsed = 0;
+        uint32_t freeRangeCount = 0; // a lot of free ranges for the free size means the pool is fragmented
+        VkDeviceSize largestVertexRange = 0;
+        VkDeviceSize largestIndexRange = 0;
+    };
+
+    static void Init();
+    static GeometryPool& Instance();
+    static void Shutdown();
+    static bool IsEnabled();
+
+    GeometryPool();
+
+    // the offset of the vertices is a multiple of the stride, so it's a whole number of vertices
+    bool allocateVertices(VkDeviceSize size, VkDeviceSize stride, Range& range);
+    bool allocateIndices(VkDeviceSize size, Range& range);
+    void freeVertices(Range& range);
+    void freeIndices(Range& range);
+
+    // device local, the copy is done at the start of the next frame. The staging ring barrier waits for the draws
+    // submitted before, so a freed range can be written again right away
+    void uploadVertices(const Range& range, const void* data, size_t size);
+    void uploadIndices(const Range& range, const void* data, size_t size);
+
+    void bind(VkCommandBuffer commandBuffer);
+
+    Stats getStats() const;
+
+private:
+    std::unique_ptr<Buffer> m_vertexBuffer;
+    std::unique_ptr<Buffer> m_indexBuffer;
+    RangeAllocator m_vertexRanges;
+    RangeAllocator m_indexRanges;
+};
+
+}
+}
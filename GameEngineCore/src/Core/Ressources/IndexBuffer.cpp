@@ -16,24 +16,19 @@ IndexBuffer::IndexBuffer(void* data, size_t size, int indexCount)
 }
 
 void IndexBuffer::createBuffer(void* data, size_t size) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    Allocation stagingAllocation;
 
-    createBaseBuffer(
+    createRawBuffer(
         size,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        0  // Use temporary index
+        stagingBuffer,
+        stagingAllocation,
+        MemoryAllocator::Usage::Transient
     );
 
-    stagingBuffer = m_buffers[0];
-    stagingBufferMemory = m_buffersMemory[0];
-
-    void* mappedMemory;
-    api.mapMemory(stagingBufferMemory, 0, size, 0, &mappedMemory);
-    memcpy(mappedMemory, data, size);
-    api.unmapMemory(stagingBufferMemory);
+    memcpy(stagingAllocation.mappedMemory, data, size);
 
     createBaseBuffer(
         size,
@@ -44,34 +39,7 @@ void IndexBuffer::createBuffer(void* data, size_t size) {
 
     copyBuffer(stagingBuffer, m_buffers[0], size);
 
-    api.destroyBuffer(stagingBuffer, nullptr);
-    api.freeMemory(stagingBufferMemory, nullptr);
-}
-
-void IndexBuffer::updateData(void* data, size_t size, uint32_t bufferIndex, uint32_t offset) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    createBaseBuffer(
-        size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        0  // Use temporary index
-    );
-
-    stagingBuffer = m_buffers[0];
-    stagingBufferMemory = m_buffersMemory[0];
-
-    void* mappedMemory;
-    api.mapMemory(stagingBufferMemory, 0, size, 0, &mappedMemory);
-    memcpy(mappedMemory, data, size);
-    api.unmapMemory(stagingBufferMemory);
-
-    copyBuffer(stagingBuffer, m_buffers[bufferIndex], size, 0, offset);
-
-    api.destroyBuffer(stagingBuffer, nullptr);
-    api.freeMemory(stagingBufferMemory, nullptr);
+    destroyRawBuffer(stagingBuffer, stagingAllocation);
 }
 
 }
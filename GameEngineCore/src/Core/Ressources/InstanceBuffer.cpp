@@ -0,0 +1,51 @@
+#include "Core/Renderer/VulkanApi.h"
+#include "InstanceBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+InstanceBuffer::InstanceBuffer(size_t size, uint32_t bufferCount, VkBufferUsageFlags usage)
+    : Buffer(size, bufferCount), m_usage(usage), m_capacities(bufferCount, 0)
+{
+    for (uint32_t i = 0; i < bufferCount; i++) {
+        createBuffer(size, i);
+    }
+}
+
+void InstanceBuffer::createBuffer(size_t size, uint32_t bufferIndex) {
+    destroyBaseBuffer(bufferIndex);
+
+    // host visible so the allocator keeps it mapped
+    createBaseBuffer(
+        size,
+        m_usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        bufferIndex
+    );
+    m_capacities[bufferIndex] = size;
+}
+
+bool InstanceBuffer::reserve(size_t size, uint32_t bufferIndex) {
+    if (size <= m_capacities[bufferIndex]) {
+        return false;
+    }
+    // grow by 1.5 so a slowly growing emitter doesn't recreate the buffer every frame
+    createBuffer(std::max(size, m_capacities[bufferIndex] + m_capacities[bufferIndex] / 2), bufferIndex);
+    return true;
+}
+
+void InstanceBuffer::updateData(void* data, size_t size, uint32_t bufferIndex, uint32_t offset) {
+    if (bufferIndex >= m_mappedMemory.size()) {
+        throw std::runtime_error("Buffer index out of range");
+    }
+    reserve(offset + size, bufferIndex);
+
+    char* dst = static_cast<char*>(m_mappedMemory[bufferIndex]) + offset;
+    memcpy(dst, data, size);
+}
+
+}
+}
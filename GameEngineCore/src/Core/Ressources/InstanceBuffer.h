@@ -0,0 +1,33 @@
+#pragma once
+#include <GLFW/glfw3.h>
+#include "Buffer.h"
+
+namespace Engine {
+namespace Ressources {
+
+// per instance data that changes every frame (particles, instanced meshes, ...)
+// a vertex buffer by default, usage can be VK_BUFFER_USAGE_STORAGE_BUFFER_BIT to read it from a shader with an index
+// one buffer per frame in flight, host visible and mapped for its whole life so writing is just a memcpy
+// it grows when needed, the buffer of a frame is only recreated when that frame is the current one
+// (its fence was waited in beginFrame so the gpu is not reading it anymore)
+class InstanceBuffer: public Buffer {
+public:
+    InstanceBuffer(size_t size, uint32_t bufferCount, VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+    // make sure the buffer of bufferIndex can hold size bytes (content is lost if it has to grow)
+    // returns true when the VkBuffer changed, the descriptor sets that use it have to be updated
+    bool reserve(size_t size, uint32_t bufferIndex);
+    void updateData(void* data, size_t size, uint32_t bufferIndex = 0, uint32_t offset = 0) override;
+
+    size_t getCapacity(uint32_t bufferIndex) const { return m_capacities[bufferIndex]; };
+
+private:
+    void createBuffer(size_t size, uint32_t bufferIndex);
+
+private:
+    VkBufferUsageFlags m_usage;
+    std::vector<size_t> m_capacities;
+};
+
+}
+}
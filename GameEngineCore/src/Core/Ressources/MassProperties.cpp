@@ -0,0 +1,203 @@
+#include "MassProperties.h"
+#include "Core/Log/Log.h"
+#include <cmath>
+
+namespace Engine {
+namespace Ressources {
+
+namespace {
+
+// names are the same as in volInt.c from the paper so it's easier to compare
+
+struct ProjectionIntegrals {
+    double P1 = 0, Pa = 0, Pb = 0, Paa = 0, Pab = 0, Pbb = 0, Paaa = 0, Paab = 0, Pabb = 0, Pbbb = 0;
+};
+
+// integrals over the triangle projected on the plane (A, B)
+ProjectionIntegrals computeProjectionIntegrals(const glm::dvec3 vertices[3], int A, int B) {
+    ProjectionIntegrals p;
+
+    for (int i = 0; i < 3; i++) {
+        double a0 = vertices[i][A];
+        double b0 = vertices[i][B];
+        double a1 = vertices[(i + 1) % 3][A];
+        double b1 = vertices[(i + 1) % 3][B];
+        double da = a1 - a0;
+        double db = b1 - b0;
+
+        double a0_2 = a0 * a0, a0_3 = a0_2 * a0, a0_4 = a0_3 * a0;
+        double b0_2 = b0 * b0, b0_3 = b0_2 * b0, b0_4 = b0_3 * b0;
+        double a1_2 = a1 * a1, a1_3 = a1_2 * a1;
+        double b1_2 = b1 * b1, b1_3 = b1_2 * b1;
+
+        double C1 = a1 + a0;
+        double Ca = a1 * C1 + a0_2;
+        double Caa = a1 * Ca + a0_3;
+        double Caaa = a1 * Caa + a0_4;
+        double Cb = b1 * (b1 + b0) + b0_2;
+        double Cbb = b1 * Cb + b0_3;
+        double Cbbb = b1 * Cbb + b0_4;
+        double Cab = 3 * a1_2 + 2 * a1 * a0 + a0_2;
+        double Kab = a1_2 + 2 * a1 * a0 + 3 * a0_2;
+        double Caab = a0 * Cab + 4 * a1_3;
+        double Kaab = a1 * Kab + 4 * a0_3;
+        double Cabb = 4 * b1_3 + 3 * b1_2 * b0 + 2 * b1 * b0_2 + b0_3;
+        double Kabb = b1_3 + 2 * b1_2 * b0 + 3 * b1 * b0_2 + 4 * b0_3;
+
+        p.P1 += db * C1;
+        p.Pa += db * Ca;
+        p.Paa += db * Caa;
+        p.Paaa += db * Caaa;
+        p.Pb += da * Cb;
+        p.Pbb += da * Cbb;
+        p.Pbbb += da * Cbbb;
+        p.Pab += db * (b1 * Cab + b0 * Kab);
+        p.Paab += db * (b1 * Caab + b0 * Kaab);
+        p.Pabb += da * (a1 * Cabb + a0 * Kabb);
+    }
+
+    p.P1 /= 2.0;
+    p.Pa /= 6.0;
+    p.Paa /= 12.0;
+    p.Paaa /= 20.0;
+    p.Pb /= -6.0;
+    p.Pbb /= -12.0;
+    p.Pbbb /= -20.0;
+    p.Pab /= 24.0;
+    p.Paab /= 60.0;
+    p.Pabb /= -60.0;
+
+    return p;
+}
+
+}
+
+MassProperties MassProperties::compute(const glm::vec3* positions, const uint32_t* indices, size_t indexCount) {
+    // T0 : volume, T1 : first moments, T2 : x^2 y^2 z^2, TP : xy yz zx
+    double T0 = 0;
+    glm::dvec3 T1(0.0), T2(0.0), TP(0.0);
+
+    for (size_t triangle = 0; triangle + 2 < indexCount; triangle += 3) {
+        glm::dvec3 vertices[3] = {
+            positions[indices[triangle + 0]],
+            positions[indices[triangle + 1]],
+            positions[indices[triangle + 2]]
+        };
+
+        glm::dvec3 normal = glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]);
+        double length = glm::length(normal);
+        if (length < 1e-12) {
+            // degenerate triangle, it doesn't add anything
+            continue;
+        }
+        normal /= length;
+        double w = -glm::dot(normal, vertices[0]);
+
+        // project on the plane where the triangle is the biggest
+        glm::dvec3 absNormal = glm::abs(normal);
+        int C = (absNormal.x > absNormal.y) ? ((absNormal.x > absNormal.z) ? 0 : 2) : ((absNormal.y > absNormal.z) ? 1 : 2);
+        int A = (C + 1) % 3;
+        int B = (A + 1) % 3;
+
+        ProjectionIntegrals p = computeProjectionIntegrals(vertices, A, B);
+
+        // face integrals
+        double nA = normal[A], nB = normal[B], nC = normal[C];
+        double k1 = 1.0 / nC, k2 = k1 * k1, k3 = k2 * k1, k4 = k3 * k1;
+
+        double Fa = k1 * p.Pa;
+        double Fb = k1 * p.Pb;
+        double Fc = -k2 * (nA * p.Pa + nB * p.Pb + w * p.P1);
+
+        double Faa = k1 * p.Paa;
+        double Fbb = k1 * p.Pbb;
+        double Fcc = k3 * (nA * nA * p.Paa + 2 * nA * nB * p.Pab + nB * nB * p.Pbb
+                           + w * (2 * (nA * p.Pa + nB * p.Pb) + w * p.P1));
+
+        double Faaa = k1 * p.Paaa;
+        double Fbbb = k1 * p.Pbbb;
+        double Fccc = -k4 * (nA * nA * nA * p.Paaa + 3 * nA * nA * nB * p.Paab
+                             + 3 * nA * nB * nB * p.Pabb + nB * nB * nB * p.Pbbb
+                             + 3 * w * (nA * nA * p.Paa + 2 * nA * nB * p.Pab + nB * nB * p.Pbb)
+                             + w * w * (3 * (nA * p.Pa + nB * p.Pb) + w * p.P1));
+
+        double Faab = k1 * p.Paab;
+        double Fbbc = -k2 * (nA * p.Pabb + nB * p.Pbbb + w * p.Pbb);
+        double Fcca = k3 * (nA * nA * p.Paaa + 2 * nA * nB * p.Paab + nB * nB * p.Pabb
+                            + w * (2 * (nA * p.Paa + nB * p.Pab) + w * p.Pa));
+
+        // volume integrals
+        T0 += normal.x * ((A == 0) ? Fa : ((B == 0) ? Fb : Fc));
+
+        T1[A] += nA * Faa;
+        T1[B] += nB * Fbb;
+        T1[C] += nC * Fcc;
+        T2[A] += nA * Faaa;
+        T2[B] += nB * Fbbb;
+        T2[C] += nC * Fccc;
+        TP[A] += nA * Faab;
+        TP[B] += nB * Fbbc;
+        TP[C] += nC * Fcca;
+    }
+
+    T1 /= 2.0;
+    T2 /= 3.0;
+    TP /= 2.0;
+
+    // clockwise winding : everything has the wrong sign
+    if (T0 < 0) {
+        T0 = -T0;
+        T1 = -T1;
+        T2 = -T2;
+        TP = -TP;
+    }
+
+    MassProperties result;
+    if (T0 < 1e-9) {
+        LogWarning("Mass properties : volume is ~0, the mesh is probably not closed");
+        return result;
+    }
+
+    result.valid = true;
+    result.volume = (float)T0;
+    glm::dvec3 centerOfMass = T1 / T0;
+    result.centerOfMass = centerOfMass;
+
+    // second moments around the origin then moved to the center of mass (parallel axis)
+    // TP.x = xy, TP.y = yz, TP.z = zx
+    glm::dmat3 covariance(
+        T2.x, TP.x, TP.z,
+        TP.x, T2.y, TP.y,
+        TP.z, TP.y, T2.z
+    );
+    covariance -= T0 * glm::outerProduct(centerOfMass, centerOfMass);
+    result.covariance = glm::mat3(covariance);
+
+    return result;
+}
+
+MassProperties MassProperties::scaled(glm::vec3 scale) const {
+    MassProperties result = *this;
+    float determinant = std::abs(scale.x * scale.y * scale.z);
+
+    result.volume = volume * determinant;
+    result.centerOfMass = centerOfMass * scale;
+
+    // x' = S x so integral of x' x'^T = |det S| * S C S
+    glm::mat3 scaleMatrix(0.0f);
+    scaleMatrix[0][0] = scale.x;
+    scaleMatrix[1][1] = scale.y;
+    scaleMatrix[2][2] = scale.z;
+    result.covariance = determinant * scaleMatrix * covariance * scaleMatrix;
+    result.valid = valid && determinant > 0.0f;
+
+    return result;
+}
+
+glm::mat3 MassProperties::getInertiaTensor(float density) const {
+    float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+    return density * (trace * glm::mat3(1.0f) - covariance);
+}
+
+}
+}
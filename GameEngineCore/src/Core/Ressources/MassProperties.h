@@ -0,0 +1,42 @@
+//
+//
+// Polyhedral mass properties, this is Brian Mirtich's algorithm :
+// https://people.eecs.berkeley.edu/~jfc/mirtich/massProps.html
+// (the paper : "Fast and Accurate Computation of Polyhedral Mass Properties")
+//
+// It turns the volume integrals into surface integrals (divergence theorem) and then into line integrals
+// over the edges of each face projected on a plane, so it's exact for any closed triangle mesh.
+//
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Engine {
+namespace Ressources {
+
+struct MassProperties {
+    // negative or ~0 volume means the mesh isn't closed (or is flat), don't use it for a rigidbody
+    bool valid = false;
+
+    float volume = 0.0f;
+    glm::vec3 centerOfMass = glm::vec3(0.0f);
+    // integral of x * x^T over the volume around the center of mass (for a density of 1)
+    // it's stored instead of the inertia tensor because a scale can be applied on it directly (see scaled())
+    glm::mat3 covariance = glm::mat3(0.0f);
+
+    // indices are triangles, the winding must be counter clockwise seen from outside (if it's the other way it's flipped)
+    static MassProperties compute(const glm::vec3* positions, const uint32_t* indices, size_t indexCount);
+
+    // same properties for the mesh scaled by scale (no need to go through the triangles again)
+    MassProperties scaled(glm::vec3 scale) const;
+
+    float getMass(float density) const { return volume * density; };
+    // inertia tensor around the center of mass
+    glm::mat3 getInertiaTensor(float density) const;
+};
+
+}
+}
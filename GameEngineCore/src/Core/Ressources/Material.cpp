@@ -4,70 +4,182 @@
 #include "Pipeline.h"
 #include "Material.h"
 #include "DescriptorsManager.h"
+#include "MaterialTable.h"
+#include "TextureStreamer.h"
 #include "Core/Renderer/VulkanApi.h"
 #include "UniformBuffer.h"
 #include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace Engine {
 namespace Ressources {
 
+uint32_t MaterialTemplate::s_nextIndex = 0;
+
 MaterialTemplate::MaterialTemplate(std::unique_ptr<Pipeline> pipeline)
+: m_index(s_nextIndex++)
 {
     m_pipeline = std::move(pipeline);
 };
 
+MaterialTemplate::MaterialTemplate(std::shared_ptr<PendingPipeline> pipeline)
+: m_pendingPipeline(pipeline), m_index(s_nextIndex++)
+{
+};
+
 void MaterialTemplate::bindPipeline(Renderer::Renderer::FrameInfo frameInfo){
     Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-    api.cmdBindPipeline(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPipeline());
+    api.cmdBindPipeline(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, getPipeline()->getPipeline());
 };
 
+uint32_t Material::s_nextIndex = 0;
+
 Material::Material(std::shared_ptr<MaterialTemplate> matTemplate, size_t matSize)
 : Material(matTemplate, matSize, nullptr)
 {
 }
 
 Material::Material(std::shared_ptr<MaterialTemplate> matTemplate, size_t matSize, std::vector<VkDescriptorImageInfo>* texturesInfo)
-: m_matTemplate(matTemplate), m_sizeOfMaterial(matSize)
+: m_matTemplate(matTemplate), m_sizeOfMaterial(matSize), m_bindless(matTemplate->isBindless())
 {
+    createDescriptorSets(texturesInfo);
+};
+
+Material::Material(std::shared_ptr<MaterialTemplate> matTemplate, size_t matSize, std::vector<std::shared_ptr<Texture>> textures)
+: m_matTemplate(matTemplate), m_sizeOfMaterial(matSize), m_bindless(matTemplate->isBindless()), m_textures(std::move(textures))
+{
+    for (const std::shared_ptr<Texture>& texture : m_textures) {
+        m_streamed |= texture->isStreamed();
+    }
+    std::vector<VkDescriptorImageInfo> texturesInfo = getTexturesInfo();
+    createDescriptorSets(&texturesInfo);
+    if (m_streamed) {
+        TextureStreamer::Instance().addMaterial(this);
+    }
+}
+
+void Material::createDescriptorSets(std::vector<VkDescriptorImageInfo>* texturesInfo) {
+    if (m_bindless) {
+        if (!MaterialTable::IsEnabled()) {
+            throw std::runtime_error("bindless material but the device has no descriptor indexing!");
+        }
+        m_index = MaterialTable::Instance().addMaterial(texturesInfo);
+        m_texturesVersions.assign(1, getTexturesVersion());
+        return;
+    }
+
+    m_index = s_nextIndex++;
     m_matUniformBuffer = std::make_unique<UniformBuffer>(m_sizeOfMaterial, 1);
 
-    m_matDescriptorSet.resize(1);
+    uint32_t setCount = m_streamed ? Renderer::VulkanApi::Instance().getMaxFramesInFlight() : 1;
+    m_matDescriptorSet.resize(setCount);
+    m_texturesVersions.assign(setCount, getTexturesVersion());
 
-    for (size_t i = 0;i < 1; i++) {
+    for (size_t i = 0;i < setCount; i++) {
         VkDescriptorBufferInfo matBufferInfo{};
-        matBufferInfo.buffer = m_matUniformBuffer->getBuffer(i);
+        matBufferInfo.buffer = m_matUniformBuffer->getBuffer(0);
         matBufferInfo.offset = 0;
-        matBufferInfo.range = sizeof(m_sizeOfMaterial); // Size of one model matrix
+        matBufferInfo.range = m_sizeOfMaterial;
 
         auto descriptorBuilder = ::Engine::Ressources::DescriptorBuilder();
         descriptorBuilder
             .bind_buffer(0, &matBufferInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
         if (texturesInfo) {
             int binding = 1;
-            for (VkDescriptorImageInfo textureInfo : *texturesInfo) {
+            // the builder keeps a pointer to the info until build()
+            for (VkDescriptorImageInfo& textureInfo : *texturesInfo) {
                 descriptorBuilder.bind_image(binding, &textureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
                 binding ++;
             }
         }
         m_matDescriptorSet[i] = descriptorBuilder.build();
     }
+}
 
-};
+Material::~Material() {
+    if (m_streamed && TextureStreamer::IsEnabled()) {
+        TextureStreamer::Instance().removeMaterial(this);
+    }
+    if (m_bindless && MaterialTable::IsEnabled()) {
+        MaterialTable::Instance().removeMaterial(m_index);
+    }
+}
+
+std::vector<VkDescriptorImageInfo> Material::getTexturesInfo() {
+    std::vector<VkDescriptorImageInfo> texturesInfo;
+    for (const std::shared_ptr<Texture>& texture : m_textures) {
+        texturesInfo.push_back(texture->createDescriptorImageInfo());
+    }
+    return texturesInfo;
+}
+
+uint32_t Material::getTexturesVersion() const {
+    // the versions only go up, the sum changes when any of them does
+    uint32_t version = 0;
+    for (const std::shared_ptr<Texture>& texture : m_textures) {
+        version += texture->getVersion();
+    }
+    return version;
+}
+
+VkDescriptorSet Material::getDescriptorSet(uint32_t frameIndex) const {
+    return m_matDescriptorSet.size() > 1 ? m_matDescriptorSet[frameIndex] : m_matDescriptorSet[0];
+}
+
+void Material::refreshTextures(uint32_t frameIndex) {
+    uint32_t version = getTexturesVersion();
+    uint32_t set = m_bindless ? 0 : frameIndex;
+    if (m_texturesVersions[set] == version) {
+        return;
+    }
+    m_texturesVersions[set] = version;
+
+    std::vector<VkDescriptorImageInfo> texturesInfo = getTexturesInfo();
+    if (m_bindless) {
+        MaterialTable::Instance().setMaterialTextures(m_index, texturesInfo);
+        return;
+    }
+
+    std::vector<VkWriteDescriptorSet> writes(texturesInfo.size());
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_matDescriptorSet[set];
+        writes[i].dstBinding = i + 1;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[i].pImageInfo = &texturesInfo[i];
+    }
+    Renderer::VulkanApi::Instance().updateDescriptorSets((uint32_t)writes.size(), writes.data(), 0, nullptr);
+}
 
 void Material::updateData(void* data) {
+    if (m_bindless) {
+        MaterialTable::Instance().updateMaterial(m_index, data, m_sizeOfMaterial);
+        return;
+    }
     m_matUniformBuffer->updateData(data, m_sizeOfMaterial);
 }
 
 void Material::bindDescriptorSet(Renderer::Renderer::FrameInfo frameInfo) {
     Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-    api.cmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_matTemplate->getPipeline()->getPipelineLayout(), 2, 1, &m_matDescriptorSet[0], 0, nullptr);
+    if (m_bindless) {
+        MaterialTable::Instance().bind(frameInfo.commandBuffer, m_matTemplate->getPipeline()->getPipelineLayout());
+        return;
+    }
+    VkDescriptorSet set = getDescriptorSet(frameInfo.frameIndex);
+    api.cmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_matTemplate->getPipeline()->getPipelineLayout(), 2, 1, &set, 0, nullptr);
 }
 
 void Material::bind(Renderer::Renderer::FrameInfo frameInfo) {
     Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
     m_matTemplate->bindPipeline(frameInfo);
-    api.cmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_matTemplate->getPipeline()->getPipelineLayout(), 2, 1, &m_matDescriptorSet[0], 0, nullptr);
+    if (m_bindless) {
+        MaterialTable::Instance().bind(frameInfo.commandBuffer, m_matTemplate->getPipeline()->getPipelineLayout());
+        return;
+    }
+    VkDescriptorSet set = getDescriptorSet(frameInfo.frameIndex);
+    api.cmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_matTemplate->getPipeline()->getPipelineLayout(), 2, 1, &set, 0, nullptr);
 }
 
 }
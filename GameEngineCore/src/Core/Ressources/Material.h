@@ -1,10 +1,12 @@
 #pragma once
 #include "Core/Renderer/Renderer.h"
 #include "Pipeline.h"
+#include "PipelineBuilder.h"
 #include <GLFW/glfw3.h>
 #include <memory>
 #include <vector>
 #include "UniformBuffer.h"
+#include "Texture.h"
 
 namespace Engine {
 namespace Ressources {
@@ -16,28 +18,65 @@ class MaterialTemplate {
 friend Material;
 public:
     MaterialTemplate(std::unique_ptr<Pipeline> pipeline);
+    // from PipelineBuilder, the materials can be made with it right away but nothing is drawn with it until it's ready
+    MaterialTemplate(std::shared_ptr<PendingPipeline> pipeline);
     /*MaterialTemplate(size_t bufferSize, std::string& pipelineKey);*/
 
-    Pipeline* getPipeline() {return m_pipeline.get();};
+    bool isReady() const { return m_pipeline || m_pendingPipeline->isReady(); };
+    // its materials are in the MaterialTable, doesn't wait for the pipeline
+    bool isBindless() const { return m_pipeline ? m_pipeline->isBindless() : m_pendingPipeline->isBindless(); };
+    // waits for the pipeline if it's still building
+    Pipeline* getPipeline() {return m_pipeline ? m_pipeline.get() : m_pendingPipeline->wait();};
     void bindPipeline(Renderer::Renderer::FrameInfo frameInfo);
+    uint32_t getIndex() const { return m_index; }; // unique, used in the sort keys of the render queue
 private:
+    static uint32_t s_nextIndex;
+
     std::unique_ptr<Pipeline> m_pipeline;
+    std::shared_ptr<PendingPipeline> m_pendingPipeline; // when m_pipeline is null
+    uint32_t m_index;
 };
 
 class Material {
 public:
     Material(std::shared_ptr<MaterialTemplate> matTemplate, size_t matSize);
     Material(std::shared_ptr<MaterialTemplate> matTemplate, size_t matSize, std::vector<VkDescriptorImageInfo>* texturesInfo);
+    // keeps the textures, the ones from the TextureStreamer are written again in the descriptors when their levels change
+    Material(std::shared_ptr<MaterialTemplate> matTemplate, size_t matSize, std::vector<std::shared_ptr<Texture>> textures);
+    ~Material();
 
     void updateData(void* data);
     void bindDescriptorSet(Renderer::Renderer::FrameInfo frameInfo);
     void bind(Renderer::Renderer::FrameInfo frameInfo); // should not be called but it's there (pipeline is already bind in the renderer)
     MaterialTemplate* getMaterialTemplate() {return m_matTemplate.get();}; // I don't want to deal with weak_ptr this func is just to get the pipeline
+    uint32_t getIndex() const { return m_index; }; // unique, the shaders get it in the object data (index in the MaterialTable when bindless)
+    bool isBindless() const { return m_bindless; };
+    const std::vector<std::shared_ptr<Texture>>& getTextures() const { return m_textures; };
+    bool hasStreamedTextures() const { return m_streamed; };
+    // writes the textures whose version changed in the set of this frame (or in the MaterialTable), by the
+    // TextureStreamer once the frame's fence is waited on
+    void refreshTextures(uint32_t frameIndex);
+private:
+    void createDescriptorSets(std::vector<VkDescriptorImageInfo>* texturesInfo);
+    std::vector<VkDescriptorImageInfo> getTexturesInfo();
+    uint32_t getTexturesVersion() const;
+    VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+
 private:
+    static uint32_t s_nextIndex;
+
     std::shared_ptr<MaterialTemplate> m_matTemplate;
+    uint32_t m_index;
     uint32_t m_sizeOfMaterial;
+    bool m_bindless;
+    // not used when bindless, one per frame in flight with streamed textures so the set of a frame is written once
+    // that frame is done
     std::vector<VkDescriptorSet> m_matDescriptorSet;
     std::unique_ptr<UniformBuffer> m_matUniformBuffer;
+    std::vector<std::shared_ptr<Texture>> m_textures;
+    bool m_streamed = false;
+    // sum of the versions of the textures when each set was written (one for the bindless ones)
+    std::vector<uint32_t> m_texturesVersions;
 };
 
 }
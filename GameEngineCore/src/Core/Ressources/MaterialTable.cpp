@@ -0,0 +1,269 @@
+#include "MaterialTable.h"
+#include "Core/Renderer/VulkanApi.h"
+#include "Core/Log/Log.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+static MaterialTable* instance;
+
+void MaterialTable::Init() {
+    instance = new MaterialTable();
+}
+
+MaterialTable& MaterialTable::Instance() {
+    return *instance;
+}
+
+void MaterialTable::Shutdown() {
+    delete instance;
+    instance = nullptr;
+}
+
+bool MaterialTable::IsEnabled() {
+    return instance != nullptr;
+}
+
+MaterialTable::MaterialTable() {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    m_maxTextures = std::min(MAX_TEXTURES, api.getMaxBindlessTextures());
+
+    m_materialBuffer = std::make_unique<Buffer>(MAX_MATERIALS * MATERIAL_STRIDE, 1);
+    m_materialBuffer->createBaseBuffer(
+        MAX_MATERIALS * MATERIAL_STRIDE,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0
+    );
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = m_maxTextures;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // the slots without a texture are never read, and new textures are written while older frames still use the set
+    VkDescriptorBindingFlags bindingFlags[2] = {
+        0,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+    };
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 2;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    if (api.createDescriptorSetLayout(&layoutInfo, nullptr, &m_layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create the material table descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = m_maxTextures;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (api.createDescriptorPool(&poolInfo, nullptr, &m_pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create the material table descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_layout;
+    if (api.allocateDescriptorSets(&allocInfo, &m_set) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate the material table descriptor set!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_materialBuffer->getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    api.updateDescriptorSets(1, &write, 0, nullptr);
+
+    LogInfo("bindless materials : ", MAX_MATERIALS, " materials, ", m_maxTextures, " textures");
+}
+
+MaterialTable::~MaterialTable() {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    // the set is freed with its pool
+    api.destroyDescriptorPool(m_pool, nullptr);
+    api.destroyDescriptorSetLayout(m_layout, nullptr);
+}
+
+uint32_t MaterialTable::addMaterial(const std::vector<VkDescriptorImageInfo>* texturesInfo) {
+    if (texturesInfo && texturesInfo->size() > MAX_TEXTURES_PER_MATERIAL) {
+        throw std::runtime_error("too many textures for a bindless material!");
+    }
+
+    uint32_t index;
+    if (!m_freeMaterials.empty()) {
+        index = m_freeMaterials.back();
+        m_freeMaterials.pop_back();
+    } else {
+        if (m_materialCount == MAX_MATERIALS) {
+            throw std::runtime_error("the material table is full!");
+        }
+        index = m_materialCount++;
+        m_materialTextures.resize(m_materialCount);
+        m_materialTextureCounts.resize(m_materialCount);
+    }
+
+    std::array<uint32_t, MAX_TEXTURES_PER_MATERIAL> textures{};
+    uint32_t textureCount = 0;
+    if (texturesInfo) {
+        for (const VkDescriptorImageInfo& textureInfo : *texturesInfo) {
+            textures[textureCount++] = addTexture(textureInfo);
+        }
+    }
+    m_materialTextures[index] = textures;
+    m_materialTextureCounts[index] = textureCount;
+
+    m_materialBuffer->updateData(textures.data(), sizeof(textures), 0, index * MATERIAL_STRIDE);
+    return index;
+}
+
+// the frames in flight can still draw with the material, a new one in its index (or a new texture in its slots)
+// would show up in them
+void MaterialTable::removeMaterial(uint32_t index) {
+    for (uint32_t i = 0; i < m_materialTextureCounts[index]; i++) {
+        m_retiredTextures.push_back({m_frame, m_materialTextures[index][i]});
+    }
+    m_materialTextureCounts[index] = 0;
+    m_retiredMaterials.push_back({m_frame, index});
+}
+
+void MaterialTable::updateMaterial(uint32_t index, const void* data, size_t size) {
+    if (size > MAX_MATERIAL_SIZE) {
+        throw std::runtime_error("material is too big for the material table!");
+    }
+    uint32_t offset = index * MATERIAL_STRIDE + MAX_TEXTURES_PER_MATERIAL * sizeof(uint32_t);
+    m_materialBuffer->updateData(const_cast<void*>(data), size, 0, offset);
+}
+
+void MaterialTable::setMaterialTextures(uint32_t index, const std::vector<VkDescriptorImageInfo>& texturesInfo) {
+    if (texturesInfo.size() > MAX_TEXTURES_PER_MATERIAL) {
+        throw std::runtime_error("too many textures for a bindless material!");
+    }
+
+    // added before the old ones are retired, a texture that didn't change keeps its slot
+    std::array<uint32_t, MAX_TEXTURES_PER_MATERIAL> textures{};
+    uint32_t textureCount = 0;
+    for (const VkDescriptorImageInfo& textureInfo : texturesInfo) {
+        textures[textureCount++] = addTexture(textureInfo);
+    }
+    for (uint32_t i = 0; i < m_materialTextureCounts[index]; i++) {
+        m_retiredTextures.push_back({m_frame, m_materialTextures[index][i]});
+    }
+    m_materialTextures[index] = textures;
+    m_materialTextureCounts[index] = textureCount;
+
+    m_materialBuffer->updateData(textures.data(), sizeof(textures), 0, index * MATERIAL_STRIDE);
+}
+
+// the new indices are copied by the frame being recorded or the next one, the frames up to that one still read the
+// old slots
+void MaterialTable::beginFrame() {
+    m_frame++;
+    uint64_t framesInFlight = Renderer::VulkanApi::Instance().getMaxFramesInFlight();
+    auto isDone = [&](const Retired& retired) { return m_frame >= retired.frame + framesInFlight + 1; };
+
+    auto it = m_retiredTextures.begin();
+    while (it != m_retiredTextures.end()) {
+        if (!isDone(*it)) {
+            ++it;
+            continue;
+        }
+        removeTexture(it->index);
+        it = m_retiredTextures.erase(it);
+    }
+
+    auto material = m_retiredMaterials.begin();
+    while (material != m_retiredMaterials.end()) {
+        if (!isDone(*material)) {
+            ++material;
+            continue;
+        }
+        m_freeMaterials.push_back(material->index);
+        material = m_retiredMaterials.erase(material);
+    }
+}
+
+void MaterialTable::bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    api.cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, SET, 1, &m_set, 0, nullptr);
+}
+
+uint32_t MaterialTable::addTexture(const VkDescriptorImageInfo& textureInfo) {
+    std::pair<VkImageView, VkSampler> key = {textureInfo.imageView, textureInfo.sampler};
+    auto it = m_textureSlots.find(key);
+    if (it != m_textureSlots.end()) {
+        m_textures[it->second].refCount++;
+        return it->second;
+    }
+
+    uint32_t index;
+    if (!m_freeTextures.empty()) {
+        index = m_freeTextures.back();
+        m_freeTextures.pop_back();
+    } else {
+        if (m_textures.size() == m_maxTextures) {
+            throw std::runtime_error("the material table has no texture slot left!");
+        }
+        index = (uint32_t)m_textures.size();
+        m_textures.push_back({});
+    }
+    m_textures[index] = {key, 1};
+    m_textureSlots[key] = index;
+
+    // the slot isn't used by any frame in flight (update unused while pending)
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_set;
+    write.dstBinding = 1;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &textureInfo;
+    Renderer::VulkanApi::Instance().updateDescriptorSets(1, &write, 0, nullptr);
+    return index;
+}
+
+void MaterialTable::removeTexture(uint32_t index) {
+    TextureSlot& slot = m_textures[index];
+    if (--slot.refCount > 0) {
+        return;
+    }
+    // the descriptor stays, it's partially bound and nothing reads it anymore
+    m_textureSlots.erase(slot.key);
+    m_freeTextures.push_back(index);
+}
+
+}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include "Buffer.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+namespace Ressources {
+
+// Bindless materials: the parameters of every material are in one storage buffer and every texture in one array of
+// samplers (descriptor indexing), both in a single set bound once per pipeline. The shaders read their material with
+// the materialIndex of the object data, so the materials don't break the draw batches anymore.
+// Only made when the device supports it (VulkanApi::supportsBindless), the other materials keep their own set.
+class MaterialTable {
+public:
+    static constexpr uint32_t SET = 2; // the set of the materials, same as the non bindless ones
+    static constexpr uint32_t MAX_MATERIALS = 4096;
+    static constexpr uint32_t MAX_TEXTURES = 4096; // lowered to what the device allows
+    // a material is 4 texture indices (uvec4) then its parameters, make numbers the same as in shader
+    static constexpr uint32_t MAX_TEXTURES_PER_MATERIAL = 4;
+    static constexpr uint32_t MATERIAL_STRIDE = 128;
+    static constexpr uint32_t MAX_MATERIAL_SIZE = MATERIAL_STRIDE - MAX_TEXTURES_PER_MATERIAL * sizeof(uint32_t);
+
+    static void Init();
+    static MaterialTable& Instance();
+    static void Shutdown();
+    static bool IsEnabled();
+
+    MaterialTable();
+    ~MaterialTable();
+
+    // returns the index of the material, the same texture (image view and sampler) is only put once in the array
+    uint32_t addMaterial(const std::vector<VkDescriptorImageInfo>* texturesInfo);
+    // its index and texture slots are given back once the frames that may still read them are done
+    void removeMaterial(uint32_t index);
+    // device local, the copy goes through the StagingRing like the other buffers
+    void updateMaterial(uint32_t index, const void* data, size_t size);
+    // new image views (streamed textures), they get new slots and the old ones are given back once the frames that
+    // read the old indices are done
+    void setMaterialTextures(uint32_t index, const std::vector<VkDescriptorImageInfo>& texturesInfo);
+    // once per frame, before the materials change, frees what was retired long enough ago
+    void beginFrame();
+
+    VkDescriptorSetLayout getLayout() { return m_layout; };
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout);
+
+private:
+    uint32_t addTexture(const VkDescriptorImageInfo& textureInfo);
+    void removeTexture(uint32_t index);
+
+private:
+    struct TextureSlot {
+        std::pair<VkImageView, VkSampler> key;
+        uint32_t refCount;
+    };
+
+    std::unique_ptr<Buffer> m_materialBuffer;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_set = VK_NULL_HANDLE;
+    uint32_t m_maxTextures;
+
+    uint32_t m_materialCount = 0; // slots used at least once, the free ones are in m_freeMaterials
+    std::vector<uint32_t> m_freeMaterials;
+    std::vector<std::array<uint32_t, MAX_TEXTURES_PER_MATERIAL>> m_materialTextures;
+    std::vector<uint32_t> m_materialTextureCounts;
+
+    // a texture slot or a material index, given back getMaxFramesInFlight frames after frame
+    struct Retired {
+        uint64_t frame;
+        uint32_t index;
+    };
+
+    std::vector<TextureSlot> m_textures;
+    std::vector<uint32_t> m_freeTextures;
+    std::map<std::pair<VkImageView, VkSampler>, uint32_t> m_textureSlots;
+    std::vector<Retired> m_retiredTextures;
+    std::vector<Retired> m_retiredMaterials;
+    uint64_t m_frame = 0;
+};
+
+}
+}
@@ -0,0 +1,519 @@
+#include "MemoryAllocator.h"
+#include "Core/Renderer/VulkanApi.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+static MemoryAllocator* instance;
+
+// a free range smaller than that stays in the allocation before it
+static constexpr VkDeviceSize MIN_RANGE_SIZE = 16;
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+MemoryBlock::MemoryBlock(uint32_t memoryType, VkDeviceSize size, bool hostVisible, Strategy strategy, uint32_t pool, bool dedicated)
+    : m_size(size), m_strategy(strategy), m_pool(pool), m_dedicated(dedicated)
+{
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    if (api.allocateMemory(&allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory block!");
+    }
+
+    // a VkDeviceMemory can only be mapped once, so the whole block is mapped for all its allocations
+    if (hostVisible && api.mapMemory(m_memory, 0, VK_WHOLE_SIZE, 0, &m_mappedMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map device memory block!");
+    }
+
+    if (m_strategy == Strategy::Tlsf) {
+        m_freeHeads.assign(FL_COUNT * SL_COUNT, NONE);
+        uint32_t first = newRange();
+        m_ranges[first] = {0, size, 1, NONE, NONE, NONE, NONE, true, nullptr};
+        insertFreeRange(first);
+    }
+}
+
+MemoryBlock::~MemoryBlock() {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    if (m_mappedMemory) {
+        api.unmapMemory(m_memory);
+    }
+    api.freeMemory(m_memory, nullptr);
+}
+
+// fl is the power of 2 of the size, sl splits it in 16. Under 256 bytes fl is 0 and sl is size / 16
+void MemoryBlock::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+    if (size < (1ull << SMALL_SIZE_LOG2)) {
+        fl = 0;
+        sl = (uint32_t)(size >> (SMALL_SIZE_LOG2 - SL_LOG2));
+        return;
+    }
+    uint32_t msb = 63 - std::countl_zero(size);
+    fl = msb - SMALL_SIZE_LOG2 + 1;
+    sl = (uint32_t)(size >> (msb - SL_LOG2)) - SL_COUNT;
+}
+
+// the size is rounded up to the next class so any range of the list found is big enough
+uint32_t MemoryBlock::findFreeRange(VkDeviceSize size) const {
+    VkDeviceSize rounded;
+    if (size < (1ull << SMALL_SIZE_LOG2)) {
+        rounded = alignUp(size, 1ull << (SMALL_SIZE_LOG2 - SL_LOG2));
+    } else {
+        uint32_t msb = 63 - std::countl_zero(size);
+        rounded = size + (1ull << (msb - SL_LOG2)) - 1;
+    }
+
+    uint32_t fl, sl;
+    mapping(rounded, fl, sl);
+    if (fl >= FL_COUNT) {
+        return NONE;
+    }
+
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0) {
+        if (fl + 1 >= FL_COUNT) {
+            return NONE;
+        }
+        uint64_t flMap = m_flBitmap & (~0ull << (fl + 1));
+        if (flMap == 0) {
+            return NONE;
+        }
+        fl = std::countr_zero(flMap);
+        slMap = m_slBitmaps[fl];
+    }
+    sl = std::countr_zero(slMap);
+    return m_freeHeads[fl * SL_COUNT + sl];
+}
+
+void MemoryBlock::insertFreeRange(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(m_ranges[index].size, fl, sl);
+    uint32_t& head = m_freeHeads[fl * SL_COUNT + sl];
+
+    m_ranges[index].previousFree = NONE;
+    m_ranges[index].nextFree = head;
+    if (head != NONE) {
+        m_ranges[head].previousFree = index;
+    }
+    head = index;
+
+    m_flBitmap |= 1ull << fl;
+    m_slBitmaps[fl] |= 1u << sl;
+    m_freeRangeCount++;
+}
+
+void MemoryBlock::removeFreeRange(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(m_ranges[index].size, fl, sl);
+    Range& range = m_ranges[index];
+
+    if (range.previousFree != NONE) {
+        m_ranges[range.previousFree].nextFree = range.nextFree;
+    } else {
+        m_freeHeads[fl * SL_COUNT + sl] = range.nextFree;
+    }
+    if (range.nextFree != NONE) {
+        m_ranges[range.nextFree].previousFree = range.previousFree;
+    }
+
+    if (m_freeHeads[fl * SL_COUNT + sl] == NONE) {
+        m_slBitmaps[fl] &= ~(1u << sl);
+        if (m_slBitmaps[fl] == 0) {
+            m_flBitmap &= ~(1ull << fl);
+        }
+    }
+    m_freeRangeCount--;
+}
+
+uint32_t MemoryBlock::newRange() {
+    if (!m_unusedRanges.empty()) {
+        uint32_t index = m_unusedRanges.back();
+        m_unusedRanges.pop_back();
+        return index;
+    }
+    m_ranges.emplace_back();
+    return (uint32_t)m_ranges.size() - 1;
+}
+
+void MemoryBlock::releaseRange(uint32_t index) {
+    m_unusedRanges.push_back(index);
+}
+
+bool MemoryBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, void* userData, Allocation& allocation) {
+    bool allocated = m_strategy == Strategy::Linear
+        ? allocateLinear(size, alignment, allocation)
+        : allocateTlsf(size, alignment, userData, allocation);
+    if (!allocated) {
+        return false;
+    }
+
+    allocation.memory = m_memory;
+    allocation.size = size;
+    allocation.alignment = alignment;
+    allocation.mappedMemory = m_mappedMemory ? (char*)m_mappedMemory + allocation.offset : nullptr;
+    allocation.userData = userData;
+    allocation.block = this;
+    m_allocationCount++;
+    return true;
+}
+
+bool MemoryBlock::allocateLinear(VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation) {
+    VkDeviceSize offset = alignUp(m_linearOffset, alignment);
+    if (offset + size > m_size) {
+        return false;
+    }
+
+    m_linearOffset = offset + size;
+    m_usedSize += size;
+    allocation.offset = offset;
+    allocation.range = NONE;
+    return true;
+}
+
+bool MemoryBlock::allocateTlsf(VkDeviceSize size, VkDeviceSize alignment, void* userData, Allocation& allocation) {
+    // the start of the range isn't aligned, ask for enough to align it
+    uint32_t index = findFreeRange(size + alignment - 1);
+    if (index == NONE) {
+        return false;
+    }
+    removeFreeRange(index);
+
+    VkDeviceSize offset = m_ranges[index].offset;
+    VkDeviceSize alignedOffset = alignUp(offset, alignment);
+    if (alignedOffset > offset) {
+        // the padding before goes back in the free lists (its previous range isn't free or they would be merged)
+        uint32_t padding = newRange();
+        Range& range = m_ranges[index];
+        m_ranges[padding] = {offset, alignedOffset - offset, 1, range.previousPhysical, index, NONE, NONE, true, nullptr};
+        if (range.previousPhysical != NONE) {
+            m_ranges[range.previousPhysical].nextPhysical = padding;
+        }
+        range.previousPhysical = padding;
+        range.offset = alignedOffset;
+        range.size -= alignedOffset - offset;
+        insertFreeRange(padding);
+    }
+
+    if (m_ranges[index].size - size >= MIN_RANGE_SIZE) {
+        uint32_t rest = newRange();
+        Range& range = m_ranges[index];
+        m_ranges[rest] = {range.offset + size, range.size - size, 1, index, range.nextPhysical, NONE, NONE, true, nullptr};
+        if (range.nextPhysical != NONE) {
+            m_ranges[range.nextPhysical].previousPhysical = rest;
+        }
+        range.nextPhysical = rest;
+        range.size = size;
+        insertFreeRange(rest);
+    }
+
+    Range& range = m_ranges[index];
+    range.free = false;
+    range.alignment = alignment;
+    range.userData = userData;
+    m_usedSize += range.size;
+
+    allocation.offset = range.offset;
+    allocation.range = index;
+    return true;
+}
+
+void MemoryBlock::free(const Allocation& allocation) {
+    m_allocationCount--;
+
+    if (m_strategy == Strategy::Linear) {
+        m_usedSize -= allocation.size;
+        if (m_allocationCount == 0) {
+            m_linearOffset = 0;
+        }
+        return;
+    }
+
+    uint32_t index = allocation.range;
+    m_usedSize -= m_ranges[index].size;
+    m_ranges[index].free = true;
+    m_ranges[index].userData = nullptr;
+
+    uint32_t next = m_ranges[index].nextPhysical;
+    if (next != NONE && m_ranges[next].free) {
+        removeFreeRange(next);
+        m_ranges[index].size += m_ranges[next].size;
+        m_ranges[index].nextPhysical = m_ranges[next].nextPhysical;
+        if (m_ranges[index].nextPhysical != NONE) {
+            m_ranges[m_ranges[index].nextPhysical].previousPhysical = index;
+        }
+        releaseRange(next);
+    }
+
+    uint32_t previous = m_ranges[index].previousPhysical;
+    if (previous != NONE && m_ranges[previous].free) {
+        removeFreeRange(previous);
+        m_ranges[previous].size += m_ranges[index].size;
+        m_ranges[previous].nextPhysical = m_ranges[index].nextPhysical;
+        if (m_ranges[previous].nextPhysical != NONE) {
+            m_ranges[m_ranges[previous].nextPhysical].previousPhysical = previous;
+        }
+        releaseRange(index);
+        index = previous;
+    }
+
+    insertFreeRange(index);
+}
+
+// the range at offset 0 is always the first one, it's never merged in another
+void MemoryBlock::getAllocations(std::vector<Allocation>& allocations) const {
+    if (m_strategy != Strategy::Tlsf) {
+        return;
+    }
+
+    for (uint32_t index = 0; index != NONE; index = m_ranges[index].nextPhysical) {
+        const Range& range = m_ranges[index];
+        if (range.free) {
+            continue;
+        }
+
+        Allocation allocation;
+        allocation.memory = m_memory;
+        allocation.offset = range.offset;
+        allocation.size = range.size;
+        allocation.alignment = range.alignment;
+        allocation.mappedMemory = m_mappedMemory ? (char*)m_mappedMemory + range.offset : nullptr;
+        allocation.userData = range.userData;
+        allocation.block = const_cast<MemoryBlock*>(this);
+        allocation.range = index;
+        allocations.push_back(allocation);
+    }
+}
+
+void MemoryAllocator::Init() {
+    instance = new MemoryAllocator();
+}
+
+MemoryAllocator& MemoryAllocator::Instance() {
+    return *instance;
+}
+
+void MemoryAllocator::Shutdown() {
+    delete instance;
+    instance = nullptr;
+}
+
+MemoryAllocator::MemoryAllocator() {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    api.getPhysicalDeviceMemoryProperties(&m_memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    api.getPhysicalDeviceProperties(&properties);
+    m_separateImages = properties.limits.bufferImageGranularity > 1;
+
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) &&
+            (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+uint32_t MemoryAllocator::getPoolIndex(uint32_t memoryType, ResourceKind kind) const {
+    return memoryType * 2 + (m_separateImages && kind == ResourceKind::Image ? 1 : 0);
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, Usage usage, void* userData) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    bool hostVisible = m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    uint32_t poolIndex = getPoolIndex(memoryType, kind);
+    Pool& pool = m_pools[poolIndex];
+
+    // small heaps (the host visible device local one is often 256MB) get smaller blocks
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    VkDeviceSize blockSize = std::min(BLOCK_SIZE, heapSize / 8);
+
+    Allocation allocation;
+    if (usage == Usage::Transient) {
+        if (!pool.transientBlock) {
+            pool.transientBlock = std::make_unique<MemoryBlock>(memoryType, std::min(TRANSIENT_BLOCK_SIZE, blockSize), hostVisible, MemoryBlock::Strategy::Linear, poolIndex, false);
+        }
+        if (pool.transientBlock->allocate(requirements.size, requirements.alignment, userData, allocation)) {
+            return allocation;
+        }
+    }
+
+    // a dedicated block holds one allocation at offset 0, the linear strategy is enough
+    if (requirements.size > blockSize / 2) {
+        pool.blocks.push_back(std::make_unique<MemoryBlock>(memoryType, requirements.size, hostVisible, MemoryBlock::Strategy::Linear, poolIndex, true));
+        pool.blocks.back()->allocate(requirements.size, requirements.alignment, userData, allocation);
+        return allocation;
+    }
+
+    for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+        if (!block->isDedicated() && block->allocate(requirements.size, requirements.alignment, userData, allocation)) {
+            return allocation;
+        }
+    }
+
+    pool.blocks.push_back(std::make_unique<MemoryBlock>(memoryType, blockSize, hostVisible, MemoryBlock::Strategy::Tlsf, poolIndex, false));
+    if (!pool.blocks.back()->allocate(requirements.size, requirements.alignment, userData, allocation)) {
+        throw std::runtime_error("failed to allocate in a new memory block!");
+    }
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if (!allocation.block) {
+        return;
+    }
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    MemoryBlock* block = allocation.block;
+    block->free(allocation);
+    allocation = Allocation{};
+
+    if (!block->isEmpty() || block == m_pools[block->getPool()].transientBlock.get()) {
+        return;
+    }
+
+    // one empty block is kept per pool so a level load doesn't allocate and free the same block again and again
+    if (block->isDedicated()) {
+        releaseBlock(block);
+        return;
+    }
+    for (std::unique_ptr<MemoryBlock>& other : m_pools[block->getPool()].blocks) {
+        if (other.get() != block && !other->isDedicated() && other->isEmpty()) {
+            releaseBlock(block);
+            return;
+        }
+    }
+}
+
+void MemoryAllocator::releaseBlock(MemoryBlock* block) {
+    std::vector<std::unique_ptr<MemoryBlock>>& blocks = m_pools[block->getPool()].blocks;
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<MemoryBlock>& other) {
+        return other.get() == block;
+    }), blocks.end());
+}
+
+Allocation MemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Usage usage, void* userData) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    VkMemoryRequirements requirements;
+    api.getBufferMemoryRequirements(buffer, &requirements);
+
+    Allocation allocation = allocate(requirements, properties, ResourceKind::Buffer, usage, userData);
+    if (api.bindBufferMemory(buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+    return allocation;
+}
+
+Allocation MemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, void* userData) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    VkMemoryRequirements requirements;
+    api.getImageMemoryRequirements(image, &requirements);
+
+    Allocation allocation = allocate(requirements, properties, ResourceKind::Image, Usage::Persistent, userData);
+    if (api.bindImageMemory(image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind image memory!");
+    }
+    return allocation;
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats() {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    Stats stats;
+    auto addBlock = [&stats](const MemoryBlock& block) {
+        stats.deviceMemoryCount++;
+        stats.dedicatedCount += block.isDedicated() ? 1 : 0;
+        stats.allocationCount += block.getAllocationCount();
+        stats.allocatedSize += block.getSize();
+        stats.usedSize += block.getUsedSize();
+        stats.freeRangeCount += block.getFreeRangeCount();
+    };
+
+    for (const Pool& pool : m_pools) {
+        for (const std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+            addBlock(*block);
+        }
+        if (pool.transientBlock) {
+            addBlock(*pool.transientBlock);
+        }
+    }
+    return stats;
+}
+
+uint32_t MemoryAllocator::defragment(const MoveFunction& move, uint32_t maxMoves) {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    uint32_t moveCount = 0;
+    std::vector<Allocation> allocations;
+    for (Pool& pool : m_pools) {
+        MemoryBlock* source = nullptr;
+        uint32_t blockCount = 0;
+        for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+            if (block->isDedicated()) {
+                continue;
+            }
+            blockCount++;
+            if (!source || block->getUsedSize() < source->getUsedSize()) {
+                source = block.get();
+            }
+        }
+        if (blockCount < 2 || source->isEmpty()) {
+            continue;
+        }
+
+        allocations.clear();
+        source->getAllocations(allocations);
+        for (Allocation& from : allocations) {
+            if (moveCount >= maxMoves) {
+                return moveCount;
+            }
+            if (!from.userData) {
+                continue;
+            }
+
+            Allocation to;
+            bool found = false;
+            for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+                if (block.get() != source && !block->isDedicated() && block->allocate(from.size, from.alignment, from.userData, to)) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                break; // the other blocks are full
+            }
+
+            if (move(from.userData, from, to)) {
+                moveCount++;
+            } else {
+                free(to);
+            }
+        }
+    }
+    return moveCount;
+}
+
+}
+}
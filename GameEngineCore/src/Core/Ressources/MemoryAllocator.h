@@ -0,0 +1,176 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Engine {
+namespace Ressources {
+
+class MemoryBlock;
+
+// a piece of a VkDeviceMemory, bind the resource at memory + offset
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    VkDeviceSize alignment = 1;
+    void* mappedMemory = nullptr; // host visible blocks stay mapped, this is already at offset
+    void* userData = nullptr; // given to allocate, passed back by the defragmentation
+
+    MemoryBlock* block = nullptr; // nullptr when nothing is allocated
+    uint32_t range = 0;
+};
+
+// One vkAllocateMemory split in allocations.
+// Tlsf: two level segregated fit, the free ranges are in lists by size class (power of 2, then 16 steps) found with two
+// bitmaps, allocate and free are O(1) and the neighbouring free ranges are merged back.
+// Linear: a bump pointer that goes back to 0 when everything is freed, for staging buffers that live for one upload.
+class MemoryBlock {
+public:
+    enum class Strategy { Tlsf, Linear };
+
+    MemoryBlock(uint32_t memoryType, VkDeviceSize size, bool hostVisible, Strategy strategy, uint32_t pool, bool dedicated);
+    ~MemoryBlock();
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, void* userData, Allocation& allocation);
+    void free(const Allocation& allocation);
+
+    // every live allocation (Tlsf only), for the defragmentation
+    void getAllocations(std::vector<Allocation>& allocations) const;
+
+    bool isEmpty() const { return m_allocationCount == 0; };
+    bool isDedicated() const { return m_dedicated; };
+    uint32_t getPool() const { return m_pool; };
+    VkDeviceSize getSize() const { return m_size; };
+    VkDeviceSize getUsedSize() const { return m_usedSize; };
+    uint32_t getAllocationCount() const { return m_allocationCount; };
+    uint32_t getFreeRangeCount() const { return m_freeRangeCount; };
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr uint32_t SL_LOG2 = 4;
+    static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+    static constexpr uint32_t SMALL_SIZE_LOG2 = 8; // under 256 bytes the classes are linear, 16 bytes each
+    static constexpr uint32_t FL_COUNT = 64 - SMALL_SIZE_LOG2 + 1;
+
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkDeviceSize alignment;
+        uint32_t previousPhysical;
+        uint32_t nextPhysical;
+        uint32_t previousFree;
+        uint32_t nextFree;
+        bool free;
+        void* userData;
+    };
+
+    static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+    uint32_t findFreeRange(VkDeviceSize size) const;
+    void insertFreeRange(uint32_t index);
+    void removeFreeRange(uint32_t index);
+    uint32_t newRange();
+    void releaseRange(uint32_t index);
+
+    bool allocateLinear(VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+    bool allocateTlsf(VkDeviceSize size, VkDeviceSize alignment, void* userData, Allocation& allocation);
+
+private:
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    void* m_mappedMemory = nullptr;
+    VkDeviceSize m_size;
+    Strategy m_strategy;
+    uint32_t m_pool;
+    bool m_dedicated;
+
+    VkDeviceSize m_usedSize = 0;
+    uint32_t m_allocationCount = 0;
+    uint32_t m_freeRangeCount = 0;
+
+    // Tlsf
+    std::vector<Range> m_ranges;
+    std::vector<uint32_t> m_unusedRanges;
+    uint64_t m_flBitmap = 0;
+    uint32_t m_slBitmaps[FL_COUNT] = {};
+    std::vector<uint32_t> m_freeHeads; // FL_COUNT * SL_COUNT
+
+    // Linear
+    VkDeviceSize m_linearOffset = 0;
+};
+
+// All the device memory of the buffers and textures comes from here instead of one vkAllocateMemory each
+// (maxMemoryAllocationCount is 4096 on a lot of drivers). There is a pool per memory type, made of Tlsf blocks;
+// transient allocations first try a linear block and big resources get a dedicated allocation.
+// bufferImageGranularity: when the device has one, buffers and optimal tiling images are in different pools so they
+// are never next to each other in a block.
+class MemoryAllocator {
+public:
+    enum class Usage {
+        Persistent,
+        Transient // freed right after the upload, staging buffers
+    };
+
+    enum class ResourceKind {
+        Buffer, // and linear tiling images
+        Image // optimal tiling
+    };
+
+    struct Stats {
+        uint32_t deviceMemoryCount = 0; // live vkAllocateMemory
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize allocatedSize = 0; // size of the blocks
+        VkDeviceSize usedSize = 0;
+        uint32_t freeRangeCount = 0; // a lot of free ranges for the free size means the blocks are fragmented
+    };
+
+    // the owner (userData) recreates its resource on to and records the copy, true when done : from is its own then
+    // and it frees it once the frames in flight don't use it anymore. false to keep from (to is freed)
+    using MoveFunction = std::function<bool(void* userData, const Allocation& from, const Allocation& to)>;
+
+    static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+    static constexpr VkDeviceSize TRANSIENT_BLOCK_SIZE = 16 * 1024 * 1024;
+
+    static void Init();
+    static MemoryAllocator& Instance();
+    static void Shutdown();
+
+    MemoryAllocator();
+    ~MemoryAllocator();
+
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, Usage usage = Usage::Persistent, void* userData = nullptr);
+    void free(Allocation& allocation);
+
+    // allocate and bind
+    Allocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Usage usage = Usage::Persistent, void* userData = nullptr);
+    Allocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, void* userData = nullptr);
+
+    Stats getStats();
+
+    // moves the allocations of the emptiest block of each pool in the other blocks so it can be released,
+    // allocations without userData are never moved (only the streamed textures have one, TextureStreamer calls it).
+    // Returns the number of moves
+    uint32_t defragment(const MoveFunction& move, uint32_t maxMoves = UINT32_MAX);
+
+private:
+    struct Pool {
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        std::unique_ptr<MemoryBlock> transientBlock;
+    };
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    uint32_t getPoolIndex(uint32_t memoryType, ResourceKind kind) const;
+    void releaseBlock(MemoryBlock* block);
+
+private:
+    std::recursive_mutex m_mutex; // the move function of the defragmentation can allocate and free
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    bool m_separateImages;
+    std::vector<Pool> m_pools; // memory type * 2 + resource kind
+};
+
+}
+}
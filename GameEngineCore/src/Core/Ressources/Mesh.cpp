@@ -1,14 +1,21 @@
 #include "Mesh.h"
 #include "Core/Log/Log.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantization.h"
 #include <_string.h>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <cmath>
 #include "tiny_obj_loader.h"
 
 namespace Engine {
 namespace Ressources {
 
+uint32_t Mesh::s_nextIndex = 0;
+
 Mesh::Mesh() {
 
 };
@@ -21,6 +28,7 @@ Mesh::Mesh(std::vector<uint32_t> indices, void* vertexData, size_t size)
 {
     m_vertexBuffer = new Engine::Ressources::VertexBuffer(vertexData, size);
     m_indexBuffer = new Engine::Ressources::IndexBuffer(indices.data(), (size_t)indices.size() * sizeof(indices[0]), indices.size());
+    m_lods = {{0, (uint32_t)indices.size(), 0.0f}};
     m_state = State::storedOnGpu;
 }
 
@@ -33,11 +41,35 @@ Mesh::~Mesh() {
         LogDebug(m_channelOrder.size());
     }
 
+    releasePoolRanges();
     delete m_indexBuffer;
     delete m_vertexBuffer;
 }
 
-// TODO: vertex deduplication
+// what is compared to merge the vertices, the channels that are not loaded stay at 0
+struct ObjVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoord;
+
+    bool operator==(const ObjVertex& other) const {
+        return position == other.position && normal == other.normal && texCoord == other.texCoord;
+    }
+};
+
+struct ObjVertexHash {
+    // FNV-1a over the floats
+    size_t operator()(const ObjVertex& vertex) const {
+        const uint32_t* words = (const uint32_t*)&vertex;
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(ObjVertex) / sizeof(uint32_t); i++) {
+            hash ^= words[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
 void Mesh::loadObj(const std::string& path, uint8_t infoToLoad){
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -48,75 +80,127 @@ void Mesh::loadObj(const std::string& path, uint8_t infoToLoad){
     Assert(success, "Failed to load obj, warning : ", warn, ", error : ", err);
     LogWarning(warn);
 
-    uint32_t nbPositions = 0;
-    uint32_t nbNormals = 0;
-    uint32_t nbTex_coords = 0;
-    uint32_t nbIndices = 0;
-    
-    for (const auto& shape : shapes){
-        for (const auto& index : shape.mesh.indices){
-            if (infoToLoad & (1 << (int)VertexDataType::positions)) {
-                nbPositions ++;
-            }
+    bool loadPositions = infoToLoad & (1 << (int)VertexDataType::positions);
+    bool loadNormals = infoToLoad & (1 << (int)VertexDataType::normals);
+    bool loadTexCoords = infoToLoad & (1 << (int)VertexDataType::tex_coords);
 
-            if (infoToLoad & (1 << (int)VertexDataType::normals)) {
-                nbNormals ++;
-            }
-
-            if (infoToLoad & (1 << (int)VertexDataType::tex_coords)) {
-                nbTex_coords ++;
-            }
-
-            nbIndices++;
-        }
-    }
-
-    glm::vec3* positions = (glm::vec3*)malloc(sizeof(glm::vec3) * nbPositions);
-    glm::vec3* normals = (glm::vec3*)malloc(sizeof(glm::vec3) * nbNormals);
-    glm::vec2* tex_coords = (glm::vec2*)malloc(sizeof(glm::vec2) * nbTex_coords);
-    std::vector<uint32_t> indices(nbIndices);
-
-    uint32_t arrIdx = 0;
+    // the obj has one index per attribute, the same (position, normal, uv) is only one vertex
+    std::vector<ObjVertex> vertices;
+    std::unordered_map<ObjVertex, uint32_t, ObjVertexHash> uniqueVertices;
+    std::vector<uint32_t> indices;
 
     for (const auto& shape : shapes) {
         for (const auto& index : shape.mesh.indices) {
-            if (infoToLoad & (1 << (int)VertexDataType::positions)) {
-                positions[arrIdx] = {
+            ObjVertex vertex{};
+            if (loadPositions) {
+                vertex.position = {
                     attrib.vertices[3 * index.vertex_index + 0],
                     attrib.vertices[3 * index.vertex_index + 1],
                     attrib.vertices[3 * index.vertex_index + 2]
                 };
             }
 
-            if (infoToLoad & (1 << (int)VertexDataType::normals)) {
-                normals[arrIdx] = {
+            if (loadNormals) {
+                vertex.normal = {
                     attrib.normals[3 * index.normal_index + 0],
                     attrib.normals[3 * index.normal_index + 1],
                     attrib.normals[3 * index.normal_index + 2]
                 };
             }
 
-            if (infoToLoad & (1 << (int)VertexDataType::tex_coords)) {
-                tex_coords[arrIdx] = {
+            if (loadTexCoords) {
+                vertex.texCoord = {
                     attrib.texcoords[2 * index.texcoord_index + 0],
                     1- attrib.texcoords[2 * index.texcoord_index + 1]
                 };
             }
 
-
-            indices[arrIdx] = arrIdx;
-            arrIdx ++;
+            auto [it, inserted] = uniqueVertices.try_emplace(vertex, (uint32_t)vertices.size());
+            if (inserted) {
+                vertices.push_back(vertex);
+            }
+            indices.push_back(it->second);
         }
     }
 
-    if (infoToLoad & (1 << (int)VertexDataType::positions))
-        setOrCreateChannel(VertexDataType::positions, positions, sizeof(positions[0]), sizeof(positions[0]) * nbPositions);
-    if (infoToLoad & (1 << (int)VertexDataType::normals))
-        setOrCreateChannel(VertexDataType::normals, normals, sizeof(normals[0]), sizeof(normals[0]) * nbNormals);
-    if (infoToLoad & (1 << (int)VertexDataType::tex_coords))
-        setOrCreateChannel(VertexDataType::tex_coords, tex_coords, sizeof(tex_coords[0]), sizeof(tex_coords[0]) * nbTex_coords);
+    uint32_t vertexCount = (uint32_t)vertices.size();
+    float acmrBefore = MeshOptimizer::computeAcmr(indices, vertexCount);
+    MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    float acmrAfter = MeshOptimizer::computeAcmr(indices, vertexCount);
+    std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexFetch(indices, vertexCount);
+    // one vertex per index was an acmr of 3
+    LogInfo("loaded ", path, " : ", vertexCount, " vertices for ", indices.size(), " indices, acmr 3 -> ", acmrBefore, " deduplicated -> ", acmrAfter, " reordered");
+
+    glm::vec3* positions = (glm::vec3*)malloc(sizeof(glm::vec3) * (loadPositions ? vertexCount : 0));
+    glm::vec3* normals = (glm::vec3*)malloc(sizeof(glm::vec3) * (loadNormals ? vertexCount : 0));
+    glm::vec2* tex_coords = (glm::vec2*)malloc(sizeof(glm::vec2) * (loadTexCoords ? vertexCount : 0));
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        if (loadPositions) positions[remap[v]] = vertices[v].position;
+        if (loadNormals) normals[remap[v]] = vertices[v].normal;
+        if (loadTexCoords) tex_coords[remap[v]] = vertices[v].texCoord;
+    }
+
+    if (loadPositions)
+        setOrCreateChannel(VertexDataType::positions, positions, sizeof(positions[0]), vertexCount);
+    if (loadNormals)
+        setOrCreateChannel(VertexDataType::normals, normals, sizeof(normals[0]), vertexCount);
+    if (loadTexCoords)
+        setOrCreateChannel(VertexDataType::tex_coords, tex_coords, sizeof(tex_coords[0]), vertexCount);
 
     setIndices(std::move(indices));
+
+    if (loadPositions) {
+        computeMassProperties();
+        generateLods();
+        for (uint32_t lod = 1; lod < m_lods.size(); lod++) {
+            LogInfo(path, " lod ", lod, " : ", m_lods[lod].indexCount / 3, " triangles, error ", m_lods[lod].error);
+        }
+    }
+}
+
+void Mesh::setIndices(std::vector<uint32_t> indices) {
+    m_indices = std::move(indices);
+    m_lods = {{0, (uint32_t)m_indices.size(), 0.0f}};
+    m_massProperties.reset();
+}
+
+// a level that removes less than that isn't kept
+static constexpr float MIN_LOD_REDUCTION = 0.9f;
+
+void Mesh::generateLods(uint32_t maxLodCount, float reduction) {
+    const char* positionsName = vertexDataTypeToCharPointer(VertexDataType::positions);
+    Assert(m_channels.contains(positionsName), "Can't generate the lods of a mesh without positions");
+    Assert(!m_lods.empty(), "Can't generate the lods of a mesh without indices");
+
+    Channel& positions = m_channels[positionsName];
+    Assert(positions.sizeOfElement == sizeof(glm::vec3), "Lods : positions must be vec3");
+    maxLodCount = std::min(maxLodCount, MAX_LODS);
+
+    // generated again from the full mesh if it already had levels
+    std::vector<uint32_t> indices(m_indices.begin(), m_indices.begin() + m_lods[0].indexCount);
+    std::vector<MeshLod> lods = {m_lods[0]};
+    std::vector<uint32_t> previous = indices;
+    uint32_t vertexCount = (uint32_t)positions.nbOfElement;
+    float error = 0.0f;
+
+    while (lods.size() < maxLodCount) {
+        size_t targetIndexCount = (size_t)(previous.size() / 3 * reduction) * 3;
+        float lodError;
+        std::vector<uint32_t> lod = MeshSimplifier::simplify((glm::vec3*)positions.data, vertexCount, previous, targetIndexCount, lodError);
+        if (lod.empty() || lod.size() > previous.size() * MIN_LOD_REDUCTION) {
+            break;
+        }
+
+        // simplified from the previous level so the errors add up
+        error += lodError;
+        MeshOptimizer::optimizeVertexCache(lod, vertexCount);
+        lods.push_back({(uint32_t)indices.size(), (uint32_t)lod.size(), error});
+        indices.insert(indices.end(), lod.begin(), lod.end());
+        previous = std::move(lod);
+    }
+
+    m_indices = std::move(indices);
+    m_lods = std::move(lods);
 }
 
 const char* Mesh::vertexDataTypeToCharPointer(VertexDataType dataType){
@@ -173,6 +257,11 @@ void Mesh::setOrCreateChannel(const char* identifier, void* data, size_t sizeOfE
         removeChannel(identifier);
     }
 
+    // the cached mass properties came from the old positions
+    if (strcmp(identifier, vertexDataTypeToCharPointer(VertexDataType::positions)) == 0){
+        m_massProperties.reset();
+    }
+
     Channel channel;
     channel.data = data;
     channel.sizeOfElement = sizeOfElement;
@@ -193,26 +282,40 @@ void Mesh::uploadDataToGpu() {
     // calculate the size of the mesh.
     int nbVertices = m_channels.begin()->second.nbOfElement;
     Assert(nbVertices > 0, "vertices not > 0 can't upload mesh data to gpu if no data");
+
+    // the quantized positions are in the bounds
+    computeBounds();
+    m_dequantization = glm::mat4(1.0f);
+    if (m_vertexFormat == VertexFormat::Quantized) {
+        Assert(m_bounds.has_value(), "Quantized vertices need the positions");
+        m_quantizationMin = m_bounds->min;
+        m_quantizationExtent = glm::max(m_bounds->max - m_bounds->min, glm::vec3(1e-6f));
+        m_dequantization[0][0] = m_quantizationExtent.x;
+        m_dequantization[1][1] = m_quantizationExtent.y;
+        m_dequantization[2][2] = m_quantizationExtent.z;
+        m_dequantization[3] = glm::vec4(m_quantizationMin, 1.0f);
+    }
+
     size_t stride = 0;
-    for (auto channel : m_channels){
-        stride += channel.second.sizeOfElement;
+    for (auto& channel : m_channels){
+        stride += packedElementSize(channel.first, channel.second);
     }
     size_t size = stride * nbVertices;
 
     void* data = malloc(size);
-    void* writePointer = data;
+    char* writePointer = (char*)data;
     for (int element=0;element<m_channels.begin()->second.nbOfElement;element++){
         for (auto channelName : m_channelOrder){
-            auto& channel = m_channels[channelName];
-           memcpy(writePointer, (void*)((char*)channel.data + element * channel.sizeOfElement), channel.sizeOfElement);
-            writePointer = (char*)writePointer + channel.sizeOfElement;
+            writePointer = packElement(channelName, m_channels[channelName], element, writePointer);
         }
     }
 
-    if (m_state != State::storedOnCpu && m_state != State::storedNoWhere) {
+    // own buffers only when the pool is disabled or full, a mesh that already has them keeps them
+    bool pooled = GeometryPool::IsEnabled() && !m_vertexBuffer && uploadToPool(data, size, stride);
+    if (!pooled && m_vertexBuffer) {
         m_vertexBuffer->updateData(data, size);
         m_indexBuffer->updateData(m_indices.data(), m_indices.size() * sizeof(m_indices[0]));
-    }else {
+    } else if (!pooled) {
         // don't think this can happen
         if (m_indexBuffer){
             delete m_indexBuffer;
@@ -230,6 +333,76 @@ void Mesh::uploadDataToGpu() {
     free(data);
 }
 
+size_t Mesh::packedElementSize(const std::string& name, const Channel& channel) const {
+    if (m_vertexFormat == VertexFormat::Quantized) {
+        if (name == vertexDataTypeToCharPointer(VertexDataType::positions)) {
+            return VertexQuantization::POSITION_SIZE;
+        }
+        if (name == vertexDataTypeToCharPointer(VertexDataType::normals)) {
+            return VertexQuantization::NORMAL_SIZE;
+        }
+        if (channel.sizeOfElement == sizeof(glm::vec2)) {
+            return VertexQuantization::TEX_COORD_SIZE;
+        }
+    }
+    return channel.sizeOfElement;
+}
+
+char* Mesh::packElement(const std::string& name, const Channel& channel, size_t element, char* out) const {
+    const char* in = (const char*)channel.data + element * channel.sizeOfElement;
+    if (m_vertexFormat == VertexFormat::Quantized) {
+        if (name == vertexDataTypeToCharPointer(VertexDataType::positions)) {
+            VertexQuantization::encodePosition(*(const glm::vec3*)in, m_quantizationMin, m_quantizationExtent, (uint16_t*)out);
+            return out + VertexQuantization::POSITION_SIZE;
+        }
+        if (name == vertexDataTypeToCharPointer(VertexDataType::normals)) {
+            VertexQuantization::encodeNormal(*(const glm::vec3*)in, (int16_t*)out);
+            return out + VertexQuantization::NORMAL_SIZE;
+        }
+        if (channel.sizeOfElement == sizeof(glm::vec2)) {
+            VertexQuantization::encodeTexCoord(*(const glm::vec2*)in, (uint16_t*)out);
+            return out + VertexQuantization::TEX_COORD_SIZE;
+        }
+    }
+    memcpy(out, in, channel.sizeOfElement);
+    return out + channel.sizeOfElement;
+}
+
+bool Mesh::uploadToPool(void* data, size_t size, size_t stride) {
+    GeometryPool& pool = GeometryPool::Instance();
+    size_t indicesSize = m_indices.size() * sizeof(m_indices[0]);
+
+    // same sizes, written in place
+    bool sameRanges = m_pooled && m_vertexRange.size == size && m_indexRange.size == indicesSize && m_vertexStride == stride;
+    if (!sameRanges) {
+        releasePoolRanges();
+        if (!pool.allocateVertices(size, stride, m_vertexRange)) {
+            return false;
+        }
+        if (!pool.allocateIndices(indicesSize, m_indexRange)) {
+            pool.freeVertices(m_vertexRange);
+            return false;
+        }
+        m_pooled = true;
+        m_vertexStride = stride;
+    }
+
+    pool.uploadVertices(m_vertexRange, data, size);
+    pool.uploadIndices(m_indexRange, m_indices.data(), indicesSize);
+    return true;
+}
+
+void Mesh::releasePoolRanges() {
+    if (!m_pooled) {
+        return;
+    }
+    if (GeometryPool::IsEnabled()) {
+        GeometryPool::Instance().freeVertices(m_vertexRange);
+        GeometryPool::Instance().freeIndices(m_indexRange);
+    }
+    m_pooled = false;
+}
+
 
 void Mesh::removeDataFromCpu() {
     AssertWarn((m_state != State::storedOnGpu && m_state != State::storedNoWhere), "try to remove data from cpu but already not there");
@@ -240,13 +413,75 @@ void Mesh::removeDataFromCpu() {
         m_state = State::storedNoWhere;
     }
 
+    // last chance to read the positions
+    if (!m_massProperties.has_value() && m_channels.contains(vertexDataTypeToCharPointer(VertexDataType::positions))) {
+        computeMassProperties();
+    }
+
     while (m_channelOrder.size() > 0){
         removeChannel(m_channelOrder[0].c_str());
     }
 };
 
+void Mesh::computeMassProperties() {
+    const char* positionsName = vertexDataTypeToCharPointer(VertexDataType::positions);
+    Assert(m_channels.contains(positionsName), "Can't compute the mass properties of a mesh without positions");
+    Assert(!m_lods.empty() && m_lods[0].indexCount > 0, "Can't compute the mass properties of a mesh without indices");
+
+    Channel& positions = m_channels[positionsName];
+    Assert(positions.sizeOfElement == sizeof(glm::vec3), "Mass properties : positions must be vec3");
+
+    // the full mesh, the other levels are after it
+    m_massProperties = MassProperties::compute((glm::vec3*)positions.data, m_indices.data(), m_lods[0].indexCount);
+}
+
+void Mesh::computeBounds() {
+    const char* positionsName = vertexDataTypeToCharPointer(VertexDataType::positions);
+    if (!m_channels.contains(positionsName)) {
+        m_bounds.reset();
+        return;
+    }
+
+    Channel& positions = m_channels[positionsName];
+    Assert(positions.sizeOfElement == sizeof(glm::vec3), "Bounds : positions must be vec3");
+    if (positions.nbOfElement == 0) {
+        m_bounds.reset();
+        return;
+    }
+
+    glm::vec3* vertices = (glm::vec3*)positions.data;
+    MeshBounds bounds;
+    bounds.min = vertices[0];
+    bounds.max = vertices[0];
+    for (size_t i = 1; i < positions.nbOfElement; i++) {
+        bounds.min = glm::min(bounds.min, vertices[i]);
+        bounds.max = glm::max(bounds.max, vertices[i]);
+    }
+
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < positions.nbOfElement; i++) {
+        glm::vec3 offset = vertices[i] - bounds.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+
+    m_bounds = bounds;
+}
+
+const MassProperties& Mesh::getMassProperties() {
+    if (!m_massProperties.has_value()) {
+        computeMassProperties();
+    }
+    return m_massProperties.value();
+}
+
 void Mesh::bind(Engine::Renderer::Renderer::FrameInfo frameInfo){
     Assert((m_state != State::storedOnCpu), "Try to draw mesh but is stored on the cpu. You need to call uploadDataToGpu()");
+    if (m_pooled) {
+        GeometryPool::Instance().bind(frameInfo.commandBuffer);
+        return;
+    }
     auto& api = ::Engine::Renderer::VulkanApi::Instance();
 
     VkBuffer vertexBuffers[] = {m_vertexBuffer->getBuffer()};
@@ -256,12 +491,12 @@ void Mesh::bind(Engine::Renderer::Renderer::FrameInfo frameInfo){
 
 };
 
-void Mesh::draw(Engine::Renderer::Renderer::FrameInfo frameInfo){
+void Mesh::draw(Engine::Renderer::Renderer::FrameInfo frameInfo, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod){
     if (m_state == State::storedOnCpu){
         LogError("Try to draw mesh but is stored on the cpu. You need to call uploadDataToGpu()");
     }
     auto& api = ::Engine::Renderer::VulkanApi::Instance();
-    api.cmdDrawIndexed(frameInfo.commandBuffer, m_indexBuffer->indexCount, 1, 0, 0, 0);
+    api.cmdDrawIndexed(frameInfo.commandBuffer, getIndexCount(lod), instanceCount, getFirstIndex(lod), getVertexOffset(), firstInstance);
 };
 
 }
@@ -1,7 +1,10 @@
 #pragma once
 #include "Core/Renderer/Renderer.h"
+#include "GeometryPool.h"
 #include "IndexBuffer.h"
+#include "MassProperties.h"
 #include "vertexBuffer.h"
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -9,6 +12,21 @@
 namespace Engine {
 namespace Ressources {
 
+// local space bounds of the vertices, the sphere is around the center of the box (not the smallest one but close enough for culling)
+struct MeshBounds {
+    glm::vec3 min;
+    glm::vec3 max;
+    glm::vec3 center;
+    float radius;
+};
+
+// one level of detail, a range of the index buffer over the same vertices
+struct MeshLod {
+    uint32_t firstIndex; // from the first index of the mesh
+    uint32_t indexCount;
+    float error; // distance to the full mesh in local space (MeshSimplifier), 0 for the first one
+};
+
 class Mesh {
 public:
     enum class VertexDataType {
@@ -16,6 +34,14 @@ public:
         normals,
         tex_coords
     };
+
+    // how uploadDataToGpu writes the vertices, the pipeline attributes must match
+    enum class VertexFormat {
+        Float, // the channels as they are
+        Quantized // see VertexQuantization : positions 16 bit in the bounds, octahedral normals, vec2 channels in half floats
+    };
+    // the full mesh included
+    static constexpr uint32_t MAX_LODS = 5;
 public:
     Mesh();
     ~Mesh();
@@ -26,7 +52,7 @@ public:
 
     void loadObj(const std::string& path, uint8_t infoToLoad = 0xFF);
 
-    const char* vertexDataTypeToCharPointer(VertexDataType dataType);
+    static const char* vertexDataTypeToCharPointer(VertexDataType dataType);
     
     // use string if not in vertex data type (it's just not to do typos)
     void setOrCreateChannel(VertexDataType dataType, void* data, size_t sizeOfOneElement, size_t nbOfElement);
@@ -38,20 +64,48 @@ public:
     void removeChannel(VertexDataType dataType);
     void removeChannel(const char* identifier);
 
-    void setIndices(std::vector<uint32_t> indices) {m_indices = std::move(indices);}; // don't want to "guess" the behavior so std::move
+    void setIndices(std::vector<uint32_t> indices); // don't want to "guess" the behavior so std::move
+
+    // simplifies the first level with MeshSimplifier, each level has about reduction times the triangles of the
+    // previous one. Stops before maxLodCount when it can't remove enough (small or locked meshes keep only one).
+    // The levels are appended to the indices, call it before uploadDataToGpu
+    void generateLods(uint32_t maxLodCount = MAX_LODS, float reduction = 0.5f);
+    uint32_t getLodCount() const { return (uint32_t)m_lods.size(); };
+    const MeshLod& getLod(uint32_t lod) const { return m_lods[lod]; };
 
     template<typename T>
     T* getChannel(const char* identifier);
 
+    // set before uploadDataToGpu
+    void setVertexFormat(VertexFormat format) { m_vertexFormat = format; };
+    VertexFormat getVertexFormat() const { return m_vertexFormat; };
+    // from the quantized positions ([0, 1]) to the local space, goes on the right of the model matrix (identity for Float)
+    const glm::mat4& getDequantization() const { return m_dequantization; };
+
     // if data already in gpu update it
     void uploadDataToGpu();
 
     // no way of getting it back
     void removeDataFromCpu();
 
+    // computed only once from the positions (at load or at the latest before the cpu data is removed) so every
+    // rigidbody using this mesh just reads it
+    const MassProperties& getMassProperties();
+
+    // computed from the positions when the data is uploaded, nullopt if the mesh was created from raw vertex data
+    const std::optional<MeshBounds>& getBounds() const { return m_bounds; };
+
+    uint32_t getIndex() const { return m_index; }; // unique, used in the sort keys of the render queue
+
     // if data is on gpu
+    uint32_t getIndexCount(uint32_t lod = 0) const { return m_lods[lod].indexCount; };
+    // where the level is in the index buffer, the mesh is in the GeometryPool buffers or in its own
+    uint32_t getFirstIndex(uint32_t lod = 0) const { return (m_pooled ? (uint32_t)(m_indexRange.offset / sizeof(uint32_t)) : 0) + m_lods[lod].firstIndex; };
+    int32_t getVertexOffset() const { return m_pooled ? (int32_t)(m_vertexRange.offset / m_vertexStride) : 0; };
+    // meshes in the GeometryPool all bind the same buffers
+    bool isPooled() const { return m_pooled; };
     void bind(Engine::Renderer::Renderer::FrameInfo frameInfo);
-    void draw(Engine::Renderer::Renderer::FrameInfo frameInfo);
+    void draw(Engine::Renderer::Renderer::FrameInfo frameInfo, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
 private:
 
 
@@ -77,7 +131,37 @@ private:
     std::vector<std::string>              m_channelOrder;
 
     std::vector<uint32_t> m_indices;
+    // never empty once there are indices, the first level is the whole mesh
+    std::vector<MeshLod> m_lods;
+
+    void computeMassProperties();
+    std::optional<MassProperties> m_massProperties;
+
+    void computeBounds();
+    std::optional<MeshBounds> m_bounds;
+
+    size_t packedElementSize(const std::string& name, const Channel& channel) const;
+    // writes element of the channel in the vertex format, returns the pointer after it
+    char* packElement(const std::string& name, const Channel& channel, size_t element, char* out) const;
+
+    VertexFormat m_vertexFormat = VertexFormat::Float;
+    glm::mat4 m_dequantization{1.0f};
+    glm::vec3 m_quantizationMin{0.0f};
+    glm::vec3 m_quantizationExtent{1.0f};
+
+    // false when the pool is full, the mesh gets its own buffers then
+    bool uploadToPool(void* data, size_t size, size_t stride);
+    void releasePoolRanges();
+
+    static uint32_t s_nextIndex;
+    uint32_t m_index = s_nextIndex++;
+
+    bool m_pooled = false;
+    GeometryPool::Range m_vertexRange;
+    GeometryPool::Range m_indexRange;
+    size_t m_vertexStride = 0;
 
+    // when the GeometryPool is disabled or full
     IndexBuffer* m_indexBuffer = nullptr;
     VertexBuffer* m_vertexBuffer = nullptr;
 };
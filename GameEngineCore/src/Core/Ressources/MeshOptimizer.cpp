@@ -0,0 +1,192 @@
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+namespace Engine {
+namespace Ressources {
+
+// size of the simulated LRU cache, the score values are the ones of the paper
+static constexpr uint32_t CACHE_SIZE = 32;
+static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float CACHE_DECAY_POWER = 1.5f;
+static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertexScore(int cachePosition, uint32_t remainingTriangles) {
+    // not used anymore, never makes a triangle better
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // the vertices of the last triangle get a fixed score so it doesn't just pick a triangle with the same edge
+        if (cachePosition < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            float scaler = 1.0f / (CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // finish the vertices that have few triangles left, they would be alone later
+    score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangles of each vertex : adjacency[offsets[v], offsets[v] + remaining[v]), the emitted ones are swapped out
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        offsets[index + 1]++;
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    std::vector<uint32_t> adjacency(indices.size());
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            uint32_t v = indices[triangle * 3 + corner];
+            adjacency[offsets[v] + remaining[v]++] = triangle;
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    auto triangleScore = [&](uint32_t triangle) {
+        return vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+    };
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(CACHE_SIZE + 3);
+    newCache.reserve(CACHE_SIZE + 3);
+
+    // the first triangle is the best one of the mesh, then only the triangles around the cache are looked at
+    int bestTriangle = 0;
+    for (uint32_t triangle = 1; triangle < triangleCount; triangle++) {
+        if (triangleScore(triangle) > triangleScore(bestTriangle)) {
+            bestTriangle = triangle;
+        }
+    }
+    uint32_t nextUnemitted = 0;
+
+    for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // nothing left around the cache (the previous part of the mesh is done), take the next one in the input order
+        if (bestTriangle < 0) {
+            while (emitted[nextUnemitted]) {
+                nextUnemitted++;
+            }
+            bestTriangle = nextUnemitted;
+        }
+
+        const uint32_t* triangleIndices = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        newCache.clear();
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            uint32_t v = triangleIndices[corner];
+            result.push_back(v);
+            newCache.push_back(v);
+
+            uint32_t* first = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++) {
+                if (first[i] == (uint32_t)bestTriangle) {
+                    first[i] = first[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // the triangle goes at the front of the LRU cache, the vertices pushed past the end leave it
+        for (uint32_t v : cache) {
+            if (v != triangleIndices[0] && v != triangleIndices[1] && v != triangleIndices[2]) {
+                newCache.push_back(v);
+            }
+        }
+        for (uint32_t i = CACHE_SIZE; i < newCache.size(); i++) {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = vertexScore(-1, remaining[newCache[i]]);
+        }
+        if (newCache.size() > CACHE_SIZE) {
+            newCache.resize(CACHE_SIZE);
+        }
+        cache.swap(newCache);
+
+        for (uint32_t i = 0; i < cache.size(); i++) {
+            cachePositions[cache[i]] = i;
+            vertexScores[cache[i]] = vertexScore(i, remaining[cache[i]]);
+        }
+
+        // only the triangles of the cached vertices changed score
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache) {
+            for (uint32_t i = 0; i < remaining[v]; i++) {
+                uint32_t triangle = adjacency[offsets[v] + i];
+                float score = triangleScore(triangle);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+    }
+
+    // a degenerate or odd tail (indices.size() % 3) is kept as it was
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    static constexpr uint32_t UNUSED = UINT32_MAX;
+    std::vector<uint32_t> remap(vertexCount, UNUSED);
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        if (remap[v] == UNUSED) {
+            remap[v] = next++;
+        }
+    }
+    return remap;
+}
+
+float MeshOptimizer::computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+    if (triangleCount == 0) {
+        return 0.0f;
+    }
+
+    // FIFO like the post transform cache of most gpus, the timestamp of when each vertex went in
+    std::vector<uint32_t> insertedAt(vertexCount, 0);
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < triangleCount * 3; i++) {
+        uint32_t v = indices[i];
+        if (insertedAt[v] == 0 || misses - insertedAt[v] >= cacheSize) {
+            misses++;
+            insertedAt[v] = misses;
+        }
+    }
+    return (float)misses / triangleCount;
+}
+
+}
+}
@@ -0,0 +1,36 @@
+//
+//
+// Index and vertex reordering for the meshes loaded from files.
+//
+// The vertex cache pass is Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" :
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+// Every vertex has a score from its position in a simulated LRU cache and from how many triangles still use it, the
+// next triangle is the best one among the triangles of the vertices in the cache. It doesn't depend on the real cache
+// size of the gpu so it's good on all of them.
+//
+// The vertex fetch pass then puts the vertices in the order the indices first use them, so the vertex shader reads
+// the vertex buffer mostly forward.
+//
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+namespace Ressources {
+
+struct MeshOptimizer {
+    // reorders the triangles, the indices still point to the same vertices
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+    // rewrites the indices and returns the remap : vertex v goes to remap[v] (unused vertices go at the end)
+    static std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+    // average cache miss ratio : transformed vertices per triangle with a FIFO cache, 3 without reuse, ~0.5 at best
+    static float computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+};
+
+}
+}
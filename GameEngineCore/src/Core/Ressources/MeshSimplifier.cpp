@@ -0,0 +1,221 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace Engine {
+namespace Ressources {
+
+// symmetric 4x4 matrix, sum of the plane equations (a, b, c, d) times themselves
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double planes = 0; // how many were added, the error is the mean over them
+
+    void addPlane(const glm::dvec3& n, double d) {
+        a2 += n.x * n.x; ab += n.x * n.y; ac += n.x * n.z; ad += n.x * d;
+        b2 += n.y * n.y; bc += n.y * n.z; bd += n.y * d;
+        c2 += n.z * n.z; cd += n.z * d;
+        d2 += d * d;
+        planes += 1;
+    }
+
+    void add(const Quadric& other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        planes += other.planes;
+    }
+
+    // sum of the squared distances from p to the planes
+    double evaluate(const glm::dvec3& p) const {
+        double error = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+                     + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+                     + c2 * p.z * p.z + 2 * cd * p.z
+                     + d2;
+        return std::max(error, 0.0);
+    }
+};
+
+struct Collapse {
+    double cost;
+    double meanCost; // cost over the planes of the quadric, a squared distance
+    uint32_t from;
+    uint32_t to;
+    // the costs change when the quadrics or the triangles around the vertices change, older entries are skipped
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; };
+};
+
+std::vector<uint32_t> MeshSimplifier::simplify(const glm::vec3* positions, size_t vertexCount, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error) {
+    error = 0.0f;
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<bool> removed(triangleCount, false);
+    size_t liveTriangles = triangleCount;
+
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(triangleCount * 3);
+
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        glm::dvec3 p0 = positions[triangles[t * 3]];
+        glm::dvec3 p1 = positions[triangles[t * 3 + 1]];
+        glm::dvec3 p2 = positions[triangles[t * 3 + 2]];
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length > 0.0) {
+            normal /= length;
+            Quadric plane;
+            plane.addPlane(normal, -glm::dot(normal, p0));
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                quadrics[triangles[t * 3 + corner]].add(plane);
+            }
+        }
+
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            uint32_t a = triangles[t * 3 + corner];
+            uint32_t b = triangles[t * 3 + (corner + 1) % 3];
+            vertexTriangles[a].push_back(t);
+            edgeUses[((uint64_t)std::min(a, b) << 32) | std::max(a, b)]++;
+        }
+    }
+
+    // an edge of only one triangle is a border (or a seam, the vertices are split there)
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto& [edge, uses] : edgeUses) {
+        if (uses == 1) {
+            locked[edge >> 32] = true;
+            locked[edge & 0xFFFFFFFF] = true;
+        }
+    }
+
+    std::vector<bool> alive(vertexCount, true);
+    std::vector<uint32_t> versions(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    auto pushCollapse = [&](uint32_t from, uint32_t to) {
+        if (locked[from]) {
+            return;
+        }
+        Quadric quadric = quadrics[from];
+        quadric.add(quadrics[to]);
+        double cost = quadric.evaluate(positions[to]);
+        heap.push({cost, quadric.planes > 0 ? cost / quadric.planes : 0.0, from, to, versions[from], versions[to]});
+    };
+
+    for (const auto& [edge, uses] : edgeUses) {
+        uint32_t a = (uint32_t)(edge >> 32);
+        uint32_t b = (uint32_t)(edge & 0xFFFFFFFF);
+        pushCollapse(a, b);
+        pushCollapse(b, a);
+    }
+
+    double maxMeanCost = 0.0;
+    std::vector<uint32_t> neighbours;
+    while (liveTriangles * 3 > targetIndexCount && !heap.empty()) {
+        Collapse collapse = heap.top();
+        heap.pop();
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (!alive[from] || !alive[to] || collapse.fromVersion != versions[from] || collapse.toVersion != versions[to]) {
+            continue;
+        }
+
+        // the triangles that stay must not flip when from moves to to
+        bool connected = false;
+        bool flips = false;
+        glm::vec3 target = positions[to];
+        for (uint32_t t : vertexTriangles[from]) {
+            if (removed[t]) {
+                continue;
+            }
+            uint32_t* corners = &triangles[t * 3];
+            if (corners[0] == to || corners[1] == to || corners[2] == to) {
+                connected = true;
+                continue;
+            }
+
+            glm::vec3 p[3];
+            glm::vec3 moved[3];
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                p[corner] = positions[corners[corner]];
+                moved[corner] = corners[corner] == from ? target : p[corner];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            if (glm::dot(before, after) <= 0.0f) {
+                flips = true;
+                break;
+            }
+        }
+        if (!connected || flips) {
+            continue;
+        }
+
+        for (uint32_t t : vertexTriangles[from]) {
+            if (removed[t]) {
+                continue;
+            }
+            uint32_t* corners = &triangles[t * 3];
+            if (corners[0] == to || corners[1] == to || corners[2] == to) {
+                removed[t] = true;
+                liveTriangles--;
+                continue;
+            }
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                if (corners[corner] == from) {
+                    corners[corner] = to;
+                }
+            }
+            vertexTriangles[to].push_back(t);
+        }
+
+        quadrics[to].add(quadrics[from]);
+        alive[from] = false;
+        versions[to]++;
+        maxMeanCost = std::max(maxMeanCost, collapse.meanCost);
+
+        // every edge around to has a new cost (versions[to] made their entries stale), the other edges of the
+        // neighbours keep theirs
+        neighbours.clear();
+        for (uint32_t t : vertexTriangles[to]) {
+            if (removed[t]) {
+                continue;
+            }
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t v = triangles[t * 3 + corner];
+                if (v != to) {
+                    neighbours.push_back(v);
+                }
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (uint32_t v : neighbours) {
+            pushCollapse(to, v);
+            pushCollapse(v, to);
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(liveTriangles * 3);
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        if (!removed[t]) {
+            result.insert(result.end(), {triangles[t * 3], triangles[t * 3 + 1], triangles[t * 3 + 2]});
+        }
+    }
+
+    error = (float)std::sqrt(maxMeanCost);
+    return result;
+}
+
+}
+}
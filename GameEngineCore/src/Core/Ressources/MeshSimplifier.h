@@ -0,0 +1,32 @@
+//
+//
+// Mesh simplification by edge collapse with the quadric error metric :
+// Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"
+// https://www.cs.cmu.edu/~garland/Papers/quadrics.pdf
+//
+// Every vertex has a quadric, the sum of the squared distances to the planes of its triangles. The cheapest edge is
+// collapsed first, its cost being the quadric of both ends evaluated where the merged vertex goes.
+// Here a vertex only collapses on one of its neighbours (no new position), so the levels of detail are index buffers
+// over the same vertices. The vertices on a border are locked, that includes the uv and normal seams (the vertices
+// are split there so they look like a border), and a collapse that would flip a triangle is skipped.
+//
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Engine {
+namespace Ressources {
+
+struct MeshSimplifier {
+    // stops at targetIndexCount or when nothing can be collapsed anymore. error is the distance (in the units of the
+    // positions) between the result and the original surface, from the quadrics : the root mean square distance to
+    // the planes of the worst collapse, about half the largest deviation
+    static std::vector<uint32_t> simplify(const glm::vec3* positions, size_t vertexCount, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error);
+};
+
+}
+}
@@ -1,8 +1,11 @@
 #include "DescriptorsManager.h"
+#include "MaterialTable.h"
 #include "Core/Renderer/VulkanApi.h"
+#include "Core/Renderer/PipelineCache.h"
 #include "Pipeline.h"
 #include "iostream"
 #include "vulkan/vulkan_core.h"
+#include <chrono>
 #include <fstream>
 #include <map>
 #include <spirv_reflect.h>
@@ -12,78 +15,75 @@
 namespace Engine {
 namespace Ressources {
 
-static std::pair<int, int> dynamicBuffers[] = {std::pair(1, 0)}; // set , binding
-
 struct DescriptorSetLayoutData {
     std::map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
     VkShaderStageFlags stageFlags;
 };
 
+// the bindings of one shader, SPIRV-Reflect only runs the first time a SPIR-V is seen (the cache is kept on disk)
+static std::vector<Renderer::PipelineCache::ReflectedBinding> reflectBindings(const std::vector<char>& spirvCode) {
+    Renderer::PipelineCache& cache = Renderer::VulkanApi::Instance().getPipelineCache();
+    uint64_t hash = Renderer::PipelineCache::hashCode(spirvCode);
+
+    std::vector<Renderer::PipelineCache::ReflectedBinding> reflected;
+    if (cache.findReflection(hash, reflected)) {
+        return reflected;
+    }
+
+    SpvReflectShaderModule module;
+    SpvReflectResult result = spvReflectCreateShaderModule(
+        spirvCode.size(),
+        spirvCode.data(),
+        &module);
+
+    if (result != SPV_REFLECT_RESULT_SUCCESS) {
+        spvReflectDestroyShaderModule(&module);
+        throw std::runtime_error("Failed to create reflection module");
+    }
+
+    uint32_t count = 0;
+    result = spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
+    std::vector<SpvReflectDescriptorSet*> sets(count);
+    result = spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
+
+    for (auto* set : sets) {
+        for (uint32_t b = 0; b < set->binding_count; b++) {
+            const auto& binding = set->bindings[b];
+            reflected.push_back({set->set, binding->binding, static_cast<VkDescriptorType>(binding->descriptor_type)});
+        }
+    }
+
+    spvReflectDestroyShaderModule(&module);
+
+    cache.addReflection(hash, reflected);
+    return reflected;
+}
+
 std::map<uint32_t, VkDescriptorSetLayout> reflectShaderModule(
     const std::vector<std::pair<std::vector<char>, VkShaderStageFlags>>& shaderData) {
     std::map<uint32_t, DescriptorSetLayoutData> setLayouts;
     
     // Process each shader
     for (const auto& [spirvCode, shaderStage] : shaderData) {
-        SpvReflectShaderModule module;
-        SpvReflectResult result = spvReflectCreateShaderModule(
-            spirvCode.size(),
-            spirvCode.data(),
-            &module);
-        
-        if (result != SPV_REFLECT_RESULT_SUCCESS) {
-            spvReflectDestroyShaderModule(&module);
-            throw std::runtime_error("Failed to create reflection module");
-        }
-
-        uint32_t count = 0;
-        result = spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
-        std::vector<SpvReflectDescriptorSet*> sets(count);
-        result = spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
-
-        // Process each set in the shader
-        for (auto* set : sets) {
-            auto setIndex = set->set;
-            auto& setLayout = setLayouts[setIndex];
-
-            // Process each binding in the set
-            for (uint32_t b = 0; b < set->binding_count; b++) {
-                const auto& binding = set->bindings[b];
-                auto bindingIndex = binding->binding;
-
-
-                // Check if this binding already exists
-                auto& bindings = setLayout.bindings;
-                if (bindings.find(bindingIndex) != bindings.end()) {
-                    // Combine shader stages if binding already exists
-                    bindings[bindingIndex].stageFlags |= shaderStage;
-                } else {
-                    // Create new binding
-                    VkDescriptorSetLayoutBinding newBinding{};
-                    newBinding.binding = bindingIndex;
-                    newBinding.descriptorCount = 1;
-                    newBinding.descriptorType = static_cast<VkDescriptorType>(binding->descriptor_type);
-                    newBinding.stageFlags = shaderStage;
-                    newBinding.pImmutableSamplers = nullptr;
-
-                    // Check for dynamic buffer
-                    for (const auto& [setIdx, bindingIdx] : dynamicBuffers) {
-                        if (setIdx == setIndex && bindingIdx == bindingIndex) {
-                            if (newBinding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-                                newBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-                            } else if (newBinding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
-                                newBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-                            }
-                            break;
-                        }
-                    }
-
-                    bindings[bindingIndex] = newBinding;
-                }
+        for (const auto& binding : reflectBindings(spirvCode)) {
+            auto& bindings = setLayouts[binding.set].bindings;
+
+            // Check if this binding already exists
+            if (bindings.find(binding.binding) != bindings.end()) {
+                // Combine shader stages if binding already exists
+                bindings[binding.binding].stageFlags |= shaderStage;
+            } else {
+                // Create new binding
+                VkDescriptorSetLayoutBinding newBinding{};
+                newBinding.binding = binding.binding;
+                newBinding.descriptorCount = 1;
+                newBinding.descriptorType = binding.type;
+                newBinding.stageFlags = shaderStage;
+                newBinding.pImmutableSamplers = nullptr;
+
+                bindings[binding.binding] = newBinding;
             }
         }
-
-        spvReflectDestroyShaderModule(&module);
     }
 
     // Create final descriptor set layouts
@@ -250,11 +250,14 @@ void Pipeline::createPipeline() {
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
     // Vertex Input State
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = {m_configInfo.bindingDescription};
+    bindingDescriptions.insert(bindingDescriptions.end(), m_configInfo.extraBindingDescriptions.begin(), m_configInfo.extraBindingDescriptions.end());
+
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_configInfo.attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &m_configInfo.bindingDescription;
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.pVertexAttributeDescriptions = m_configInfo.attributeDescriptions.data();
 
     auto swapChainExtent = api.getSwapChainExtent();
@@ -275,6 +278,11 @@ void Pipeline::createPipeline() {
     m_configInfo.viewportInfo.pViewports = &viewport;
     m_configInfo.viewportInfo.pScissors = &scissor;
 
+    // the config was copied around since defaultPipelineConfigInfo, these still pointed to the old copy
+    m_configInfo.colorBlendInfo.pAttachments = &m_configInfo.colorBlendAttachment;
+    m_configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(m_configInfo.dynamicStateEnables.size());
+    m_configInfo.dynamicStateInfo.pDynamicStates = m_configInfo.dynamicStateEnables.data();
+
     // Pipeline Layout
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -286,6 +294,13 @@ void Pipeline::createPipeline() {
     };
 
     auto layouts = reflectShaderModule(shaderData);
+    if (m_configInfo.bindless) {
+        if (!MaterialTable::IsEnabled()) {
+            throw std::runtime_error("bindless pipeline but the device has no descriptor indexing!");
+        }
+        // the reflection doesn't know the binding flags and the size of the texture array
+        layouts[MaterialTable::SET] = MaterialTable::Instance().getLayout();
+    }
 
     // Convert map to vector for pipeline layout creation
     std::vector<VkDescriptorSetLayout> layoutsVec;
@@ -324,9 +339,12 @@ void Pipeline::createPipeline() {
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (api.createGraphicsPipelines(VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
+    Renderer::PipelineCache& pipelineCache = api.getPipelineCache();
+    auto start = std::chrono::steady_clock::now();
+    if (api.createGraphicsPipelines(pipelineCache.getCache(), 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
+    pipelineCache.addPipelineTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 
     // Cleanup
     api.destroyShaderModule(fragShaderModule, nullptr);
@@ -349,6 +367,75 @@ VkShaderModule Pipeline::createShaderModule(const std::vector<char> &code) {
     return shaderModule;
 }
 
+ComputePipeline::ComputePipeline(const std::string& shaderPath, uint32_t pushConstantSize) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    auto shaderCode = readFile(shaderPath);
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = shaderCode.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t *>(shaderCode.data());
+
+    VkShaderModule shaderModule;
+    if (api.createShaderModule(&moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    auto layouts = reflectShaderModule({{shaderCode, VK_SHADER_STAGE_COMPUTE_BIT}});
+
+    std::vector<VkDescriptorSetLayout> layoutsVec;
+    for (const auto& [setIndex, layout] : layouts) {
+        if (layoutsVec.size() <= setIndex) {
+            layoutsVec.resize(setIndex + 1, VK_NULL_HANDLE);
+        }
+        layoutsVec[setIndex] = layout;
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layoutsVec.size());
+    pipelineLayoutInfo.pSetLayouts = layoutsVec.data();
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+    if (api.createPipelineLayout(&pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    };
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+
+    Renderer::PipelineCache& pipelineCache = api.getPipelineCache();
+    auto start = std::chrono::steady_clock::now();
+    if (api.createComputePipelines(pipelineCache.getCache(), 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+    pipelineCache.addPipelineTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    api.destroyShaderModule(shaderModule, nullptr);
+}
+
+ComputePipeline::~ComputePipeline() {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    api.destroyPipeline(m_pipeline, nullptr);
+    api.destroyPipelineLayout(m_pipelineLayout, nullptr);
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+    Renderer::VulkanApi::Instance().cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+}
+
 void Pipeline::recreatePipeline() {
     Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
     // Clean up old pipeline
@@ -12,6 +12,8 @@ struct PipelineConfigInfo {
     std::string vertShaderPath;
     std::string fragShaderPath;
     VkVertexInputBindingDescription bindingDescription;
+    // other vertex buffers, for exemple per instance data (VK_VERTEX_INPUT_RATE_INSTANCE), their attributes go in attributeDescriptions too
+    std::vector<VkVertexInputBindingDescription> extraBindingDescriptions;
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
     VkPipelineViewportStateCreateInfo viewportInfo;
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
@@ -24,6 +26,8 @@ struct PipelineConfigInfo {
     VkPipelineDynamicStateCreateInfo dynamicStateInfo;
     VkRenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    // set 2 is the MaterialTable set (every material) instead of the set of each material
+    bool bindless = false;
 
     static PipelineConfigInfo defaultPipelineConfigInfo(std::string vertShaderPath, const std::string fragShaderPath, VkVertexInputBindingDescription bindingDescription, std::vector<VkVertexInputAttributeDescription> attributeDescription);
 };
@@ -36,6 +40,7 @@ public:
 
     VkPipeline& getPipeline() { return m_graphicsPipeline; };
     VkPipelineLayout& getPipelineLayout() { return m_pipelineLayout; };
+    bool isBindless() const { return m_configInfo.bindless; };
 
     void createPipeline();
     void recreatePipeline();
@@ -48,5 +53,22 @@ private:
     PipelineConfigInfo m_configInfo;
 };
 
+// one compute shader, the layout comes from the reflection like the graphics one
+// push constants are not reflected, their size is given here (visible to the compute stage)
+class ComputePipeline {
+public:
+    ComputePipeline(const std::string& shaderPath, uint32_t pushConstantSize = 0);
+    ~ComputePipeline();
+
+    VkPipeline& getPipeline() { return m_pipeline; };
+    VkPipelineLayout& getPipelineLayout() { return m_pipelineLayout; };
+
+    void bind(VkCommandBuffer commandBuffer);
+
+private:
+    VkPipelineLayout m_pipelineLayout;
+    VkPipeline m_pipeline;
+};
+
 }
 }
@@ -0,0 +1,83 @@
+#include "PipelineBuilder.h"
+#include "Core/Utils/ThreadPool.h"
+
+namespace Engine {
+namespace Ressources {
+
+static PipelineBuilder* instance;
+
+void PipelineBuilder::Init() {
+    instance = new PipelineBuilder();
+}
+
+PipelineBuilder& PipelineBuilder::Instance() {
+    return *instance;
+}
+
+void PipelineBuilder::Shutdown() {
+    delete instance;
+    instance = nullptr;
+}
+
+PipelineBuilder::~PipelineBuilder() {
+    waitAll();
+}
+
+Pipeline* PendingPipeline::wait() {
+    if (!isReady()) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [&]() { return isReady(); });
+    }
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    return m_pipeline.get();
+}
+
+void PendingPipeline::finish(std::unique_ptr<Pipeline> pipeline, std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pipeline = std::move(pipeline);
+        m_error = error;
+        m_ready.store(true, std::memory_order_release);
+    }
+    m_finished.notify_all();
+}
+
+std::shared_ptr<PendingPipeline> PipelineBuilder::build(PipelineConfigInfo configInfo) {
+    auto pending = std::make_shared<PendingPipeline>();
+    pending->m_bindless = configInfo.bindless;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingCount++;
+    }
+
+    Utils::ThreadPool::Instance().submit([this, pending, configInfo]() mutable {
+        std::unique_ptr<Pipeline> pipeline;
+        std::exception_ptr error;
+        try {
+            pipeline = std::make_unique<Pipeline>(configInfo);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        pending->finish(std::move(pipeline), error);
+        // if nothing else holds it the pipeline is destroyed here, before waitAll can return
+        pending.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingCount--;
+        }
+        m_allDone.notify_all();
+    });
+
+    return pending;
+}
+
+void PipelineBuilder::waitAll() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_allDone.wait(lock, [&]() { return m_pendingCount == 0; });
+}
+
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Pipeline.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace Engine {
+namespace Ressources {
+
+// a pipeline built on a worker thread, the MaterialTemplate can hold it before it's ready
+class PendingPipeline {
+public:
+    bool isReady() const { return m_ready.load(std::memory_order_acquire); };
+    // blocks until it's built, throws what the Pipeline constructor threw
+    Pipeline* wait();
+    // known before it's built, from the config
+    bool isBindless() const { return m_bindless; };
+
+private:
+    friend class PipelineBuilder;
+    void finish(std::unique_ptr<Pipeline> pipeline, std::exception_ptr error);
+
+private:
+    std::unique_ptr<Pipeline> m_pipeline;
+    std::exception_ptr m_error;
+    bool m_bindless = false;
+    std::atomic<bool> m_ready{false};
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+};
+
+// Builds the pipelines on the workers of Utils::ThreadPool: reading the SPIR-V, the reflection and the driver compile
+// of each one run in parallel (they all share the VkPipelineCache of VulkanApi). The main thread keeps loading.
+class PipelineBuilder {
+public:
+    static void Init();
+    static PipelineBuilder& Instance();
+    // waits for the pipelines still building, before anything they use is destroyed
+    static void Shutdown();
+
+    ~PipelineBuilder();
+
+    std::shared_ptr<PendingPipeline> build(PipelineConfigInfo configInfo);
+    void waitAll();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_allDone;
+    uint32_t m_pendingCount = 0;
+};
+
+}
+}
@@ -0,0 +1,160 @@
+#include "StagingRing.h"
+#include "Buffer.h"
+#include "Core/Renderer/VulkanApi.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+static StagingRing* instance;
+
+// keeps every upload 16 bytes aligned in the slice
+static constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+void StagingRing::Init() {
+    instance = new StagingRing(Renderer::VulkanApi::Instance().getMaxFramesInFlight() + 1, INITIAL_SLICE_SIZE);
+}
+
+StagingRing& StagingRing::Instance() {
+    return *instance;
+}
+
+void StagingRing::Shutdown() {
+    delete instance;
+    instance = nullptr;
+}
+
+bool StagingRing::IsEnabled() {
+    return instance != nullptr;
+}
+
+StagingRing::StagingRing(uint32_t sliceCount, VkDeviceSize sliceSize)
+    : m_slices(sliceCount)
+{
+    for (Slice& slice : m_slices) {
+        createSlice(slice, sliceSize);
+    }
+}
+
+StagingRing::~StagingRing() {
+    for (Slice& slice : m_slices) {
+        destroySlice(slice);
+    }
+}
+
+void StagingRing::createSlice(Slice& slice, VkDeviceSize size) {
+    // host visible, the allocator keeps it mapped
+    Buffer::createRawBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        slice.buffer,
+        slice.allocation
+    );
+    slice.size = size;
+}
+
+void StagingRing::destroySlice(Slice& slice) {
+    Buffer::destroyRawBuffer(slice.buffer, slice.allocation);
+    slice = Slice{};
+}
+
+bool StagingRing::upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+    Slice& slice = m_slices[m_currentSlice];
+
+    VkDeviceSize offset = (m_offset + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+    if (offset + size > slice.size) {
+        m_wantedSize = std::max(m_wantedSize, offset + size);
+
+        // the caller uploads it now, an older queued copy overlapping the range would overwrite it at the flush
+        removeRange(dstBuffer, dstOffset, size);
+        return false;
+    }
+
+    memcpy((char*)slice.allocation.mappedMemory + offset, data, size);
+    m_offset = offset + size;
+
+    PendingCopy copy{};
+    copy.dstBuffer = dstBuffer;
+    copy.region.srcOffset = offset;
+    copy.region.dstOffset = dstOffset;
+    copy.region.size = size;
+    m_pendingCopies.push_back(copy);
+    return true;
+}
+
+// the copies partly in the range keep the bytes before and after it, a copy around the range is split in two
+void StagingRing::removeRange(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size) {
+    VkDeviceSize rangeEnd = dstOffset + size;
+    std::vector<PendingCopy> kept;
+    kept.reserve(m_pendingCopies.size());
+    for (const PendingCopy& copy : m_pendingCopies) {
+        VkDeviceSize copyEnd = copy.region.dstOffset + copy.region.size;
+        if (copy.dstBuffer != dstBuffer || copyEnd <= dstOffset || copy.region.dstOffset >= rangeEnd) {
+            kept.push_back(copy);
+            continue;
+        }
+        if (copy.region.dstOffset < dstOffset) {
+            PendingCopy before = copy;
+            before.region.size = dstOffset - copy.region.dstOffset;
+            kept.push_back(before);
+        }
+        if (copyEnd > rangeEnd) {
+            PendingCopy after = copy;
+            after.region.srcOffset += rangeEnd - copy.region.dstOffset;
+            after.region.dstOffset = rangeEnd;
+            after.region.size = copyEnd - rangeEnd;
+            kept.push_back(after);
+        }
+    }
+    m_pendingCopies = std::move(kept);
+}
+
+void StagingRing::cancel(VkBuffer dstBuffer) {
+    m_pendingCopies.erase(std::remove_if(m_pendingCopies.begin(), m_pendingCopies.end(), [&](const PendingCopy& copy) {
+        return copy.dstBuffer == dstBuffer;
+    }), m_pendingCopies.end());
+}
+
+void StagingRing::flush(VkCommandBuffer commandBuffer) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    if (!m_pendingCopies.empty()) {
+        VkBuffer srcBuffer = m_slices[m_currentSlice].buffer;
+
+        // the frames before this one may still read the buffers that are overwritten
+        api.cmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        for (const PendingCopy& copy : m_pendingCopies) {
+            api.cmdCopyBuffer(commandBuffer, srcBuffer, copy.dstBuffer, 1, &copy.region);
+        }
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        api.cmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        m_pendingCopies.clear();
+    }
+
+    m_currentSlice = (m_currentSlice + 1) % (uint32_t)m_slices.size();
+    m_offset = 0;
+
+    // nothing reads the next slice anymore (see the class comment)
+    Slice& next = m_slices[m_currentSlice];
+    if (m_wantedSize > next.size) {
+        VkDeviceSize size = std::max(m_wantedSize, next.size + next.size / 2);
+        destroySlice(next);
+        createSlice(next, size);
+    }
+}
+
+}
+}
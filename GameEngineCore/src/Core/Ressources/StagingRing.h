@@ -0,0 +1,63 @@
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include "MemoryAllocator.h"
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+namespace Ressources {
+
+// Uploads to device local buffers without waiting on the queue. Each frame writes its data linearly in one slice of a
+// persistently mapped buffer and the renderer records the copies in the frame's command buffer before its render pass.
+// There is one more slice than frames in flight: the slice written after a frame's flush was last copied from by the
+// frame getMaxFramesInFlight before that one, whose fence the frame's beginFrame waited on, so it's always free.
+class StagingRing {
+public:
+    static constexpr VkDeviceSize INITIAL_SLICE_SIZE = 4 * 1024 * 1024;
+
+    static void Init();
+    static StagingRing& Instance();
+    static void Shutdown();
+    static bool IsEnabled();
+
+    StagingRing(uint32_t sliceCount, VkDeviceSize sliceSize);
+    ~StagingRing();
+
+    // copies data in the current slice and queues the copy to dstBuffer (which needs TRANSFER_DST) until the next
+    // flush. false when it doesn't fit, the slice grows for later frames and the caller
+    // uploads it itself
+    bool upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset);
+
+    // records the queued copies (outside of a render pass) and moves to the next slice
+    void flush(VkCommandBuffer commandBuffer);
+
+    // the queued copies to dstBuffer are dropped, before it's destroyed
+    void cancel(VkBuffer dstBuffer);
+
+private:
+    struct Slice {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        VkDeviceSize size = 0;
+    };
+
+    struct PendingCopy {
+        VkBuffer dstBuffer;
+        VkBufferCopy region;
+    };
+
+    // the queued copies to dstBuffer lose the bytes in [dstOffset, dstOffset + size)
+    void removeRange(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+    void createSlice(Slice& slice, VkDeviceSize size);
+    void destroySlice(Slice& slice);
+
+private:
+    std::vector<Slice> m_slices;
+    uint32_t m_currentSlice = 0;
+    VkDeviceSize m_offset = 0;
+    VkDeviceSize m_wantedSize = 0; // biggest frame that didn't fit, the slices are recreated with it when they are free
+    std::vector<PendingCopy> m_pendingCopies;
+};
+
+}
+}
@@ -2,12 +2,29 @@
 #include "Core/Renderer/VulkanApi.h"
 #include "vulkan/vulkan_core.h"
 #include "Buffer.h"
+#include "TextureProcessing.h"
+#include "Core/Log/Log.h"
 #include <stb_image.h>
+#include <atomic>
+#include <cstring>
 #include <filesystem>
 
 namespace Engine {
 namespace Ressources {
 
+// the textures can be loaded on several threads
+static std::atomic<uint32_t> s_textureCount = 0;
+static std::atomic<VkDeviceSize> s_textureMemory = 0;
+static std::atomic<VkDeviceSize> s_uncompressedTextureMemory = 0;
+
+Texture::MemoryStats Texture::getMemoryStats() {
+    MemoryStats stats;
+    stats.textureCount = s_textureCount;
+    stats.size = s_textureMemory;
+    stats.uncompressedSize = s_uncompressedTextureMemory;
+    return stats;
+}
+
 Texture::TextureCreateInfo Texture::TextureCreateInfo::getDefault(std::string path) {
     TextureCreateInfo info;
     info.path = std::move(path);
@@ -17,11 +34,14 @@ Texture::TextureCreateInfo Texture::TextureCreateInfo::getDefault(std::string pa
     info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
     info.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     info.featureFlags = 0;
+    info.generateMips = true;
     return std::move(info);
 }
 
 Texture::TextureCreateInfo Texture::TextureCreateInfo::getDefaultWihtoutPath(int width, int height) {
     TextureCreateInfo info;
+    info.width = width;
+    info.height = height;
     info.possibleFormats = {VK_FORMAT_R8G8B8_SRGB, VK_FORMAT_R8G8B8A8_SRGB};
     info.tiling = VK_IMAGE_TILING_OPTIMAL;
     info.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -38,7 +58,7 @@ Texture::TextureCreateInfo Texture::TextureCreateInfo::getDefaultForDepthBuffer(
     info.possibleFormats = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT};
     info.tiling = VK_IMAGE_TILING_OPTIMAL;
     info.aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
-    info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; // sampled for the depth pyramid
     info.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     info.featureFlags = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
     return std::move(info);
@@ -62,7 +82,7 @@ Texture::Texture(TextureCreateInfo& info){
     initMemberFromInfo(info);
     
     if (info.path != "") {
-        loadImage(info.path);
+        loadImage(info.path, info.generateMips);
     }else {
         createImage();
     }
@@ -76,7 +96,7 @@ Texture::Texture(TextureCreateInfo& info, ::Engine::Renderer::VulkanApi* api)
 
     initMemberFromInfo(info);
     if (info.path != "") {
-        loadImage(info.path);
+        loadImage(info.path, info.generateMips);
     }else {
         createImage();
     }
@@ -84,10 +104,29 @@ Texture::Texture(TextureCreateInfo& info, ::Engine::Renderer::VulkanApi* api)
     createSampler();
 };
 
+Texture::Texture(TextureCreateInfo& info, uint32_t streamId)
+: m_streamId(streamId)
+{
+    initMemberFromInfo(info);
+    createImage();
+    createImageView();
+    createSampler();
+}
+
 Texture::~Texture() {
+    if (m_countedInStats) {
+        s_textureCount--;
+        s_textureMemory -= m_memorySize;
+        s_uncompressedTextureMemory -= (VkDeviceSize)m_width * m_height * 4;
+    }
+
     auto& api = m_api ? *m_api : Renderer::VulkanApi::Instance();
     api.destroyImage(m_image, nullptr);
-    api.freeMemory(m_imageMemory, nullptr);
+    if (m_imageMemory != VK_NULL_HANDLE) {
+        api.freeMemory(m_imageMemory, nullptr);
+    } else {
+        MemoryAllocator::Instance().free(m_allocation);
+    }
     api.destroyImageView(m_imageView, nullptr);
     api.destroySampler(m_imageSampler, nullptr);
 }
@@ -101,44 +140,95 @@ VkDescriptorImageInfo Texture::createDescriptorImageInfo(){
     return imageInfo;
 }
 
-void Texture::loadImage(const std::string& path) {
-    //constant for now
-
-    int texChannels;
-    stbi_uc* pixels = stbi_load(path.data(), &m_width, &m_height, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = m_width * m_height * 4;
+void Texture::loadImage(const std::string& path, bool generateMips) {
+    TextureData texture = readImage(path, generateMips);
 
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture image!");
-    } 
+    m_format = texture.format;
+    m_width = texture.width;
+    m_height = texture.height;
+    m_mipLevels = (uint32_t)texture.levels.size();
+    VkDeviceSize imageSize = texture.pixels.size();
 
     Buffer stagingBuffer;
-    stagingBuffer.createBaseBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0);
+    stagingBuffer.createBaseBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, MemoryAllocator::Usage::Transient);
 
-    auto& api = m_api ? *m_api : Renderer::VulkanApi::Instance();
-
-    void* data;
-    stagingBuffer.mapMemory(imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    stagingBuffer.unmapMemory();
+    memcpy(stagingBuffer.getMappedMemory(), texture.pixels.data(), static_cast<size_t>(imageSize));
 
     createImage();
 
     transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(stagingBuffer.getBuffer());
+    copyBufferToImage(stagingBuffer.getBuffer(), texture.levels);
     transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-    stbi_image_free(pixels);
+    // what the texture would be as it was loaded before (one rgba8 level) against what it is
+    VkDeviceSize uncompressedSize = (VkDeviceSize)m_width * m_height * 4;
+    s_textureCount++;
+    s_textureMemory += m_memorySize;
+    s_uncompressedTextureMemory += uncompressedSize;
+    m_countedInStats = true;
+    LogInfo("texture ", path, " : ", m_width, "x", m_height, ", ", m_mipLevels, " mip levels, ", m_memorySize / 1024, " KB on the gpu (", uncompressedSize / 1024, " KB as one rgba8 level)");
 };
 
-void Texture::createImage() {
+TextureData Texture::readImage(const std::string& path, bool generateMips) {
+    TextureData texture;
+    if (TextureContainer::isContainer(path)) {
+        // the legacy dds formats are srgb if the texture was asked in srgb
+        texture = TextureContainer::load(path, TextureProcessing::isSrgb(m_format));
+    } else {
+        int width, height, texChannels;
+        stbi_uc* pixels = stbi_load(path.data(), &width, &height, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("failed to load texture image!");
+        }
+
+        // stb_image always gives 4 channels
+        texture.format = TextureProcessing::isSrgb(m_format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        texture.width = width;
+        texture.height = height;
+        texture.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+        texture.levels.push_back({0, texture.pixels.size(), texture.width, texture.height});
+        stbi_image_free(pixels);
+    }
+    selectFormat(texture, path);
+
+    // the block compressed ones can't be filtered on the cpu, they come with their mips or without
+    if (generateMips && texture.levels.size() == 1 && !TextureProcessing::isBlockCompressed(texture.format)) {
+        TextureProcessing::generateMips(texture);
+    }
+    return texture;
+}
+
+void Texture::selectFormat(TextureData& texture, const std::string& path) {
+    std::vector<VkFormat> candidates;
+    if (!TextureProcessing::isBlockCompressed(texture.format)) {
+        candidates.push_back(texture.format);
+    } else {
+        auto& api = m_api ? *m_api : Renderer::VulkanApi::Instance();
+        if (api.supportsTextureCompressionBC()) {
+            candidates.push_back(texture.format);
+        }
+        VkFormat decodedFormat = TextureProcessing::getDecodedFormat(texture.format);
+        if (decodedFormat != VK_FORMAT_UNDEFINED) {
+            candidates.push_back(decodedFormat);
+        }
+    }
+
+    // throws when nothing is left (BC7 without textureCompressionBC)
+    VkFormat format = findSupportedFormat(candidates, m_tiling, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+    if (format != texture.format) {
+        LogWarning("texture ", path, " : the gpu can't sample its block compressed format, decoded on the cpu");
+        texture = TextureProcessing::decode(texture);
+    }
+}
+
+void Texture::createImage(const Allocation* placement) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent.width = m_width;
     imageInfo.extent.height = m_height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = m_mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = m_format;
     imageInfo.tiling = m_tiling;
@@ -153,12 +243,27 @@ void Texture::createImage() {
         throw std::runtime_error("failed to create image!");
     }
 
+    if (placement) {
+        if (api.bindImageMemory(m_image, placement->memory, placement->offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory!");
+        }
+        m_allocation = *placement;
+        m_memorySize = m_allocation.size;
+        return;
+    }
+    if (!m_api) {
+        m_allocation = MemoryAllocator::Instance().allocateForImage(m_image, m_properties, isStreamed() ? this : nullptr);
+        m_memorySize = m_allocation.size;
+        return;
+    }
+
     VkMemoryRequirements memRequirements;
     api.getImageMemoryRequirements(m_image, &memRequirements);
 
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
+    m_memorySize = memRequirements.size;
     allocInfo.memoryTypeIndex = Buffer::findMemoryType(memRequirements.memoryTypeBits, m_properties, api);
 
     if (api.allocateMemory(&allocInfo, nullptr, &m_imageMemory) != VK_SUCCESS) {
@@ -178,7 +283,7 @@ void Texture::createImageView() {
     viewInfo.format = m_format;
     viewInfo.subresourceRange.aspectMask = m_aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = m_mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -214,7 +319,8 @@ void Texture::createSampler() {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    // the streamed ones get more levels later with the same sampler
+    samplerInfo.maxLod = isStreamed() ? VK_LOD_CLAMP_NONE : (float)m_mipLevels;
 
     if (api.createSampler(&samplerInfo, nullptr, &m_imageSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler!");
@@ -235,7 +341,7 @@ void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLa
     barrier.image = m_image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = m_mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -267,28 +373,32 @@ void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLa
     api.endSingleTimeCommands(commandBuffer);
 }
 
-void Texture::copyBufferToImage(VkBuffer buffer) {
+void Texture::copyBufferToImage(VkBuffer buffer, const std::vector<TextureLevel>& levels) {
     auto& api = m_api ? *m_api : Renderer::VulkanApi::Instance();
     VkCommandBuffer commandBuffer = api.beginSingleTimeCommands();
 
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {
-        static_cast<uint32_t>(m_width),
-        static_cast<uint32_t>(m_height),
-        1
-    };
+    // one region per mip level, they are one after the other in the buffer
+    std::vector<VkBufferImageCopy> regions(levels.size());
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = levels[level].offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {
+            levels[level].width,
+            levels[level].height,
+            1
+        };
+    }
 
-    api.cmdCopyBufferToImage(commandBuffer, buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    api.cmdCopyBufferToImage(commandBuffer, buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
 
     api.endSingleTimeCommands(commandBuffer);
 }
@@ -1,10 +1,14 @@
+#pragma once
 #include <string>
 #include <GLFW/glfw3.h>
 #include <vector>
 #include "Core/Renderer/VulkanApi.h"
+#include "MemoryAllocator.h"
+#include "TextureContainer.h"
 
 namespace Engine {
 namespace Ressources {
+class TextureStreamer;
 
 class Texture {
 public:
@@ -18,6 +22,8 @@ public:
         VkImageTiling tiling;
         VkImageUsageFlags usage;
         VkMemoryPropertyFlags memoryProperties;
+        // the whole chain down to 1x1 when the file doesn't have the mips (not for the block compressed ones)
+        bool generateMips = false;
 
         static TextureCreateInfo getDefault(std::string path);
         static TextureCreateInfo getDefaultWihtoutPath(int width=0, int height=0);
@@ -33,26 +39,60 @@ public:
     VkDescriptorImageInfo createDescriptorImageInfo();
     VkFormat getFormat() {return m_format;};
     VkImageView getImageView() {return m_imageView;};
+    VkImage getImage() {return m_image;};
+    uint32_t getMipLevels() {return m_mipLevels;};
+    // loaded by the TextureStreamer, its image and view are replaced when its resident levels change
+    bool isStreamed() const {return m_streamId != NOT_STREAMED;};
+    // goes up every time the image view changes, the descriptor sets that use the texture are written again
+    uint32_t getVersion() const {return m_version;};
+
+    // every texture loaded from a file, the size on the gpu and the size they would have as one rgba8 level
+    struct MemoryStats {
+        uint32_t textureCount = 0;
+        VkDeviceSize size = 0;
+        VkDeviceSize uncompressedSize = 0;
+    };
+    static MemoryStats getMemoryStats();
 private:
-    void loadImage(const std::string& path);
+    friend TextureStreamer;
+    static constexpr uint32_t NOT_STREAMED = UINT32_MAX;
+
+    // 1x1 placeholder made by the TextureStreamer, it's replaced once the file is decoded
+    Texture(TextureCreateInfo& info, uint32_t streamId);
+
+    void loadImage(const std::string& path, bool generateMips);
+    // dds and ktx2 files are read with TextureContainer, the others with stb_image. Only cpu work, the streamer calls
+    // it on the worker threads
+    TextureData readImage(const std::string& path, bool generateMips);
+    // the block compressed formats the gpu can't sample are decoded
+    void selectFormat(TextureData& texture, const std::string& path);
     void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
-    void copyBufferToImage(VkBuffer buffer);
-    void createImage();
+    void copyBufferToImage(VkBuffer buffer, const std::vector<TextureLevel>& levels);
+    // bound to placement when given (a move of the defragmentation), allocated otherwise. The streamed textures give
+    // themselves as the userData of their allocation, the TextureStreamer moves them
+    void createImage(const Allocation* placement = nullptr);
     void createImageView();
     void createSampler();
 
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 private:
-    ::Engine::Renderer::VulkanApi* m_api;
+    ::Engine::Renderer::VulkanApi* m_api = nullptr;
 
     VkImage m_image;
-    VkDeviceMemory m_imageMemory;
+    Allocation m_allocation;
+    // the attachments of the swap chain (m_api) are created before the allocator, they keep their own allocation
+    VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
     VkImageView m_imageView;
     VkSampler m_imageSampler;
     VkFormat m_format;
     VkImageAspectFlags m_aspectFlags;
     int m_width;
     int m_height;
+    uint32_t m_mipLevels = 1;
+    VkDeviceSize m_memorySize = 0;
+    bool m_countedInStats = false;
+    uint32_t m_streamId = NOT_STREAMED;
+    uint32_t m_version = 0;
     VkImageTiling m_tiling;
     VkImageUsageFlags m_usage;
     VkMemoryPropertyFlags m_properties;
@@ -0,0 +1,220 @@
+#include "TextureContainer.h"
+#include "TextureProcessing.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+static uint32_t readU32(const std::vector<uint8_t>& file, size_t offset) {
+    if (offset + sizeof(uint32_t) > file.size()) {
+        throw std::runtime_error("texture file is truncated");
+    }
+    uint32_t value;
+    memcpy(&value, file.data() + offset, sizeof(value));
+    return value;
+}
+
+static uint64_t readU64(const std::vector<uint8_t>& file, size_t offset) {
+    if (offset + sizeof(uint64_t) > file.size()) {
+        throw std::runtime_error("texture file is truncated");
+    }
+    uint64_t value;
+    memcpy(&value, file.data() + offset, sizeof(value));
+    return value;
+}
+
+static constexpr uint32_t fourCC(char a, char b, char c, char d) {
+    return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+bool TextureContainer::isContainer(const std::string& path) {
+    std::string extension = path.substr(std::min(path.find_last_of('.'), path.size()));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".dds" || extension == ".ktx2";
+}
+
+TextureData TextureContainer::load(const std::string& path, bool srgb) {
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream.is_open()) {
+        throw std::runtime_error("failed to open texture file " + path);
+    }
+    std::vector<uint8_t> file((size_t)stream.tellg());
+    stream.seekg(0);
+    stream.read((char*)file.data(), file.size());
+
+    static constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    if (file.size() >= sizeof(KTX2_IDENTIFIER) && memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+        return loadKtx2(file);
+    }
+    if (file.size() >= 4 && readU32(file, 0) == fourCC('D', 'D', 'S', ' ')) {
+        return loadDds(file, srgb);
+    }
+    throw std::runtime_error("texture file " + path + " is not a DDS or KTX2 file");
+}
+
+// the levels are packed one after the other from offset
+static void fillLevels(TextureData& texture, const std::vector<uint8_t>& file, size_t offset, uint32_t levelCount) {
+    uint32_t width = texture.width;
+    uint32_t height = texture.height;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        size_t size = TextureProcessing::getLevelSize(texture.format, width, height);
+        texture.levels.push_back({offset, size, width, height});
+        offset += size;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    if (offset > file.size()) {
+        throw std::runtime_error("texture file is truncated");
+    }
+}
+
+// DXGI_FORMAT values of the DX10 header
+static VkFormat dxgiToVkFormat(uint32_t dxgiFormat) {
+    switch (dxgiFormat) {
+        case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+        case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+        case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+        case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+        case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+        case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+        case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+        case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+        case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+        case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+        case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+        case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+        case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+        default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+TextureData TextureContainer::loadDds(const std::vector<uint8_t>& file, bool srgb) {
+    // offsets from the start of the file, the header is after the 4 bytes of the magic
+    static constexpr size_t HEIGHT = 12;
+    static constexpr size_t WIDTH = 16;
+    static constexpr size_t MIP_MAP_COUNT = 28;
+    static constexpr size_t PIXEL_FORMAT_FLAGS = 80;
+    static constexpr size_t FOUR_CC = 84;
+    static constexpr size_t RGB_BIT_COUNT = 88;
+    static constexpr size_t R_BIT_MASK = 92;
+    static constexpr size_t DATA = 128;
+    static constexpr size_t DX10_DATA = DATA + 20;
+    static constexpr uint32_t DDPF_FOURCC = 0x4;
+    static constexpr uint32_t DDPF_RGB = 0x40;
+
+    TextureData texture;
+    texture.height = readU32(file, HEIGHT);
+    texture.width = readU32(file, WIDTH);
+    uint32_t levelCount = std::max(readU32(file, MIP_MAP_COUNT), 1u);
+    uint32_t flags = readU32(file, PIXEL_FORMAT_FLAGS);
+    size_t dataOffset = DATA;
+
+    if (flags & DDPF_FOURCC) {
+        uint32_t code = readU32(file, FOUR_CC);
+        if (code == fourCC('D', 'X', '1', '0')) {
+            // dxgiFormat, resourceDimension (3 is 2d), miscFlag, arraySize
+            texture.format = dxgiToVkFormat(readU32(file, DATA));
+            if (readU32(file, DATA + 4) != 3 || readU32(file, DATA + 12) > 1) {
+                throw std::runtime_error("DDS : only 2d textures are supported");
+            }
+            dataOffset = DX10_DATA;
+        } else if (code == fourCC('D', 'X', 'T', '1')) {
+            texture.format = srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        } else if (code == fourCC('D', 'X', 'T', '3')) {
+            texture.format = srgb ? VK_FORMAT_BC2_SRGB_BLOCK : VK_FORMAT_BC2_UNORM_BLOCK;
+        } else if (code == fourCC('D', 'X', 'T', '5')) {
+            texture.format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        } else if (code == fourCC('A', 'T', 'I', '1') || code == fourCC('B', 'C', '4', 'U')) {
+            texture.format = VK_FORMAT_BC4_UNORM_BLOCK;
+        } else if (code == fourCC('A', 'T', 'I', '2') || code == fourCC('B', 'C', '5', 'U')) {
+            texture.format = VK_FORMAT_BC5_UNORM_BLOCK;
+        }
+    } else if ((flags & DDPF_RGB) && readU32(file, RGB_BIT_COUNT) == 32) {
+        // the red mask says the byte order
+        uint32_t redMask = readU32(file, R_BIT_MASK);
+        if (redMask == 0x000000FF) {
+            texture.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        } else if (redMask == 0x00FF0000) {
+            texture.format = srgb ? VK_FORMAT_B8G8R8A8_SRGB : VK_FORMAT_B8G8R8A8_UNORM;
+        }
+    }
+
+    if (texture.format == VK_FORMAT_UNDEFINED || TextureProcessing::getBlockSize(texture.format) == 0) {
+        throw std::runtime_error("DDS : format not supported");
+    }
+
+    fillLevels(texture, file, dataOffset, levelCount);
+    texture.pixels.assign(file.begin() + dataOffset, file.begin() + texture.levels.back().offset + texture.levels.back().size);
+    for (TextureLevel& level : texture.levels) {
+        level.offset -= dataOffset;
+    }
+    return texture;
+}
+
+TextureData TextureContainer::loadKtx2(const std::vector<uint8_t>& file) {
+    static constexpr size_t FORMAT = 12;
+    static constexpr size_t PIXEL_WIDTH = 20;
+    static constexpr size_t PIXEL_HEIGHT = 24;
+    static constexpr size_t PIXEL_DEPTH = 28;
+    static constexpr size_t LAYER_COUNT = 32;
+    static constexpr size_t FACE_COUNT = 36;
+    static constexpr size_t LEVEL_COUNT = 40;
+    static constexpr size_t SUPERCOMPRESSION_SCHEME = 44;
+    static constexpr size_t LEVEL_INDEX = 80;
+    static constexpr size_t LEVEL_INDEX_ENTRY_SIZE = 24; // byteOffset, byteLength, uncompressedByteLength
+
+    TextureData texture;
+    texture.format = (VkFormat)readU32(file, FORMAT);
+    texture.width = readU32(file, PIXEL_WIDTH);
+    texture.height = std::max(readU32(file, PIXEL_HEIGHT), 1u);
+
+    if (readU32(file, PIXEL_DEPTH) > 1 || readU32(file, LAYER_COUNT) > 1 || readU32(file, FACE_COUNT) != 1) {
+        throw std::runtime_error("KTX2 : only 2d textures are supported");
+    }
+    if (readU32(file, SUPERCOMPRESSION_SCHEME) != 0) {
+        throw std::runtime_error("KTX2 : supercompressed files are not supported");
+    }
+    if (TextureProcessing::getBlockSize(texture.format) == 0) {
+        throw std::runtime_error("KTX2 : format not supported");
+    }
+
+    // 0 means the loader makes the mips, there is one level in the file
+    uint32_t levelCount = std::max(readU32(file, LEVEL_COUNT), 1u);
+
+    // the levels can be in any order in the file (usually the smallest first), they are put biggest first here
+    size_t dataSize = 0;
+    uint32_t width = texture.width;
+    uint32_t height = texture.height;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        size_t entry = LEVEL_INDEX + level * LEVEL_INDEX_ENTRY_SIZE;
+        size_t size = (size_t)readU64(file, entry + 8);
+        if (size != TextureProcessing::getLevelSize(texture.format, width, height)) {
+            throw std::runtime_error("KTX2 : the size of a level doesn't match its format");
+        }
+        texture.levels.push_back({dataSize, size, width, height});
+        dataSize += size;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    texture.pixels.resize(dataSize);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        size_t fileOffset = (size_t)readU64(file, LEVEL_INDEX + level * LEVEL_INDEX_ENTRY_SIZE);
+        const TextureLevel& textureLevel = texture.levels[level];
+        if (fileOffset + textureLevel.size > file.size()) {
+            throw std::runtime_error("texture file is truncated");
+        }
+        memcpy(texture.pixels.data() + textureLevel.offset, file.data() + fileOffset, textureLevel.size);
+    }
+    return texture;
+}
+
+}
+}
@@ -0,0 +1,53 @@
+//
+//
+// Readers of the files that store the texture the way the gpu samples it (block compressed, mip levels already made)
+// so the loading is a copy :
+// - DDS : the DirectX one, the legacy header (DXT1/3/5, ATI1/2, 32 bit rgba) and the DX10 header (dxgi formats)
+//   https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide
+// - KTX2 : the Khronos one, it stores the VkFormat. Only the ones without supercompression (no basis universal / zstd)
+//   https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+// Only 2d textures, no arrays or cube maps.
+//
+//
+
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Engine {
+namespace Ressources {
+
+struct TextureLevel {
+    size_t offset; // in TextureData::pixels
+    size_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+// the mip levels one after the other in pixels, level 0 is the biggest
+struct TextureData {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<TextureLevel> levels;
+    std::vector<uint8_t> pixels;
+};
+
+struct TextureContainer {
+    // from the extension (.dds or .ktx2)
+    static bool isContainer(const std::string& path);
+
+    // throws when the file is not valid or the format isn't handled. The legacy DDS formats don't say if they are
+    // srgb, srgb is used for them
+    static TextureData load(const std::string& path, bool srgb);
+
+private:
+    static TextureData loadDds(const std::vector<uint8_t>& file, bool srgb);
+    static TextureData loadKtx2(const std::vector<uint8_t>& file);
+};
+
+}
+}
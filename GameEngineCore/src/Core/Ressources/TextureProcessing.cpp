@@ -0,0 +1,316 @@
+#include "TextureProcessing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+bool TextureProcessing::isSrgb(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8_SRGB:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool TextureProcessing::isBlockCompressed(VkFormat format) {
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+uint32_t TextureProcessing::getBlockSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return 4;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t TextureProcessing::getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+    if (isBlockCompressed(format)) {
+        // the blocks on the right and bottom edges are partly outside
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+    }
+    return (size_t)width * height * getBlockSize(format);
+}
+
+uint32_t TextureProcessing::getMipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+    return levels;
+}
+
+VkFormat TextureProcessing::getDecodedFormat(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+// 16 texels, row by row
+using Block = uint8_t[16][4];
+
+static void expand565(uint16_t color, uint8_t* out) {
+    uint8_t r = (color >> 11) & 31;
+    uint8_t g = (color >> 5) & 63;
+    uint8_t b = color & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+    out[3] = 255;
+}
+
+// the BC1 block, also the color part of BC2 and BC3 where it's always the 4 colors mode.
+// transparentBlack : color0 <= color1 is the 3 colors mode, the 4th is black with alpha 0 (only BC1 rgba)
+static void decodeColorBlock(const uint8_t* data, bool threeColorMode, bool transparentBlack, Block& out) {
+    uint16_t color0 = data[0] | (data[1] << 8);
+    uint16_t color1 = data[2] | (data[3] << 8);
+    uint8_t palette[4][4];
+    expand565(color0, palette[0]);
+    expand565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (!threeColorMode || color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (threeColorMode && color0 <= color1 && transparentBlack) ? 0 : 255;
+
+    uint32_t indices = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+    for (int texel = 0; texel < 16; texel++) {
+        memcpy(out[texel], palette[(indices >> (2 * texel)) & 3], 4);
+    }
+}
+
+// the alpha part of BC3 and the channels of BC4 and BC5, 2 end points and 3 bit indices
+static void decodeChannelBlock(const uint8_t* data, Block& out, int channel) {
+    uint8_t palette[8];
+    palette[0] = data[0];
+    palette[1] = data[1];
+    if (palette[0] > palette[1]) {
+        for (int i = 1; i < 7; i++) {
+            palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+        }
+    } else {
+        for (int i = 1; i < 5; i++) {
+            palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= (uint64_t)data[2 + i] << (8 * i);
+    }
+    for (int texel = 0; texel < 16; texel++) {
+        out[texel][channel] = palette[(indices >> (3 * texel)) & 7];
+    }
+}
+
+static void decodeBlock(VkFormat format, const uint8_t* data, Block& out) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            decodeColorBlock(data, true, false, out);
+            break;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            decodeColorBlock(data, true, true, out);
+            break;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+            decodeColorBlock(data + 8, false, false, out);
+            // 4 bits of alpha per texel
+            for (int texel = 0; texel < 16; texel++) {
+                out[texel][3] = ((data[texel / 2] >> (4 * (texel % 2))) & 15) * 17;
+            }
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            decodeColorBlock(data + 8, false, false, out);
+            decodeChannelBlock(data, out, 3);
+            break;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            memset(out, 0, sizeof(Block));
+            decodeChannelBlock(data, out, 0);
+            for (int texel = 0; texel < 16; texel++) {
+                out[texel][3] = 255;
+            }
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            memset(out, 0, sizeof(Block));
+            decodeChannelBlock(data, out, 0);
+            decodeChannelBlock(data + 8, out, 1);
+            for (int texel = 0; texel < 16; texel++) {
+                out[texel][3] = 255;
+            }
+            break;
+        default:
+            throw std::runtime_error("no cpu decoder for this texture format");
+    }
+}
+
+TextureData TextureProcessing::decode(const TextureData& texture) {
+    TextureData decoded;
+    decoded.format = getDecodedFormat(texture.format);
+    if (decoded.format == VK_FORMAT_UNDEFINED) {
+        throw std::runtime_error("no cpu decoder for this texture format");
+    }
+    decoded.width = texture.width;
+    decoded.height = texture.height;
+
+    size_t size = 0;
+    for (const TextureLevel& level : texture.levels) {
+        decoded.levels.push_back({size, getLevelSize(decoded.format, level.width, level.height), level.width, level.height});
+        size += decoded.levels.back().size;
+    }
+    decoded.pixels.resize(size);
+
+    uint32_t blockSize = getBlockSize(texture.format);
+    for (size_t l = 0; l < texture.levels.size(); l++) {
+        const TextureLevel& level = texture.levels[l];
+        const uint8_t* blocks = texture.pixels.data() + level.offset;
+        uint8_t* pixels = decoded.pixels.data() + decoded.levels[l].offset;
+        uint32_t blocksX = (level.width + 3) / 4;
+        uint32_t blocksY = (level.height + 3) / 4;
+
+        for (uint32_t by = 0; by < blocksY; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                Block block;
+                decodeBlock(texture.format, blocks + ((size_t)by * blocksX + bx) * blockSize, block);
+                // the texels outside of the level are dropped
+                for (uint32_t texel = 0; texel < 16; texel++) {
+                    uint32_t x = bx * 4 + texel % 4;
+                    uint32_t y = by * 4 + texel / 4;
+                    if (x < level.width && y < level.height) {
+                        memcpy(pixels + ((size_t)y * level.width + x) * 4, block[texel], 4);
+                    }
+                }
+            }
+        }
+    }
+    return decoded;
+}
+
+static float srgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+void TextureProcessing::generateMips(TextureData& texture) {
+    if (getBlockSize(texture.format) != 4 || isBlockCompressed(texture.format) || texture.levels.empty()) {
+        throw std::runtime_error("mips can only be generated for 4 bytes per pixel formats");
+    }
+
+    // the alpha is never srgb
+    bool srgb = isSrgb(texture.format);
+    float toLinear[256];
+    for (int i = 0; i < 256; i++) {
+        toLinear[i] = srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+    }
+
+    uint32_t levelCount = getMipLevelCount(texture.width, texture.height);
+    std::vector<TextureLevel> levels;
+    size_t size = 0;
+    uint32_t width = texture.width;
+    uint32_t height = texture.height;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        levels.push_back({size, (size_t)width * height * 4, width, height});
+        size += levels.back().size;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    std::vector<uint8_t> pixels(size);
+    memcpy(pixels.data(), texture.pixels.data() + texture.levels[0].offset, levels[0].size);
+
+    for (uint32_t level = 1; level < levelCount; level++) {
+        const TextureLevel& source = levels[level - 1];
+        const TextureLevel& destination = levels[level];
+        const uint8_t* in = pixels.data() + source.offset;
+        uint8_t* out = pixels.data() + destination.offset;
+
+        for (uint32_t y = 0; y < destination.height; y++) {
+            // an odd size drops the last row or column, a dimension of 1 reads the same texel twice
+            uint32_t y0 = std::min(y * 2, source.height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+            for (uint32_t x = 0; x < destination.width; x++) {
+                uint32_t x0 = std::min(x * 2, source.width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                const uint8_t* texels[4] = {
+                    in + ((size_t)y0 * source.width + x0) * 4,
+                    in + ((size_t)y0 * source.width + x1) * 4,
+                    in + ((size_t)y1 * source.width + x0) * 4,
+                    in + ((size_t)y1 * source.width + x1) * 4,
+                };
+
+                uint8_t* texel = out + ((size_t)y * destination.width + x) * 4;
+                for (int c = 0; c < 3; c++) {
+                    float sum = toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]];
+                    float value = sum * 0.25f;
+                    texel[c] = (uint8_t)std::lround(std::clamp(srgb ? linearToSrgb(value) : value, 0.0f, 1.0f) * 255.0f);
+                }
+                texel[3] = (uint8_t)((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+            }
+        }
+    }
+
+    texture.levels = std::move(levels);
+    texture.pixels = std::move(pixels);
+}
+
+}
+}
@@ -0,0 +1,41 @@
+//
+//
+// Cpu side work on the texture data before the upload :
+// - the mip chain, a 2x2 box filter from level 0 down to 1x1. The srgb formats are averaged in linear space or the
+//   small mips get darker
+// - the BC1 to BC5 decoders, when the gpu can't sample block compressed formats (no textureCompressionBC) the texture
+//   is decoded to rgba8. There is no BC7 decoder (the partitions and modes are a lot of code for a fallback that
+//   desktop gpus never need), a BC7 texture can't be loaded without the feature
+//   https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html#S3TC
+//
+//
+
+#pragma once
+#include "TextureContainer.h"
+#include "vulkan/vulkan_core.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine {
+namespace Ressources {
+
+struct TextureProcessing {
+    static bool isSrgb(VkFormat format);
+    static bool isBlockCompressed(VkFormat format);
+    // bytes of a 4x4 block for the compressed formats, of a pixel for the others, 0 when the format isn't handled
+    static uint32_t getBlockSize(VkFormat format);
+    static size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+    // down to 1x1
+    static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+    // the rgba8 format a compressed one decodes to (BC4 and BC5 go in r and g), VK_FORMAT_UNDEFINED without decoder
+    static VkFormat getDecodedFormat(VkFormat format);
+    // every level, the format must have a decoder
+    static TextureData decode(const TextureData& texture);
+
+    // replaces the levels by level 0 and its mips, only for 4 bytes per pixel formats
+    static void generateMips(TextureData& texture);
+};
+
+}
+}
@@ -0,0 +1,553 @@
+#include "TextureStreamer.h"
+#include "Material.h"
+#include "Core/Renderer/VulkanApi.h"
+#include "Core/Utils/ThreadPool.h"
+#include "Core/Log/Log.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+namespace Ressources {
+
+static TextureStreamer* instance;
+
+void TextureStreamer::Init() {
+    instance = new TextureStreamer();
+}
+
+TextureStreamer& TextureStreamer::Instance() {
+    return *instance;
+}
+
+void TextureStreamer::Shutdown() {
+    delete instance;
+    instance = nullptr;
+}
+
+bool TextureStreamer::IsEnabled() {
+    return instance != nullptr;
+}
+
+TextureStreamer::~TextureStreamer() {
+    // the jobs read the files into their texture
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_allDone.wait(lock, [&]() { return m_pendingCount == 0; });
+    }
+    // the device is idle, the textures still used by the scene are gone already
+    destroyRetired(true);
+    m_entries.clear();
+
+    LogInfo("texture streaming : ", m_stats.peakResidentSize / 1024, " KB resident at most (budget ", m_budget / 1024, " KB), ",
+        m_stats.uploadedSize / 1024, " KB uploaded, ", m_stats.evictions, " evictions");
+}
+
+std::shared_ptr<Texture> TextureStreamer::load(const std::string& path) {
+    uint32_t id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        id = (uint32_t)m_entries.size();
+        m_entries.push_back({});
+    }
+
+    // the same formats as a loaded texture, TRANSFER_SRC to copy the kept levels to the next image
+    Texture::TextureCreateInfo info = Texture::TextureCreateInfo::getDefaultWihtoutPath();
+    info.width = 1;
+    info.height = 1;
+    info.possibleFormats = {VK_FORMAT_R8G8B8A8_SRGB};
+    info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    Entry& entry = m_entries[id];
+    entry = Entry{};
+    entry.texture = std::shared_ptr<Texture>(new Texture(info, id));
+    entry.path = path;
+    m_newPlaceholders.push_back(id);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pendingCount == 0) {
+            m_loadStart = std::chrono::steady_clock::now();
+        }
+        m_pendingCount++;
+    }
+
+    // the entry holds the texture until the job is collected
+    Texture* texture = entry.texture.get();
+    Utils::ThreadPool::Instance().submit([this, texture, id, path]() {
+        DecodedTexture decoded{id, {}, false};
+        try {
+            decoded.data = texture->readImage(path, true);
+        } catch (const std::exception& e) {
+            LogWarning("texture ", path, " couldn't be loaded : ", e.what());
+            decoded.failed = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoded.push_back(std::move(decoded));
+            m_pendingCount--;
+        }
+        m_allDone.notify_all();
+    });
+
+    return entry.texture;
+}
+
+void TextureStreamer::request(Texture* texture, float pixels) {
+    Entry& entry = m_entries[texture->m_streamId];
+    if (entry.lastRequestFrame != m_frame) {
+        entry.lastRequestFrame = m_frame;
+        entry.requestedPixels = 0.0f;
+    }
+    entry.requestedPixels = std::max(entry.requestedPixels, pixels);
+}
+
+void TextureStreamer::addMaterial(Material* material) {
+    m_materials.push_back(material);
+}
+
+void TextureStreamer::removeMaterial(Material* material) {
+    m_materials.erase(std::remove(m_materials.begin(), m_materials.end(), material), m_materials.end());
+}
+
+void TextureStreamer::update(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    m_frame++;
+    destroyRetired(false);
+
+    for (uint32_t id : m_newPlaceholders) {
+        Entry& entry = m_entries[id];
+        if (entry.texture && entry.baseLevel == entry.data.levels.size()) {
+            clearPlaceholder(commandBuffer, *entry.texture);
+        }
+    }
+    m_newPlaceholders.clear();
+
+    collectDecoded();
+    releaseUnused();
+    chooseLevels();
+
+    // the evictions first, they give back memory for the uploads
+    std::vector<Entry*> upgrades;
+    for (Entry& entry : m_entries) {
+        if (!entry.texture || entry.state != State::Loaded) {
+            continue;
+        }
+        if (entry.targetLevel > entry.baseLevel) {
+            setResidentLevels(commandBuffer, entry, entry.targetLevel);
+            m_stats.evictions++;
+        } else if (entry.targetLevel < entry.baseLevel) {
+            upgrades.push_back(&entry);
+        }
+    }
+
+    // the ones drawn lately and the biggest on screen first
+    std::sort(upgrades.begin(), upgrades.end(), [](const Entry* a, const Entry* b) {
+        if (a->lastRequestFrame != b->lastRequestFrame) {
+            return a->lastRequestFrame > b->lastRequestFrame;
+        }
+        return a->requestedPixels > b->requestedPixels;
+    });
+
+    VkDeviceSize uploadLeft = m_maxUploadPerFrame;
+    for (Entry* entry : upgrades) {
+        // the always resident levels come in one go
+        uint32_t baseLevel = std::min(entry->baseLevel, entry->minBaseLevel);
+        VkDeviceSize size = getResidentSize(*entry, baseLevel) - getResidentSize(*entry, entry->baseLevel);
+        while (baseLevel > entry->targetLevel && size + entry->data.levels[baseLevel - 1].size <= uploadLeft) {
+            baseLevel--;
+            size += entry->data.levels[baseLevel].size;
+        }
+        if (baseLevel == entry->baseLevel) {
+            // a level bigger than the whole limit still goes up, alone in its frame
+            if (uploadLeft < m_maxUploadPerFrame) {
+                break;
+            }
+            baseLevel--;
+            size += entry->data.levels[baseLevel].size;
+        }
+        uploadLeft -= std::min(size, uploadLeft);
+        setResidentLevels(commandBuffer, *entry, baseLevel);
+        if (uploadLeft == 0) {
+            break;
+        }
+    }
+
+    if (m_frame % DEFRAGMENT_INTERVAL == 0) {
+        m_stats.defragmentMoves += MemoryAllocator::Instance().defragment([&](void* userData, const Allocation& from, const Allocation& to) {
+            return moveTexture(commandBuffer, userData, from, to);
+        }, MAX_DEFRAGMENT_MOVES);
+    }
+
+    m_stats.textureCount = 0;
+    m_stats.residentSize = 0;
+    for (Entry& entry : m_entries) {
+        if (entry.texture) {
+            m_stats.textureCount++;
+            m_stats.residentSize += entry.texture->m_memorySize;
+        }
+    }
+    m_stats.peakResidentSize = std::max(m_stats.peakResidentSize, m_stats.residentSize);
+
+    // their set of this frame was last used by the frame beginFrame waited on
+    for (Material* material : m_materials) {
+        material->refreshTextures(frameIndex);
+    }
+}
+
+void TextureStreamer::collectDecoded() {
+    std::vector<DecodedTexture> decoded;
+    bool allDone;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        decoded.swap(m_decoded);
+        allDone = m_pendingCount == 0;
+        m_stats.loadingCount = m_pendingCount;
+    }
+
+    for (DecodedTexture& texture : decoded) {
+        Entry& entry = m_entries[texture.id];
+        if (texture.failed) {
+            // stays the placeholder
+            entry.state = State::Failed;
+            continue;
+        }
+        entry.data = std::move(texture.data);
+        entry.state = State::Loaded;
+        entry.baseLevel = (uint32_t)entry.data.levels.size();
+        entry.minBaseLevel = 0;
+        while (entry.minBaseLevel + 1 < entry.data.levels.size()) {
+            const TextureLevel& level = entry.data.levels[entry.minBaseLevel];
+            if (std::max(level.width, level.height) <= MIN_RESIDENT_SIZE) {
+                break;
+            }
+            entry.minBaseLevel++;
+        }
+        LogDebug("texture ", entry.path, " decoded : ", entry.data.width, "x", entry.data.height, ", ", entry.data.levels.size(), " mip levels");
+    }
+
+    if (!decoded.empty() && allDone) {
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_loadStart).count();
+        LogInfo("streamed textures decoded in ", milliseconds, " ms");
+    }
+}
+
+// the textures only the streamer holds, once their job is done
+void TextureStreamer::releaseUnused() {
+    for (uint32_t id = 0; id < m_entries.size(); id++) {
+        Entry& entry = m_entries[id];
+        if (!entry.texture || entry.state == State::Loading || entry.texture.use_count() > 1) {
+            continue;
+        }
+        Retired retired;
+        retired.frame = m_frame;
+        retired.texture = std::move(entry.texture);
+        m_retired.push_back(std::move(retired));
+        entry = Entry{};
+        m_freeIds.push_back(id);
+    }
+}
+
+// the smallest level that still has as many texels as the pixels it covers
+uint32_t TextureStreamer::getWantedLevel(const Entry& entry) const {
+    if (m_frame - entry.lastRequestFrame > REQUEST_TIMEOUT) {
+        return entry.minBaseLevel;
+    }
+    uint32_t level = 0;
+    while (level < entry.minBaseLevel) {
+        const TextureLevel& next = entry.data.levels[level + 1];
+        if ((float)std::max(next.width, next.height) < entry.requestedPixels) {
+            break;
+        }
+        level++;
+    }
+    return level;
+}
+
+// The levels wanted by the requests (a texture isn't lowered just because it's smaller on screen, only when the
+// budget is full), then while it's over the budget the levels nobody asked for lately go first: the ones bigger than
+// what is wanted, then the wanted ones
+void TextureStreamer::chooseLevels() {
+    VkDeviceSize total = 0;
+    std::vector<Entry*> loaded;
+    for (Entry& entry : m_entries) {
+        if (!entry.texture || entry.state != State::Loaded) {
+            continue;
+        }
+        bool requested = m_frame - entry.lastRequestFrame <= REQUEST_TIMEOUT;
+        entry.targetLevel = requested ? std::min(getWantedLevel(entry), entry.baseLevel) : entry.baseLevel;
+        entry.targetLevel = std::min(entry.targetLevel, entry.minBaseLevel);
+        total += getResidentSize(entry, entry.targetLevel);
+        loaded.push_back(&entry);
+    }
+    if (total <= m_budget) {
+        m_overBudgetWarned = false;
+        return;
+    }
+
+    std::sort(loaded.begin(), loaded.end(), [](const Entry* a, const Entry* b) {
+        if (a->lastRequestFrame != b->lastRequestFrame) {
+            return a->lastRequestFrame < b->lastRequestFrame;
+        }
+        return a->requestedPixels < b->requestedPixels;
+    });
+    for (bool keepWanted : {true, false}) {
+        for (Entry* entry : loaded) {
+            uint32_t lowest = keepWanted ? std::min(getWantedLevel(*entry), entry->minBaseLevel) : entry->minBaseLevel;
+            while (total > m_budget && entry->targetLevel < lowest) {
+                total -= entry->data.levels[entry->targetLevel].size;
+                entry->targetLevel++;
+            }
+        }
+    }
+
+    if (total > m_budget && !m_overBudgetWarned) {
+        LogWarning("texture streaming : the always resident levels (", total / 1024, " KB) don't fit in the budget (", m_budget / 1024, " KB)");
+        m_overBudgetWarned = true;
+    }
+}
+
+VkDeviceSize TextureStreamer::getResidentSize(const Entry& entry, uint32_t baseLevel) const {
+    VkDeviceSize size = 0;
+    for (uint32_t level = baseLevel; level < entry.data.levels.size(); level++) {
+        size += entry.data.levels[level].size;
+    }
+    return size;
+}
+
+void TextureStreamer::setResidentLevels(VkCommandBuffer commandBuffer, Entry& entry, uint32_t baseLevel) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    Texture& texture = *entry.texture;
+    const std::vector<TextureLevel>& levels = entry.data.levels;
+    uint32_t levelCount = (uint32_t)levels.size();
+    uint32_t oldBaseLevel = entry.baseLevel;
+    // the placeholder has nothing to keep
+    bool hasLevels = oldBaseLevel < levelCount;
+
+    Retired retired;
+    retired.frame = m_frame;
+    retired.image = texture.m_image;
+    retired.view = texture.m_imageView;
+    retired.allocation = texture.m_allocation;
+
+    texture.m_format = entry.data.format;
+    texture.m_width = levels[baseLevel].width;
+    texture.m_height = levels[baseLevel].height;
+    texture.m_mipLevels = levelCount - baseLevel;
+    texture.createImage();
+    texture.createImageView();
+
+    VkImageMemoryBarrier barriers[2]{};
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+    }
+    barriers[0].image = texture.m_image;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    // the frames before this one may still sample the old image
+    barriers[1].image = retired.image;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    api.cmdPipelineBarrier(commandBuffer,
+                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           0,
+                           0, nullptr,
+                           0, nullptr,
+                           hasLevels ? 2 : 1, barriers);
+
+    // the levels both images have
+    if (hasLevels) {
+        std::vector<VkImageCopy> copies;
+        for (uint32_t level = std::max(baseLevel, oldBaseLevel); level < levelCount; level++) {
+            VkImageCopy copy{};
+            copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - oldBaseLevel, 0, 1};
+            copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - baseLevel, 0, 1};
+            copy.extent = {levels[level].width, levels[level].height, 1};
+            copies.push_back(copy);
+        }
+        api.cmdCopyImage(commandBuffer, retired.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copies.size(), copies.data());
+    }
+
+    // the new ones, packed one after the other in data
+    uint32_t uploadEnd = std::min(oldBaseLevel, levelCount);
+    if (baseLevel < uploadEnd) {
+        size_t start = levels[baseLevel].offset;
+        size_t size = levels[uploadEnd - 1].offset + levels[uploadEnd - 1].size - start;
+
+        retired.stagingBuffer = std::make_unique<Buffer>();
+        retired.stagingBuffer->createBaseBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, MemoryAllocator::Usage::Transient);
+        memcpy(retired.stagingBuffer->getMappedMemory(), entry.data.pixels.data() + start, size);
+
+        std::vector<VkBufferImageCopy> regions;
+        for (uint32_t level = baseLevel; level < uploadEnd; level++) {
+            VkBufferImageCopy region{};
+            region.bufferOffset = levels[level].offset - start;
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - baseLevel, 0, 1};
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {levels[level].width, levels[level].height, 1};
+            regions.push_back(region);
+        }
+        api.cmdCopyBufferToImage(commandBuffer, retired.stagingBuffer->getBuffer(), texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+        m_stats.uploadedSize += size;
+    }
+
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    // still sampled by this frame until the descriptors are written again
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    api.cmdPipelineBarrier(commandBuffer,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                           0,
+                           0, nullptr,
+                           0, nullptr,
+                           hasLevels ? 2 : 1, barriers);
+
+    m_retired.push_back(std::move(retired));
+    entry.baseLevel = baseLevel;
+    texture.m_version++;
+}
+
+void TextureStreamer::clearPlaceholder(VkCommandBuffer commandBuffer, Texture& texture) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture.m_image;
+    barrier.subresourceRange = range;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkClearColorValue gray = {{0.5f, 0.5f, 0.5f, 1.0f}};
+    api.cmdClearColorImage(commandBuffer, texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &gray, 1, &range);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    api.cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// The retired allocations keep the texture as their userData and the texture can be gone, it's only compared
+bool TextureStreamer::moveTexture(VkCommandBuffer commandBuffer, void* userData, const Allocation& from, const Allocation& to) {
+    Texture* texture = nullptr;
+    for (Entry& entry : m_entries) {
+        if (entry.texture.get() == userData) {
+            texture = entry.texture.get();
+            break;
+        }
+    }
+    if (!texture || texture->m_allocation.memory != from.memory || texture->m_allocation.offset != from.offset) {
+        return false;
+    }
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+
+    Retired retired;
+    retired.frame = m_frame;
+    retired.image = texture->m_image;
+    retired.view = texture->m_imageView;
+    retired.allocation = from;
+
+    // same parameters so the same memory requirements as the old one
+    texture->createImage(&to);
+    texture->createImageView();
+
+    VkImageMemoryBarrier barriers[2]{};
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+    }
+    barriers[0].image = texture->m_image;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    // it may have been written earlier in this command buffer by setResidentLevels
+    barriers[1].image = retired.image;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    api.cmdPipelineBarrier(commandBuffer,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           0,
+                           0, nullptr,
+                           0, nullptr,
+                           2, barriers);
+
+    std::vector<VkImageCopy> copies;
+    for (uint32_t level = 0; level < texture->m_mipLevels; level++) {
+        VkImageCopy copy{};
+        copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        copy.extent = {std::max(1u, (uint32_t)texture->m_width >> level), std::max(1u, (uint32_t)texture->m_height >> level), 1};
+        copies.push_back(copy);
+    }
+    api.cmdCopyImage(commandBuffer, retired.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copies.size(), copies.data());
+
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    // still sampled by this frame until the descriptors are written again
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    api.cmdPipelineBarrier(commandBuffer,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                           0,
+                           0, nullptr,
+                           0, nullptr,
+                           2, barriers);
+
+    m_retired.push_back(std::move(retired));
+    texture->m_version++;
+    return true;
+}
+
+// The descriptors of a material are written with the new view in the frame of the swap (its set of that frame) or in
+// the next one (the bindless indices go through the StagingRing), the old image is used until then
+void TextureStreamer::destroyRetired(bool all) {
+    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
+    uint64_t framesInFlight = api.getMaxFramesInFlight();
+    auto it = m_retired.begin();
+    while (it != m_retired.end()) {
+        if (!all && m_frame < it->frame + framesInFlight + 1) {
+            ++it;
+            continue;
+        }
+        api.destroyImageView(it->view, nullptr);
+        api.destroyImage(it->image, nullptr);
+        MemoryAllocator::Instance().free(it->allocation);
+        it = m_retired.erase(it);
+    }
+}
+
+}
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include "Texture.h"
+#include "Buffer.h"
+#include "vulkan/vulkan_core.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Engine {
+namespace Ressources {
+class Material;
+
+// Loads the textures without blocking the loading of the scene: load() returns a 1x1 placeholder right away and the
+// file is read, decoded and its mips made on the workers of Utils::ThreadPool. Once decoded only the small levels are
+// uploaded, the renderers then request the size they are drawn at on screen and the bigger levels are uploaded a few
+// at a time (at most getMaxUploadPerFrame bytes per frame). When the resident levels of all the textures go over the
+// budget, the levels nobody asked for lately are dropped first.
+// A texture can't change its levels in place (no sparse binding), its image is made again with the new levels : the
+// kept ones are copied on the gpu from the old image, the new ones from a staging buffer. The copies are recorded in
+// the frame's command buffer before its render pass like the ones of the StagingRing, and the old image is destroyed once the
+// frames that used it are done.
+// The decoded files stay in system memory so the levels can come back without reading the file again, only the gpu
+// memory is budgeted.
+// The images made again and again leave holes in the memory blocks, every DEFRAGMENT_INTERVAL frames a few of them
+// are moved out of the emptiest block (MemoryAllocator::defragment) the same way : a new image, a gpu copy and the old
+// one retired.
+class TextureStreamer {
+public:
+    static constexpr VkDeviceSize DEFAULT_BUDGET = 256 * 1024 * 1024;
+    static constexpr VkDeviceSize DEFAULT_MAX_UPLOAD_PER_FRAME = 16 * 1024 * 1024;
+    // the levels that are at most this big (biggest side) are always resident, they are the first upload
+    static constexpr uint32_t MIN_RESIDENT_SIZE = 64;
+    // a texture not requested for that many frames isn't raised anymore and is the first to lose its levels
+    static constexpr uint32_t REQUEST_TIMEOUT = 60;
+    // more than the frames in flight, the images moved last time are freed by then
+    static constexpr uint32_t DEFRAGMENT_INTERVAL = 30;
+    static constexpr uint32_t MAX_DEFRAGMENT_MOVES = 4;
+
+    static void Init();
+    static TextureStreamer& Instance();
+    // waits for the files still decoding
+    static void Shutdown();
+    static bool IsEnabled();
+
+    ~TextureStreamer();
+
+    // srgb like Texture::TextureCreateInfo::getDefault, the mips are made when the file doesn't have them
+    std::shared_ptr<Texture> load(const std::string& path);
+
+    // the texture covers about pixels on screen (biggest side) this frame, called by the renderers while building the
+    // queue. The biggest request of the frame wins
+    void request(Texture* texture, float pixels);
+
+    // records the uploads and evictions in the frame's command buffer (outside of a render pass), then writes the
+    // descriptors of the materials whose textures changed. The requests are the ones of the last frame
+    void update(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // the materials with streamed textures, their descriptors are written again when a texture changes
+    void addMaterial(Material* material);
+    void removeMaterial(Material* material);
+
+    void setBudget(VkDeviceSize budget) { m_budget = budget; };
+    VkDeviceSize getBudget() const { return m_budget; };
+    void setMaxUploadPerFrame(VkDeviceSize size) { m_maxUploadPerFrame = size; };
+    VkDeviceSize getMaxUploadPerFrame() const { return m_maxUploadPerFrame; };
+
+    struct Stats {
+        uint32_t textureCount = 0;
+        uint32_t loadingCount = 0; // still decoding on a worker
+        VkDeviceSize residentSize = 0; // gpu memory of the images
+        VkDeviceSize peakResidentSize = 0;
+        VkDeviceSize uploadedSize = 0; // since the start
+        uint32_t evictions = 0; // times a texture lost levels
+        uint32_t defragmentMoves = 0; // since the start
+    };
+    Stats getStats() const { return m_stats; };
+
+private:
+    enum class State {
+        Loading,
+        Loaded,
+        Failed,
+    };
+
+    struct Entry {
+        std::shared_ptr<Texture> texture;
+        std::string path;
+        State state = State::Loading;
+        TextureData data; // once loaded
+        uint32_t minBaseLevel = 0; // the first of the always resident levels
+        uint32_t baseLevel = 0; // first resident level, data.levels.size() when nothing is uploaded yet
+        uint32_t targetLevel = 0;
+        float requestedPixels = 0.0f;
+        uint64_t lastRequestFrame = 0;
+    };
+
+    struct DecodedTexture {
+        uint32_t id;
+        TextureData data;
+        bool failed;
+    };
+
+    // destroyed once the frames that used them are done
+    struct Retired {
+        uint64_t frame;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        Allocation allocation;
+        std::unique_ptr<Buffer> stagingBuffer;
+        std::shared_ptr<Texture> texture; // not used by anything anymore
+    };
+
+    void collectDecoded();
+    void releaseUnused();
+    uint32_t getWantedLevel(const Entry& entry) const;
+    void chooseLevels();
+    VkDeviceSize getResidentSize(const Entry& entry, uint32_t baseLevel) const;
+    // makes the image of [baseLevel, levels) and records the copies, the old one is retired
+    void setResidentLevels(VkCommandBuffer commandBuffer, Entry& entry, uint32_t baseLevel);
+    void clearPlaceholder(VkCommandBuffer commandBuffer, Texture& texture);
+    // the MemoryAllocator::MoveFunction, false when from isn't the current image of a streamed texture
+    bool moveTexture(VkCommandBuffer commandBuffer, void* userData, const Allocation& from, const Allocation& to);
+    void destroyRetired(bool all);
+
+private:
+    VkDeviceSize m_budget = DEFAULT_BUDGET;
+    VkDeviceSize m_maxUploadPerFrame = DEFAULT_MAX_UPLOAD_PER_FRAME;
+    uint64_t m_frame = 0;
+    Stats m_stats;
+    bool m_overBudgetWarned = false;
+
+    std::vector<Entry> m_entries; // by stream id, the released ones have no texture
+    std::vector<uint32_t> m_freeIds;
+    std::vector<uint32_t> m_newPlaceholders; // stream ids, cleared in the next update
+    std::vector<Retired> m_retired;
+    std::vector<Material*> m_materials;
+    std::chrono::steady_clock::time_point m_loadStart;
+
+    // filled by the workers
+    std::mutex m_mutex;
+    std::condition_variable m_allDone;
+    uint32_t m_pendingCount = 0;
+    std::vector<DecodedTexture> m_decoded;
+};
+
+}
+}
@@ -13,7 +13,6 @@ UniformBuffer::UniformBuffer(size_t size, uint32_t bufferCount)
 }
 
 void UniformBuffer::createBuffer(size_t size) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
     for (size_t i = 0; i < m_buffers.size(); i++) {
         createBaseBuffer(
             size,
@@ -21,11 +20,6 @@ void UniformBuffer::createBuffer(size_t size) {
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             i
         );
-
-        VkResult result = api.mapMemory(m_buffersMemory[i], 0, size, 0, &m_mappedMemory[i]);
-        if (result != VK_SUCCESS) {
-            throw std::runtime_error("Failed to map memory for uniform buffer");
-        }
     }
 }
 
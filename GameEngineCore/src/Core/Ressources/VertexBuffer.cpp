@@ -1,5 +1,6 @@
 #include "Core/Renderer/VulkanApi.h"
 #include "VertexBuffer.h"
+#include <cstring>
 #include <stdexcept>
 
 namespace Engine {
@@ -13,24 +14,18 @@ VertexBuffer::VertexBuffer( void* data, size_t size)
 
 void VertexBuffer::createBuffer(void* data, size_t size) {
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    Allocation stagingAllocation;
 
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-
-    createBaseBuffer(
+    createRawBuffer(
         size,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        0  // Use temporary index
+        stagingBuffer,
+        stagingAllocation,
+        MemoryAllocator::Usage::Transient
     );
 
-    stagingBuffer = m_buffers[0];
-    stagingBufferMemory = m_buffersMemory[0];
-
-    void* mappedMemory;
-    api.mapMemory(stagingBufferMemory, 0, size, 0, &mappedMemory);
-    memcpy(mappedMemory, data, size);
-    api.unmapMemory(stagingBufferMemory);
+    memcpy(stagingAllocation.mappedMemory, data, size);
 
     createBaseBuffer(
         size,
@@ -41,34 +36,7 @@ void VertexBuffer::createBuffer(void* data, size_t size) {
 
     copyBuffer(stagingBuffer, m_buffers[0], size);
 
-    api.destroyBuffer(stagingBuffer, nullptr);
-    api.freeMemory(stagingBufferMemory, nullptr);
-}
-
-void VertexBuffer::updateData(void* data, size_t size, uint32_t bufferIndex, uint32_t offset) {
-    Renderer::VulkanApi& api = Renderer::VulkanApi::Instance();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    createBaseBuffer(
-        size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        0  // Use temporary index
-    );
-
-    stagingBuffer = m_buffers[0];
-    stagingBufferMemory = m_buffersMemory[0];
-
-    void* mappedMemory;
-    api.mapMemory(stagingBufferMemory, 0, size, 0, &mappedMemory);
-    memcpy(mappedMemory, data, size);
-    api.unmapMemory(stagingBufferMemory);
-
-    copyBuffer(stagingBuffer, m_buffers[bufferIndex], size, 0, offset);
-
-    api.destroyBuffer(stagingBuffer, nullptr);
-    api.freeMemory(stagingBufferMemory, nullptr);
+    destroyRawBuffer(stagingBuffer, stagingAllocation);
 }
 
 }
@@ -0,0 +1,49 @@
+#include "VertexQuantization.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace Engine {
+namespace Ressources {
+
+void VertexQuantization::encodePosition(const glm::vec3& position, const glm::vec3& min, const glm::vec3& extent, uint16_t* out) {
+    glm::vec3 normalized = glm::clamp((position - min) / extent, 0.0f, 1.0f);
+    for (int i = 0; i < 3; i++) {
+        out[i] = (uint16_t)std::lround(normalized[i] * 65535.0f);
+    }
+    out[3] = 0;
+}
+
+void VertexQuantization::encodeNormal(const glm::vec3& normal, int16_t* out) {
+    // on the octahedron |x| + |y| + |z| = 1, the lower half is folded over the diagonals
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 encoded(0.0f);
+    if (length > 0.0f) {
+        glm::vec3 n = normal / length;
+        encoded = glm::vec2(n.x, n.y);
+        if (n.z < 0.0f) {
+            encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+            encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        out[i] = (int16_t)std::lround(glm::clamp(encoded[i], -1.0f, 1.0f) * 32767.0f);
+    }
+}
+
+void VertexQuantization::encodeTexCoord(const glm::vec2& texCoord, uint16_t* out) {
+    out[0] = glm::packHalf1x16(texCoord.x);
+    out[1] = glm::packHalf1x16(texCoord.y);
+}
+
+glm::vec3 VertexQuantization::decodeNormal(const int16_t* encoded) {
+    glm::vec2 e(std::max(encoded[0] / 32767.0f, -1.0f), std::max(encoded[1] / 32767.0f, -1.0f));
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+}
+}
@@ -0,0 +1,44 @@
+//
+//
+// Compressed vertex attributes, half the size of the float ones (16 bytes instead of 32 for position, normal, uv) :
+// - positions : 16 bit unorm inside the bounds of the mesh, the vertex shader gets [0, 1] and the model matrix
+//   scales it back (Mesh::getDequantization is put in ObjectData::model by the renderer)
+// - normals : octahedral encoding, the unit sphere is folded on a square, 2 x 16 bit snorm. The shaders decode it
+//   with octDecode
+// - vec2 channels (uv) : half floats
+//
+// Survey of the normal encodings : "A Survey of Efficient Representations for Independent Unit Vectors"
+// (Cigolle, Donow, Evangelakos, Mara, McGuire, Meyer), https://jcgt.org/published/0003/02/01/
+//
+//
+
+#pragma once
+#include "vulkan/vulkan_core.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace Engine {
+namespace Ressources {
+
+struct VertexQuantization {
+    // the formats of the attributes, the 4th component of the position is padding (there is no 3 x 16 bit format
+    // every gpu can read)
+    static constexpr VkFormat POSITION_FORMAT = VK_FORMAT_R16G16B16A16_UNORM;
+    static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16_SNORM;
+    static constexpr VkFormat TEX_COORD_FORMAT = VK_FORMAT_R16G16_SFLOAT;
+
+    static constexpr size_t POSITION_SIZE = 4 * sizeof(uint16_t);
+    static constexpr size_t NORMAL_SIZE = 2 * sizeof(int16_t);
+    static constexpr size_t TEX_COORD_SIZE = 2 * sizeof(uint16_t);
+
+    // min and extent are the bounds of the mesh, the extent is never 0
+    static void encodePosition(const glm::vec3& position, const glm::vec3& min, const glm::vec3& extent, uint16_t* out);
+    static void encodeNormal(const glm::vec3& normal, int16_t* out);
+    static void encodeTexCoord(const glm::vec2& texCoord, uint16_t* out);
+
+    // same as octDecode in the shaders
+    static glm::vec3 decodeNormal(const int16_t* encoded);
+};
+
+}
+}
@@ -12,7 +12,8 @@ public:
     MeshRenderer(std::shared_ptr<Ressources::Material> material, std::shared_ptr<Ressources::Mesh> mesh);
     ~MeshRenderer();
 
-    void render(Engine::Renderer::Renderer::FrameInfo& frameInfo) override;
+    // drawn by the DefaultRenderer with the other renderers that have the same mesh and material
+    Ressources::Mesh* getInstancedMesh() override { return m_mesh.get(); };
 
 private:
     std::shared_ptr<Ressources::Mesh> m_mesh;
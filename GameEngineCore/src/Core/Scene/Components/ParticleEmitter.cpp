@@ -0,0 +1,114 @@
+#include "ParticleEmitter.h"
+#include "Core/Renderer/VulkanApi.h"
+#include "Core/Scene/Entities/Entity.h"
+#include "Core/Scene/Components/Transform.h"
+#include "Core/Log/Log.h"
+#include "vulkan/vulkan_core.h"
+#include <cstddef>
+
+namespace Engine {
+namespace Components {
+
+static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+
+Ressources::PipelineConfigInfo ParticleEmitter::defaultPipelineConfigInfo(std::string vertShaderPath, std::string fragShaderPath) {
+    VkVertexInputBindingDescription quadBinding{};
+    quadBinding.binding = 0;
+    quadBinding.stride = sizeof(glm::vec2);
+    quadBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[0].offset = 0;
+
+    attributeDescriptions[1].binding = 1;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT; // position + size
+    attributeDescriptions[1].offset = offsetof(InstanceData, position);
+
+    attributeDescriptions[2].binding = 1;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributeDescriptions[2].offset = offsetof(InstanceData, color);
+
+    auto configInfo = Ressources::PipelineConfigInfo::defaultPipelineConfigInfo(vertShaderPath, fragShaderPath, quadBinding, attributeDescriptions);
+
+    VkVertexInputBindingDescription instanceBinding{};
+    instanceBinding.binding = 1;
+    instanceBinding.stride = sizeof(InstanceData);
+    instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    configInfo.extraBindingDescriptions.push_back(instanceBinding);
+
+    // transparent quads : both sides, test against the depth but don't write it
+    configInfo.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+    configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
+    configInfo.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    configInfo.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    configInfo.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+    return configInfo;
+}
+
+ParticleEmitter::ParticleEmitter(std::shared_ptr<Ressources::Material> material, Settings settings)
+: Renderer(material), settings(settings)
+{
+    std::vector<glm::vec2> corners = {
+        {-0.5f, -0.5f},
+        { 0.5f, -0.5f},
+        { 0.5f,  0.5f},
+        {-0.5f,  0.5f}
+    };
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
+    m_quad = std::make_unique<Ressources::Mesh>(indices, (void*)corners.data(), corners.size() * sizeof(corners[0]));
+
+    auto maxFramesInFlight = ::Engine::Renderer::VulkanApi::Instance().getMaxFramesInFlight();
+    m_instanceBuffer = std::make_unique<Ressources::InstanceBuffer>(INITIAL_INSTANCE_CAPACITY * sizeof(InstanceData), maxFramesInFlight);
+}
+
+ParticleEmitter::~ParticleEmitter() {
+}
+
+glm::vec3 ParticleEmitter::getOrigin() const {
+    if (auto transform = m_entity->getComponent<Transform>()) {
+        return transform.value()->position;
+    }
+    return glm::vec3(0.0f);
+}
+
+void ParticleEmitter::emit(uint32_t count) {
+    m_simulation.emit(settings, count, getOrigin());
+}
+
+void ParticleEmitter::update(float dt) {
+    m_simulation.update(settings, dt, getOrigin());
+}
+
+void ParticleEmitter::render(Engine::Renderer::Renderer::FrameInfo& frameInfo) {
+    uint32_t count = m_simulation.getAliveCount();
+    if (count == 0) {
+        return;
+    }
+
+    auto& api = ::Engine::Renderer::VulkanApi::Instance();
+
+    // sets 0 and 1 are already bound, the particles are in world space so they don't need an object
+    m_instanceBuffer->reserve(count * sizeof(InstanceData), frameInfo.frameIndex);
+    m_simulation.writeInstances(settings, (InstanceData*)m_instanceBuffer->getMappedMemory(frameInfo.frameIndex));
+
+    m_material->bindDescriptorSet(frameInfo);
+
+    m_quad->bind(frameInfo);
+    VkBuffer instanceBuffers[] = {m_instanceBuffer->getBuffer(frameInfo.frameIndex)};
+    VkDeviceSize offsets[] = {0};
+    api.cmdBindVertexBuffers(frameInfo.commandBuffer, 1, 1, instanceBuffers, offsets);
+
+    // one draw for the whole emitter
+    m_quad->draw(frameInfo, count);
+}
+
+}
+}
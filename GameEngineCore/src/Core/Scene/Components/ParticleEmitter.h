@@ -0,0 +1,53 @@
+#pragma once
+#include "Renderer.h"
+#include "ParticleSimulation.h"
+#include <cstdint>
+#include <memory>
+#include <glm/glm.hpp>
+#include "Core/Ressources/Mesh.h"
+#include "Core/Ressources/InstanceBuffer.h"
+#include "Core/Ressources/Pipeline.h"
+#include "Core/Renderer/Renderer.h"
+
+namespace Engine {
+namespace Components {
+
+// CPU particles, everything lives in the emitter (no entity per particle)
+// the simulation is a ParticleSimulation (structure of arrays updated 4 particles at once), they are all drawn with
+// one instanced draw
+// the particles are simulated in world space (moving the entity only moves where new ones spawn)
+class ParticleEmitter: public Renderer {
+public:
+    using Plane = ParticleSimulation::Plane;
+    using Settings = ParticleSimulation::Settings;
+    // binding 1, per instance
+    using InstanceData = ParticleSimulation::InstanceData;
+
+    // quad vertex + instance data, alpha blending and no depth write
+    static Ressources::PipelineConfigInfo defaultPipelineConfigInfo(std::string vertShaderPath, std::string fragShaderPath);
+
+    ParticleEmitter(std::shared_ptr<Ressources::Material> material, Settings settings);
+    ~ParticleEmitter();
+
+    void update(float dt) override;
+    void render(Engine::Renderer::Renderer::FrameInfo& frameInfo) override;
+
+    // spawn count particles now (on top of the emission rate), ignored when the pool is full
+    void emit(uint32_t count);
+    uint32_t getAliveCount() const { return m_simulation.getAliveCount(); };
+
+public:
+    Settings settings;
+
+private:
+    glm::vec3 getOrigin() const;
+
+private:
+    ParticleSimulation m_simulation;
+
+    std::unique_ptr<Ressources::Mesh> m_quad;
+    std::unique_ptr<Ressources::InstanceBuffer> m_instanceBuffer;
+};
+
+}
+}
@@ -0,0 +1,224 @@
+#include "ParticleSimulation.h"
+#include "Core/Utils/Simd.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+namespace Engine {
+namespace Components {
+
+using namespace Utils::Simd;
+
+ParticleSimulation::~ParticleSimulation() {
+    ::operator delete(m_pool, std::align_val_t(16));
+}
+
+void ParticleSimulation::reservePool(uint32_t maxParticles) {
+    if (!m_pool || m_capacity != ((maxParticles + 3) & ~3u)) {
+        allocatePool(maxParticles);
+    }
+}
+
+void ParticleSimulation::allocatePool(uint32_t capacity) {
+    // round up so the simd loops can always read 4 (the extra ones are never drawn)
+    uint32_t roundedCapacity = (capacity + 3) & ~3u;
+    size_t bytes = (size_t)roundedCapacity * StreamCount * sizeof(float);
+    float* pool = (float*)::operator new(bytes, std::align_val_t(16));
+    memset(pool, 0, bytes);
+
+    uint32_t kept = std::min(m_count, roundedCapacity);
+    if (m_pool) {
+        for (int s = 0; s < StreamCount; s++) {
+            memcpy(pool + (size_t)s * roundedCapacity, stream((Stream)s), kept * sizeof(float));
+        }
+        ::operator delete(m_pool, std::align_val_t(16));
+    }
+
+    m_pool = pool;
+    m_capacity = roundedCapacity;
+    m_count = kept;
+}
+
+// xorshift, good enough for particles and way cheaper than <random>
+float ParticleSimulation::random01() {
+    m_randomState ^= m_randomState << 13;
+    m_randomState ^= m_randomState >> 17;
+    m_randomState ^= m_randomState << 5;
+    return (m_randomState >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSimulation::update(const Settings& settings, float dt, glm::vec3 origin) {
+    reservePool(settings.maxParticles);
+
+    m_emissionAccumulator += settings.emissionRate * dt;
+    uint32_t toSpawn = (uint32_t)m_emissionAccumulator;
+    m_emissionAccumulator -= (float)toSpawn;
+    if (toSpawn > 0) {
+        spawn(settings, toSpawn, origin);
+    }
+
+    simulate(settings, dt);
+    collidePlanes(settings);
+    removeDead();
+}
+
+void ParticleSimulation::emit(const Settings& settings, uint32_t count, glm::vec3 origin) {
+    // maxParticles can have been raised since the last update
+    reservePool(settings.maxParticles);
+    spawn(settings, count, origin);
+}
+
+void ParticleSimulation::spawn(const Settings& settings, uint32_t count, glm::vec3 origin) {
+    // the pool is rounded up, what's above maxParticles is only there for the simd loops
+    uint32_t maxCount = std::min(settings.maxParticles, m_capacity);
+    count = std::min(count, maxCount - std::min(maxCount, m_count));
+
+    float* px = stream(PositionX); float* py = stream(PositionY); float* pz = stream(PositionZ);
+    float* vx = stream(VelocityX); float* vy = stream(VelocityY); float* vz = stream(VelocityZ);
+    float* age = stream(Age);
+    float* invLifetime = stream(InvLifetime);
+
+    for (uint32_t n = 0; n < count; n++) {
+        uint32_t i = m_count++;
+        px[i] = origin.x + (random01() * 2.0f - 1.0f) * settings.spawnHalfExtent.x;
+        py[i] = origin.y + (random01() * 2.0f - 1.0f) * settings.spawnHalfExtent.y;
+        pz[i] = origin.z + (random01() * 2.0f - 1.0f) * settings.spawnHalfExtent.z;
+        vx[i] = settings.initialVelocity.x + (random01() * 2.0f - 1.0f) * settings.velocitySpread.x;
+        vy[i] = settings.initialVelocity.y + (random01() * 2.0f - 1.0f) * settings.velocitySpread.y;
+        vz[i] = settings.initialVelocity.z + (random01() * 2.0f - 1.0f) * settings.velocitySpread.z;
+        age[i] = 0.0f;
+        float lifetime = settings.minLifetime + (settings.maxLifetime - settings.minLifetime) * random01();
+        invLifetime[i] = 1.0f / std::max(lifetime, 1e-4f);
+    }
+}
+
+// gravity, drag, integration and aging, 4 particles per iteration
+void ParticleSimulation::simulate(const Settings& settings, float dt) {
+    float* px = stream(PositionX); float* py = stream(PositionY); float* pz = stream(PositionZ);
+    float* vx = stream(VelocityX); float* vy = stream(VelocityY); float* vz = stream(VelocityZ);
+    float* age = stream(Age);
+
+    const Float4 gravityX = set1(settings.gravity.x * dt);
+    const Float4 gravityY = set1(settings.gravity.y * dt);
+    const Float4 gravityZ = set1(settings.gravity.z * dt);
+    const Float4 damping = set1(std::max(0.0f, 1.0f - settings.drag * dt));
+    const Float4 deltaTime = set1(dt);
+
+    for (uint32_t i = 0; i < m_count; i += 4) {
+        Float4 velocityX = (load(vx + i) + gravityX) * damping;
+        Float4 velocityY = (load(vy + i) + gravityY) * damping;
+        Float4 velocityZ = (load(vz + i) + gravityZ) * damping;
+        store(vx + i, velocityX);
+        store(vy + i, velocityY);
+        store(vz + i, velocityZ);
+
+        store(px + i, mulAdd(velocityX, deltaTime, load(px + i)));
+        store(py + i, mulAdd(velocityY, deltaTime, load(py + i)));
+        store(pz + i, mulAdd(velocityZ, deltaTime, load(pz + i)));
+
+        store(age + i, load(age + i) + deltaTime);
+    }
+}
+
+// particles are points, if one is behind a plane put it back on the plane and reflect the normal velocity
+void ParticleSimulation::collidePlanes(const Settings& settings) {
+    float* px = stream(PositionX); float* py = stream(PositionY); float* pz = stream(PositionZ);
+    float* vx = stream(VelocityX); float* vy = stream(VelocityY); float* vz = stream(VelocityZ);
+
+    const Float4 zero = set1(0.0f);
+
+    for (const Plane& plane : settings.planes) {
+        const Float4 nx = set1(plane.normal.x);
+        const Float4 ny = set1(plane.normal.y);
+        const Float4 nz = set1(plane.normal.z);
+        const Float4 planeDistance = set1(plane.distance);
+        const Float4 bounce = set1(plane.bounciness);
+        const Float4 tangentKeep = set1(1.0f - plane.friction);
+
+        for (uint32_t i = 0; i < m_count; i += 4) {
+            Float4 positionX = load(px + i), positionY = load(py + i), positionZ = load(pz + i);
+            Float4 velocityX = load(vx + i), velocityY = load(vy + i), velocityZ = load(vz + i);
+
+            Float4 distance = positionX * nx + positionY * ny + positionZ * nz - planeDistance;
+            Float4 normalVelocity = velocityX * nx + velocityY * ny + velocityZ * nz;
+
+            Float4 behind = lessThan(distance, zero);
+            Float4 hit = logicalAnd(behind, lessThan(normalVelocity, zero));
+
+            store(px + i, select(behind, positionX - nx * distance, positionX));
+            store(py + i, select(behind, positionY - ny * distance, positionY));
+            store(pz + i, select(behind, positionZ - nz * distance, positionZ));
+
+            // v = tangent * (1 - friction) - normal * bounciness
+            Float4 normalX = nx * normalVelocity, normalY = ny * normalVelocity, normalZ = nz * normalVelocity;
+            Float4 newVelocityX = (velocityX - normalX) * tangentKeep - normalX * bounce;
+            Float4 newVelocityY = (velocityY - normalY) * tangentKeep - normalY * bounce;
+            Float4 newVelocityZ = (velocityZ - normalZ) * tangentKeep - normalZ * bounce;
+
+            store(vx + i, select(hit, newVelocityX, velocityX));
+            store(vy + i, select(hit, newVelocityY, velocityY));
+            store(vz + i, select(hit, newVelocityZ, velocityZ));
+        }
+    }
+}
+
+// swap the dead ones with the last alive one, the order of particles doesn't matter
+void ParticleSimulation::removeDead() {
+    float* age = stream(Age);
+    float* invLifetime = stream(InvLifetime);
+
+    uint32_t i = 0;
+    while (i < m_count) {
+        if (age[i] * invLifetime[i] < 1.0f) {
+            i++;
+            continue;
+        }
+        uint32_t last = --m_count;
+        for (int s = 0; s < StreamCount; s++) {
+            float* data = stream((Stream)s);
+            data[i] = data[last];
+        }
+    }
+}
+
+void ParticleSimulation::writeInstances(const Settings& settings, InstanceData* destination) {
+    float* px = stream(PositionX); float* py = stream(PositionY); float* pz = stream(PositionZ);
+    float* age = stream(Age);
+    float* invLifetime = stream(InvLifetime);
+
+    // the channels are clamped and scaled to [0.5, 255.5] 4 at a time, the truncation then rounds them
+    const Float4 zero = set1(0.0f);
+    const Float4 one = set1(1.0f);
+    const Float4 scale = set1(255.0f);
+    const Float4 half = set1(0.5f);
+    auto channel = [&](Float4 start, Float4 delta, Float4 t) {
+        return mulAdd(min(max(mulAdd(delta, t, start), zero), one), scale, half);
+    };
+    const Float4 startR = set1(settings.startColor.r), deltaR = set1(settings.endColor.r - settings.startColor.r);
+    const Float4 startG = set1(settings.startColor.g), deltaG = set1(settings.endColor.g - settings.startColor.g);
+    const Float4 startB = set1(settings.startColor.b), deltaB = set1(settings.endColor.b - settings.startColor.b);
+    const Float4 startA = set1(settings.startColor.a), deltaA = set1(settings.endColor.a - settings.startColor.a);
+
+    alignas(16) float r[4], g[4], b[4], a[4];
+    for (uint32_t i = 0; i < m_count; i += 4) {
+        // color over life
+        Float4 t = min(load(age + i) * load(invLifetime + i), one);
+        store(r, channel(startR, deltaR, t));
+        store(g, channel(startG, deltaG, t));
+        store(b, channel(startB, deltaB, t));
+        store(a, channel(startA, deltaA, t));
+
+        uint32_t end = std::min(i + 4, m_count);
+        for (uint32_t j = i; j < end; j++) {
+            uint32_t k = j - i;
+            InstanceData& instance = destination[j];
+            instance.position = glm::vec3(px[j], py[j], pz[j]);
+            instance.size = settings.size;
+            instance.color = (uint32_t)r[k] | ((uint32_t)g[k] << 8) | ((uint32_t)b[k] << 16) | ((uint32_t)a[k] << 24);
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Engine {
+namespace Components {
+
+// the cpu side of the ParticleEmitter, no vulkan in here so it can be run (and timed) on its own
+// the particles are stored as structure of arrays (one array for x, one for y, ...) so the update
+// can do 4 particles at once with Utils::Simd
+// the particles are simulated in world space (origin is only where new ones spawn)
+class ParticleSimulation {
+public:
+    // dot(normal, position) = distance, particles stay on the side the normal points to
+    struct Plane {
+        glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        float distance = 0.0f;
+        float bounciness = 0.3f;
+        float friction = 0.1f; // part of the tangent velocity removed on each hit
+    };
+
+    struct Settings {
+        uint32_t maxParticles = 10000;
+        float emissionRate = 1000.0f; // particles per second
+
+        glm::vec3 spawnHalfExtent = glm::vec3(0.0f); // spawn inside a box around the origin
+        glm::vec3 initialVelocity = glm::vec3(0.0f, 5.0f, 0.0f);
+        glm::vec3 velocitySpread = glm::vec3(1.0f); // random in [-spread, spread] added to the initial velocity
+        float minLifetime = 1.0f;
+        float maxLifetime = 2.0f;
+        float size = 0.1f;
+
+        glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+        float drag = 0.1f; // velocity *= 1 - drag * dt
+
+        // color over life (linear between the two)
+        glm::vec4 startColor = glm::vec4(1.0f);
+        glm::vec4 endColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+
+        std::vector<Plane> planes;
+    };
+
+    // what the gpu gets for each particle
+    struct InstanceData {
+        glm::vec3 position;
+        float size;
+        uint32_t color; // RGBA8
+    };
+
+    ParticleSimulation() = default;
+    ~ParticleSimulation();
+    ParticleSimulation(const ParticleSimulation&) = delete;
+    ParticleSimulation& operator=(const ParticleSimulation&) = delete;
+
+    // the pool follows settings.maxParticles, it's reallocated by both when it changed
+    void update(const Settings& settings, float dt, glm::vec3 origin);
+    // spawn count particles now (on top of the emission rate), ignored when the pool is full
+    void emit(const Settings& settings, uint32_t count, glm::vec3 origin);
+
+    // getAliveCount() of them
+    void writeInstances(const Settings& settings, InstanceData* destination);
+    uint32_t getAliveCount() const { return m_count; };
+
+private:
+    void reservePool(uint32_t maxParticles);
+    void allocatePool(uint32_t capacity);
+    void spawn(const Settings& settings, uint32_t count, glm::vec3 origin);
+    void simulate(const Settings& settings, float dt);
+    void collidePlanes(const Settings& settings);
+    void removeDead();
+
+    float random01();
+
+private:
+    // all the streams are in one allocation, each one is m_capacity floats (multiple of 4, 16 bytes aligned)
+    enum Stream {
+        PositionX, PositionY, PositionZ,
+        VelocityX, VelocityY, VelocityZ,
+        Age, InvLifetime,
+        StreamCount
+    };
+    float* stream(Stream s) { return m_pool + (size_t)s * m_capacity; };
+
+    float* m_pool = nullptr;
+    uint32_t m_capacity = 0;
+    uint32_t m_count = 0;
+
+    float m_emissionAccumulator = 0.0f;
+    uint32_t m_randomState = 0x12345678u;
+};
+
+}
+}
@@ -68,6 +68,31 @@ glm::vec3 CubeCollider::findFurthestPoint(glm::vec3 dir) const{
     return maxPoint;
 };
 
+AABB SphereCollider::getWorldAABB() const {
+    glm::vec3 worldCenter = getWorldCenter();
+    glm::vec3 extent(getRadius());
+    return {worldCenter - extent, worldCenter + extent};
+};
+
+AABB CapsuleCollider::getWorldAABB() const {
+    glm::vec3 center1 = getWorldCenter1();
+    glm::vec3 center2 = getWorldCenter2();
+    glm::vec3 extent(getRadius());
+    return {glm::min(center1, center2) - extent, glm::max(center1, center2) + extent};
+};
+
+// called for every collider at every step: the corners are the center plus or minus the three half axes, so the box
+// around them is the world center plus or minus the sum of the absolute world half axes (no corner list to build)
+AABB CubeCollider::getWorldAABB() const {
+    glm::mat4 model = m_entity->getComponent<Transform>().value()->getModelMatrix();
+    glm::mat3 linear(model);
+    glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    glm::vec3 extent = glm::abs(linear * (forward * forwardHalfSize))
+        + glm::abs(linear * (up * upHalfSize))
+        + glm::abs(linear * (right * rightHalfSize));
+    return {worldCenter - extent, worldCenter + extent};
+};
+
 glm::vec3 calculateFaceNormal(
     const std::vector<uint32_t>& faceIndices,
     const std::vector<glm::vec3>& polyVertices) {
@@ -34,12 +34,30 @@ struct Polyhedron {
     std::vector<Face> faces;
 };
 
+// world space axis aligned box, used to skip pairs before running GJK
+struct AABB {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    bool overlaps(const AABB& other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    };
+    AABB merged(const AABB& other) const {
+        return {glm::min(min, other.min), glm::max(max, other.max)};
+    };
+    // grow the box so it covers where it will be after moving by displacement, plus a margin on every side
+    AABB swept(glm::vec3 displacement, float margin) const {
+        return {glm::min(min, min + displacement) - glm::vec3(margin), glm::max(max, max + displacement) + glm::vec3(margin)};
+    };
+};
+
 struct Collider : Component {
     Collider(ColliderType type):Component(), type(type) {};
     ColliderType type;
 
     virtual glm::vec3 findFurthestPoint(glm::vec3 dir)const =0;
     virtual Polyhedron getPolyhedron() const{};
+    virtual AABB getWorldAABB() const =0;
 };
 
 struct CubeCollider : Collider {
@@ -50,6 +68,7 @@ struct CubeCollider : Collider {
 
     glm::vec3 findFurthestPoint(glm::vec3 dir) const override;
     Polyhedron getPolyhedron() const override;
+    AABB getWorldAABB() const override;
 
     std::vector<glm::vec3> getAllVertices() const;
 public:
@@ -71,6 +90,7 @@ struct SphereCollider: Collider {
     float getRadius() const;
 
     glm::vec3 findFurthestPoint(glm::vec3 dir) const override;
+    AABB getWorldAABB() const override;
 private:
     glm::vec3 center;
     float radius;
@@ -85,6 +105,7 @@ struct CapsuleCollider: Collider {
     float getRadius() const;
 
     glm::vec3 findFurthestPoint(glm::vec3 dir) const override;
+    AABB getWorldAABB() const override;
 private:
     glm::vec3 center;
     glm::vec3 center2;
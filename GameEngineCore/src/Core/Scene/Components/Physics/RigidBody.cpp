@@ -1,12 +1,26 @@
 #include "RigidBody.h"
+#include "Core/Log/Log.h"
 #include "glm/gtx/quaternion.hpp"
 #include <iostream>
 
 namespace Engine {
 namespace Components {
 
+glm::mat3 diagonal(glm::vec3 vec);
+
 RigidBody::RigidBody(glm::vec3 centerOfMass, glm::vec3 bodyInv)
-    : Component(), m_IbodyInv(bodyInv), m_centerOfMass(centerOfMass) {}
+    : Component(), m_IbodyInv(diagonal(bodyInv)), m_centerOfMass(centerOfMass) {}
+
+RigidBody::RigidBody(Ressources::Mesh *mesh, float density)
+    : Component(), m_IbodyInv(1.0f), m_centerOfMass(0.0f), m_density(density) {
+  // just a copy of what the mesh already computed, nothing is integrated here
+  const Ressources::MassProperties &massProperties = mesh->getMassProperties();
+  AssertWarn(massProperties.valid, "RigidBody from a mesh without valid mass properties (not closed ?), using the defaults");
+  if (massProperties.valid) {
+    m_meshMassProperties = massProperties;
+    m_centerOfMass = massProperties.centerOfMass;
+  }
+}
 
 glm::vec3 RigidBody::InvInertiaCuboidDensity(float forwardSize, float upSize,
                                              float righSize) {
@@ -53,6 +67,13 @@ void RigidBody::updatePositionAndRotations(float dt){
 
 void RigidBody::start(){
   m_transform = m_entity->getComponent<Transform>().value();
+
+  if (m_meshMassProperties.has_value()) {
+    // the center of mass stays in mesh space (getWorldCenterOfMass uses the whole model matrix) but mass and inertia depend on the scale
+    Ressources::MassProperties scaled = m_meshMassProperties->scaled(m_transform->scale);
+    mass = scaled.getMass(m_density);
+    m_IbodyInv = glm::inverse(scaled.getInertiaTensor(m_density));
+  }
 }
 
 void RigidBody::update(float dt) {
@@ -67,7 +88,7 @@ void RigidBody::update(float dt) {
 void RigidBody::recomputeVariables() {
   glm::mat3 rotationMatrix = m_transform->getRotationMatrix();
   m_invInertiaTensor =
-      rotationMatrix * diagonal(m_IbodyInv) * glm::transpose(rotationMatrix);
+      rotationMatrix * m_IbodyInv * glm::transpose(rotationMatrix);
   m_Omega = m_invInertiaTensor * m_angularMomentum;
 };
 
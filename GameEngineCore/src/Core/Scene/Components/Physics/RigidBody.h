@@ -18,6 +18,7 @@
 #include "Core/Ressources/Mesh.h"
 #include <glm/glm.hpp>
 #include <memory>
+#include <optional>
 
 namespace Engine {
 namespace Components {
@@ -40,7 +41,9 @@ enum class ForceMode { Force, Impulse, Acceleration, VelocityChange };
 
 class RigidBody : public Component {
 public:
-  RigidBody(Ressources::Mesh *mesh);
+  // mass, center of mass and inertia come from the (cached) mass properties of the mesh
+  // the scale of the transform is applied in start()
+  RigidBody(Ressources::Mesh *mesh, float density = 1.0f);
   // com offset
   RigidBody(glm::vec3 centerOfMass, glm::vec3 bodyInv);
 
@@ -83,7 +86,10 @@ private:
 
 private:
   glm::vec3 m_centerOfMass;
-  glm::vec3 m_IbodyInv;
+  glm::mat3 m_IbodyInv; // not always diagonal when it comes from a mesh
+
+  std::optional<Ressources::MassProperties> m_meshMassProperties;
+  float m_density = 1.0f;
 
   glm::mat3 m_invInertiaTensor;
 
@@ -7,28 +7,38 @@
 #include "functional"
 
 namespace Engine {
+namespace Ressources {
+class Mesh;
+}
 namespace Components {
+class Transform;
 
 class Renderer: public Component {
 public:
-    static void SetModelBufferAllocator(std::function<uint32_t()> allocator);
-    static void SetModelBufferDeallocator(std::function<void(uint32_t)> deallocator);
-    
     Renderer(std::shared_ptr<Ressources::Material> material); 
     virtual ~Renderer();
 
     void update(float dt) override {};
     void start() override {};
 
-    virtual void render(Engine::Renderer::Renderer::FrameInfo& frameInfo) = 0;
-    uint32_t getModelBufferIndex() const { return m_modelBufferIndex; }
+    // renderers that only draw a mesh with the transform of their entity return it here, the DefaultRenderer
+    // then draws all the ones with the same mesh and material in one instanced draw and render() isn't called
+    virtual Ressources::Mesh* getInstancedMesh() { return nullptr; };
+    // for the ones that draw themselves (the pipeline of the material is already bound)
+    virtual void render(Engine::Renderer::Renderer::FrameInfo& frameInfo) {};
     std::weak_ptr<::Engine::Ressources::Material> getMaterial() { return m_material; }
+    // cached, looking it up in the entity goes through all the transforms of the scene
+    Transform* getTransform();
+
+    // level of detail of the instanced mesh drawn last frame, the DefaultRenderer picks it again every frame and only
+    // moves away from it past a margin so it doesn't flicker at the limit
+    uint32_t getLod() const { return m_lod; };
+    void setLod(uint32_t lod) { m_lod = lod; };
 
 protected:
     std::shared_ptr<::Engine::Ressources::Material> m_material;
-    uint32_t m_modelBufferIndex;
-    static std::function<uint32_t()> s_modelBufferAllocator;
-    static std::function<void(uint32_t)> s_modelBufferDeallocator;
+    Transform* m_transform = nullptr;
+    uint32_t m_lod = 0;
 };
 
 }
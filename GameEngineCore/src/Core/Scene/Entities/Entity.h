@@ -1,5 +1,6 @@
 #pragma once
 #include "Core/Scene/Scene.h"
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -61,6 +62,8 @@ public:
   UUID uuid;
   std::string name;
   std::vector<std::string> tags;
+  // 0 to 31, systems that filter by layer use the bit (1 << layer) (collision events for now)
+  uint32_t layer = 0;
 
 private:
 private:
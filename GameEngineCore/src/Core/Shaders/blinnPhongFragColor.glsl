@@ -1,8 +1,13 @@
 #version 450
 
-const uint numPointLights = 100;
 const uint numDirectionalLights = 10;
 
+// make numbers the same as in LightClusters
+const uint clusterCountX = 16;
+const uint clusterCountY = 9;
+const uint clusterCountZ = 24;
+const uint clusterCount = clusterCountX * clusterCountY * clusterCountZ;
+
 struct PointLight {
     vec4 pos;
     vec4 color;
@@ -25,10 +30,22 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
 layout(set = 0, binding = 1) uniform lightBufferObject {
     uint nbPointLights;
     uint nbDirectionalLights;
-    PointLight pointLights[numPointLights];
+    vec2 clusterTileSize;
+    float clusterSliceScale;
+    float clusterSliceBias;
     DirectionalLight directionalLights[numDirectionalLights];
 } lights;
 
+layout(set = 0, binding = 2) readonly buffer PointLightBuffer {
+    PointLight pointLights[];
+} pointLightBuffer;
+
+// the lights of cluster i are lightIndices[clusters[i].x, clusters[i].x + clusters[i].y)
+layout(set = 0, binding = 3) readonly buffer ClusterBuffer {
+    uvec2 clusters[clusterCount];
+    uint lightIndices[];
+} clusterBuffer;
+
 layout(set = 2, binding = 0) uniform Material {
     vec3 diffuse;
     float shininess;
@@ -41,8 +58,14 @@ layout(location = 0) out vec4 outColor;
 
 void main() {
     vec4 result = vec4(0.0, 0.0, 0.0, 1.0);
-    for (uint i = 0; i < lights.nbPointLights; i++) {
-        PointLight light = lights.pointLights[i];
+    // tile from the pixel, slice from the view depth (the slices are exponential)
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / lights.clusterTileSize), uvec2(clusterCountX - 1, clusterCountY - 1));
+    float slice = log(-inVertPos.z) * lights.clusterSliceScale + lights.clusterSliceBias;
+    uint sliceIndex = uint(clamp(slice, 0.0, float(clusterCountZ - 1)));
+    uvec2 cluster = clusterBuffer.clusters[tile.x + clusterCountX * (tile.y + clusterCountY * sliceIndex)];
+
+    for (uint i = cluster.x; i < cluster.x + cluster.y; i++) {
+        PointLight light = pointLightBuffer.pointLights[clusterBuffer.lightIndices[i]];
         vec4 lightViewPos = ubo.view * light.pos;
         vec4 lightDir = normalize(lightViewPos - inVertPos);
         float distance = distance(lightViewPos, inVertPos);
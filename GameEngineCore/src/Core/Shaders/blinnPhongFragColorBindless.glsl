@@ -0,0 +1,112 @@
+#version 450
+
+const uint numDirectionalLights = 10;
+
+// make numbers the same as in LightClusters
+const uint clusterCountX = 16;
+const uint clusterCountY = 9;
+const uint clusterCountZ = 24;
+const uint clusterCount = clusterCountX * clusterCountY * clusterCountZ;
+
+struct PointLight {
+    vec4 pos;
+    vec4 color;
+
+    float constantAttenuation;
+    float linearAttenuation;
+    float quadraticAttenuation;
+};
+
+struct DirectionalLight {
+    vec4 dir;
+    vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(set = 0, binding = 1) uniform lightBufferObject {
+    uint nbPointLights;
+    uint nbDirectionalLights;
+    vec2 clusterTileSize;
+    float clusterSliceScale;
+    float clusterSliceBias;
+    DirectionalLight directionalLights[numDirectionalLights];
+} lights;
+
+layout(set = 0, binding = 2) readonly buffer PointLightBuffer {
+    PointLight pointLights[];
+} pointLightBuffer;
+
+// the lights of cluster i are lightIndices[clusters[i].x, clusters[i].x + clusters[i].y)
+layout(set = 0, binding = 3) readonly buffer ClusterBuffer {
+    uvec2 clusters[clusterCount];
+    uint lightIndices[];
+} clusterBuffer;
+
+// every material is in the MaterialTable, make numbers the same as in MaterialTable
+const uint materialStride = 8; // in uvec4, the first one has the texture indices then the parameters
+
+layout(set = 2, binding = 0) readonly buffer MaterialBuffer {
+    uvec4 data[];
+} materialBuffer;
+
+struct Material {
+    vec3 diffuse;
+    float shininess;
+};
+
+layout(location = 0) in vec4 inVertPos;
+layout(location = 1) in vec4 inNormal;
+layout(location = 2) flat in uint inMaterialIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 parameters = uintBitsToFloat(materialBuffer.data[inMaterialIndex * materialStride + 1]);
+    Material material = Material(parameters.xyz, parameters.w);
+    vec4 result = vec4(0.0, 0.0, 0.0, 1.0);
+    // tile from the pixel, slice from the view depth (the slices are exponential)
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / lights.clusterTileSize), uvec2(clusterCountX - 1, clusterCountY - 1));
+    float slice = log(-inVertPos.z) * lights.clusterSliceScale + lights.clusterSliceBias;
+    uint sliceIndex = uint(clamp(slice, 0.0, float(clusterCountZ - 1)));
+    uvec2 cluster = clusterBuffer.clusters[tile.x + clusterCountX * (tile.y + clusterCountY * sliceIndex)];
+
+    for (uint i = cluster.x; i < cluster.x + cluster.y; i++) {
+        PointLight light = pointLightBuffer.pointLights[clusterBuffer.lightIndices[i]];
+        vec4 lightViewPos = ubo.view * light.pos;
+        vec4 lightDir = normalize(lightViewPos - inVertPos);
+        float distance = distance(lightViewPos, inVertPos);
+        float lambertian = max(dot(lightDir, inNormal), 0.0);
+        float specular = 0.0;
+
+        if (lambertian > 0) {
+            vec4 viewDir = normalize(-inVertPos);
+            vec4 halfDir = normalize(lightDir + viewDir);
+            float specAngle = max(dot(halfDir, inNormal), 0.0);
+            specular = pow(specAngle, material.shininess);
+        }
+
+        float attenuation = 1.0 / (light.constantAttenuation + light.linearAttenuation * distance +
+                    light.quadraticAttenuation * (distance * distance));
+
+        result += (lambertian * light.color * vec4(material.diffuse, 1.0) * specular) * attenuation;
+    }
+    for (uint i = 0; i < lights.nbDirectionalLights; i++) {
+        DirectionalLight light = lights.directionalLights[i];
+        float lambertian = max(dot(light.dir, inNormal), 0.0);
+        float specular = 0.0;
+
+        if (lambertian > 0) {
+            vec4 viewDir = normalize(-inVertPos);
+            vec4 halfDir = normalize(light.dir + viewDir);
+            float specAngle = max(dot(halfDir, inNormal), 0.0);
+            specular = pow(specAngle, material.shininess);
+        }
+
+        result += lambertian * light.color * vec4(material.diffuse, 1.0) * specular;
+    }
+    outColor = result;
+}
@@ -29,9 +29,17 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
 //     DirectionalLight directionalLights[numDirectionalLights];
 // } lights;
 
-layout(set = 1, binding = 0) uniform ModelUniformBufferObject {
+// per object data (std430), filled by the DefaultRenderer every frame
+// the renderers with the same mesh and material are next to each other, firstInstance is where a draw starts
+struct ObjectData {
     mat4 model;
-} modelUbo; // Declare as an array to use with dynamic offsets
+    mat4 normalMatrix; // transpose(inverse(model)), computed on the cpu once per object
+    uint materialIndex;
+};
+
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
 
 // layout(set = 2, binding = 0) uniform Material {
 //     vec3 diffuse;
@@ -43,13 +51,18 @@ layout(location = 1) in vec3 inNormal;
 
 layout(location = 0) out vec4 outVertPos;
 layout(location = 1) out vec4 outNormal;
+// only read by the bindless materials (MaterialTable)
+layout(location = 2) flat out uint outMaterialIndex;
 
 void main() {
-    vec4 worldPos = modelUbo.model * vec4(inPosition, 1.0); // Use index 0 since dynamic offset will handle the actual index
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    mat4 model = object.model;
+    vec4 worldPos = model * vec4(inPosition, 1.0);
     vec4 viewPos = ubo.view * worldPos;
     gl_Position = ubo.proj * viewPos;
     outVertPos = viewPos;
-    mat3 normalMatrix = mat3(transpose(inverse(modelUbo.model)));
+    mat3 normalMatrix = mat3(object.normalMatrix);
     vec3 rotatedNormal = normalize(normalMatrix * inNormal);
     outNormal = vec4(rotatedNormal, 0.0);
+    outMaterialIndex = object.materialIndex;
 }
@@ -0,0 +1,52 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// per object data (std430), filled by the DefaultRenderer every frame
+// the renderers with the same mesh and material are next to each other, firstInstance is where a draw starts
+struct ObjectData {
+    mat4 model;
+    mat4 normalMatrix; // transpose(inverse(model)), computed on the cpu once per object
+    uint materialIndex;
+};
+
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+// 16 bit unorm in the bounds of the mesh, object.model has the dequantization
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec4 outVertPos;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out vec2 outTexCoord;
+// only read by the bindless materials (MaterialTable)
+layout(location = 3) flat out uint outMaterialIndex;
+
+// octahedral normal (VertexQuantization), the lower half of the sphere was folded over the diagonals
+vec3 octDecode(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+    mat4 model = object.model;
+    vec4 worldPos = model * vec4(inPosition, 1.0);
+    vec4 viewPos = ubo.view * worldPos;
+    gl_Position = ubo.proj * viewPos;
+    outVertPos = viewPos;
+    mat3 normalMatrix = mat3(object.normalMatrix);
+    vec3 rotatedNormal = normalize(normalMatrix * octDecode(inNormal));
+    outNormal = vec4(rotatedNormal, 0.0);
+    outMaterialIndex = object.materialIndex;
+    outTexCoord = inTexCoord;
+}
@@ -0,0 +1,21 @@
+#version 450
+
+layout(set = 2, binding = 0) uniform Material {
+    vec4 tint;
+} material;
+
+layout(location = 0) in vec2 inUV;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // round particle with a soft edge
+    float distanceToCenter = length(inUV - 0.5) * 2.0;
+    float alpha = 1.0 - smoothstep(0.7, 1.0, distanceToCenter);
+    if (alpha <= 0.0) {
+        discard;
+    }
+    outColor = inColor * material.tint;
+    outColor.a *= alpha;
+}
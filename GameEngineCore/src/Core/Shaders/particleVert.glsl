@@ -0,0 +1,38 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// the object table of the meshes, not used (the particles are already in world space)
+// but it has to be declared so the pipeline layout has a set 1 like the others
+struct ObjectData {
+    mat4 model;
+    mat4 normalMatrix;
+    uint materialIndex;
+};
+
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+// quad corner from -0.5 to 0.5
+layout(location = 0) in vec2 inCorner;
+
+// per instance (ParticleEmitter::InstanceData)
+layout(location = 1) in vec4 inPositionSize;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec4 outColor;
+
+void main() {
+    vec4 viewPos = ubo.view * vec4(inPositionSize.xyz, 1.0);
+    // billboard : the corner is added in view space so the quad always faces the camera
+    viewPos.xy += inCorner * inPositionSize.w;
+    gl_Position = ubo.proj * viewPos;
+
+    outUV = inCorner + 0.5;
+    outColor = inColor;
+}
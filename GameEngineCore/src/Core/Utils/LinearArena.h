@@ -0,0 +1,91 @@
+#pragma once
+// a bump allocator: allocate() just moves a pointer forward, reset() gives everything back at once
+// blocks are kept between resets so once it has grown to the size of a frame/step it doesn't touch the heap anymore
+// | block 0 (full) | block 1 (full) | block 2 (cursor here)    |
+// nothing is destroyed on reset so only put trivially destructible things in it
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Core/Log/Log.h"
+
+namespace Engine {
+namespace Utils {
+
+class LinearArena {
+public:
+    LinearArena(size_t blockSize = 64 * 1024)
+    : m_blockSize(blockSize)
+    {
+    };
+
+    ~LinearArena()
+    {
+        for (Block& block : m_blocks){
+            ::operator delete(block.data, std::align_val_t(alignof(std::max_align_t)));
+        }
+    };
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        Assert(size <= m_blockSize, "Arena allocation bigger than the block size");
+
+        while (m_currentBlock < m_blocks.size()) {
+            Block& block = m_blocks[m_currentBlock];
+            size_t offset = (m_cursor + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.size) {
+                m_cursor = offset + size;
+                return block.data + offset;
+            }
+            // this block is full go to the next one (might already exist from a previous step)
+            m_currentBlock++;
+            m_cursor = 0;
+        }
+
+        Block block;
+        block.size = m_blockSize;
+        block.data = (char*)::operator new(m_blockSize, std::align_val_t(alignof(std::max_align_t)));
+        m_blocks.push_back(block);
+        m_cursor = size;
+        return block.data;
+    };
+
+    template<typename T, class... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "LinearArena never calls destructors, T must be trivially destructible");
+        void* memory = allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    };
+
+    // keep the blocks, just start again from the first one
+    void reset()
+    {
+        m_currentBlock = 0;
+        m_cursor = 0;
+    };
+
+    size_t capacity() const
+    {
+        return m_blocks.size() * m_blockSize;
+    };
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_currentBlock = 0;
+    size_t m_cursor = 0;
+};
+
+}
+}
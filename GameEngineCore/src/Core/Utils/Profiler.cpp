@@ -0,0 +1,217 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include "Core/Log/Log.h"
+
+namespace Engine {
+namespace Utils {
+
+static Profiler* instance = nullptr;
+static std::atomic<uint64_t> nextProfilerId{1};
+
+Profiler::Profiler()
+: m_id(nextProfilerId.fetch_add(1))
+{
+}
+
+void Profiler::Init() {
+    instance = new Profiler();
+}
+
+Profiler& Profiler::Instance() {
+    return *instance;
+}
+
+void Profiler::Shutdown() {
+    if (instance && instance->isCapturing()) {
+        std::lock_guard<std::mutex> lock(instance->m_mutex);
+        instance->merge();
+        instance->writeTrace();
+    }
+    delete instance;
+    instance = nullptr;
+}
+
+bool Profiler::IsEnabled() {
+    return instance != nullptr;
+}
+
+int64_t Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::RollingAverage::add(double sample) {
+    if (count == AVERAGE_FRAMES) {
+        sum -= samples[next];
+    } else {
+        count++;
+    }
+    samples[next] = sample;
+    sum += sample;
+    next = (next + 1) % AVERAGE_FRAMES;
+}
+
+void Profiler::beginFrame() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    merge();
+    for (auto& [key, stat] : m_stats) {
+        if (stat.inFrame) {
+            stat.average.add(stat.frameTotal);
+            stat.frameTotal = 0.0;
+            stat.inFrame = false;
+        }
+    }
+    uint64_t frame = m_frame.load(std::memory_order_relaxed) + 1;
+    m_frame.store(frame, std::memory_order_relaxed);
+
+    if (m_captureFrames > 0 && frame >= m_captureStart + m_captureFrames + GPU_LATENCY_FRAMES) {
+        writeTrace();
+    }
+}
+
+void Profiler::addScope(Track track, const char* name, int64_t start, int64_t end, uint64_t frame) {
+    ThreadBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.records.push_back({track, name, start, end, frame});
+}
+
+const char* Profiler::intern(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names.insert(name).first->c_str();
+}
+
+// the lock isn't held, it's only taken at the first scope of the thread. A thread that outlives the profiler finds
+// its buffer stale with the id
+Profiler::ThreadBuffer& Profiler::getThreadBuffer() {
+    thread_local uint64_t profilerId = 0;
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (profilerId != m_id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = m_threadBuffers.back().get();
+        buffer->thread = (uint32_t)m_threadBuffers.size() - 1;
+        profilerId = m_id;
+    }
+    return *buffer;
+}
+
+// the lock is held. Two literals with the same text (from different files) are the same scope
+const char* Profiler::canonicalName(const char* name) {
+    auto it = m_canonicalNames.find(name);
+    if (it != m_canonicalNames.end()) {
+        return it->second;
+    }
+    const char* canonical = m_names.insert(name).first->c_str();
+    m_canonicalNames.emplace(name, canonical);
+    return canonical;
+}
+
+// the lock is held, the threads only wait for their buffer while it's swapped
+void Profiler::merge() {
+    for (const std::unique_ptr<ThreadBuffer>& buffer : m_threadBuffers) {
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            buffer->records.swap(buffer->merging);
+        }
+
+        for (const Record& record : buffer->merging) {
+            const char* name = canonicalName(record.name);
+            Stat& stat = m_stats[{record.track, name}];
+            stat.frameTotal += (record.end - record.start) / 1e6;
+            stat.inFrame = true;
+
+            if (m_captureFrames > 0 && record.frame >= m_captureStart && record.frame < m_captureStart + m_captureFrames) {
+                uint32_t thread = record.track == Track::Cpu ? buffer->thread : 0;
+                m_traceEvents.push_back({record.track, name, record.start, record.end, thread});
+            }
+        }
+        buffer->merging.clear();
+    }
+}
+
+Profiler::Scope::Scope(const char* name)
+: m_name(name), m_start(Now()), m_frame(IsEnabled() ? Instance().getFrame() : 0)
+{
+}
+
+Profiler::Scope::~Scope() {
+    if (IsEnabled()) {
+        Instance().addScope(Track::Cpu, m_name, m_start, Now(), m_frame);
+    }
+}
+
+void Profiler::captureTrace(const std::string& path, uint32_t frameCount) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_captureFrames > 0) {
+        LogWarning("a trace is already being captured to ", m_capturePath);
+        return;
+    }
+    m_capturePath = path;
+    m_captureStart = m_frame.load(std::memory_order_relaxed) + 1;
+    m_captureFrames = frameCount;
+    m_traceEvents.clear();
+}
+
+std::vector<Profiler::Average> Profiler::getAverages() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Average> averages;
+    averages.reserve(m_stats.size());
+    for (const auto& [key, stat] : m_stats) {
+        if (stat.average.count > 0) {
+            averages.push_back({key.first, key.second, stat.average.get(), stat.average.last()});
+        }
+    }
+    // the stats are keyed by pointer, sorted by name for the log
+    std::sort(averages.begin(), averages.end(), [](const Average& a, const Average& b) {
+        return a.track != b.track ? a.track < b.track : a.name < b.name;
+    });
+    return averages;
+}
+
+void Profiler::logAverages() {
+    for (const Average& average : getAverages()) {
+        LogInfo(average.track == Track::Cpu ? "cpu " : "gpu ", average.name, " : ", average.milliseconds, " ms (last ", average.lastMilliseconds, " ms)");
+    }
+}
+
+static std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// the lock is held. The cpu threads are the threads of process 0 and the gpu queue the one of process 1, the times
+// are in microseconds
+void Profiler::writeTrace() {
+    std::ofstream file(m_capturePath);
+    if (!file) {
+        LogError("failed to write the trace to ", m_capturePath);
+        m_captureFrames = 0;
+        return;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"cpu\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"gpu\"}}";
+    for (const TraceEvent& event : m_traceEvents) {
+        file << ",\n{\"name\":\"" << escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":" << (event.track == Track::Cpu ? 0 : 1)
+             << ",\"tid\":" << event.thread << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+    }
+    file << "\n]}\n";
+
+    LogInfo("trace of ", m_captureFrames, " frames written to ", m_capturePath);
+    m_captureFrames = 0;
+    m_traceEvents.clear();
+}
+
+}
+}
@@ -0,0 +1,149 @@
+#pragma once
+// timings of the named scopes of the frame on the cpu and on the gpu (Renderer::GpuProfiler gives them here once
+// they are resolved), averaged over the last AVERAGE_FRAMES frames where they appear.
+// The gpu timestamps are moved to the cpu clock so a capture (captureTrace) shows both timelines side by side, it's
+// the json of chrome://tracing and perfetto.
+// The scopes go to a buffer of the thread that ends them (its lock is only shared with beginFrame), the main thread
+// merges them in beginFrame. Their names aren't copied: a literal or a name from intern, the totals are keyed by the
+// interned pointer
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+namespace Utils {
+
+class Profiler {
+public:
+    static constexpr uint32_t AVERAGE_FRAMES = 64;
+    // the gpu scopes come that many frames late at most, a capture waits for them before being written
+    static constexpr uint32_t GPU_LATENCY_FRAMES = 4;
+
+    enum class Track {
+        Cpu,
+        Gpu,
+    };
+
+    static void Init();
+    static Profiler& Instance();
+    // writes the capture still going
+    static void Shutdown();
+    static bool IsEnabled();
+
+    // nanoseconds of the steady clock, the time of every scope
+    static int64_t Now();
+
+    // the scopes ended before are part of the previous frame, called once per frame by the main thread
+    void beginFrame();
+    uint64_t getFrame() const { return m_frame.load(std::memory_order_relaxed); };
+
+    // can be called from any thread, frame is the one the scope was recorded in (the gpu ones are resolved later).
+    // name is a literal or comes from intern
+    void addScope(Track track, const char* name, int64_t start, int64_t end, uint64_t frame);
+    // a name made at runtime that lives as long as the profiler, the same text gives the same pointer. Takes the lock,
+    // keep what it returns instead of calling it for every scope
+    const char* intern(const std::string& name);
+
+    // a cpu scope, from the constructor to the destructor
+    class Scope {
+    public:
+        Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const char* m_name;
+        int64_t m_start;
+        uint64_t m_frame;
+    };
+
+    // the scopes of the next frameCount frames are written to path, for chrome://tracing or perfetto
+    void captureTrace(const std::string& path, uint32_t frameCount);
+    bool isCapturing() const { return m_captureFrames > 0; };
+
+    // the total of each scope per frame (a scope can be there several times in a frame)
+    struct Average {
+        Track track;
+        std::string name;
+        double milliseconds;
+        double lastMilliseconds;
+    };
+    std::vector<Average> getAverages();
+    void logAverages();
+
+private:
+    struct RollingAverage {
+        std::array<double, AVERAGE_FRAMES> samples{};
+        uint32_t next = 0;
+        uint32_t count = 0;
+        double sum = 0.0;
+
+        void add(double sample);
+        double get() const { return count ? sum / count : 0.0; };
+        double last() const { return count ? samples[(next + AVERAGE_FRAMES - 1) % AVERAGE_FRAMES] : 0.0; };
+    };
+
+    struct Stat {
+        RollingAverage average;
+        double frameTotal = 0.0; // summed until the end of the frame
+        bool inFrame = false;
+    };
+
+    struct Record {
+        Track track;
+        const char* name;
+        int64_t start;
+        int64_t end;
+        uint64_t frame;
+    };
+
+    // the scopes a thread ended since the last beginFrame
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Record> records;
+        std::vector<Record> merging; // swapped with records by beginFrame, both keep their capacity
+        uint32_t thread; // in the trace, by order of their first scope
+    };
+
+    struct TraceEvent {
+        Track track;
+        const char* name;
+        int64_t start;
+        int64_t end;
+        uint32_t thread; // cpu only
+    };
+
+    Profiler();
+
+    ThreadBuffer& getThreadBuffer();
+    const char* canonicalName(const char* name);
+    void merge();
+    void writeTrace();
+
+private:
+    uint64_t m_id; // tells the thread local buffers of a previous profiler apart
+    std::atomic<uint64_t> m_frame{0};
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+    std::unordered_set<std::string> m_names; // interned
+    std::unordered_map<const char*, const char*> m_canonicalNames; // a literal to the interned copy of its text
+    std::map<std::pair<Track, const char*>, Stat> m_stats;
+
+    std::string m_capturePath;
+    uint64_t m_captureStart = 0;
+    uint32_t m_captureFrames = 0; // 0 when not capturing
+    std::vector<TraceEvent> m_traceEvents;
+};
+
+}
+}
@@ -0,0 +1,107 @@
+#pragma once
+// very small 4 wide float wrapper so the hot loops (particles for now) can be written once
+// NEON on arm (apple silicon), SSE on x86 and a plain array if there is neither
+// only what is actually used is here, add things when you need them
+#include <cstdint>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ENGINE_SIMD_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define ENGINE_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Engine {
+namespace Utils {
+namespace Simd {
+
+struct Float4 {
+#if defined(ENGINE_SIMD_NEON)
+    float32x4_t v;
+#elif defined(ENGINE_SIMD_SSE)
+    __m128 v;
+#else
+    float v[4];
+#endif
+};
+
+// pointers given to load/store must be 16 bytes aligned
+
+inline Float4 load(const float* p) {
+#if defined(ENGINE_SIMD_NEON)
+    return {vld1q_f32(p)};
+#elif defined(ENGINE_SIMD_SSE)
+    return {_mm_load_ps(p)};
+#else
+    return {{p[0], p[1], p[2], p[3]}};
+#endif
+}
+
+inline void store(float* p, Float4 a) {
+#if defined(ENGINE_SIMD_NEON)
+    vst1q_f32(p, a.v);
+#elif defined(ENGINE_SIMD_SSE)
+    _mm_store_ps(p, a.v);
+#else
+    for (int i = 0; i < 4; i++) p[i] = a.v[i];
+#endif
+}
+
+inline Float4 set1(float x) {
+#if defined(ENGINE_SIMD_NEON)
+    return {vdupq_n_f32(x)};
+#elif defined(ENGINE_SIMD_SSE)
+    return {_mm_set1_ps(x)};
+#else
+    return {{x, x, x, x}};
+#endif
+}
+
+#if defined(ENGINE_SIMD_NEON)
+inline Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline Float4 min(Float4 a, Float4 b) { return {vminq_f32(a.v, b.v)}; }
+inline Float4 max(Float4 a, Float4 b) { return {vmaxq_f32(a.v, b.v)}; }
+// masks are all bits set where true
+inline Float4 lessThan(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vcltq_f32(a.v, b.v))}; }
+inline Float4 logicalAnd(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)))}; }
+// mask ? a : b
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return {vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v)}; }
+// one bit per lane (lane 0 is bit 0)
+inline int moveMask(Float4 mask) {
+    static const int32_t shifts[4] = {0, 1, 2, 3};
+    uint32x4_t bits = vshlq_u32(vshrq_n_u32(vreinterpretq_u32_f32(mask.v), 31), vld1q_s32(shifts));
+    return (int)vaddvq_u32(bits);
+}
+#elif defined(ENGINE_SIMD_SSE)
+inline Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Float4 min(Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Float4 max(Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline Float4 lessThan(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline Float4 logicalAnd(Float4 a, Float4 b) { return {_mm_and_ps(a.v, b.v)}; }
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))}; }
+inline int moveMask(Float4 mask) { return _mm_movemask_ps(mask.v); }
+#else
+#define ENGINE_SIMD_SCALAR_OP(name, expr) \
+    inline Float4 name(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) { float x = a.v[i]; float y = b.v[i]; r.v[i] = (expr); } return r; }
+ENGINE_SIMD_SCALAR_OP(operator+, x + y)
+ENGINE_SIMD_SCALAR_OP(operator-, x - y)
+ENGINE_SIMD_SCALAR_OP(operator*, x * y)
+ENGINE_SIMD_SCALAR_OP(min, x < y ? x : y)
+ENGINE_SIMD_SCALAR_OP(max, x > y ? x : y)
+#undef ENGINE_SIMD_SCALAR_OP
+inline Float4 lessThan(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? 1.0f : 0.0f; return r; }
+inline Float4 logicalAnd(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = (a.v[i] != 0.0f && b.v[i] != 0.0f) ? 1.0f : 0.0f; return r; }
+inline Float4 select(Float4 mask, Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i]; return r; }
+inline int moveMask(Float4 mask) { int r = 0; for (int i = 0; i < 4; i++) r |= (mask.v[i] != 0.0f) << i; return r; }
+#endif
+
+inline Float4 mulAdd(Float4 a, Float4 b, Float4 c) { return a * b + c; } // a * b + c
+
+}
+}
+}
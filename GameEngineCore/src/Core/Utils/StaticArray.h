@@ -237,6 +237,21 @@ public:
         return result;
     }
 
+    // same but fill a vector the caller keeps around (no allocation once it is big enough)
+    template<typename Base>
+    void getAllElementOfType(std::vector<Base*>& result){
+        result.clear();
+        std::type_index baseTypeId = std::type_index(typeid(Base));
+
+        for (auto& pair : m_arrays) {
+            if (baseTypeId == pair.first || isBaseOf<Base>(pair.second)) {
+                for (Base& element : *(StaticArray<Base>*)pair.second){
+                    result.push_back(&element);
+                }
+            }
+        }
+    }
+
     template<typename Base>
     std::vector<StaticArray<Base>*> getAllArraysOfType() {
         std::vector<StaticArray<Base>*> result;
@@ -0,0 +1,134 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace Engine {
+namespace Utils {
+
+ThreadPool& ThreadPool::Instance() {
+    static ThreadPool instance(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return instance;
+}
+
+ThreadPool::ThreadPool(uint32_t workerCount) {
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+// the parallelFor chunks go first, the main thread is waiting on them
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        Task task;
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&]() { return m_stop || m_generation != seenGeneration || !m_tasks.empty(); });
+            if (m_stop) {
+                return;
+            }
+            if (m_generation == seenGeneration) {
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            } else {
+                job = m_job;
+            }
+            seenGeneration = m_generation;
+        }
+
+        if (task) {
+            task();
+        } else {
+            runChunks(job, (uint32_t)seenGeneration);
+        }
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    if (m_workers.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_wakeUp.notify_one();
+}
+
+// a worker can wake up late, once the job it copied is done and the next one started: the generation in m_nextChunk
+// stops it from taking a chunk of the new job with the old one
+void ThreadPool::runChunks(const Job& job, uint32_t generation) {
+    uint64_t next = m_nextChunk.load();
+    while (true) {
+        uint32_t chunk = (uint32_t)next;
+        if ((uint32_t)(next >> 32) != generation || chunk >= job.chunkCount) {
+            return;
+        }
+        if (!m_nextChunk.compare_exchange_weak(next, next + 1)) {
+            continue;
+        }
+
+        uint32_t begin = chunk * job.chunkSize;
+        uint32_t end = std::min(begin + job.chunkSize, job.count);
+        (*job.func)(begin, end);
+
+        // the caller waits for every chunk, the job stays valid until this one is counted
+        if (m_finishedChunks.fetch_add(1) + 1 == job.chunkCount) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_one();
+        }
+        next = m_nextChunk.load();
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t minChunkSize, const RangeFunc& func) {
+    if (count == 0) {
+        return;
+    }
+
+    uint32_t chunkCount = std::min(getWorkerCount() + 1, count / std::max(1u, minChunkSize));
+    if (chunkCount <= 1) {
+        func(0, count);
+        return;
+    }
+
+    Job job;
+    job.func = &func;
+    job.count = count;
+    job.chunkSize = (count + chunkCount - 1) / chunkCount;
+    job.chunkCount = (count + job.chunkSize - 1) / job.chunkSize;
+
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = job;
+        m_generation++;
+        generation = (uint32_t)m_generation;
+        m_finishedChunks = 0;
+        m_nextChunk = (uint64_t)generation << 32;
+    }
+    m_wakeUp.notify_all();
+
+    runChunks(job, generation);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&]() { return m_finishedChunks.load() == job.chunkCount; });
+    m_job = Job{};
+}
+
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+// a few worker threads that stay alive for the whole app (creating threads every frame costs more than the work)
+// parallelFor splits a range in chunks that the workers and the calling thread take one after the other
+// submit queues longer jobs (loading) that the workers run when they have no parallelFor chunks
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+namespace Utils {
+
+class ThreadPool {
+public:
+    using RangeFunc = std::function<void(uint32_t begin, uint32_t end)>;
+    using Task = std::function<void()>;
+
+    // hardware_concurrency - 1 workers (the calling thread works too)
+    static ThreadPool& Instance();
+
+    ThreadPool(uint32_t workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // func is called on [begin, end) ranges covering [0, count), each at least minChunkSize long (except the last one)
+    // returns once everything is done, small counts just run on the calling thread
+    // one parallelFor at a time (it's only called from the main thread)
+    void parallelFor(uint32_t count, uint32_t minChunkSize, const RangeFunc& func);
+
+    // returns right away, task runs later on a worker (on the calling thread when there are no workers)
+    // can be called from any thread, the caller waits for its own tasks
+    void submit(Task task);
+
+    uint32_t getWorkerCount() const { return (uint32_t)m_workers.size(); };
+
+private:
+    struct Job {
+        const RangeFunc* func = nullptr;
+        uint32_t count = 0;
+        uint32_t chunkSize = 0;
+        uint32_t chunkCount = 0;
+    };
+
+    void workerLoop();
+    // the chunks of the job of that generation, nothing once a newer job started
+    void runChunks(const Job& job, uint32_t generation);
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    bool m_stop = false;
+    std::deque<Task> m_tasks;
+
+    // current job, the workers copy it with the generation under the lock
+    Job m_job;
+    // the generation of the job in the high 32 bits and its next chunk in the low ones, a worker only takes a chunk
+    // of the generation it copied the job of
+    std::atomic<uint64_t> m_nextChunk{0};
+    std::atomic<uint32_t> m_finishedChunks{0};
+};
+
+}
+}
@@ -52,13 +52,17 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 }
 
 
-Window::Window(const char* title, uint32_t width, uint32_t height) {
+Window::Window(const char* title, uint32_t width, uint32_t height, bool headless) {
     m_Title = title;
     m_Width = width;
     m_Height = height;
+    m_headless = headless;
 
-    initWindow();
+    if (!m_headless) {
+        initWindow();
+    }
     initVulkan();
+    // without a window no key is ever pressed
     Engine::Input::Init(m_window);
 };
 
@@ -93,7 +97,9 @@ void Window::initVulkan() {
     if (enableValidationLayers) {
         setupVulkanDebugMessenger();
     }
-    createSurface();
+    if (!m_headless) {
+        createSurface();
+    }
 };
 
 void Window::createVulkanInstance(){
@@ -121,7 +127,7 @@ void Window::createVulkanInstance(){
     const char** glfwExtensions;
 
 
-    std::vector<const char*> requiredExtensions = VulkanConfig::getRequiredExtensions();
+    std::vector<const char*> requiredExtensions = VulkanConfig::getRequiredExtensions(!m_headless);
 
     for(uint32_t i = 0; i < glfwExtensionCount; i++) {
         requiredExtensions.emplace_back(glfwExtensions[i]);
@@ -186,6 +192,9 @@ void Window::createSurface() {
 
 
 void Window::shutDownWindow() {
+    if (m_headless) {
+        return;
+    }
     if (m_window)
     {
         glfwDestroyWindow(m_window);
@@ -199,14 +208,23 @@ void Window::shutDownVulkan(){
         DestroyDebugUtilsMessengerEXT(m_instance, m_vulkanDebugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    if (m_surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    }
     vkDestroyInstance(m_instance, nullptr);
 }
 
 bool Window::shouldClose() {
+    // the headless runs stop after their frame count
+    if (m_headless) {
+        return false;
+    }
     return glfwWindowShouldClose(m_window); 
 }
 
 void Window::pollEvents() {
+    if (m_headless) {
+        return;
+    }
     glfwPollEvents();
 }
@@ -6,7 +6,8 @@
 
 class Window {
 public:
-    Window(const char* title, uint32_t width, uint32_t height);
+    // headless : no glfw window and no surface, VulkanApi renders in offscreen images of that size (CI, render farm)
+    Window(const char* title, uint32_t width, uint32_t height, bool headless = false);
     ~Window();
 
     void pollEvents();
@@ -16,6 +17,7 @@ public:
     VkSurfaceKHR getSurface() const { return m_surface; }
     GLFWwindow* getGLFWWindow() const { return m_window; }
     VkExtent2D getExtent() const { return {m_Width, m_Height}; }
+    bool isHeadless() const { return m_headless; }
 
     // Define callback type
     using ResizeCallback = std::function<void(int, int)>;
@@ -52,12 +54,13 @@ private:
     //const int MAX_FRAMES_IN_FLIGHT = 2;
 
 
-    GLFWwindow* m_window;
+    GLFWwindow* m_window = nullptr;
 
     VkInstance m_instance;
     VkDebugUtilsMessengerEXT m_vulkanDebugMessenger;
 
-    VkSurfaceKHR m_surface;
+    VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+    bool m_headless = false;
 
 
 #ifdef NDEBUG
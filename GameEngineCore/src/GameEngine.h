@@ -7,6 +7,10 @@
 #include "Core/Input.h"
 
 #include "Core/Ressources/RessourceManager.h"
+#include "Core/Ressources/MaterialTable.h"
+#include "Core/Ressources/TextureStreamer.h"
+
+#include "Core/Utils/Profiler.h"
 
 #include "Core/Scene/Scene.h"
 
@@ -15,10 +19,12 @@
 #include "Core/Scene/Components/DirectionalLight.h"
 #include "Core/Scene/Components/Renderer.h"
 #include "Core/Scene/Components/MeshRenderer.h"
+#include "Core/Scene/Components/ParticleEmitter.h"
 #include "Core/Scene/Components/PointLight.h"
 #include "Core/Scene/Components/Transform.h"
 #include "Core/Scene/Components/Physics/Colliders.h"
 #include "Core/Scene/Components/Physics/RigidBody.h"
+#include "Core/Collisions/CollisionEvents.h"
 
 #include "Core/Scene/Entities/Camera.h"
 #include "Core/Scene/Entities/Entity.h"
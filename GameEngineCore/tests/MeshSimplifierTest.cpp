@@ -0,0 +1,134 @@
+// MeshSimplifier on a closed unit sphere of about 8k triangles: the levels must stay close to the sphere (the
+// distance of the original vertices to the simplified surface) and the error it reports must be of the same order
+// as that distance, DefaultRenderer::selectLod switches the levels with it
+#include "Core/Ressources/MeshSimplifier.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <glm/glm.hpp>
+
+using Engine::Ressources::MeshSimplifier;
+
+// subdivisions of each face of the cube the sphere is made from, 6 * 2 * 26 * 26 = 8112 triangles
+static constexpr uint32_t FACE_SUBDIVISIONS = 26;
+
+struct Level {
+    float ratio; // of the triangles kept
+    float maxDeviation;
+};
+
+// a cube with its vertices pushed on the sphere, the vertices on the edges of the faces are shared so it's closed
+// (no border to lock) and the triangles are about the same size everywhere
+static void makeSphere(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+    std::map<std::array<int, 3>, uint32_t> vertexIndices;
+    auto vertex = [&](const glm::ivec3& grid) {
+        std::array<int, 3> key = {grid.x, grid.y, grid.z};
+        auto it = vertexIndices.find(key);
+        if (it != vertexIndices.end()) {
+            return it->second;
+        }
+        uint32_t index = (uint32_t)positions.size();
+        positions.push_back(glm::normalize(glm::vec3(grid) / (float)FACE_SUBDIVISIONS - 0.5f));
+        vertexIndices.emplace(key, index);
+        return index;
+    };
+
+    const int n = FACE_SUBDIVISIONS;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int side = 0; side < 2; side++) {
+            // u and v go around the face so that u x v points out of the cube
+            glm::ivec3 normal(0), u(0), v(0);
+            normal[axis] = 1;
+            u[(axis + 1) % 3] = 1;
+            v[(axis + 2) % 3] = 1;
+            glm::ivec3 origin = normal * (side * n);
+            if (side == 0) {
+                std::swap(u, v);
+            }
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    uint32_t a = vertex(origin + u * i + v * j);
+                    uint32_t b = vertex(origin + u * (i + 1) + v * j);
+                    uint32_t c = vertex(origin + u * (i + 1) + v * (j + 1));
+                    uint32_t d = vertex(origin + u * i + v * (j + 1));
+                    indices.insert(indices.end(), {a, b, c, a, c, d});
+                }
+            }
+        }
+    }
+}
+
+static float distanceToTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    // Ericson, Real-Time Collision Detection 5.1.5
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return glm::length(p - a);
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return glm::length(p - b);
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return glm::length(p - c);
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+    float denominator = 1.0f / (va + vb + vc);
+    return glm::length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+}
+
+// the farthest original vertex from the simplified surface
+static float maxDeviation(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+    float deviation = 0.0f;
+    for (const glm::vec3& p : positions) {
+        float closest = INFINITY;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            closest = std::min(closest, distanceToTriangle(p, positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]));
+        }
+        deviation = std::max(deviation, closest);
+    }
+    return deviation;
+}
+
+int main() {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    makeSphere(positions, indices);
+
+    // what the greedy order gives on this sphere, with some margin
+    const Level levels[] = {
+        {0.10f, 0.03f},
+        {0.02f, 0.12f},
+    };
+
+    bool passed = true;
+    for (const Level& level : levels) {
+        size_t target = (size_t)(indices.size() / 3 * level.ratio) * 3;
+        float error = 0.0f;
+        std::vector<uint32_t> lod = MeshSimplifier::simplify(positions.data(), positions.size(), indices, target, error);
+        float deviation = maxDeviation(positions, lod);
+        std::cout << indices.size() / 3 << " -> " << lod.size() / 3 << " triangles : max deviation " << deviation
+                  << ", reported error " << error << std::endl;
+
+        if (lod.size() > target * 11 / 10) {
+            std::cerr << "  stopped at " << lod.size() / 3 << " triangles for a target of " << target / 3 << std::endl;
+            passed = false;
+        }
+        if (deviation > level.maxDeviation) {
+            std::cerr << "  deviation above " << level.maxDeviation << std::endl;
+            passed = false;
+        }
+        // the quadrics sum squared distances to planes, not exactly the distance to the surface
+        if (error < deviation * 0.25f || error > deviation * 4.0f) {
+            std::cerr << "  the reported error isn't of the order of the deviation" << std::endl;
+            passed = false;
+        }
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
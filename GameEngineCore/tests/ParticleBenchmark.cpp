@@ -0,0 +1,79 @@
+// ParticleSimulation with 1M particles at 60 Hz, the pool kept full by the emission rate with a ground plane to bounce
+// on : the update and the write of the instances of every frame are timed against the 16.6 ms of a frame.
+// Before that, emit() right after maxParticles is raised must grow the pool and stop at the new maximum.
+//   ParticleBenchmark [frames]
+#include "Core/Scene/Components/ParticleSimulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Engine::Components::ParticleSimulation;
+
+static constexpr uint32_t PARTICLE_COUNT = 1000000;
+static constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+static bool checkRaisedMaxParticles() {
+    ParticleSimulation simulation;
+    ParticleSimulation::Settings settings;
+    settings.maxParticles = 100;
+    simulation.update(settings, FRAME_TIME, glm::vec3(0.0f));
+
+    settings.maxParticles = 1000;
+    simulation.emit(settings, 5000, glm::vec3(0.0f));
+    if (simulation.getAliveCount() != settings.maxParticles) {
+        std::cerr << "emit after raising maxParticles spawned " << simulation.getAliveCount() << " particles for a maximum of "
+                  << settings.maxParticles << std::endl;
+        return false;
+    }
+
+    std::vector<ParticleSimulation::InstanceData> instances(simulation.getAliveCount());
+    simulation.writeInstances(settings, instances.data());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t frameCount = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 600;
+
+    if (!checkRaisedMaxParticles()) {
+        return EXIT_FAILURE;
+    }
+
+    ParticleSimulation simulation;
+    ParticleSimulation::Settings settings;
+    settings.maxParticles = PARTICLE_COUNT;
+    settings.minLifetime = 1.0f;
+    settings.maxLifetime = 2.0f;
+    // as many spawned as dying, what's above the maximum is dropped
+    settings.emissionRate = PARTICLE_COUNT / 1.5f;
+    settings.spawnHalfExtent = glm::vec3(5.0f, 0.0f, 5.0f);
+    settings.velocitySpread = glm::vec3(3.0f);
+    settings.planes.push_back({});
+
+    std::vector<ParticleSimulation::InstanceData> instances(PARTICLE_COUNT);
+    simulation.emit(settings, PARTICLE_COUNT, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    using Clock = std::chrono::steady_clock;
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    uint64_t aliveSum = 0;
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        Clock::time_point start = Clock::now();
+        simulation.update(settings, FRAME_TIME, glm::vec3(0.0f, 1.0f, 0.0f));
+        simulation.writeInstances(settings, instances.data());
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+        aliveSum += simulation.getAliveCount();
+    }
+
+    double averageMs = totalMs / std::max(frameCount, 1u);
+    std::cout << frameCount << " frames, " << aliveSum / std::max(frameCount, 1u) << " particles alive on average : "
+              << averageMs << " ms per frame (worst " << worstMs << " ms), " << averageMs / (FRAME_TIME * 1000.0f) * 100.0f
+              << "% of a 60 Hz frame" << std::endl;
+    // only a report, the time depends on the machine
+    return EXIT_SUCCESS;
+}
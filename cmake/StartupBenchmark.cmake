@@ -0,0 +1,48 @@
+# Cold and warm startup of the game: the first launch of each run clears the pipeline and reflection caches, the second
+# one loads what the first saved. Both are headless and stop once the pipelines of the scene are built, the best time
+# of the runs is reported for each.
+# Run from the build directory, the caches are written there:
+#   cmake -DGAME_EXECUTABLE=bin/Game [-DRUNS=5] -P ../cmake/StartupBenchmark.cmake
+# or cmake --build . --target StartupBenchmark
+
+if(NOT GAME_EXECUTABLE)
+    message(FATAL_ERROR "GAME_EXECUTABLE is not set")
+endif()
+if(NOT RUNS)
+    set(RUNS 3)
+endif()
+
+# sets the startup milliseconds printed by --startup-report in outVar
+function(run_startup outVar)
+    execute_process(
+        COMMAND "${GAME_EXECUTABLE}" --headless --frames 0 --startup-report ${ARGN}
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${GAME_EXECUTABLE} failed (${result}):\n${output}${errors}")
+    endif()
+    string(REGEX MATCH "startup ([0-9.]+) ms [^\n]*" line "${output}")
+    if(NOT line)
+        message(FATAL_ERROR "no startup report in the output of ${GAME_EXECUTABLE}:\n${output}")
+    endif()
+    message(STATUS "  ${line}")
+    set(${outVar} ${CMAKE_MATCH_1} PARENT_SCOPE)
+endfunction()
+
+set(bestCold "")
+set(bestWarm "")
+foreach(run RANGE 1 ${RUNS})
+    message(STATUS "run ${run}/${RUNS}")
+    run_startup(cold --clear-caches)
+    run_startup(warm)
+    if(bestCold STREQUAL "" OR cold LESS bestCold)
+        set(bestCold ${cold})
+    endif()
+    if(bestWarm STREQUAL "" OR warm LESS bestWarm)
+        set(bestWarm ${warm})
+    endif()
+endforeach()
+
+message(STATUS "cold startup ${bestCold} ms, warm startup ${bestWarm} ms (best of ${RUNS})")
@@ -0,0 +1,48 @@
+@echo off
+
+:: Get the directory where the script is located
+set "SCRIPT_DIR=%~dp0"
+set "ROOT_DIR=%SCRIPT_DIR%.."
+
+:: Default configuration
+set "CONFIG=Debug"
+:: json of the vulkan driver of the headless tests, the default driver when empty
+set "LAVAPIPE_ICD="
+
+:: Process command line arguments
+:arg_loop
+if "%1" == "" goto arg_done
+if "%1" == "--config" (
+    set "CONFIG=%2"
+    shift
+    shift
+    goto arg_loop
+)
+if "%1" == "--lavapipe" (
+    set "LAVAPIPE_ICD=%~2"
+    shift
+    shift
+    goto arg_loop
+)
+echo Unknown option: %1
+exit /b 1
+:arg_done
+
+cd "%ROOT_DIR%\build"
+cmake -DLAVAPIPE_ICD="%LAVAPIPE_ICD%" .
+cmake --build . --config %CONFIG%
+
+if %ERRORLEVEL% neq 0 (
+    echo Build failed!
+    exit /b 1
+)
+
+:: the simplifier and particle tests, then the headless captures of the sample scene on both culling paths
+ctest -C %CONFIG% --output-on-failure
+
+if %ERRORLEVEL% neq 0 (
+    echo Tests failed!
+    exit /b 1
+)
+
+echo Tests passed!
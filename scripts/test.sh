@@ -0,0 +1,47 @@
+#!/bin/bash
+
+# Get the directory where the script is located
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+ROOT_DIR="$SCRIPT_DIR/.."
+
+# Default configuration
+CONFIG="Debug"
+# json of the vulkan driver of the headless tests, e.g. /usr/share/vulkan/icd.d/lvp_icd.x86_64.json for lavapipe
+LAVAPIPE_ICD=""
+
+# Process command line arguments
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --config)
+            CONFIG="$2"
+            shift 2
+            ;;
+        --lavapipe)
+            LAVAPIPE_ICD="$2"
+            shift 2
+            ;;
+        *)
+            echo "Unknown option: $1"
+            exit 1
+            ;;
+    esac
+done
+
+cd "$ROOT_DIR/build"
+cmake -DLAVAPIPE_ICD="$LAVAPIPE_ICD" .
+cmake --build . --config "$CONFIG"
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+# the simplifier and particle tests, then the headless captures of the sample scene on both culling paths
+ctest -C "$CONFIG" --output-on-failure
+
+if [ $? -ne 0 ]; then
+    echo "Tests failed!"
+    exit 1
+fi
+
+echo "Tests passed!"